@@ -0,0 +1,130 @@
+/**
+ *  air.c
+ * 
+ *  DESCRIPTION: DxWiFi virtual air interface program. Hosts the shared memory
+ *  medium that tx and rx programs attach to with --air and reports on every
+ *  station attached to it
+ * 
+ *  https://github.com/oresat/oresat-dxwifi-software
+ * 
+ */
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <signal.h>
+
+#include <dxwifi/air/cli.h>
+
+#include <libdxwifi/details/air.h>
+#include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/daemon.h>
+#include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/syslogger.h>
+
+
+static volatile sig_atomic_t running = true;
+
+
+/**
+ *  DESCRIPTION:    Signals to the report loop to close out
+ * 
+ *  ARGUMENTS:
+ * 
+ *      signum:     Received signal
+ * 
+ */
+static void stop_handler(int signum) {
+    running = false;
+}
+
+
+static const char* role_to_str(uint32_t role) {
+    switch (role)
+    {
+    case DXWIFI_AIR_TRANSMITTER:    return "tx";
+    case DXWIFI_AIR_RECEIVER:       return "rx";
+    default:                        return "monitor";
+    }
+}
+
+
+/**
+ *  DESCRIPTION:    Logs the counters of every station attached to the medium
+ * 
+ *  ARGUMENTS:
+ * 
+ *      air:        Handle attached as a monitor
+ * 
+ *      name:       Name of the medium
+ * 
+ */
+static void log_stations(dxwifi_air* air, const char* name) {
+    dxwifi_air_station stations[DXWIFI_AIR_MAX_STATIONS];
+    size_t count = dxwifi_air_stations(air, stations, NELEMS(stations));
+
+    char report[4096];
+    int len = snprintf(report, sizeof(report), "Air interface %s, %" PRIu64 " frames sent\n\t%-8s %-8s %10s %12s %8s %10s %9s %12s %12s",
+        name, dxwifi_air_frames_sent(air), "PID", "Role", "Frames", "Bytes", "Lost", "Corrupted", "Overruns", "Blocked(ms)", "Latency(us)");
+
+    for(size_t i = 0; i < count && len < (int) sizeof(report); ++i) {
+        const dxwifi_air_station* station = &stations[i];
+        len += snprintf(report + len, sizeof(report) - len, "\n\t%-8d %-8s %10" PRIu64 " %12" PRIu64 " %8" PRIu64 " %10" PRIu64 " %9" PRIu64 " %12" PRIu64 " %12" PRIu64,
+            station->pid, role_to_str(station->role), station->frames, station->bytes, station->lost, 
+            station->corrupted, station->overruns, station->blocked_us / 1000,
+            station->frames ? station->latency_us / station->frames : 0);
+    }
+    log_info("%s", report);
+}
+
+
+int main(int argc, char** argv) {
+    cli_args args = DEFAULT_CLI_ARGS;
+
+    parse_args(argc, argv, &args);
+
+    set_log_level(DXWIFI_LOG_ALL_MODULES, args.verbosity);
+
+    if(args.use_syslog) {
+        set_logger(DXWIFI_LOG_ALL_MODULES, syslogger);
+    }
+    if(args.daemon) {
+        daemon_run(args.pid_file, args.daemon);
+    }
+
+    bool created = dxwifi_air_create(args.name, args.slots);
+    assert_M(created, "Failed to create air interface %s", args.name);
+
+    dxwifi_air air = { .channel = DXWIFI_AIR_CHANNEL_CLEAR };
+    bool attached = dxwifi_air_attach(&air, args.name, DXWIFI_AIR_MONITOR);
+    assert_M(attached, "Failed to attach to air interface %s", args.name);
+
+    struct sigaction action = { 0 };
+    action.sa_handler = stop_handler;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    while(running) {
+        // Interrupted by the signal that ends the loop
+        struct timespec interval = { .tv_sec = args.interval ? args.interval : 3600, .tv_nsec = 0 };
+        nanosleep(&interval, NULL);
+
+        if(running && args.interval) {
+            log_stations(&air, args.name);
+        }
+    }
+    log_stations(&air, args.name);
+
+    dxwifi_air_detach(&air);
+    if(!args.keep) {
+        dxwifi_air_remove(args.name);
+    }
+
+    if(args.daemon == DAEMON_START) { // This process is the daemon, tear it down
+        stop_daemon(args.pid_file);
+    }
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+/**
+ *  cli.c
+ *  
+ *  DESCRIPTION: Command line interface for air.c
+ * 
+ *  https://github.com/oresat/oresat-dxwifi-software
+ * 
+ */
+
+#include <argp.h>
+#include <stdlib.h>
+
+#include <dxwifi/air/cli.h>
+
+#include <libdxwifi/details/logging.h>
+
+#define PRIMARY_GROUP   0
+#define HELP_GROUP      500
+
+
+const char* argp_program_version = DXWIFI_VERSION;
+
+// Description of key arguments 
+static char args_doc[] = "[name]";
+
+// Program description
+static char doc[] = 
+    "Host a virtual air interface that tx and rx attach to with --air, and report on every station attached. "
+    "The medium is removed on exit";
+
+// Available command line options 
+static struct argp_option opts[] = { 
+    { "slots",      'n', "<number>",        0, "Number of frames the medium holds, receivers further behind lose frames",      PRIMARY_GROUP },
+    { "interval",   'i', "<seconds>",       0, "Seconds between station reports, 0 to only report on exit",                    PRIMARY_GROUP },
+    { "keep",       'k', 0,                 0, "Leave the medium in place on exit",                                            PRIMARY_GROUP },
+    { "daemon",     'D', "<start|stop>",    0, "Run the air program as a forked daemon process (Sets logger to syslog as well)", PRIMARY_GROUP },
+    { "pid-file",   'P', "<file-path>",     0, "Location of the Daemon's PID File",                                            PRIMARY_GROUP },
+
+    { 0, 0, 0, 0, "Help options", HELP_GROUP },
+    { "verbose", 'v', 0, 0, "Verbosity level",              HELP_GROUP },
+    { "syslog",  's', 0, 0, "Use SysLog for messages",      HELP_GROUP }, 
+    { "quiet",   'q', 0, 0, "Silence any output",           HELP_GROUP },
+
+    { 0 } // Final zero field is required by argp
+};
+
+
+static error_t parse_opt(int key, char* arg, struct argp_state *state) {
+
+    error_t status = 0;
+    cli_args* args = (cli_args*) state->input;
+
+    switch (key)
+    {
+    case ARGP_KEY_ARG:
+        if(state->arg_num >= 1) {
+            argp_usage(state);
+        }
+        args->name = arg;
+        break;
+
+    case ARGP_KEY_END:
+        if(args->quiet) {
+            args->verbosity = 0;
+        }
+        break;
+
+    case 'n':
+        args->slots = strtoul(arg, NULL, 0);
+        if(args->slots == 0) {
+            argp_error(state, "The medium needs at least one slot");
+        }
+        break;
+
+    case 'i':
+        args->interval = atoi(arg);
+        break;
+
+    case 'k':
+        args->keep = true;
+        break;
+
+    case 'D':
+        args->daemon = str_to_daemon_cmd(arg);
+        break;
+
+    case 'P':
+        args->pid_file = arg;
+        break;
+
+    case 'v':
+        ++args->verbosity;
+        break;
+
+    case 's':
+        args->use_syslog = true;
+        break;
+
+    case 'q':
+        args->quiet = true;
+        break;
+
+    default:
+        status = ARGP_ERR_UNKNOWN;
+        break;
+    }
+    return status;
+}
+
+
+static struct argp argparser = { 
+    .options        = opts, 
+    .parser         = parse_opt, 
+    .args_doc       = args_doc, 
+    .doc            = doc, 
+    .children       = 0, 
+    .help_filter    = 0,
+    .argp_domain    = 0
+};
+
+
+int parse_args(int argc, char** argv, cli_args* out) {
+
+    return argp_parse(&argparser, argc, argv, 0, 0, out);
+
+}
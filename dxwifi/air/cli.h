@@ -0,0 +1,62 @@
+/**
+ *  cli.h
+ *  
+ *  DESCRIPTION: Command line interface for air.c
+ * 
+ *  https://github.com/oresat/oresat-dxwifi-software
+ * 
+ */
+
+
+#include <libdxwifi/details/air.h>
+#include <libdxwifi/details/daemon.h>
+#include <libdxwifi/details/logging.h>
+
+
+#define AIR_DEFAULT_PID_FILE "/run/oresat-dxwifi-aird.pid"
+
+
+typedef struct {
+    dxwifi_daemon_cmd_t daemon;
+    const char*         pid_file;
+    const char*         name;
+    size_t              slots;
+    unsigned            interval;
+    bool                keep;
+    int                 verbosity;
+    bool                quiet;
+    bool                use_syslog;
+} cli_args;
+
+
+#define DEFAULT_CLI_ARGS {\
+        .daemon         = DAEMON_UNKNOWN_CMD,\
+        .pid_file       = AIR_DEFAULT_PID_FILE,\
+        .name           = DXWIFI_AIR_DFLT_NAME,\
+        .slots          = DXWIFI_AIR_DFLT_SLOTS,\
+        .interval       = 5,\
+        .keep           = false,\
+        .verbosity      = DXWIFI_LOG_INFO,\
+        .quiet          = false,\
+        .use_syslog     = false\
+    }\
+
+
+/**
+ *  DESCRIPTION:    Parse command line arguments into the cli_args struct
+ * 
+ *  ARGUMENTS:
+ * 
+ *      argc:       Number of command line arguments
+ * 
+ *      argv:       list of arguments
+ * 
+ *      out:        Pointer to allocated cli_args structure.
+ * 
+ *  RETURNS:
+ *      
+ *      int:        0 if arguments were parsed successfully
+ *     
+ *  
+ */
+int parse_args(int argc, char** argv, cli_args* out);
@@ -18,15 +18,21 @@
 const char* argp_program_version = DXWIFI_VERSION;
 
 // Description of key arguments 
-static char args_doc[] = "input-file";
+static char args_doc[] = "input-file(s)";
 
 // Program description
 static char doc[] = 
-    "FEC Decode input-file and output to file or stdout";
+    "FEC Decode input-file and output to file or stdout. Given several captures"
+    " of the same object, from different passes or ground stations, their frames"
+    " are merged and decoded together. Inputs may be raw captures or archives"
+    " written by rx --archive";
 
 // Available command line options 
 static struct argp_option opts[] = {
     { "output",         'o', "<path>",              0, "Output file path",                                   PRIMARY_GROUP },
+    { "object",         'i', "<id>",                0, "Only decode this object from archives",              PRIMARY_GROUP },
+    { "list",           'l', 0,                     0, "List the objects held in archives and exit",         PRIMARY_GROUP },
+    { "jobs",           'j', "<n>",                 0, "Worker threads besides the main one (default: one per extra CPU)", PRIMARY_GROUP },
 
     { 0, 0, 0, 0, "Help Options", HELP_GROUP },
     { "verbose",    'v', 0, 0, "Verbosity level",           HELP_GROUP },
@@ -40,6 +46,7 @@ static struct argp_option opts[] = {
 static error_t parse_opt(int key, char* arg, struct argp_state *state) {
 
     error_t status = 0;
+    char* end = NULL;
     cli_args* args = (cli_args*) state->input;
 
     switch (key)
@@ -51,14 +58,15 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
         break;
 
     case ARGP_KEY_ARG:
-        if(state->arg_num > 0) {
-            argp_usage(state);
+        if(state->arg_num >= DECODE_CLI_FILE_MAX) {
+            argp_error(state, "Error: At most %d input files can be merged", DECODE_CLI_FILE_MAX);
         }
         else if (!is_regular_file(arg)){
             argp_error(state, "Error: Input file must be a regular file");
         }
         else {
-            args->file_in = arg;
+            args->files[args->file_count++] = arg;
+            args->file_in = args->files[0];
         }
         break;
 
@@ -66,6 +74,24 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
         args->file_out = arg;
         break;
 
+    case 'i':
+        args->object_id = strtoul(arg, &end, 0);
+        if(*end != '\0' || args->object_id == 0) {
+            argp_error(state, "Error: Object id must be a non-zero number");
+        }
+        break;
+
+    case 'l':
+        args->list = true;
+        break;
+
+    case 'j':
+        args->jobs = strtol(arg, &end, 0);
+        if(*end != '\0' || args->jobs < 0 || args->jobs > DXWIFI_POOL_MAX_WORKERS) {
+            argp_error(state, "Error: Jobs must be between 0 and %d", DXWIFI_POOL_MAX_WORKERS);
+        }
+        break;
+
     case 'v':
         ++args->verbosity;
         break;
@@ -2,12 +2,23 @@
  *  cli.h - Command line interface for `decode`
  */
 
+#include <stdint.h>
 #include <stdbool.h>
 
+#include <libdxwifi/details/threadpool.h>
+
+// Max number of captures that can be merged at once
+#define DECODE_CLI_FILE_MAX 1024
+
 
 typedef struct {
     const char* file_in;
+    const char* files[DECODE_CLI_FILE_MAX];
+    int         file_count;
     const char* file_out;
+    uint32_t    object_id;
+    bool        list;
+    int         jobs;
     int         verbosity;
     bool        quiet;
 } cli_args;
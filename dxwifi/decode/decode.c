@@ -12,21 +12,34 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <linux/limits.h>
 
 #include <dxwifi/decode/cli.h>
 
 #include <libdxwifi/fec.h>
+#include <libdxwifi/merge.h>
+#include <libdxwifi/archive.h>
+#include <libdxwifi/compress.h>
 #include <libdxwifi/details/utils.h>
 #include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/memory.h>
 #include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/threadpool.h>
 
 void decode_file(cli_args* args);
+void decode_merged(cli_args* args);
 void decode_stream(cli_args* args);
+void list_archives(cli_args* args);
+bool is_archive_file(const char* path);
 
 int main(int argc, char** argv) {
     cli_args args = {
         .file_in    = NULL,
         .file_out   = NULL,
+        .file_count = 0,
+        .object_id  = 0,
+        .list       = false,
+        .jobs       = DXWIFI_POOL_DFLT_WORKERS,
         .verbosity  = DXWIFI_LOG_INFO,
         .quiet      = false
     };
@@ -35,13 +48,23 @@ int main(int argc, char** argv) {
 
     set_log_level(DXWIFI_LOG_ALL_MODULES, args.verbosity);
 
-    if(args.file_in) {
+    dxwifi_pool_set_workers(args.jobs);
+
+    if(args.list) {
+        list_archives(&args);
+    }
+    else if(args.file_count > 1 || (args.file_in && is_archive_file(args.file_in))) {
+        decode_merged(&args);
+    }
+    else if(args.file_in) {
         decode_file(&args);
     }
     else {
         decode_stream(&args);
     }
 
+    dxwifi_mem_log_usage();
+
     exit(0);
 }
 
@@ -71,6 +94,20 @@ void decode_file(cli_args* args) {
 
         log_info("Successfully decoded %s. Decoded file size: %d", args->file_in, msglen);
 
+        // Objects compressed ahead of encoding carry a header saying so
+        void* decompressed = NULL;
+        ssize_t size = 0;
+        if(dxwifi_is_compressed(decoded_msg, msglen)) {
+            if((size = dxwifi_decompress(decoded_msg, msglen, &decompressed)) >= 0) {
+                free(decoded_msg);
+                decoded_msg = decompressed;
+                msglen      = size;
+            }
+            else {
+                log_error("Failed to decompress %s, writing the compressed object", args->file_in);
+            }
+        }
+
         int nbytes = write(fd_out, decoded_msg, msglen);
         assert_M(nbytes == msglen, "Partial write occured: %d/%d - %s", nbytes, msglen, strerror(errno));
         free(decoded_msg);
@@ -88,6 +125,214 @@ void decode_file(cli_args* args) {
 }
 
 
+// Write a decoded object to path or stdout, undoing any compression
+static void write_decoded(const char* path, void* decoded_msg, ssize_t msglen) {
+    int open_flags  = O_WRONLY | O_CREAT | O_TRUNC;
+    mode_t mode     = S_IRUSR  | S_IWUSR | S_IROTH | S_IWOTH; 
+
+    void* decompressed = NULL;
+    ssize_t size = 0;
+    if(dxwifi_is_compressed(decoded_msg, msglen)) {
+        if((size = dxwifi_decompress(decoded_msg, msglen, &decompressed)) >= 0) {
+            decoded_msg = decompressed;
+            msglen      = size;
+        }
+        else {
+            log_error("Failed to decompress object, writing it compressed");
+        }
+    }
+
+    int fd_out = path ? open(path, open_flags, mode) : STDOUT_FILENO;
+    assert_M(fd_out > 0, "Failed to open file: %s - %s", path, strerror(errno));
+
+    int nbytes = write(fd_out, decoded_msg, msglen);
+    assert_M(nbytes == msglen, "Partial write occured: %d/%d - %s", nbytes, msglen, strerror(errno));
+
+    if(path) {
+        close(fd_out);
+    }
+    free(decompressed);
+}
+
+
+// Objects of a merger decoded by the thread pool
+typedef struct {
+    const dxwifi_merger*    merger;
+    void**                  decoded;
+    ssize_t*                sizes;
+} merged_decode_job;
+
+
+static void decode_merged_objects(void* arg, size_t begin, size_t end) {
+    merged_decode_job* job = arg;
+
+    for(size_t i = begin; i < end; ++i) {
+        job->sizes[i] = dxwifi_merger_decode(job->merger, i, &job->decoded[i]);
+    }
+}
+
+
+void decode_merged(cli_args* args) {
+    dxwifi_merger merger;
+    dxwifi_merger_init(&merger);
+
+    // Captures are streamed through the merger, only the union of their
+    // frames is held in memory
+    for(int i = 0; i < args->file_count; ++i) {
+        if(is_archive_file(args->files[i])) {
+            dxwifi_archive archive;
+            if(!dxwifi_archive_map(&archive, args->files[i])) {
+                continue;
+            }
+            // The index points straight at the object's frames, nothing else is read
+            size_t nframes = args->object_id
+                ? dxwifi_merger_add_archived_object(&merger, &archive, args->object_id)
+                : dxwifi_merger_add_archive(&merger, &archive);
+
+            log_info("Merged %zu frames from archive %s", nframes, args->files[i]);
+            dxwifi_archive_unmap(&archive);
+            continue;
+        }
+        if(args->object_id) {
+            log_warning("%s is a raw capture, every object in it is merged", args->files[i]);
+        }
+
+        int fd_in = open(args->files[i], O_RDONLY);
+        if(fd_in < 0) {
+            log_error("Failed to open file: %s - %s", args->files[i], strerror(errno));
+            continue;
+        }
+        ssize_t nframes = dxwifi_merger_add_capture(&merger, fd_in);
+        log_info("Merged %zd frames from %s", nframes, args->files[i]);
+        close(fd_in);
+    }
+    log_info(
+        "Merged %zu frames: %zu duplicates, %zu replaced by a better copy, %zu rejected", 
+        merger.frames, 
+        merger.duplicates, 
+        merger.replaced, 
+        merger.rejected
+    );
+    if(merger.fountain > 0) {
+        log_error("Refused %zu fountain coded frames, fountain coded objects can't be merged. Decode each capture on its own", merger.fountain);
+    }
+
+    // Objects are decoded side by side, each one on a task of its own
+    size_t count = dxwifi_merger_object_count(&merger);
+
+    void** decoded = calloc(count ? count : 1, sizeof(void*));
+    ssize_t* sizes = calloc(count ? count : 1, sizeof(ssize_t));
+    assert_M(decoded && sizes, "Failed to allocate decoded objects - %s", strerror(errno));
+
+    merged_decode_job job = {
+        .merger     = &merger,
+        .decoded    = decoded,
+        .sizes      = sizes
+    };
+    dxwifi_task_group group;
+    dxwifi_task_group_init(&group);
+
+    for(size_t i = 0; i < count; ++i) {
+        dxwifi_task_group_spawn(&group, decode_merged_objects, &job, i, i + 1);
+    }
+    dxwifi_task_group_wait(&group);
+
+    // The first object goes to the output, any others alongside it
+    char path[PATH_MAX];
+    for(size_t i = 0; i < count; ++i) {
+        void* decoded_msg = decoded[i];
+        ssize_t msglen = sizes[i];
+
+        if(msglen < 0) {
+            log_error("Decode failed for object %zu - %s", i, dxwifi_fec_error_to_str(msglen));
+            continue;
+        }
+        log_info("Successfully decoded object %zu. Decoded file size: %zd", i, msglen);
+
+        if(i == 0) {
+            write_decoded(args->file_out, decoded_msg, msglen);
+        }
+        else if(args->file_out) {
+            snprintf(path, sizeof(path), "%s.%zu", args->file_out, i);
+            write_decoded(path, decoded_msg, msglen);
+        }
+        else {
+            log_warning("Object %zu not written, use an output file to keep every object", i);
+        }
+        free(decoded_msg);
+    }
+    if(count == 0) {
+        log_error("No objects found in the input files");
+    }
+    free(decoded);
+    free(sizes);
+    dxwifi_merger_close(&merger);
+}
+
+
+bool is_archive_file(const char* path) {
+    dxwifi_archive_hdr hdr;
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    ssize_t nbytes = read(fd, &hdr, sizeof(hdr));
+    close(fd);
+
+    return nbytes > 0 && dxwifi_is_archive(&hdr, nbytes);
+}
+
+
+void list_archives(cli_args* args) {
+    for(int i = 0; i < args->file_count; ++i) {
+        dxwifi_archive archive;
+        if(!is_archive_file(args->files[i]) || !dxwifi_archive_map(&archive, args->files[i])) {
+            log_error("%s is not an archive", args->files[i]);
+            continue;
+        }
+        printf("%s: %zu frames%s\n", args->files[i], archive.count, archive.rebuilt ? " (index rebuilt)" : "");
+
+        size_t nobjects = dxwifi_archive_objects(&archive, NULL, 0);
+        uint32_t* ids = calloc(nobjects ? nobjects : 1, sizeof(uint32_t));
+        assert_M(ids, "Failed to allocate object list - %s", strerror(errno));
+
+        dxwifi_archive_objects(&archive, ids, nobjects);
+        for(size_t j = 0; j < nobjects; ++j) {
+            size_t first = 0;
+            size_t count = dxwifi_archive_lookup(&archive, ids[j], &first);
+
+            dxwifi_archive_record record;
+            size_t   distinct   = 0;
+            int      rssi_total = 0;
+            uint32_t start      = UINT32_MAX;
+            uint32_t end        = 0;
+            int32_t  last_esi   = -1;
+            for(size_t k = first; k < first + count; ++k) {
+                dxwifi_archive_entry_at(&archive, k, &record);
+                if(record.esi != DXWIFI_ARCHIVE_ESI_UNKNOWN && record.esi != last_esi) {
+                    ++distinct;
+                    last_esi = record.esi;
+                }
+                rssi_total += record.rssi;
+                start = record.ts_sec < start ? record.ts_sec : start;
+                end   = record.ts_sec > end   ? record.ts_sec : end;
+            }
+            printf(
+                "  object %-10u  frames: %-6zu  distinct ESIs: %-6zu  mean RSSI: %4ddBm  span: %us\n",
+                ids[j],
+                count,
+                distinct,
+                count ? rssi_total / (int) count : 0,
+                end - start
+            );
+        }
+        free(ids);
+        dxwifi_archive_unmap(&archive);
+    }
+}
+
+
 void decode_stream(cli_args* args) {
     assert_always("Unimplemented");
 }
\ No newline at end of file
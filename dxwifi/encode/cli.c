@@ -28,6 +28,9 @@ static char doc[] =
 static struct argp_option opts[] = {
     { "output",         'o', "<path>",              0, "Output file path",                                   PRIMARY_GROUP },
     { "coderate",       'c', "[0,1]",               0, "Rate of repair symbols ",                            PRIMARY_GROUP },
+    { "inner-code",     'i', "<rs|crc|none>",       0, "Inner code protecting each FEC frame",               PRIMARY_GROUP },
+    { "compress",       'z', "<lz4|zstd|none>",     0, "Compress the file before encoding",                  PRIMARY_GROUP },
+    { "jobs",           'j', "<n>",                 0, "Worker threads besides the main one (default: one per extra CPU)", PRIMARY_GROUP },
 
 
     { 0, 0, 0, 0, "Help Options", HELP_GROUP },
@@ -72,6 +75,34 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
         }
         break;
 
+    case 'i':
+        args->inner_code = dxwifi_fec_inner_code_from_str(arg);
+        if(args->inner_code == DXWIFI_FEC_INNER_CODE_COUNT) {
+            argp_error(state, "Inner code must be one of rs, crc or none");
+            argp_usage(state);
+        }
+        break;
+
+    case 'z':
+        args->compression = dxwifi_compression_from_str(arg);
+        if(args->compression == DXWIFI_COMPRESSION_COUNT) {
+            argp_error(state, "Compression must be one of lz4, zstd or none");
+            argp_usage(state);
+        }
+        else if(!dxwifi_compression_supported(args->compression)) {
+            argp_error(state, "%s compression is not supported by this build", arg);
+            argp_usage(state);
+        }
+        break;
+
+    case 'j':
+        args->jobs = atoi(arg);
+        if(args->jobs < 0 || args->jobs > DXWIFI_POOL_MAX_WORKERS) {
+            argp_error(state, "Jobs must be a value between 0 and %d", DXWIFI_POOL_MAX_WORKERS);
+            argp_usage(state);
+        }
+        break;
+
     case 'o':
         args->file_out = arg;
         break;
@@ -4,11 +4,18 @@
 
 #include <stdbool.h>
 
+#include <libdxwifi/fec.h>
+#include <libdxwifi/compress.h>
+#include <libdxwifi/details/threadpool.h>
+
 
 typedef struct {
     const char* file_in;
     const char* file_out;
     float       coderate;
+    dxwifi_fec_inner_code_t inner_code;
+    dxwifi_compression_t compression;
+    int         jobs;
     int         verbosity;
     bool        quiet;
 } cli_args;
@@ -16,11 +16,13 @@
 #include <dxwifi/encode/cli.h>
 
 #include <libdxwifi/fec.h>
+#include <libdxwifi/compress.h>
 #include <libdxwifi/details/utils.h>
 #include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/memory.h>
 #include <libdxwifi/details/logging.h>
 
-void encode_file(cli_args *args);
+bool encode_file(cli_args *args);
 void encode_stream(cli_args *args);
 
 int main(int argc, char **argv) {
@@ -28,6 +30,9 @@ int main(int argc, char **argv) {
         .file_in = NULL,
         .file_out = NULL,
         .coderate = 0.667,
+        .inner_code = DXWIFI_FEC_INNER_RS,
+        .compression = DXWIFI_COMPRESSION_NONE,
+        .jobs = DXWIFI_POOL_DFLT_WORKERS,
         .verbosity = DXWIFI_LOG_INFO,
         .quiet = false
     };
@@ -35,17 +40,22 @@ int main(int argc, char **argv) {
 
     set_log_level(DXWIFI_LOG_ALL_MODULES, args.verbosity);
 
+    dxwifi_pool_set_workers(args.jobs);
+
+    bool success = true;
     if (args.file_in) {
-        encode_file(&args);
+        success = encode_file(&args);
     }
     else {
         encode_stream(&args);
     }
 
-    exit(0);
+    dxwifi_mem_log_usage();
+
+    exit(success ? 0 : 1);
 }
 
-void encode_file(cli_args *args) {
+bool encode_file(cli_args *args) {
 
     // Setup File-In / File-Out
     int fd_in = open(args->file_in, O_RDWR);
@@ -62,13 +72,24 @@ void encode_file(cli_args *args) {
     void *file_data = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd_in, 0);
     assert_M(file_data != MAP_FAILED, "Failed to map file to memory - %s", strerror(errno));
 
+    // Compress File-In, falls back to the raw file if it doesn't shrink
+    void *message = file_data;
+    void *compressed = NULL;
+    size_t msglen = dxwifi_compress(file_data, file_size, args->compression, &compressed);
+    if (msglen > 0) {
+        message = compressed;
+    }
+    else {
+        msglen = file_size;
+    }
+
     // FEC Encode File-In
     void *encoded_message = NULL;
-    size_t msg_size = dxwifi_encode(file_data, file_size, args->coderate, &encoded_message);
+    ssize_t msg_size = dxwifi_encode(message, msglen, args->coderate, args->inner_code, &encoded_message);
 
     if (msg_size > 0) { // FEC encode success, write out encoded message
 
-        log_info("Successfully encoded %s. Encoded file size: %d", args->file_in, msg_size);
+        log_info("Successfully encoded %s. Encoded file size: %zd", args->file_in, msg_size);
 
         int nbytes = write(fd_out, encoded_message, msg_size);
         assert_M(nbytes == msg_size, "Partial write occured: %d/%d - %s", nbytes, msg_size, strerror(errno));
@@ -80,11 +101,14 @@ void encode_file(cli_args *args) {
     }
 
     // Teardown resources
+    free(compressed);
     close(fd_in);
     if (args->file_out) {
         close(fd_out);
     }
     munmap(file_data, file_size);
+
+    return msg_size > 0;
 }
 
 void encode_stream(cli_args *args) {
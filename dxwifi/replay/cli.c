@@ -0,0 +1,134 @@
+/**
+ *  cli.c
+ *  
+ *  DESCRIPTION: Command line interface for replay.c
+ * 
+ *  https://github.com/oresat/oresat-dxwifi-software
+ * 
+ */
+
+#include <argp.h>
+#include <stdlib.h>
+
+#include <dxwifi/replay/cli.h>
+
+#include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/logging.h>
+
+#define PRIMARY_GROUP   0
+#define HELP_GROUP      500
+
+
+const char* argp_program_version = DXWIFI_VERSION;
+
+// Description of key arguments 
+static char args_doc[] = "capture.pcap...";
+
+// Program description
+static char doc[] = 
+    "Replay recorded pass captures onto a virtual air interface at the pace they were recorded, so rx programs "
+    "attached with --air see the pass as it happened. Captures are radiotap pcaps, e.g. from tcpdump on a monitor "
+    "mode interface or the tx program's savefile. Reports how faithful the replay was and the frames dropped and "
+    "latency of every receiver on the medium";
+
+// Available command line options 
+static struct argp_option opts[] = { 
+    { "air",        'a', "<name>",          0, "Virtual air interface to replay onto",                                          PRIMARY_GROUP },
+    { "channel",    'c', "<settings>",      0, "Channel model applied to every frame, e.g. loss=0.1,ber=1e-6,rate=6000",        PRIMARY_GROUP },
+    { "speed",      'x', "<factor>",        0, "Replay faster or slower than recorded, 0 sends frames back to back",            PRIMARY_GROUP },
+    { "loop",       'l', "<count>",         0, "Number of times to replay the captures, 0 to loop until interrupted",           PRIMARY_GROUP },
+    { "settle",     'w', "<seconds>",       0, "Seconds to let receivers catch up before reporting on them",                    PRIMARY_GROUP },
+
+    { 0, 0, 0, 0, "Help options", HELP_GROUP },
+    { "verbose", 'v', 0, 0, "Verbosity level",              HELP_GROUP },
+    { "syslog",  's', 0, 0, "Use SysLog for messages",      HELP_GROUP }, 
+    { "quiet",   'q', 0, 0, "Silence any output",           HELP_GROUP },
+
+    { 0 } // Final zero field is required by argp
+};
+
+
+static error_t parse_opt(int key, char* arg, struct argp_state *state) {
+
+    error_t status = 0;
+    cli_args* args = (cli_args*) state->input;
+
+    switch (key)
+    {
+    case ARGP_KEY_ARG:
+        if(args->file_count >= (int) NELEMS(args->files)) {
+            argp_error(state, "At most %d captures can be replayed at once", REPLAY_MAX_FILES);
+        }
+        args->files[args->file_count++] = arg;
+        break;
+
+    case ARGP_KEY_END:
+        if(args->file_count == 0) {
+            argp_usage(state);
+        }
+        if(args->quiet) {
+            args->verbosity = 0;
+        }
+        break;
+
+    case 'a':
+        args->air = arg;
+        break;
+
+    case 'c':
+        if(!dxwifi_air_parse_channel(arg, &args->channel)) {
+            argp_error(state, "Invalid channel settings: %s", arg);
+        }
+        break;
+
+    case 'x':
+        args->speed = strtod(arg, NULL);
+        if(!(args->speed >= 0)) {
+            argp_error(state, "Speed must be positive or 0");
+        }
+        break;
+
+    case 'l':
+        args->loops = strtoul(arg, NULL, 0);
+        break;
+
+    case 'w':
+        args->settle = atoi(arg);
+        break;
+
+    case 'v':
+        ++args->verbosity;
+        break;
+
+    case 's':
+        args->use_syslog = true;
+        break;
+
+    case 'q':
+        args->quiet = true;
+        break;
+
+    default:
+        status = ARGP_ERR_UNKNOWN;
+        break;
+    }
+    return status;
+}
+
+
+static struct argp argparser = { 
+    .options        = opts, 
+    .parser         = parse_opt, 
+    .args_doc       = args_doc, 
+    .doc            = doc, 
+    .children       = 0, 
+    .help_filter    = 0,
+    .argp_domain    = 0
+};
+
+
+int parse_args(int argc, char** argv, cli_args* out) {
+
+    return argp_parse(&argparser, argc, argv, 0, 0, out);
+
+}
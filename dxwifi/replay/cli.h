@@ -0,0 +1,64 @@
+/**
+ *  cli.h
+ *  
+ *  DESCRIPTION: Command line interface for replay.c
+ * 
+ *  https://github.com/oresat/oresat-dxwifi-software
+ * 
+ */
+
+
+#include <libdxwifi/details/air.h>
+#include <libdxwifi/details/logging.h>
+
+
+// Most capture files replayed in one run
+#define REPLAY_MAX_FILES 64
+
+
+typedef struct {
+    const char*         files[REPLAY_MAX_FILES];
+    int                 file_count;
+    const char*         air;
+    dxwifi_air_channel  channel;
+    double              speed;
+    unsigned            loops;
+    unsigned            settle;
+    int                 verbosity;
+    bool                quiet;
+    bool                use_syslog;
+} cli_args;
+
+
+#define DEFAULT_CLI_ARGS {\
+        .files          = { 0 },\
+        .file_count     = 0,\
+        .air            = DXWIFI_AIR_DFLT_NAME,\
+        .channel        = DXWIFI_AIR_CHANNEL_CLEAR,\
+        .speed          = 1.0,\
+        .loops          = 1,\
+        .settle         = 2,\
+        .verbosity      = DXWIFI_LOG_INFO,\
+        .quiet          = false,\
+        .use_syslog     = false\
+    }\
+
+
+/**
+ *  DESCRIPTION:    Parse command line arguments into the cli_args struct
+ * 
+ *  ARGUMENTS:
+ * 
+ *      argc:       Number of command line arguments
+ * 
+ *      argv:       list of arguments
+ * 
+ *      out:        Pointer to allocated cli_args structure.
+ * 
+ *  RETURNS:
+ *      
+ *      int:        0 if arguments were parsed successfully
+ *     
+ *  
+ */
+int parse_args(int argc, char** argv, cli_args* out);
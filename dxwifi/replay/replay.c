@@ -0,0 +1,329 @@
+/**
+ *  replay.c
+ *
+ *  DESCRIPTION: DxWiFi capture replay program. Sends recorded pass captures
+ *  onto a virtual air interface with their original timing so the rx pipeline
+ *  can be benchmarked against a real pass without a radio
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <signal.h>
+
+#include <pcap.h>
+
+#include <dxwifi/replay/cli.h>
+
+#include <libdxwifi/details/air.h>
+#include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/radiotap.h>
+#include <libdxwifi/details/syslogger.h>
+
+
+// Frames sent later than this after their recorded time count as late
+#define REPLAY_LATE_NS 1000000
+
+
+/**
+ *  Fidelity of the replay to the recorded captures
+ */
+typedef struct {
+    uint64_t    frames;         /* Frames sent onto the air interface       */
+    uint64_t    bytes;          /* Bytes sent onto the air interface        */
+    uint64_t    truncated;      /* Frames the capture didn't keep whole     */
+    uint64_t    oversized;      /* Frames too large for the air interface   */
+    uint64_t    late;           /* Frames sent more than REPLAY_LATE_NS late*/
+    uint64_t    late_max_ns;    /* Furthest behind a frame was sent         */
+    uint64_t    recorded_ns;    /* Duration of the captures as recorded     */
+    uint64_t    elapsed_ns;     /* Duration of the replay                   */
+} replay_stats;
+
+
+static volatile sig_atomic_t running = true;
+
+
+/**
+ *  DESCRIPTION:    Signals to the replay loop to close out
+ *
+ *  ARGUMENTS:
+ *
+ *      signum:     Received signal
+ *
+ */
+static void stop_handler(int signum) {
+    running = false;
+}
+
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+/**
+ *  DESCRIPTION:    Sleeps until a monotonic time or until interrupted
+ */
+static void sleep_until(uint64_t deadline_ns) {
+    struct timespec ts = {
+        .tv_sec     = deadline_ns / 1000000000ull,
+        .tv_nsec    = deadline_ns % 1000000000ull
+    };
+    while(running && clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+}
+
+
+/**
+ *  DESCRIPTION:    Checks the radiotap flags of a frame for a trailing FCS
+ */
+static bool frame_has_fcs(const uint8_t* frame, uint32_t caplen) {
+    struct ieee80211_radiotap_iterator iter;
+    if(ieee80211_radiotap_iterator_init(&iter, (ieee80211_radiotap_hdr*) frame, caplen, NULL) != 0) {
+        return false;
+    }
+    while(ieee80211_radiotap_iterator_next(&iter) == 0) {
+        if(iter.this_arg_index == IEEE80211_RADIOTAP_FLAGS) {
+            return *iter.this_arg & IEEE80211_RADIOTAP_F_FCS;
+        }
+    }
+    return false;
+}
+
+
+/**
+ *  DESCRIPTION:    Sends every frame of a capture at the offset from its
+ *                  first frame it was recorded at
+ *
+ *  ARGUMENTS:
+ *
+ *      air:        Handle attached as a transmitter
+ *
+ *      path:       Radiotap pcap to replay
+ *
+ *      speed:      Factor the recorded offsets are divided by, 0 to send the
+ *                  frames back to back
+ *
+ *      stats:      Updated with the fidelity of the replay
+ *
+ *  RETURNS:
+ *
+ *      bool:       True if the capture could be read
+ *
+ *  NOTES: Captures from a monitor mode interface already end with an FCS,
+ *  the one from the tx program's savefile don't and get one appended
+ *
+ */
+static bool replay_capture(dxwifi_air* air, const char* path, double speed, replay_stats* stats) {
+    char errbuf[PCAP_ERRBUF_SIZE];
+
+    pcap_t* capture = pcap_open_offline(path, errbuf);
+    if(!capture) {
+        log_error("Failed to open %s: %s", path, errbuf);
+        return false;
+    }
+    if(pcap_datalink(capture) != DLT_IEEE802_11_RADIO) {
+        log_error("%s is not a radiotap capture", path);
+        pcap_close(capture);
+        return false;
+    }
+
+    struct pcap_pkthdr* hdr     = NULL;
+    const uint8_t*      frame   = NULL;
+    uint64_t            start   = clock_ns(CLOCK_MONOTONIC);
+    uint64_t            first   = 0;
+    uint64_t            last    = 0;
+    int                 status  = 0;
+
+    log_info("Replaying %s", path);
+
+    while(running && (status = pcap_next_ex(capture, &hdr, &frame)) == 1) {
+        uint64_t ts = (uint64_t) hdr->ts.tv_sec * 1000000000ull + (uint64_t) hdr->ts.tv_usec * 1000;
+        if(first == 0) {
+            first = ts;
+        }
+        // Timestamps that step backwards are sent right away
+        last = ts > last ? ts : last;
+
+        if(speed > 0) {
+            uint64_t target = start + (uint64_t) ((ts > first ? ts - first : 0) / speed);
+            sleep_until(target);
+
+            uint64_t lateness = clock_ns(CLOCK_MONOTONIC) - target;
+            if(lateness > REPLAY_LATE_NS) {
+                ++stats->late;
+            }
+            stats->late_max_ns = lateness > stats->late_max_ns ? lateness : stats->late_max_ns;
+        }
+
+        if(hdr->caplen < hdr->len) {
+            ++stats->truncated;
+            continue;
+        }
+        ssize_t sent = frame_has_fcs(frame, hdr->caplen)
+                     ? dxwifi_air_send_raw(air, frame, hdr->caplen)
+                     : dxwifi_air_send(air, frame, hdr->caplen);
+        if(sent < 0) {
+            ++stats->oversized;
+            continue;
+        }
+        stats->frames   += 1;
+        stats->bytes    += sent;
+    }
+    if(status == PCAP_ERROR) {
+        log_error("Failed to read %s: %s", path, pcap_geterr(capture));
+    }
+
+    stats->recorded_ns  += last - first;
+    stats->elapsed_ns   += clock_ns(CLOCK_MONOTONIC) - start;
+
+    pcap_close(capture);
+    return true;
+}
+
+
+/**
+ *  DESCRIPTION:    Finds the counters of a station in a snapshot of the table
+ */
+static const dxwifi_air_station* find_station(const dxwifi_air_station* stations, size_t count, int32_t pid) {
+    for(size_t i = 0; i < count; ++i) {
+        if(stations[i].pid == pid) {
+            return &stations[i];
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ *  DESCRIPTION:    Logs what every receiver on the medium saw of the replay
+ *
+ *  ARGUMENTS:
+ *
+ *      air:        Handle attached to the medium
+ *
+ *      before:     Station table from before the replay
+ *
+ *      count:      Number of stations in before
+ *
+ *  NOTES: Receivers attached before the replay are only charged with what
+ *  happened during it. The latency of a frame is from when it arrived on the
+ *  medium to when the receiver was done handling it. The maximum spans the
+ *  receiver's whole attachment
+ *
+ */
+static void log_receivers(dxwifi_air* air, const dxwifi_air_station* before, size_t count) {
+    dxwifi_air_station after[DXWIFI_AIR_MAX_STATIONS];
+    size_t found = dxwifi_air_stations(air, after, NELEMS(after));
+
+    char report[4096];
+    int len = snprintf(report, sizeof(report), "Receivers\n\t%-8s %10s %10s %8s %10s %14s %14s",
+        "PID", "Frames", "Dropped", "Lost", "Corrupted", "Latency(us)", "Max(us)");
+
+    for(size_t i = 0; i < found && len < (int) sizeof(report); ++i) {
+        if(after[i].role != DXWIFI_AIR_RECEIVER) {
+            continue;
+        }
+        dxwifi_air_station delta = after[i];
+
+        const dxwifi_air_station* base = find_station(before, count, after[i].pid);
+        if(base) {
+            delta.frames        -= base->frames;
+            delta.lost          -= base->lost;
+            delta.corrupted     -= base->corrupted;
+            delta.overruns      -= base->overruns;
+            delta.latency_us    -= base->latency_us;
+        }
+        len += snprintf(report + len, sizeof(report) - len, "\n\t%-8d %10" PRIu64 " %10" PRIu64 " %8" PRIu64 " %10" PRIu64 " %14" PRIu64 " %14" PRIu64,
+            delta.pid, delta.frames, delta.overruns, delta.lost, delta.corrupted,
+            delta.frames ? delta.latency_us / delta.frames : 0, delta.latency_max_us);
+    }
+    log_info("%s", report);
+}
+
+
+/**
+ *  DESCRIPTION:    Logs how faithful the replay was to the captures
+ */
+static void log_replay_stats(const replay_stats* stats, uint64_t cpu_ns) {
+    log_info(
+        "Replay Stats\n"
+        "\tFrames Sent:                 %" PRIu64 "\n"
+        "\tBytes Sent:                  %" PRIu64 "\n"
+        "\tFrames Truncated:            %" PRIu64 "\n"
+        "\tFrames Oversized:            %" PRIu64 "\n"
+        "\tFrames Late:                 %" PRIu64 "\n"
+        "\tLatest Frame:                %.3fms\n"
+        "\tRecorded Duration:           %.3fs\n"
+        "\tReplay Duration:             %.3fs\n"
+        "\tReplay CPU:                  %.3fs",
+        stats->frames,
+        stats->bytes,
+        stats->truncated,
+        stats->oversized,
+        stats->late,
+        stats->late_max_ns / 1e6,
+        stats->recorded_ns / 1e9,
+        stats->elapsed_ns / 1e9,
+        cpu_ns / 1e9
+    );
+}
+
+
+int main(int argc, char** argv) {
+    cli_args args = DEFAULT_CLI_ARGS;
+
+    parse_args(argc, argv, &args);
+
+    set_log_level(DXWIFI_LOG_ALL_MODULES, args.verbosity);
+
+    if(args.use_syslog) {
+        set_logger(DXWIFI_LOG_ALL_MODULES, syslogger);
+    }
+
+    dxwifi_air air = { .channel = args.channel };
+    bool attached = dxwifi_air_attach(&air, args.air, DXWIFI_AIR_TRANSMITTER);
+    assert_M(attached, "Failed to attach to air interface %s", args.air);
+
+    struct sigaction action = { 0 };
+    action.sa_handler = stop_handler;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    dxwifi_air_station before[DXWIFI_AIR_MAX_STATIONS];
+    size_t count = dxwifi_air_stations(&air, before, NELEMS(before));
+
+    replay_stats stats = { 0 };
+    uint64_t cpu_start = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+
+    for(unsigned loop = 0; running && (args.loops == 0 || loop < args.loops); ++loop) {
+        bool replayed = false;
+        for(int i = 0; running && i < args.file_count; ++i) {
+            replayed |= replay_capture(&air, args.files[i], args.speed, &stats);
+        }
+        if(!replayed) {
+            break;
+        }
+    }
+    uint64_t cpu_ns = clock_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+
+    // Frames still in flight or queued at a slow receiver
+    if(running && args.settle) {
+        sleep_until(clock_ns(CLOCK_MONOTONIC) + (uint64_t) args.settle * 1000000000ull);
+    }
+
+    log_replay_stats(&stats, cpu_ns);
+    log_receivers(&air, before, count);
+
+    dxwifi_air_detach(&air);
+
+    return stats.frames > 0 ? 0 : 1;
+}
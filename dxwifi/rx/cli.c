@@ -17,6 +17,7 @@
 #define PRIMARY_GROUP           0
 #define DIRECTORY_MODE_GROUP    500
 #define PCAP_SETTINGS_GROUP     1000
+#define AIR_GROUP               1250
 #define HELP_GROUP              1500
 
 #if defined(DXWIFI_TESTS)
@@ -35,6 +36,12 @@ typedef enum {
 } pcap_settings_t;
 
 
+typedef enum {
+    AIR_NAME,
+    AIR_CHANNEL,
+} air_settings_t;
+
+
 const char* argp_program_version = DXWIFI_VERSION;
 
 // Description of key arguments 
@@ -53,6 +60,11 @@ static struct argp_option opts[] = {
     { "append",         'a', 0,                     0, "Open files in append mode",                                             PRIMARY_GROUP },
     { "ordered",        'o', 0,                     0, "Expect packets to have sequence informations",                          PRIMARY_GROUP },
     { "add-noise",      'n', 0,                     0, "Add noise for missing packets",                                         PRIMARY_GROUP },
+    { "keep-capture",   'k', 0,                     0, "Keep the raw frames next to each output file as <file>.raw, for merging with decode", PRIMARY_GROUP },
+    { "archive",        'r', "<path>",              0, "Append every data frame to an indexed archive, readable by decode",   PRIMARY_GROUP },
+    { "metrics",        'm', "<path>",              0, "Keep the decodability of the object being captured in a Prometheus textfile", PRIMARY_GROUP },
+    { "jobs",           'j', "<n>",                 0, "Worker threads for decoding besides the main one (default: one per extra CPU)", PRIMARY_GROUP },
+    { "decode-budget",  'B', "<seconds>",           0, "CPU time decoding an object may take, past it the capture is kept for decode (default: no limit)", PRIMARY_GROUP },
 
     { 0, 0, 0, 0, "The following settings are only applicable when outputting to a directory",      DIRECTORY_MODE_GROUP },
     { "prefix",         'p', "<file-prefix>",       0, "What to name each created file",            DIRECTORY_MODE_GROUP },
@@ -66,6 +78,10 @@ static struct argp_option opts[] = {
     { "sender-address", GET_KEY(SENDER_ADDR,    PCAP_SETTINGS_GROUP),    "<macaddr>",    OPTION_NO_USAGE,    "Transmitters MAC address",             PCAP_SETTINGS_GROUP },
     { "max-distance",   GET_KEY(MAX_DISTANCE,   PCAP_SETTINGS_GROUP),    "<number>",     OPTION_NO_USAGE,    "Maximum hamming distance for the address", PCAP_SETTINGS_GROUP},
 
+    { 0, 0, 0, 0, "Virtual Air Interface Settings, capture from a shared memory medium instead of a device", AIR_GROUP },
+    { "air",            GET_KEY(AIR_NAME,       AIR_GROUP),     "<name>",       OPTION_ARG_OPTIONAL | OPTION_NO_USAGE,  "Capture from this medium (default: " DXWIFI_AIR_DFLT_NAME ")",   AIR_GROUP },
+    { "channel",        GET_KEY(AIR_CHANNEL,    AIR_GROUP),     "<settings>",   OPTION_NO_USAGE,                        "Impair frames this receiver hears, e.g. loss=0.1,fade=0.01:0.2",  AIR_GROUP },
+
     { 0, 0, 0, 0, "Help options", HELP_GROUP },
     { "verbose", 'v', 0, 0, "Verbosity level",              HELP_GROUP },
     { "syslog",  's', 0, 0, "Use SysLog for messages",      HELP_GROUP }, 
@@ -169,6 +185,32 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
         args->rx.add_noise = true;
         break;
 
+    case 'k':
+        args->keep_capture = true;
+        break;
+
+    case 'r':
+        args->archive_path = arg;
+        break;
+
+    case 'm':
+        args->metrics_path = arg;
+        break;
+
+    case 'j':
+        args->jobs = atoi(arg);
+        if(args->jobs < 0 || args->jobs > DXWIFI_POOL_MAX_WORKERS) {
+            argp_error(state, "Jobs must be between 0 and %d", DXWIFI_POOL_MAX_WORKERS);
+        }
+        break;
+
+    case 'B':
+        args->decode_budget = atof(arg);
+        if(args->decode_budget < 0) {
+            argp_error(state, "Decode budget must be positive");
+        }
+        break;
+
     case 's':
         args->use_syslog = true;
         break;
@@ -200,6 +242,16 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
         args->rx.max_hamming_dist = atoi(arg);
         break;
 
+    case GET_KEY(AIR_NAME, AIR_GROUP):
+        args->rx.air = arg ? arg : DXWIFI_AIR_DFLT_NAME;
+        break;
+
+    case GET_KEY(AIR_CHANNEL, AIR_GROUP):
+        if(!dxwifi_air_parse_channel(arg, &args->rx.air_channel)) {
+            argp_error(state, "Invalid channel settings: %s", arg);
+        }
+        break;
+
 #if defined(DXWIFI_TESTS)
     case ARGP_KEY_INIT:
         args->rx.savefile = NULL;
@@ -9,6 +9,7 @@
 
 
 #include <libdxwifi/receiver.h>
+#include <libdxwifi/details/threadpool.h>
 
 
 typedef enum {
@@ -23,11 +24,16 @@ typedef struct {
     int             verbosity;
     bool            quiet;
     bool            append;
+    bool            keep_capture;
     bool            use_syslog;
     const char*     device;
     const char*     output_path;
     const char*     file_prefix;
     const char*     file_extension;
+    const char*     archive_path;
+    const char*     metrics_path;
+    int             jobs;
+    double          decode_budget;
     dxwifi_receiver rx;
 } cli_args;
 
@@ -37,11 +43,16 @@ typedef struct {
         .verbosity      = DXWIFI_LOG_INFO,\
         .quiet          = false,\
         .append         = false,\
+        .keep_capture   = false,\
         .use_syslog     = false,\
         .device         = "mon0",\
         .output_path    = ".",\
         .file_prefix    = "rx",\
         .file_extension = "cap",\
+        .archive_path   = NULL,\
+        .metrics_path   = NULL,\
+        .jobs           = DXWIFI_POOL_DFLT_WORKERS,\
+        .decode_budget  = 0,\
         .rx = DXWIFI_RECEIVER_DFLT_INITIALIZER\
     }\
 
@@ -7,6 +7,7 @@
  * 
  */
 
+#include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
@@ -20,9 +21,16 @@
 #include <dxwifi/rx/cli.h>
 
 #include <libdxwifi/dxwifi.h>
+#include <libdxwifi/bundle.h>
+#include <libdxwifi/archive.h>
+#include <libdxwifi/compress.h>
 #include <libdxwifi/receiver.h>
+#include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/crc32.h>
 #include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/memory.h>
 #include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/probes.h>
 #include <libdxwifi/details/syslogger.h>
 
 
@@ -33,6 +41,7 @@ dxwifi_receiver* receiver = NULL;
 
 
 void receive(cli_args* args, dxwifi_receiver* rx);
+void write_metrics(const dxwifi_rx_stats* stats, void* user);
 
 
 int main(int argc, char** argv) {
@@ -47,12 +56,33 @@ int main(int argc, char** argv) {
 
     set_log_level(DXWIFI_LOG_ALL_MODULES, args.verbosity);
 
+    dxwifi_pool_set_workers(args.jobs);
+    dxwifi_fec_set_decode_budget(args.decode_budget);
+
     init_receiver(receiver, args.device);
 
+    dxwifi_archive_writer archive;
+    if(args.archive_path) {
+        bool opened = dxwifi_archive_writer_open(&archive, args.archive_path, DXWIFI_RS_LDPC_FRAME_SIZE);
+        assert_M(opened, "Failed to open archive: %s", args.archive_path);
+        receiver->archive = &archive;
+    }
+
+    if(args.metrics_path) {
+        receiver->on_estimate   = write_metrics;
+        receiver->estimate_user = (void*) args.metrics_path;
+    }
+
     receive(&args, receiver);
 
+    if(receiver->archive) {
+        dxwifi_archive_writer_close(receiver->archive);
+    }
+
     close_receiver(receiver);
 
+    dxwifi_mem_log_usage();
+
     exit(0);
 }
 
@@ -85,6 +115,7 @@ void log_rx_stats(dxwifi_rx_stats stats) {
         "\tPackets Dropped (receiver):  %d\n"
         "\tPackets Dropped (Kernel):    %d\n"
         "\tPackets Dropped (NIC):       %d\n"
+        "\tPeak Memory:                 %zu\n"
         "\tNote: Packet drop data is platform dependent.\n"
         "\tBlocks lost is only tracked when `ordered` flag is set",
         stats.total_payload_size,
@@ -101,7 +132,8 @@ void log_rx_stats(dxwifi_rx_stats stats) {
         stats.pcap_stats.ps_recv,
         stats.packets_dropped,
         stats.pcap_stats.ps_drop,
-        stats.pcap_stats.ps_ifdrop
+        stats.pcap_stats.ps_ifdrop,
+        stats.memory.peak
     );
     if((stats.rtap.mcs.flags & 0x03) == 0){
         log_debug("MCS Bandwidth = 20");
@@ -144,6 +176,102 @@ void log_rx_stats(dxwifi_rx_stats stats) {
         stats.rtap.mcs.flags
     );
     free(channel_flags_str);
+
+    for(int i = 0; i < DXWIFI_RX_STAGE_COUNT; ++i) {
+        const dxwifi_rx_stage_stats* stage = &stats.stages[i];
+        log_info(
+            "Stage %-8s %8u runs, %8.3fms CPU, %6.2fus per run",
+            dxwifi_rx_stage_to_str(i),
+            stage->runs,
+            stage->cpu_ns / 1e6,
+            stage->runs ? stage->cpu_ns / 1e3 / stage->runs : 0.0
+        );
+    }
+}
+
+
+/**
+ *  DESCRIPTION:    Reads a clock in seconds, e.g. to time a stage
+ */
+static double clock_seconds(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/**
+ *  DESCRIPTION:    Writes the decodability of the object being captured as a
+ *                  Prometheus textfile, e.g. for the node exporter
+ * 
+ *  ARGUMENTS: 
+ *      
+ *      See definition of dxwifi_rx_estimate_cb in receiver.h. User is the path
+ *      of the textfile
+ * 
+ *  NOTES: The file is written next to the textfile and renamed over it so the
+ *  exporter never reads a partial file.
+ * 
+ */
+void write_metrics(const dxwifi_rx_stats* stats, void* user) {
+    const char* path = (const char*) user;
+    const dxwifi_fec_estimate* estimate = &stats->estimate;
+
+    char temp_path[PATH_MAX];
+    snprintf(temp_path, PATH_MAX, "%s.tmp", path);
+
+    FILE* file = fopen(temp_path, "w");
+    if(!file) {
+        log_error("Failed to open metrics file: %s - %s", temp_path, strerror(errno));
+        return;
+    }
+    fprintf(file,
+        "# HELP dxwifi_rx_object_id Object being captured\n"
+        "# TYPE dxwifi_rx_object_id gauge\n"
+        "dxwifi_rx_object_id %u\n"
+        "# HELP dxwifi_rx_symbols_total Symbols of the object's source block\n"
+        "# TYPE dxwifi_rx_symbols_total gauge\n"
+        "dxwifi_rx_symbols_total{kind=\"source\"} %u\n"
+        "dxwifi_rx_symbols_total{kind=\"encoded\"} %u\n"
+        "# HELP dxwifi_rx_symbols_received Distinct symbols received that passed their CRC\n"
+        "# TYPE dxwifi_rx_symbols_received gauge\n"
+        "dxwifi_rx_symbols_received{kind=\"source\"} %u\n"
+        "dxwifi_rx_symbols_received{kind=\"repair\"} %u\n"
+        "# HELP dxwifi_rx_symbols_resolved Source symbols rebuilt by iterative decoding\n"
+        "# TYPE dxwifi_rx_symbols_resolved gauge\n"
+        "dxwifi_rx_symbols_resolved %u\n"
+        "# HELP dxwifi_rx_rank_deficit Estimated symbols still needed to decode\n"
+        "# TYPE dxwifi_rx_rank_deficit gauge\n"
+        "dxwifi_rx_rank_deficit %u\n"
+        "# HELP dxwifi_rx_decodability 0 unlikely, 1 likely, 2 complete\n"
+        "# TYPE dxwifi_rx_decodability gauge\n"
+        "dxwifi_rx_decodability %d\n"
+        "# HELP dxwifi_rx_antenna_signal_dbm Antenna signal of the last data frame\n"
+        "# TYPE dxwifi_rx_antenna_signal_dbm gauge\n"
+        "dxwifi_rx_antenna_signal_dbm %d\n"
+        "# HELP dxwifi_rx_packets_processed Data frames captured of the object\n"
+        "# TYPE dxwifi_rx_packets_processed gauge\n"
+        "dxwifi_rx_packets_processed %u\n"
+        "# HELP dxwifi_rx_memory_bytes Memory held by libdxwifi and OpenFEC\n"
+        "# TYPE dxwifi_rx_memory_bytes gauge\n"
+        "dxwifi_rx_memory_bytes{kind=\"current\"} %zu\n"
+        "dxwifi_rx_memory_bytes{kind=\"peak\"} %zu\n",
+        stats->manifest.object_id,
+        estimate->k,
+        estimate->n,
+        estimate->source_received,
+        estimate->repair_received,
+        estimate->resolved,
+        estimate->rank_deficit,
+        estimate->state,
+        stats->rtap.ant_signal,
+        stats->num_packets_processed,
+        stats->memory.current,
+        stats->memory.peak
+    );
+    if(fclose(file) != 0 || rename(temp_path, path) != 0) {
+        log_error("Failed to write metrics file: %s - %s", path, strerror(errno));
+    }
 }
 
 
@@ -169,8 +297,10 @@ void sigint_handler(int signum) {
  * 
  *      fd:         Opened file descriptor to output capture data
  * 
+ *      out:        Filled with the capture stats, can be NULL
+ * 
  */
-dxwifi_rx_state_t setup_handlers_and_capture(dxwifi_receiver* rx, int fd) {
+dxwifi_rx_state_t setup_handlers_and_capture(dxwifi_receiver* rx, int fd, dxwifi_rx_stats* out) {
     dxwifi_rx_stats stats;
 
     struct sigaction action = { 0 }, prev_action = { 0 };
@@ -183,9 +313,165 @@ dxwifi_rx_state_t setup_handlers_and_capture(dxwifi_receiver* rx, int fd) {
     sigaction(SIGINT, &prev_action, NULL);
     
     log_rx_stats(stats);
+    if(out) {
+        *out = stats;
+    }
     return stats.capture_state;
 }
 
+/**
+ *  DESCRIPTION:    Checks a decoded object against the manifest announced in 
+ *                  its control frames
+ * 
+ *  ARGUMENTS: 
+ *      
+ *      manifest:   Announced object, ignored if it describes raw bytes
+ * 
+ *      message:    Decoded object
+ * 
+ *      msglen:     Size of the decoded object
+ * 
+ */
+static void verify_manifest(const dxwifi_object_manifest* manifest, const void* message, size_t msglen) {
+    if(manifest->codec == DXWIFI_CODEC_NONE || manifest->size == 0) {
+        return;
+    }
+    if(manifest->size != msglen || manifest->hash != crc32(message, msglen)) {
+        log_warning("Decoded object %u does not match its manifest, Size: %zu / %u", manifest->object_id, msglen, manifest->size);
+    }
+    else {
+        log_info("Decoded object %u matches its manifest", manifest->object_id);
+    }
+}
+
+
+/**
+ *  DESCRIPTION:    Checks whether a decoded object was compressed before it
+ *                  was sent
+ *
+ *  ARGUMENTS:
+ *
+ *      manifest:   Object announced by the transmitter
+ *
+ *      message:    Decoded object
+ *
+ *      msglen:     Size of the decoded object
+ *
+ *  NOTES: The manifest settles it when the preamble was received, otherwise
+ *  the object is checked for a compression header
+ *
+ */
+static bool is_compressed_object(const dxwifi_object_manifest* manifest, const void* message, size_t msglen) {
+    if(manifest->codec == DXWIFI_CODEC_NONE) {
+        return dxwifi_is_compressed(message, msglen);
+    }
+    return manifest->compression != DXWIFI_COMPRESSION_NONE;
+}
+
+
+/**
+ *  DESCRIPTION:    Bundle entry handler, writes a bundled file out next to
+ *                  the capture output
+ *
+ *  ARGUMENTS:
+ *
+ *      See definition of dxwifi_bundle_entry_handler in bundle.h. User is the
+ *      directory to write into
+ *
+ */
+static void write_bundled_file(const char* name, const void* data, size_t size, void* user) {
+    const char* dirname = (const char*) user;
+
+    int open_flags  = O_WRONLY | O_CREAT | O_TRUNC;
+    mode_t mode     = S_IRUSR  | S_IWUSR | S_IROTH | S_IWOTH;
+
+    // Names come off the air, never let one escape the output directory
+    char filename[DXWIFI_BUNDLE_NAME_MAX + 2] = "_";
+    char* safe_name = (name[0] == '\0' || name[0] == '.') ? filename : filename + 1;
+    strncpy(filename + 1, name, DXWIFI_BUNDLE_NAME_MAX);
+    for(char* c = filename; *c; ++c) {
+        if(*c == '/') {
+            *c = '_';
+        }
+    }
+
+    char path[PATH_MAX];
+    combine_path(path, PATH_MAX, dirname, safe_name);
+
+    int fd_out = 0;
+    if((fd_out = open(path, open_flags, mode)) < 0) {
+        log_error("Failed to open file: %s - %s", path, strerror(errno));
+    }
+    else {
+        ssize_t nbytes = write(fd_out, data, size);
+        assert_M(nbytes == (ssize_t) size, "Partial write occured: %d/%d - %s", nbytes, size, strerror(errno));
+        log_info("Unbundled %s, File Size: %zu", path, size);
+        close(fd_out);
+    }
+}
+
+
+/**
+ *  DESCRIPTION:    Splits a received bundle into files in the directory of the
+ *                  capture output path
+ *
+ *  ARGUMENTS:
+ *
+ *      path:       Capture output path
+ *
+ *      message:    Decoded bundle
+ *
+ *      msglen:     Size of the decoded bundle
+ *
+ */
+static void unpack_bundle(const char* path, const void* message, size_t msglen) {
+    char dirname[PATH_MAX] = ".";
+
+    // Keep the trailing separator, combine_path won't add one to a path with a '/'
+    const char* sep = strrchr(path, '/');
+    if(sep) {
+        snprintf(dirname, PATH_MAX, "%.*s", (int) (sep - path + 1), path);
+    }
+
+    ssize_t count = dxwifi_bundle_unpack(message, msglen, write_bundled_file, dirname);
+    if(count < 0) {
+        log_error("Failed to unpack Rx'd bundle");
+    }
+    else {
+        log_info("Unpacked %zd files from Rx'd bundle", count);
+    }
+}
+
+
+/**
+ *  DESCRIPTION:    Writes the raw frames of a capture next to its output
+ * 
+ *  ARGUMENTS: 
+ *      
+ *      path:       Path of the output file, the capture goes to <path>.raw
+ * 
+ *      frames:     Raw frames as captured
+ * 
+ *      nbytes:     Size of the capture
+ * 
+ */
+static void save_capture(const char* path, const void* frames, size_t nbytes) {
+    char raw_path[PATH_MAX];
+    snprintf(raw_path, PATH_MAX, "%s.raw", path);
+
+    int fd = open(raw_path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IROTH | S_IWOTH);
+    if(fd < 0) {
+        log_error("Failed to open file: %s - %s", raw_path, strerror(errno));
+        return;
+    }
+    ssize_t written = write(fd, frames, nbytes);
+    if(written != (ssize_t) nbytes) {
+        log_error("Partial write of capture: %zd/%zu - %s", written, nbytes, strerror(errno));
+    }
+    close(fd);
+}
+
+
 /**
  *  DESCRIPTION:    Attempts to open or create a file and listen for activate 
  *                  packet capture
@@ -198,12 +484,16 @@ dxwifi_rx_state_t setup_handlers_and_capture(dxwifi_receiver* rx, int fd) {
  * 
  *      append:     Oppen file in append mode?
  * 
+ *      keep_capture:
+ *                  Save the raw frames to <path>.raw so captures of the same
+ *                  object can later be merged with `decode`
+ * 
  *  RETURNS:
  *     
  *      dxwifi_rx_state_t:  Last reported state of the receiver
  * 
  */
-dxwifi_rx_state_t open_file_and_capture(const char* path, dxwifi_receiver* rx, bool append) {
+dxwifi_rx_state_t open_file_and_capture(const char* path, dxwifi_receiver* rx, bool append, bool keep_capture) {
     int fd_out      = 0;
     int temp_fd     = 0;
 
@@ -218,35 +508,79 @@ dxwifi_rx_state_t open_file_and_capture(const char* path, dxwifi_receiver* rx, b
     }
     else {
 
-        state = setup_handlers_and_capture(rx, temp_fd);
+        dxwifi_rx_stats stats;
+        state = setup_handlers_and_capture(rx, temp_fd, &stats);
         off_t temp_file_size = get_file_size(RX_TEMP_FILE);
 
         if(temp_file_size > 0) {
             //Map the encoded file to memory
             void* encoded_data = mmap(NULL, temp_file_size, PROT_WRITE, MAP_SHARED, temp_fd, 0);
             assert_M(encoded_data != MAP_FAILED, "Failed to map file to memory - %s", strerror(errno));
+
+            if(keep_capture) {
+                save_capture(path, encoded_data, temp_file_size);
+            }
             
             if(state != DXWIFI_RX_ERROR) {
-                if((fd_out = open(path, open_flags, mode)) < 0) {
-                    log_error("Failed to open file: %s", path);
+                void *decoded_message = NULL;
+
+                // Process CPU time includes the FEC thread pool's workers
+                double wall = clock_seconds(CLOCK_MONOTONIC);
+                double cpu  = clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+                ssize_t decoded_size = dxwifi_decode(encoded_data, temp_file_size, &decoded_message);
+                log_info(
+                    "Stage decode   %8.3fms wall, %8.3fms CPU",
+                    (clock_seconds(CLOCK_MONOTONIC) - wall) * 1e3,
+                    (clock_seconds(CLOCK_PROCESS_CPUTIME_ID) - cpu) * 1e3
+                );
+
+                if(decoded_size > 0) {
+                    verify_manifest(&stats.manifest, decoded_message, decoded_size);
                 }
-                else {
 
-                    void *decoded_message = NULL;
-                    ssize_t decoded_size = dxwifi_decode(encoded_data, temp_file_size, &decoded_message);
+                // The manifest describes the object as sent, so decompress after checking it
+                if(decoded_size > 0 && is_compressed_object(&stats.manifest, decoded_message, decoded_size)) {
+                    void* decompressed = NULL;
+                    ssize_t size = dxwifi_decompress(decoded_message, decoded_size, &decompressed);
+                    if(size >= 0) {
+                        log_info("Decompressed RX'd object, %zd bytes to %zd", decoded_size, size);
+                        free(decoded_message);
+                        decoded_message = decompressed;
+                        decoded_size    = size;
+                    }
+                    else {
+                        log_error("Failed to decompress RX'd object, writing it compressed");
+                    }
+                }
 
+                if(decoded_size > 0 && dxwifi_is_bundle(decoded_message, decoded_size)) {
+                    log_info("Decoding Success for RX'd bundle, Bundle Size: %d", decoded_size);
+                    unpack_bundle(path, decoded_message, decoded_size);
+                }
+                else if((fd_out = open(path, open_flags, mode)) < 0) {
+                    log_error("Failed to open file: %s", path);
+                }
+                else {
                     if(decoded_size > 0) {
                         log_info("Decoding Success for RX'd file, File Size: %d", decoded_size);
 
+                        DXWIFI_PROBE2(write__start, fd_out, decoded_size);
                         ssize_t nbytes = write(fd_out, decoded_message, decoded_size);
+                        DXWIFI_PROBE2(write__done, fd_out, nbytes);
                         assert_M(decoded_size == nbytes, "Partial write occured: %d/%d - %s", nbytes, decoded_size, strerror(errno));
-                        free(decoded_message);
                     }
                     else{
                         log_error("Failed to Decode Rx'd file, Error: %s", dxwifi_fec_error_to_str(decoded_size));
+
+                        // A deferred object may still decode without the budget
+                        if(decoded_size == FEC_ERROR_DECODE_DEFERRED && !keep_capture) {
+                            log_info("Keeping the capture as %s.raw for decode", path);
+                            save_capture(path, encoded_data, temp_file_size);
+                        }
                     }
                     close(fd_out);
                 }
+                free(decoded_message);
             }
             munmap(encoded_data, temp_file_size);
         }
@@ -278,7 +612,7 @@ void capture_in_directory(cli_args* args, dxwifi_receiver* rx) {
     while(state == DXWIFI_RX_NORMAL) {
         snprintf(path, PATH_MAX, "%s/%s_%.5d.%s", args->output_path, args->file_prefix, count++, args->file_extension);
 
-        state = open_file_and_capture(path, rx, args->append);
+        state = open_file_and_capture(path, rx, args->append, args->keep_capture);
     }
 }
 
@@ -298,11 +632,11 @@ void receive(cli_args* args, dxwifi_receiver* rx) {
     switch (args->rx_mode)
     {
     case RX_STREAM_MODE: // Capture everything and output to stdout
-        setup_handlers_and_capture(rx, STDOUT_FILENO);
+        setup_handlers_and_capture(rx, STDOUT_FILENO, NULL);
         break;
 
     case RX_FILE_MODE: // Capture everything into a single file
-        open_file_and_capture(args->output_path, rx, args->append);
+        open_file_and_capture(args->output_path, rx, args->append, args->keep_capture);
         break;
 
     case RX_DIRECTORY_MODE: // Create new files whenever an EOT is signalled
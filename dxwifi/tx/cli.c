@@ -21,10 +21,13 @@
 
 #define PRIMARY_GROUP           0
 #define DIRECTORY_MODE_GROUP    1000
+#define BUNDLE_MODE_GROUP       1250
+#define UEP_MODE_GROUP          1375
 #define MAC_HEADER_GROUP        1500
 #define RTAP_CONF_GROUP         2000
 #define RTAP_FLAGS_GROUP        2500
 #define RTAP_TX_FLAGS_GROUP     3000
+#define AIR_GROUP               3250
 #define HELP_GROUP              3500
 
 #if defined(DXWIFI_TESTS)
@@ -42,6 +45,25 @@ typedef enum {
 } directory_mode_settings_t;
 
 
+typedef enum {
+    BUNDLE_SIZE,
+    BUNDLE_AGE,
+} bundle_mode_settings_t;
+
+
+typedef enum {
+    UEP_FLAG,
+    UEP_CODERATE,
+    UEP_CRITICAL_RANGE,
+} uep_mode_settings_t;
+
+
+typedef enum {
+    AIR_NAME,
+    AIR_CHANNEL,
+} air_settings_t;
+
+
 const char* argp_program_version = DXWIFI_VERSION;
 
 // Description of key arguments 
@@ -66,6 +88,10 @@ static struct argp_option opts[] = {
     { "error-rate" ,    'e',  "<float>",            0,  "Numbers bits flipped",                                                          PRIMARY_GROUP },
     { "enable-pa",      'E',  0,                    0,  "Enable Power Amplifer (Only works on OreSat DxWiFi board)",                     PRIMARY_GROUP },
     { "coderate",       'c',  "<float>",            0,  "Coderate for FEC encoding",                                                     PRIMARY_GROUP },
+    { "inner-code",     'i',  "<rs|crc|none>",      0,  "Inner code protecting each FEC frame, weaker codes carry more data",            PRIMARY_GROUP },
+    { "compress",       'z',  "<lz4|zstd|none>",    0,  "Compress objects before FEC encoding, already compressed data is sent as is",   PRIMARY_GROUP },
+    { "mem-budget",     'M',  "<bytes>",            0,  "Refuse to encode objects that would need more memory than this, 0 for no limit", PRIMARY_GROUP },
+    { "fountain",       'F',  0,                    0,  "Fountain encode objects, every retransmission sends fresh repair symbols",      PRIMARY_GROUP },
 
     { 0, 0, 0, OPTION_DOC, "The following settings are only applicable when reading from a directory", DIRECTORY_MODE_GROUP },
     { "filter",         GET_KEY(FILE_FILTER,        DIRECTORY_MODE_GROUP),  "<glob>",       OPTION_NO_USAGE,  "Only transmit files whose filename matches the filter",      DIRECTORY_MODE_GROUP },
@@ -73,6 +99,15 @@ static struct argp_option opts[] = {
     { "no-listen",      GET_KEY(NO_LISTEN_FLAG,     DIRECTORY_MODE_GROUP),  0,              OPTION_NO_USAGE,  "Don't listen for new files in the directory",                DIRECTORY_MODE_GROUP },
     { "watch-timeout",  GET_KEY(WATCHDIR_TIMEOUT,   DIRECTORY_MODE_GROUP),  "<seconds>",    OPTION_NO_USAGE,  "Number of seconds to listen for new files",                  DIRECTORY_MODE_GROUP },
 
+    { 0, 0, 0, OPTION_DOC, "The following settings pack small files into a single FEC object", BUNDLE_MODE_GROUP },
+    { "bundle-size",    GET_KEY(BUNDLE_SIZE,        BUNDLE_MODE_GROUP),     "<bytes>",      OPTION_NO_USAGE,  "Bundle files smaller than this, and send a bundle once it reaches this size",  BUNDLE_MODE_GROUP },
+    { "bundle-age",     GET_KEY(BUNDLE_AGE,         BUNDLE_MODE_GROUP),     "<seconds>",    OPTION_NO_USAGE,  "Send a bundle once its oldest file has waited this long, 0 to wait for size", BUNDLE_MODE_GROUP },
+
+    { 0, 0, 0, OPTION_DOC, "The following settings give the headers of each file extra protection", UEP_MODE_GROUP },
+    { "uep",            GET_KEY(UEP_FLAG,           UEP_MODE_GROUP),        0,                  OPTION_NO_USAGE,  "Send the headers of JPEGs, PNGs and bundles as a separate, better protected block", UEP_MODE_GROUP },
+    { "uep-coderate",   GET_KEY(UEP_CODERATE,       UEP_MODE_GROUP),        "<float>",          OPTION_NO_USAGE,  "Coderate of the header block, implies --uep",                                      UEP_MODE_GROUP },
+    { "critical",       GET_KEY(UEP_CRITICAL_RANGE, UEP_MODE_GROUP),        "<offset:length>",  OPTION_NO_USAGE,  "Protect this byte range of each file instead of its header, implies --uep",       UEP_MODE_GROUP },
+
     { 0, 0, 0, OPTION_DOC, "IEEE80211 MAC Header Configuration Options", MAC_HEADER_GROUP },
     { "address",        GET_KEY(1, MAC_HEADER_GROUP), "<macaddr>", OPTION_NO_USAGE, "MAC address of the transmitter", MAC_HEADER_GROUP },
 
@@ -87,6 +122,10 @@ static struct argp_option opts[] = {
     { "sequence",       GET_KEY(IEEE80211_RADIOTAP_F_TX_NOSEQNO,    RTAP_TX_FLAGS_GROUP),   0,          OPTION_NO_USAGE,  "Tx includes preconfigured sequence id",  RTAP_TX_FLAGS_GROUP },
     { "ordered",        GET_KEY(IEEE80211_RADIOTAP_F_TX_ORDER,      RTAP_TX_FLAGS_GROUP),   0,          OPTION_NO_USAGE,  "Tx should not be reordered",             RTAP_TX_FLAGS_GROUP },
 
+    { 0, 0, 0, OPTION_DOC, "The following settings transmit on a virtual air interface instead of a device, see the air program", AIR_GROUP },
+    { "air",            GET_KEY(AIR_NAME,       AIR_GROUP),     "<name>",       OPTION_ARG_OPTIONAL | OPTION_NO_USAGE,  "Transmit on this shared memory medium (default: " DXWIFI_AIR_DFLT_NAME ")",                     AIR_GROUP },
+    { "channel",        GET_KEY(AIR_CHANNEL,    AIR_GROUP),     "<settings>",   OPTION_NO_USAGE,                        "Impair every frame sent, e.g. loss=0.1,ber=1e-6,fade=0.01:0.2,delay=5,rate=6000 (kbps)",  AIR_GROUP },
+
     { 0, 0, 0, OPTION_DOC, "Help Options", HELP_GROUP },
     { "verbose",    'v', 0, 0, "Verbosity level",           HELP_GROUP },
     { "syslog",     's', 0, 0, "Use SysLog for messages",   HELP_GROUP }, 
@@ -101,6 +140,25 @@ static struct argp_option opts[] = {
 };
 
 
+// Parse an <offset>:<length> byte range
+static bool parse_priority_range(const char* arg, dxwifi_priority_range* range) {
+    char* end = NULL;
+
+    unsigned long offset = strtoul(arg, &end, 0);
+    if(end == arg || *end != ':') {
+        return false;
+    }
+    const char* length_str = end + 1;
+    unsigned long length = strtoul(length_str, &end, 0);
+    if(end == length_str || *end != '\0' || length == 0 || offset > UINT32_MAX || length > UINT32_MAX) {
+        return false;
+    }
+    range->offset = offset;
+    range->length = length;
+    return true;
+}
+
+
 // TODO all these atois() need error handling
 static error_t parse_opt(int key, char* arg, struct argp_state *state) {
 
@@ -221,6 +279,34 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
         }
         break;
 
+    case 'i':
+        args->inner_code = dxwifi_fec_inner_code_from_str(arg);
+        if(args->inner_code == DXWIFI_FEC_INNER_CODE_COUNT) {
+            argp_error(state, "Error: Inner code must be one of rs, crc or none.");
+            argp_usage(state);
+        }
+        break;
+
+    case 'z':
+        args->compression = dxwifi_compression_from_str(arg);
+        if(args->compression == DXWIFI_COMPRESSION_COUNT) {
+            argp_error(state, "Error: Compression must be one of lz4, zstd or none.");
+            argp_usage(state);
+        }
+        else if(!dxwifi_compression_supported(args->compression)) {
+            argp_error(state, "Error: %s compression is not supported by this build.", arg);
+            argp_usage(state);
+        }
+        break;
+
+    case 'M':
+        args->mem_budget = strtoul(arg, NULL, 0);
+        break;
+
+    case 'F':
+        args->fountain = true;
+        break;
+
     case GET_KEY(FILE_FILTER, DIRECTORY_MODE_GROUP):
         args->file_filter = arg;
         break;
@@ -237,6 +323,42 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
         args->dirwatch_timeout = atoi(arg);
         break;
 
+    case GET_KEY(BUNDLE_SIZE, BUNDLE_MODE_GROUP):
+        args->bundle_size = strtoul(arg, NULL, 0);
+        break;
+
+    case GET_KEY(BUNDLE_AGE, BUNDLE_MODE_GROUP):
+        args->bundle_age = atoi(arg);
+        break;
+
+    case GET_KEY(UEP_FLAG, UEP_MODE_GROUP):
+        args->uep = true;
+        break;
+
+    case GET_KEY(UEP_CODERATE, UEP_MODE_GROUP):
+        args->uep = true;
+        args->uep_coderate = atof(arg);
+        if(args->uep_coderate <= 0 || args->uep_coderate > 1) {
+            argp_error(state, "Error: UEP coderate must be a decimal between 0 and 1.");
+            argp_usage(state);
+        }
+        break;
+
+    case GET_KEY(UEP_CRITICAL_RANGE, UEP_MODE_GROUP):
+        args->uep = true;
+        if(args->critical_count == DXWIFI_UEP_MAX_RANGES) {
+            argp_error(state, "Error: At most %d critical ranges can be given.", DXWIFI_UEP_MAX_RANGES);
+            argp_usage(state);
+        }
+        else if(!parse_priority_range(arg, &args->critical_ranges[args->critical_count])) {
+            argp_error(state, "Error: Critical range must be <offset>:<length>.");
+            argp_usage(state);
+        }
+        else {
+            ++args->critical_count;
+        }
+        break;
+
     case GET_KEY(1, MAC_HEADER_GROUP):
         if(!parse_mac_address(arg, args->tx.address)) {
             argp_error(state, "Mac address must be 6 octets in hexadecimal format delimited by a ':'");
@@ -282,6 +404,16 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
         args->tx.rtap_tx_flags |= IEEE80211_RADIOTAP_F_TX_ORDER;
         break;
 
+    case GET_KEY(AIR_NAME, AIR_GROUP):
+        args->tx.air = arg ? arg : DXWIFI_AIR_DFLT_NAME;
+        break;
+
+    case GET_KEY(AIR_CHANNEL, AIR_GROUP):
+        if(!dxwifi_air_parse_channel(arg, &args->tx.air_channel)) {
+            argp_error(state, "Invalid channel settings: %s", arg);
+        }
+        break;
+
 #if defined(DXWIFI_TESTS)
     case GET_KEY(1, TEST_GROUP):
         args->tx.savefile = arg;
@@ -8,6 +8,8 @@
  */
 
 
+#include <libdxwifi/fec.h>
+#include <libdxwifi/compress.h>
 #include <libdxwifi/transmitter.h>
 #include <libdxwifi/details/daemon.h>
 
@@ -38,6 +40,8 @@ typedef struct {
     bool                transmit_current_files;
     bool                listen_for_new_files;
     int                 dirwatch_timeout; 
+    size_t              bundle_size;
+    unsigned            bundle_age;
     int                 verbosity;
     bool                quiet;
     bool                use_syslog;
@@ -48,6 +52,14 @@ typedef struct {
     float               error_rate;
     dxwifi_transmitter  tx;
     float               coderate;
+    dxwifi_fec_inner_code_t inner_code;
+    dxwifi_compression_t compression;
+    bool                uep;
+    float               uep_coderate;
+    dxwifi_priority_range critical_ranges[DXWIFI_UEP_MAX_RANGES];
+    size_t              critical_count;
+    bool                fountain;
+    size_t              mem_budget;
 } cli_args;
 
 
@@ -64,13 +76,22 @@ typedef struct {
         .transmit_current_files     = false,\
         .listen_for_new_files       = true,\
         .dirwatch_timeout           = -1,\
+        .bundle_size                = 0,\
+        .bundle_age                 = 30,\
         .tx_delay                   = 0,\
         .file_delay                 = 0,\
         .device                     = "mon0",\
         .error_rate                 = 0,\
         .packet_loss                = 0,\
         .tx                         = DXWIFI_TRANSMITTER_DFLT_INITIALIZER,\
-        .coderate                   = 0.667\
+        .coderate                   = 0.667,\
+        .inner_code                 = DXWIFI_FEC_INNER_RS,\
+        .compression                = DXWIFI_COMPRESSION_NONE,\
+        .uep                        = false,\
+        .uep_coderate               = DXWIFI_UEP_DFLT_CODERATE,\
+        .critical_count             = 0,\
+        .fountain                   = false,\
+        .mem_budget                 = 0\
     }\
 
 
@@ -12,10 +12,35 @@
 typedef struct {
     float packet_loss_rate;
     unsigned count;
+    unsigned seed;
 } packet_loss_stats;
 
+typedef struct {
+    float error_rate;
+    unsigned seed;
+} bit_error_stats;
+
+typedef struct {
+    dxwifi_bundle   bundle;     /* Small files waiting to be sent           */
+    size_t          max_size;   /* Send the bundle once it reaches this     */
+    unsigned        max_age;    /* Seconds a file may wait in the bundle    */
+} tx_bundler;
+
+typedef struct {
+    float                           coderate;   /* Coderate of the critical block       */
+    const dxwifi_priority_range*    ranges;     /* Fixed ranges, detected when empty    */
+    size_t                          count;      /* Number of fixed ranges               */
+} tx_uep;
+
 static dirwatch* dirwatch_handle = NULL;
 static dxwifi_transmitter* transmitter = NULL;
+static tx_bundler* bundler = NULL;
+static tx_uep* uep = NULL;
+static bool fountain = false;
+
+static volatile sig_atomic_t watching = false;
+static unsigned dirwatch_events = 0;
+static unsigned encode_failures = 0;
 
 
 int main(int argc, char** argv) {
@@ -46,16 +71,24 @@ int main_worker(int argc, char** argv) {
 
     srand(seed);
 
+    dxwifi_mem_set_budget(DXWIFI_MEM_ALL_SUBSYSTEMS, args.mem_budget);
+
     init_transmitter(transmitter, args.device);
 
     transmit(&args, transmitter);
 
     close_transmitter(transmitter);
 
+    dxwifi_mem_log_usage();
+
     if(args.daemon == DAEMON_START) { // This process is the daemon, tear it down
         stop_daemon(args.pid_file);
     }
 
+    if(encode_failures > 0) {
+        log_error("%u message(s) could not be encoded", encode_failures);
+        return 1;
+    }
     return 0;
 }
 
@@ -97,6 +130,7 @@ void tx_sigint_handler(int signum) {
  *
  */
 void watchdir_sigint_handler(int signum) {
+    watching = false;
     dirwatch_stop(dirwatch_handle);
 }
 
@@ -175,7 +209,7 @@ bool delay_transmission(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* use
 bool packet_loss_sim(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user) {
     packet_loss_stats * plstats = (packet_loss_stats*) user;
     //generate random num withing range
-    float random = (float)rand() / (float)RAND_MAX;
+    float random = (float)rand_r(&plstats->seed) / (float)RAND_MAX;
 
     if(plstats->packet_loss_rate > random){
         plstats->count++;
@@ -194,7 +228,8 @@ bool packet_loss_sim(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user)
  *
  */
 bool bit_error_rate_sim(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user) {
-    float error_rate = *(float*) user;
+    bit_error_stats* bestats = (bit_error_stats*) user;
+    float error_rate = bestats->error_rate;
 
     int frame_size = DXWIFI_TX_FRAME_SIZE - DXWIFI_TX_RADIOTAP_HDR_SIZE;
     int total_num_errors = DXWIFI_TX_FRAME_SIZE * 8 * error_rate; //Get total number of errors
@@ -207,8 +242,8 @@ bool bit_error_rate_sim(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* use
     uint8_t* buffer = ((uint8_t*)frame) + DXWIFI_TX_RADIOTAP_HDR_SIZE;
 
     for(int i = 0; i < total_num_errors; ++i){
-        uint32_t chosen_byte = rand() % frame_size;
-        int chosen_bit = 1 << (rand() % 8);
+        uint32_t chosen_byte = rand_r(&bestats->seed) % frame_size;
+        int chosen_bit = 1 << (rand_r(&bestats->seed) % 8);
 
         if((bit_array[chosen_byte] & chosen_bit) == 0) { //Flip bit if unseen
             buffer[chosen_byte] ^= chosen_bit; // Toggle bit in frame
@@ -223,25 +258,6 @@ bool bit_error_rate_sim(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* use
 }
 
 
-/**
- *  DESCRIPTION:    Called before every frame is injected, packs the current
- *                  frame count into the last four bytes of the MAC headers
- *                  addr1 field
- *
- *  ARGUMENTS:
- *
- *      See definition of dxwifi_tx_frame_cb in transmitter.h
- *
- */
-bool attach_frame_number(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user) {
-    uint32_t frame_no = htonl(stats.data_frame_count);
-
-    memcpy(frame->mac_hdr.addr1 + 2, &frame_no, sizeof(uint32_t));
-
-    return true;
-}
-
-
 /**
  *  DESCRIPTION:    Setups and tearsdown SIGINT handlers to control transmission
  *
@@ -270,9 +286,272 @@ dxwifi_tx_state_t setup_handlers_and_transmit(dxwifi_transmitter* tx, int fd) {
 }
 
 
+/**
+ *  DESCRIPTION:    Clips fixed critical ranges to the size of a message
+ *
+ *  ARGUMENTS:
+ *
+ *      ranges:     Ranges from the command line
+ *
+ *      count:      Number of ranges
+ *
+ *      msglen:     Size of the message in bytes
+ *
+ *      out:        Filled with the ranges that overlap the message
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Number of ranges in out
+ *
+ */
+static size_t clip_priority_ranges(const dxwifi_priority_range* ranges, size_t count, size_t msglen, dxwifi_priority_range* out) {
+    size_t nranges = 0;
+    for(size_t i = 0; i < count; ++i) {
+        if(ranges[i].offset < msglen) {
+            out[nranges].offset = ranges[i].offset;
+            out[nranges].length = ranges[i].length < msglen - ranges[i].offset ? ranges[i].length : msglen - ranges[i].offset;
+            ++nranges;
+        }
+    }
+    return nranges;
+}
+
+
+/**
+ *  DESCRIPTION:    Fountain encodes and transmits a message. Each pass sends
+ *                  K / coderate fresh frames from the same encoder
+ *
+ *  ARGUMENTS:
+ *
+ *      See transmit_message, the message is already compressed
+ *
+ *      compression:
+ *                  Compression announced in the manifest
+ *
+ *      stats:      Updated by every pass
+ *
+ *  NOTES: Frames aren't repeated until the 16 bit ESIs wrap, so a receiver 
+ *  that missed part of one pass is topped up by new repair symbols from the 
+ *  next rather than copies of what it already has.
+ *
+ */
+static void transmit_fountain(dxwifi_transmitter* tx, void* message, size_t msglen, unsigned delay, int retransmit_count, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_compression_t compression, dxwifi_tx_stats* stats) {
+    dxwifi_fountain_encoder encoder;
+    int err = dxwifi_fountain_init(&encoder, message, msglen, inner_code);
+    if(err < 0) {
+        log_error("Unable to FEC Encode message - %s", dxwifi_fec_error_to_str(err));
+        ++encode_failures;
+        return;
+    }
+
+    dxwifi_object_manifest manifest;
+    dxwifi_fountain_manifest(message, msglen, coderate, inner_code, &manifest);
+    manifest.compression = compression;
+
+    int count = retransmit_count;
+
+    bool transmit_forever = (retransmit_count == -1);
+    while((count >= 0 || transmit_forever) && stats->tx_state == DXWIFI_TX_NORMAL) {
+
+        void* encoded_message = NULL;
+        ssize_t msg_size = dxwifi_fountain_encode(&encoder, manifest.n, &encoded_message);
+        if(msg_size < 0) {
+            log_error("Unable to FEC Encode message - %s", dxwifi_fec_error_to_str(msg_size));
+            ++encode_failures;
+            break;
+        }
+        transmit_object(tx, encoded_message, msg_size, &manifest, stats);
+        free(encoded_message);
+
+        msleep(delay, false);
+
+        --count;
+    }
+    dxwifi_fountain_close(&encoder);
+}
+
+
+/**
+ *  DESCRIPTION:    FEC encodes a message and transmits it
+ *
+ *  ARGUMENTS:
+ *
+ *      tx:         Initialized transmitter
+ *
+ *      message:    Message to encode and transmit
+ *
+ *      msglen:     Size of the message in bytes
+ *
+ *      delay:      Millisecond delay to add after each transmission
+ *
+ *      retransmit_count:
+ *                  Number of times to retransmit the message. If the count is
+ *                  -1 then the message will be retransmitted forever or until
+ *                  the transmitter reports a timeout or error
+ *
+ *      coderate:   Coderate for FEC encoding
+ *
+ *      inner_code: Inner code protecting each FEC frame
+ *
+ *      compression:
+ *                  Compression applied before encoding, skipped when the
+ *                  message doesn't get any smaller
+ *
+ *  NOTES: When unequal error protection is enabled the critical ranges of the
+ *  message are sent first as a separate, more heavily protected block. In
+ *  fountain mode the message is sent with transmit_fountain instead and 
+ *  unequal error protection does not apply
+ *
+ *  RETURNS:
+ *
+ *      dxwifi_tx_state_t: The last reported state of the transmitter
+ *
+ */
+dxwifi_tx_state_t transmit_message(dxwifi_transmitter* tx, void* message, size_t msglen, unsigned delay, int retransmit_count, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_compression_t compression) {
+    dxwifi_tx_stats stats = { .tx_state = DXWIFI_TX_NORMAL };
+
+    void* compressed = NULL;
+    size_t compressed_size = dxwifi_compress(message, msglen, compression, &compressed);
+    if(compressed_size > 0) {
+        message = compressed;
+        msglen  = compressed_size;
+    }
+
+    if(fountain) {
+        transmit_fountain(tx, message, msglen, delay, retransmit_count, coderate, inner_code, compressed_size > 0 ? compression : DXWIFI_COMPRESSION_NONE, &stats);
+        free(compressed);
+        return stats.tx_state;
+    }
+
+    dxwifi_priority_range ranges[DXWIFI_UEP_MAX_RANGES];
+    size_t nranges = 0;
+
+    // Critical ranges point into the original file, a compressed object has to
+    // arrive whole to be of any use
+    if(uep && compressed_size == 0) {
+        nranges = uep->count ? clip_priority_ranges(uep->ranges, uep->count, msglen, ranges) : dxwifi_find_critical_ranges(message, msglen, ranges, DXWIFI_UEP_MAX_RANGES);
+    }
+
+    void *encoded_message = NULL;
+    ssize_t msg_size = dxwifi_encode_uep(message, msglen, ranges, nranges, uep ? uep->coderate : coderate, coderate, inner_code, &encoded_message);
+
+    if(msg_size > 0) {
+        log_info("Encoding Success, Encoded size: %zd", msg_size);
+
+        dxwifi_object_manifest manifest;
+        dxwifi_fec_manifest(message, msglen, coderate, inner_code, &manifest);
+        manifest.compression = compressed_size > 0 ? compression : DXWIFI_COMPRESSION_NONE;
+        manifest.n = msg_size / DXWIFI_RS_LDPC_FRAME_SIZE;
+
+        int count = retransmit_count;
+
+        bool transmit_forever = (retransmit_count == -1);
+        while((count >= 0 || transmit_forever) && stats.tx_state == DXWIFI_TX_NORMAL) {
+
+            transmit_object(tx, encoded_message, msg_size, &manifest, &stats);
+
+            msleep(delay, false);
+
+            --count;
+        }
+        free(encoded_message);
+    }
+    else {
+        log_error("Unable to FEC Encode message - %s", dxwifi_fec_error_to_str(msg_size));
+        ++encode_failures;
+    }
+    free(compressed);
+    return stats.tx_state;
+}
+
+
+/**
+ *  DESCRIPTION:    Transmits and empties the pending bundle, if there is one
+ *
+ *  ARGUMENTS:
+ *
+ *      See transmit_message
+ *
+ *  RETURNS:
+ *
+ *      dxwifi_tx_state_t: The last reported state of the transmitter
+ *
+ */
+dxwifi_tx_state_t flush_bundle(dxwifi_transmitter* tx, unsigned delay, int retransmit_count, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_compression_t compression) {
+    dxwifi_tx_state_t state = DXWIFI_TX_NORMAL;
+
+    void* packed = NULL;
+    size_t packed_size = 0;
+
+    if(bundler && (packed_size = dxwifi_bundle_pack(&bundler->bundle, &packed)) > 0) {
+        state = transmit_message(tx, packed, packed_size, delay, retransmit_count, coderate, inner_code, compression);
+        free(packed);
+    }
+    return state;
+}
+
+
+/**
+ *  DESCRIPTION:    Checks whether the pending bundle should be sent
+ *
+ *  RETURNS:
+ *
+ *      bool:       True if the bundle has reached its size or age limit
+ *
+ */
+static bool bundle_is_due(void) {
+    return bundler
+        && dxwifi_bundle_size(&bundler->bundle) > 0
+        && (dxwifi_bundle_size(&bundler->bundle) >= bundler->max_size
+            || (bundler->max_age > 0 && dxwifi_bundle_age(&bundler->bundle) >= bundler->max_age));
+}
+
+
+/**
+ *  DESCRIPTION:    Adds a small file to the pending bundle, sending the bundle
+ *                  when it fills up
+ *
+ *  ARGUMENTS:
+ *
+ *      name:       Name of the file
+ *
+ *      data:       File contents
+ *
+ *      size:       Size of the file
+ *
+ *      See transmit_message for the remaining arguments
+ *
+ *  RETURNS:
+ *
+ *      dxwifi_tx_state_t: The last reported state of the transmitter
+ *
+ */
+dxwifi_tx_state_t bundle_file(dxwifi_transmitter* tx, const char* name, const void* data, size_t size, unsigned delay, int retransmit_count, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_compression_t compression) {
+    dxwifi_tx_state_t state = DXWIFI_TX_NORMAL;
+
+    // Send what is queued first rather than let this file push the bundle past its limit
+    size_t entry_size = sizeof(dxwifi_bundle_entry_hdr) + strlen(name) + size;
+    if(dxwifi_bundle_size(&bundler->bundle) + entry_size > bundler->max_size) {
+        state = flush_bundle(tx, delay, retransmit_count, coderate, inner_code, compression);
+    }
+
+    if(!dxwifi_bundle_add(&bundler->bundle, name, data, size)) {
+        state = flush_bundle(tx, delay, retransmit_count, coderate, inner_code, compression);
+        dxwifi_bundle_add(&bundler->bundle, name, data, size);
+    }
+    log_info("Bundled %s, %u files pending", name, bundler->bundle.count);
+
+    if(state == DXWIFI_TX_NORMAL && bundle_is_due()) {
+        state = flush_bundle(tx, delay, retransmit_count, coderate, inner_code, compression);
+    }
+    return state;
+}
+
+
 /**
  *  DESCRIPTION:    Iterates through a list of file names, opens them, and
- *                  transmits them
+ *                  transmits them. When bundling is enabled files smaller than
+ *                  the bundle size are queued into a bundle instead
  *
  *  ARGUMENTS:
  *
@@ -288,16 +567,22 @@ dxwifi_tx_state_t setup_handlers_and_transmit(dxwifi_transmitter* tx, int fd) {
  *                  transmitter reports a timeout or error
  *		coderate:
  *					Coderate for FEC encoding.
+ *
+ *      inner_code: Inner code protecting each FEC frame
+ *
+ *      compression:
+ *                  Compression applied to each file before encoding
+ *
  *  RETURNS:
  *
  *      dxwifi_tx_state_t: The last reported state of the transmitter
  *
  */
-dxwifi_tx_state_t transmit_files(dxwifi_transmitter* tx, char** files, size_t num_files, unsigned delay, int retransmit_count, float coderate) {
+dxwifi_tx_state_t transmit_files(dxwifi_transmitter* tx, char** files, size_t num_files, unsigned delay, int retransmit_count, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_compression_t compression) {
     int fd = 0;
-    dxwifi_tx_stats stats = { .tx_state = DXWIFI_TX_NORMAL };
+    dxwifi_tx_state_t state = DXWIFI_TX_NORMAL;
 
-    for(size_t i = 0; i < num_files && stats.tx_state == DXWIFI_TX_NORMAL; ++i) {
+    for(size_t i = 0; i < num_files && state == DXWIFI_TX_NORMAL; ++i) {
         if((fd = open(files[i], O_RDONLY)) < 0) {
             log_error("Failed to open file: %s - %s", files[i], strerror(errno));
         }
@@ -308,34 +593,17 @@ dxwifi_tx_state_t transmit_files(dxwifi_transmitter* tx, char** files, size_t nu
             void* file_data = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
             assert_M(file_data != MAP_FAILED, "Failed to map file to memory - %s", strerror(errno));
 
-            void *encoded_message = NULL;
-            size_t msg_size = dxwifi_encode(file_data, file_size, coderate, &encoded_message);
-
-            if(msg_size > 0){
-
-            	log_info("Encoding Success for file: [%s], Filesize: %d", files[i], msg_size);
-
-            	int count = retransmit_count;
-
-            	bool transmit_forever = (retransmit_count == -1);
-                while((count >= 0 || transmit_forever) && stats.tx_state == DXWIFI_TX_NORMAL) {
-
-                	transmit_bytes(tx, encoded_message, msg_size, &stats);
-                	
-                	msleep(delay, false);
-
-                	free(encoded_message);
-                	--count;
-                }
+            if(bundler && (size_t) file_size < bundler->max_size) {
+                state = bundle_file(tx, files[i], file_data, file_size, delay, retransmit_count, coderate, inner_code, compression);
             }
-            else {	
-                log_error("Unable to FEC Encode File [%s]", files[i]);	
+            else {
+                state = transmit_message(tx, file_data, file_size, delay, retransmit_count, coderate, inner_code, compression);
             }
             close(fd);
             munmap(file_data, file_size);
         }
     }
-    return stats.tx_state;
+    return state;
 }
 
 
@@ -354,8 +622,13 @@ dxwifi_tx_state_t transmit_files(dxwifi_transmitter* tx, char** files, size_t nu
  *
  *		coderate:   Coderate for FEC Encoding
  *
+ *      inner_code: Inner code protecting each FEC frame
+ *
+ *      compression:
+ *                  Compression applied to each file before encoding
+ *
  */
-void transmit_directory_contents(dxwifi_transmitter* tx, const char* filter, const char* dirname, unsigned delay, int retransmit_count, float coderate) {
+void transmit_directory_contents(dxwifi_transmitter* tx, const char* filter, const char* dirname, unsigned delay, int retransmit_count, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_compression_t compression) {
     DIR* dir;
     struct dirent* file;
     dxwifi_tx_state_t state = DXWIFI_TX_NORMAL;
@@ -369,7 +642,7 @@ void transmit_directory_contents(dxwifi_transmitter* tx, const char* filter, con
             if(fnmatch(filter, file->d_name, 0) == 0) {
                 combine_path(path_buffer, PATH_MAX, dirname, file->d_name);
                 if(is_regular_file(path_buffer)) {
-                    state = transmit_files(tx, &path_buffer, 1, delay, retransmit_count, coderate);
+                    state = transmit_files(tx, &path_buffer, 1, delay, retransmit_count, coderate, inner_code, compression);
                 }
             }
         }
@@ -392,16 +665,55 @@ void transmit_directory_contents(dxwifi_transmitter* tx, const char* filter, con
 static void transmit_new_file(const dirwatch_event* event, void* user) {
     cli_args* args = (cli_args*) user;
 
+    ++dirwatch_events;
+
     char* path_buffer = calloc(PATH_MAX, sizeof(char));
 
     combine_path(path_buffer, PATH_MAX, event->dirname, event->filename);
 
-    transmit_files(&args->tx, &path_buffer, 1, args->file_delay, args->retransmit_count, args-> coderate);
+    transmit_files(&args->tx, &path_buffer, 1, args->file_delay, args->retransmit_count, args->coderate, args->inner_code, args->compression);
 
     free(path_buffer);
 }
 
 
+/**
+ *  DESCRIPTION:    Listens for new files while making sure a pending bundle is
+ *                  never held longer than the bundle age. dirwatch_listen only
+ *                  returns on a timeout, so the listen is split into slices of
+ *                  the bundle age and the dirwatch timeout is tracked here.
+ *
+ *  ARGUMENTS:
+ *
+ *      args:       Parsed command line arguments
+ *
+ *      tx:         Initialized transmitter
+ *
+ */
+static void listen_and_flush_bundles(cli_args* args, dxwifi_transmitter* tx) {
+    int timeout_ms = args->dirwatch_timeout * 1000;
+    int slice_ms   = bundler->max_age * 1000;
+    int idle_ms    = 0;
+
+    watching = true;
+    while(watching && (timeout_ms < 0 || idle_ms < timeout_ms)) {
+        unsigned events = dirwatch_events;
+
+        int wait_ms = slice_ms;
+        if(timeout_ms >= 0 && timeout_ms - idle_ms < wait_ms) {
+            wait_ms = timeout_ms - idle_ms;
+        }
+        dirwatch_listen(dirwatch_handle, wait_ms, transmit_new_file, args);
+
+        idle_ms = (events == dirwatch_events) ? idle_ms + wait_ms : 0;
+
+        if(bundle_is_due()) {
+            flush_bundle(tx, args->file_delay, args->retransmit_count, args->coderate, args->inner_code, args->compression);
+        }
+    }
+}
+
+
 /**
  *  DESCRIPTION:    Transmits current directory contents and listens for newly
  *                  created files to transmit
@@ -418,7 +730,7 @@ void transmit_directory(cli_args* args, dxwifi_transmitter* tx) {
     const char* dirname = args->files[0];
 
     if(args->transmit_current_files) {
-        transmit_directory_contents(tx, args->file_filter, dirname, args->file_delay, args->retransmit_count, args->coderate);
+        transmit_directory_contents(tx, args->file_filter, dirname, args->file_delay, args->retransmit_count, args->coderate, args->inner_code, args->compression);
     }
     if(args->listen_for_new_files) {
 
@@ -434,12 +746,18 @@ void transmit_directory(cli_args* args, dxwifi_transmitter* tx) {
         action.sa_handler = watchdir_sigint_handler;
         sigaction(SIGINT, &action, &prev_action);
 
-        dirwatch_listen(dirwatch_handle, args->dirwatch_timeout * 1000, transmit_new_file, args);
+        if(bundler && bundler->max_age > 0) {
+            listen_and_flush_bundles(args, tx);
+        }
+        else {
+            dirwatch_listen(dirwatch_handle, args->dirwatch_timeout * 1000, transmit_new_file, args);
+        }
 
         sigaction(SIGINT, &prev_action, NULL);
 
         dirwatch_close(dirwatch_handle);
     }
+    flush_bundle(tx, args->file_delay, args->retransmit_count, args->coderate, args->inner_code, args->compression);
 }
 
 
@@ -495,16 +813,37 @@ void transmit_test_sequence(dxwifi_transmitter* tx, int retransmit) {
  *
  */
 void transmit(cli_args* args, dxwifi_transmitter* tx) {
+    // Each simulation draws from its own stream, so the frames lost don't
+    // depend on how many bits are flipped in each frame and vice versa
     packet_loss_stats plstats = {
         .packet_loss_rate = args->packet_loss,
-        .count = 0
+        .count = 0,
+        .seed = rand()
+    };
+    bit_error_stats bestats = {
+        .error_rate = args->error_rate,
+        .seed = rand()
     };
+    tx_bundler bundle_state = {
+        .max_size = args->bundle_size,
+        .max_age  = args->bundle_age
+    };
+    if(args->bundle_size > 0 && (args->tx_mode == TX_FILE_MODE || args->tx_mode == TX_DIRECTORY_MODE)) {
+        dxwifi_bundle_init(&bundle_state.bundle);
+        bundler = &bundle_state;
+    }
+    tx_uep uep_state = {
+        .coderate = args->uep_coderate,
+        .ranges   = args->critical_ranges,
+        .count    = args->critical_count
+    };
+    if(args->uep && (args->tx_mode == TX_FILE_MODE || args->tx_mode == TX_DIRECTORY_MODE)) {
+        uep = &uep_state;
+    }
+    fountain = args->fountain;
     if(args->tx_delay > 0 ) {
         attach_preinject_handler(transmitter, delay_transmission, &args->tx_delay);
     }
-    if(args->tx.rtap_tx_flags & IEEE80211_RADIOTAP_F_TX_ORDER) {
-        attach_preinject_handler(transmitter, attach_frame_number, NULL);
-    }
     if(args->verbosity > DXWIFI_LOG_INFO ) {
         attach_postinject_handler(transmitter, log_frame_stats, NULL);
     }
@@ -512,7 +851,7 @@ void transmit(cli_args* args, dxwifi_transmitter* tx) {
         attach_preinject_handler(transmitter, packet_loss_sim, &plstats);
     }
     if(args->error_rate > 0){
-        attach_preinject_handler(transmitter, bit_error_rate_sim, &args->error_rate);
+        attach_preinject_handler(transmitter, bit_error_rate_sim, &bestats);
     }
     switch (args->tx_mode)
     {
@@ -521,7 +860,8 @@ void transmit(cli_args* args, dxwifi_transmitter* tx) {
         break;
 
     case TX_FILE_MODE:
-        transmit_files(tx, args->files, args->file_count, args->file_delay, args->retransmit_count, args->coderate);
+        transmit_files(tx, args->files, args->file_count, args->file_delay, args->retransmit_count, args->coderate, args->inner_code, args->compression);
+        flush_bundle(tx, args->file_delay, args->retransmit_count, args->coderate, args->inner_code, args->compression);
         break;
 
     case TX_DIRECTORY_MODE:
@@ -536,6 +876,12 @@ void transmit(cli_args* args, dxwifi_transmitter* tx) {
         break;
     }
 
+    if(bundler) {
+        dxwifi_bundle_close(&bundler->bundle);
+        bundler = NULL;
+    }
+    uep = NULL;
+    fountain = false;
     if(plstats.count > 0){
         log_info("Number of packets dropped: %d", plstats.count);
     }
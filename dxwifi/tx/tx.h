@@ -22,9 +22,13 @@
 #include <dxwifi/tx/cli.h>
 
 #include <libdxwifi/dxwifi.h>
+#include <libdxwifi/bundle.h>
+#include <libdxwifi/compress.h>
+#include <libdxwifi/priority.h>
 #include <libdxwifi/transmitter.h>
 #include <libdxwifi/details/utils.h>
 #include <libdxwifi/details/daemon.h>
+#include <libdxwifi/details/memory.h>
 #include <libdxwifi/details/logging.h>
 #include <libdxwifi/details/dirwatch.h>
 #include <libdxwifi/details/syslogger.h>
@@ -42,10 +46,12 @@ bool log_frame_stats(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user);
 bool delay_transmission(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user);
 bool packet_loss_sim(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user);
 bool bit_error_rate_sim(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user);
-bool attach_frame_number(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user);
 dxwifi_tx_state_t setup_handlers_and_transmit(dxwifi_transmitter* tx, int fd);
-dxwifi_tx_state_t transmit_files(dxwifi_transmitter* tx, char** files, size_t num_files, unsigned delay, int retransmit_count, float coderate);
-void transmit_directory_contents(dxwifi_transmitter* tx, const char* filter, const char* dirname, unsigned delay, int retransmit_count, float coderate);
+dxwifi_tx_state_t transmit_message(dxwifi_transmitter* tx, void* message, size_t msglen, unsigned delay, int retransmit_count, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_compression_t compression);
+dxwifi_tx_state_t flush_bundle(dxwifi_transmitter* tx, unsigned delay, int retransmit_count, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_compression_t compression);
+dxwifi_tx_state_t bundle_file(dxwifi_transmitter* tx, const char* name, const void* data, size_t size, unsigned delay, int retransmit_count, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_compression_t compression);
+dxwifi_tx_state_t transmit_files(dxwifi_transmitter* tx, char** files, size_t num_files, unsigned delay, int retransmit_count, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_compression_t compression);
+void transmit_directory_contents(dxwifi_transmitter* tx, const char* filter, const char* dirname, unsigned delay, int retransmit_count, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_compression_t compression);
 static void transmit_new_file(const dirwatch_event* event, void* user);
 void transmit_directory(cli_args* args, dxwifi_transmitter* tx);
 void transmit_test_sequence(dxwifi_transmitter* tx, int retransmit);
@@ -52,11 +52,18 @@ void cli_init_default(cli_args& args) {
     args.transmit_current_files = false;
     args.listen_for_new_files = true;
     args.dirwatch_timeout = -1;
+    args.bundle_size = 0;
+    args.bundle_age = 30;
     args.tx_delay = 0;
     args.error_rate = 0;
     args.packet_loss = 0;
     dxwifi_transmitter_init_default(args.tx);
     args.coderate = 0.667;
+    args.inner_code = DXWIFI_FEC_INNER_RS;
+    args.compression = DXWIFI_COMPRESSION_NONE;
+    args.uep = false;
+    args.uep_coderate = DXWIFI_UEP_DFLT_CODERATE;
+    args.critical_count = 0;
 }
 
 void init_transmitter_wrapper(dxwifi_transmitter* tx, const std::string& device_name) {
@@ -164,6 +171,18 @@ PYBIND11_MODULE(tx_module, m) {
         .value("STOP", DAEMON_STOP)
         .export_values();
 
+    pybind11::enum_<dxwifi_fec_inner_code_t>(m, "InnerCode")
+        .value("INNER_RS", DXWIFI_FEC_INNER_RS)
+        .value("INNER_CRC", DXWIFI_FEC_INNER_CRC)
+        .value("INNER_NONE", DXWIFI_FEC_INNER_NONE)
+        .export_values();
+
+    pybind11::enum_<dxwifi_compression_t>(m, "Compression")
+        .value("COMPRESSION_NONE", DXWIFI_COMPRESSION_NONE)
+        .value("COMPRESSION_LZ4", DXWIFI_COMPRESSION_LZ4)
+        .value("COMPRESSION_ZSTD", DXWIFI_COMPRESSION_ZSTD)
+        .export_values();
+
     pybind11::class_<cli_args>(m, "CliArgs")
         .def(pybind11::init<>())
         .def_readwrite("tx_mode", &cli_args::tx_mode)
@@ -178,6 +197,8 @@ PYBIND11_MODULE(tx_module, m) {
         .def_readwrite("transmit_current_files", &cli_args::transmit_current_files)
         .def_readwrite("listen_for_new_files", &cli_args::listen_for_new_files)
         .def_readwrite("dirwatch_timeout", &cli_args::dirwatch_timeout)
+        .def_readwrite("bundle_size", &cli_args::bundle_size)
+        .def_readwrite("bundle_age", &cli_args::bundle_age)
         .def_readwrite("verbosity", &cli_args::verbosity)
         .def_readwrite("quiet", &cli_args::quiet)
         .def_readwrite("use_syslog", &cli_args::use_syslog)
@@ -189,5 +210,9 @@ PYBIND11_MODULE(tx_module, m) {
         .def_readwrite("packet_loss", &cli_args::packet_loss)
         .def_readwrite("error_rate", &cli_args::error_rate)
         .def_readwrite("tx", &cli_args::tx)
-        .def_readwrite("coderate", &cli_args::coderate);
+        .def_readwrite("coderate", &cli_args::coderate)
+        .def_readwrite("inner_code", &cli_args::inner_code)
+        .def_readwrite("compression", &cli_args::compression)
+        .def_readwrite("uep", &cli_args::uep)
+        .def_readwrite("uep_coderate", &cli_args::uep_coderate);
 }
@@ -0,0 +1,465 @@
+/**
+ *  archive.c - See archive.h for description
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <endian.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+
+#include <libdxwifi/fec.h>
+#include <libdxwifi/archive.h>
+#include <libdxwifi/details/crc32.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/memory.h>
+#include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/reed_solomon.h>
+
+#define ARCHIVE_INITIAL_CAPACITY 256
+
+// Size of a record and the frame that follows it
+#define record_stride(frame_size) (sizeof(dxwifi_archive_record) + (frame_size))
+
+
+// Checks an OTI, in network byte order, is sane for the inner code it's read
+// under and returns its ESI
+static uint16_t oti_esi(const dxwifi_oti* oti, bool rs_coded) {
+    uint16_t esi = ntohs(oti->esi);
+    uint16_t n   = ntohs(oti->n);
+    bool     rs  = (ntohs(oti->rem) >> DXWIFI_OTI_INNER_CODE_SHIFT) == DXWIFI_FEC_INNER_RS;
+
+    return (rs == rs_coded && n != 0 && esi < n) ? esi : DXWIFI_ARCHIVE_ESI_UNKNOWN;
+}
+
+
+// Reads the ESI from a frame's OTI. The RS inner code protects the OTI, so
+// correct a copy of the first block before trusting it
+static uint16_t read_esi(const uint8_t* frame, size_t frame_size) {
+    dxwifi_oti oti;
+
+    if(frame_size < DXWIFI_RS_LDPC_FRAME_SIZE) {
+        return DXWIFI_ARCHIVE_ESI_UNKNOWN;
+    }
+
+    dxwifi_rs_block block;
+    memcpy(&block, frame, sizeof(block));
+
+    // A sparse frame of another inner code can look like a correctable block,
+    // so the corrected OTI must hold up too
+    if(rs_correct_errors((uint8_t*) &block, sizeof(block)) != RS_UNCORRECTABLE) {
+        memcpy(&oti, block.data, sizeof(oti));
+
+        uint16_t esi = oti_esi(&oti, true);
+        if(esi != DXWIFI_ARCHIVE_ESI_UNKNOWN) {
+            return esi;
+        }
+    }
+
+    // Other inner codes leave the OTI unprotected
+    memcpy(&oti, frame, sizeof(oti));
+    return oti_esi(&oti, false);
+}
+
+
+// Checks a record, in network byte order, against its CRC
+static bool record_valid(const dxwifi_archive_record* record) {
+    return crc32((const uint8_t*) record, offsetof(dxwifi_archive_record, crc)) == ntohl(record->crc);
+}
+
+
+// Orders index entries, in network byte order, by object id, ESI and then
+// position so retransmissions stay in capture order
+static int compare_entries(const void* lhs, const void* rhs) {
+    const dxwifi_archive_entry* e1 = lhs;
+    const dxwifi_archive_entry* e2 = rhs;
+
+    uint32_t id1 = ntohl(e1->record.object_id), id2 = ntohl(e2->record.object_id);
+    if(id1 != id2) {
+        return id1 < id2 ? -1 : 1;
+    }
+    uint16_t esi1 = ntohs(e1->record.esi), esi2 = ntohs(e2->record.esi);
+    if(esi1 != esi2) {
+        return esi1 < esi2 ? -1 : 1;
+    }
+    uint64_t off1 = be64toh(e1->offset), off2 = be64toh(e2->offset);
+    return (off1 > off2) - (off1 < off2);
+}
+
+
+// Uses the archive's index if it's intact. Returns the number of records or
+// -1 if the index can't be used
+static ssize_t load_index(dxwifi_archive* archive) {
+    dxwifi_archive_trailer trailer;
+    if(archive->size < sizeof(dxwifi_archive_hdr) + sizeof(trailer)) {
+        return -1;
+    }
+    memcpy(&trailer, archive->map + archive->size - sizeof(trailer), sizeof(trailer));
+
+    if(ntohl(trailer.magic) != DXWIFI_ARCHIVE_INDEX_MAGIC) {
+        return -1;
+    }
+    uint64_t index_offset = be64toh(trailer.index_offset);
+    size_t   count        = ntohl(trailer.count);
+    size_t   stride       = record_stride(archive->frame_size);
+
+    // Index must sit right after the records and run up to the trailer
+    if(index_offset != sizeof(dxwifi_archive_hdr) + count * stride
+        || index_offset + count * sizeof(dxwifi_archive_entry) + sizeof(trailer) != archive->size) {
+        return -1;
+    }
+    const dxwifi_archive_entry* index = (const dxwifi_archive_entry*) (archive->map + index_offset);
+
+    if(crc32((const uint8_t*) index, count * sizeof(dxwifi_archive_entry)) != ntohl(trailer.crc)) {
+        return -1;
+    }
+    archive->index = index;
+    archive->count = count;
+    return count;
+}
+
+
+// Rebuilds the index by scanning records up to the first torn one. Returns the
+// number of valid records
+static size_t rebuild_index(dxwifi_archive* archive) {
+    size_t stride   = record_stride(archive->frame_size);
+    size_t capacity = (archive->size - sizeof(dxwifi_archive_hdr)) / stride;
+
+    // malloc(0) may return NULL, always allocate at least one entry
+    dxwifi_archive_entry* index = dxwifi_malloc(DXWIFI_MEM_ARCHIVE, (capacity ? capacity : 1) * sizeof(dxwifi_archive_entry));
+    assert_M(index, "Failed to allocate archive index - %s", strerror(errno));
+
+    size_t count = 0;
+    for(; count < capacity; ++count) {
+        uint64_t record_offset = sizeof(dxwifi_archive_hdr) + count * stride;
+
+        memcpy(&index[count].record, archive->map + record_offset, sizeof(dxwifi_archive_record));
+        if(!record_valid(&index[count].record)) {
+            break;
+        }
+        index[count].offset = htobe64(record_offset + sizeof(dxwifi_archive_record));
+    }
+    qsort(index, count, sizeof(dxwifi_archive_entry), compare_entries);
+
+    archive->index   = index;
+    archive->count   = count;
+    archive->rebuilt = true;
+    return count;
+}
+
+
+// Grows the writer's index to hold at least one more entry
+static void reserve_entry(dxwifi_archive_writer* writer) {
+    if(writer->count == writer->capacity) {
+        writer->capacity = writer->capacity ? writer->capacity * 2 : ARCHIVE_INITIAL_CAPACITY;
+        writer->index    = dxwifi_realloc(DXWIFI_MEM_ARCHIVE, writer->index, writer->capacity * sizeof(dxwifi_archive_entry));
+        assert_M(writer->index, "Failed to grow archive index - %s", strerror(errno));
+    }
+}
+
+
+// Picks up the records of an existing archive and positions the writer after
+// the last one
+static bool resume_archive(dxwifi_archive_writer* writer, const char* path, uint32_t frame_size) {
+    dxwifi_archive archive;
+    if(!dxwifi_archive_map(&archive, path)) {
+        return false;
+    }
+    if(archive.frame_size != frame_size) {
+        log_error("Archive %s holds %u byte frames, expected %u", path, archive.frame_size, frame_size);
+        dxwifi_archive_unmap(&archive);
+        return false;
+    }
+
+    for(size_t i = 0; i < archive.count; ++i) {
+        reserve_entry(writer);
+        writer->index[writer->count++] = archive.index[i];
+    }
+    writer->offset = sizeof(dxwifi_archive_hdr) + archive.count * record_stride(frame_size);
+
+    log_info("Resuming archive %s with %zu frames", path, archive.count);
+    dxwifi_archive_unmap(&archive);
+
+    // Drop the old index and anything torn, new records overwrite it
+    return ftruncate(writer->fd, writer->offset) == 0 && lseek(writer->fd, writer->offset, SEEK_SET) >= 0;
+}
+
+
+//
+// See archive.h for non-static function descriptions
+//
+
+bool dxwifi_archive_writer_open(dxwifi_archive_writer* writer, const char* path, uint32_t frame_size) {
+    debug_assert(writer && path);
+
+    memset(writer, 0, sizeof(dxwifi_archive_writer));
+    writer->frame_size = frame_size;
+
+    writer->fd = open(path, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IROTH | S_IWOTH);
+    if(writer->fd < 0) {
+        log_error("Failed to open archive: %s - %s", path, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(writer->fd, &st) == 0 && st.st_size > 0) {
+        if(!resume_archive(writer, path, frame_size)) {
+            log_error("Failed to resume archive: %s", path);
+            close(writer->fd);
+            dxwifi_free(DXWIFI_MEM_ARCHIVE, writer->index);
+            return false;
+        }
+        return true;
+    }
+
+    dxwifi_archive_hdr hdr = {
+        .magic      = htonl(DXWIFI_ARCHIVE_MAGIC),
+        .version    = DXWIFI_ARCHIVE_VERSION,
+        .reserved   = { 0 },
+        .frame_size = htonl(frame_size),
+        .created    = htonl(time(NULL))
+    };
+    if(write(writer->fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+        log_error("Failed to write archive header: %s - %s", path, strerror(errno));
+        close(writer->fd);
+        return false;
+    }
+    writer->offset = sizeof(hdr);
+    return true;
+}
+
+
+void dxwifi_archive_writer_close(dxwifi_archive_writer* writer) {
+    debug_assert(writer && writer->fd >= 0);
+
+    qsort(writer->index, writer->count, sizeof(dxwifi_archive_entry), compare_entries);
+
+    size_t nbytes = writer->count * sizeof(dxwifi_archive_entry);
+
+    dxwifi_archive_trailer trailer = {
+        .index_offset   = htobe64(writer->offset),
+        .count          = htonl(writer->count),
+        .crc            = htonl(crc32((const uint8_t*) writer->index, nbytes)),
+        .magic          = htonl(DXWIFI_ARCHIVE_INDEX_MAGIC)
+    };
+
+    // Leaving the index off is recoverable, readers will rebuild it
+    if(write(writer->fd, writer->index, nbytes) != (ssize_t) nbytes
+        || write(writer->fd, &trailer, sizeof(trailer)) != sizeof(trailer)) {
+        log_warning("Failed to write archive index - %s", strerror(errno));
+    }
+    else {
+        log_info("Archive closed with %zu frames", writer->count);
+    }
+    close(writer->fd);
+    dxwifi_free(DXWIFI_MEM_ARCHIVE, writer->index);
+    memset(writer, 0, sizeof(dxwifi_archive_writer));
+    writer->fd = -1;
+}
+
+
+bool dxwifi_archive_append(dxwifi_archive_writer* writer, const dxwifi_archive_record* record, const uint8_t* frame) {
+    debug_assert(writer && writer->fd >= 0 && record && frame);
+
+    dxwifi_archive_record packed = {
+        .object_id  = htonl(record->object_id),
+        .esi        = htons(read_esi(frame, writer->frame_size)),
+        .flags      = record->flags,
+        .rssi       = record->rssi,
+        .ts_sec     = htonl(record->ts_sec),
+        .ts_usec    = htonl(record->ts_usec),
+        .crc        = 0
+    };
+    packed.crc = htonl(crc32((const uint8_t*) &packed, offsetof(dxwifi_archive_record, crc)));
+
+    struct iovec iov[2] = {
+        { .iov_base = &packed,          .iov_len = sizeof(packed)       },
+        { .iov_base = (void*) frame,    .iov_len = writer->frame_size   }
+    };
+    ssize_t nbytes = writev(writer->fd, iov, 2);
+    if(nbytes != (ssize_t) record_stride(writer->frame_size)) {
+        log_error("Partial archive write: %zd - %s", nbytes, strerror(errno));
+
+        // Put the file back to the last whole record so the log stays aligned
+        if(nbytes > 0 && ftruncate(writer->fd, writer->offset) == 0) {
+            lseek(writer->fd, writer->offset, SEEK_SET);
+        }
+        return false;
+    }
+
+    reserve_entry(writer);
+    writer->index[writer->count].record = packed;
+    writer->index[writer->count].offset = htobe64(writer->offset + sizeof(packed));
+    ++writer->count;
+
+    writer->offset += nbytes;
+    return true;
+}
+
+
+bool dxwifi_is_archive(const void* data, size_t size) {
+    debug_assert(data || size == 0);
+
+    dxwifi_archive_hdr hdr;
+    if(size < sizeof(hdr)) {
+        return false;
+    }
+    memcpy(&hdr, data, sizeof(hdr));
+
+    return ntohl(hdr.magic) == DXWIFI_ARCHIVE_MAGIC && hdr.version == DXWIFI_ARCHIVE_VERSION;
+}
+
+
+bool dxwifi_archive_map(dxwifi_archive* archive, const char* path) {
+    debug_assert(archive && path);
+
+    memset(archive, 0, sizeof(dxwifi_archive));
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        log_error("Failed to open archive: %s - %s", path, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(dxwifi_archive_hdr)) {
+        log_error("Not an archive: %s", path);
+        close(fd);
+        return false;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        log_error("Failed to map archive: %s - %s", path, strerror(errno));
+        return false;
+    }
+    archive->map  = map;
+    archive->size = st.st_size;
+
+    dxwifi_archive_hdr hdr;
+    memcpy(&hdr, archive->map, sizeof(hdr));
+
+    if(!dxwifi_is_archive(archive->map, archive->size) || ntohl(hdr.frame_size) == 0) {
+        log_error("Not an archive: %s", path);
+        dxwifi_archive_unmap(archive);
+        return false;
+    }
+    archive->frame_size = ntohl(hdr.frame_size);
+
+    if(load_index(archive) < 0) {
+        log_warning("Archive %s has no usable index, rebuilding it", path);
+        rebuild_index(archive);
+    }
+    return true;
+}
+
+
+void dxwifi_archive_unmap(dxwifi_archive* archive) {
+    debug_assert(archive);
+
+    if(archive->rebuilt) {
+        dxwifi_free(DXWIFI_MEM_ARCHIVE, (void*) archive->index);
+    }
+    if(archive->map) {
+        munmap((void*) archive->map, archive->size);
+    }
+    memset(archive, 0, sizeof(dxwifi_archive));
+}
+
+
+size_t dxwifi_archive_lookup(const dxwifi_archive* archive, uint32_t object_id, size_t* first) {
+    debug_assert(archive && first);
+
+    // Lower bound of the object, then of the next one
+    size_t lo = 0, hi = archive->count;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(ntohl(archive->index[mid].record.object_id) < object_id) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    *first = lo;
+
+    hi = archive->count;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(ntohl(archive->index[mid].record.object_id) <= object_id) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo - *first;
+}
+
+
+ssize_t dxwifi_archive_find(const dxwifi_archive* archive, uint32_t object_id, uint16_t esi) {
+    debug_assert(archive);
+
+    size_t first = 0;
+    size_t count = dxwifi_archive_lookup(archive, object_id, &first);
+
+    size_t lo = first, hi = first + count;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(ntohs(archive->index[mid].record.esi) < esi) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    if(lo < first + count && ntohs(archive->index[lo].record.esi) == esi) {
+        return lo;
+    }
+    return -1;
+}
+
+
+const uint8_t* dxwifi_archive_entry_at(const dxwifi_archive* archive, size_t entry, dxwifi_archive_record* out) {
+    debug_assert(archive && entry < archive->count);
+
+    const dxwifi_archive_entry* e = &archive->index[entry];
+    if(out) {
+        out->object_id  = ntohl(e->record.object_id);
+        out->esi        = ntohs(e->record.esi);
+        out->flags      = e->record.flags;
+        out->rssi       = e->record.rssi;
+        out->ts_sec     = ntohl(e->record.ts_sec);
+        out->ts_usec    = ntohl(e->record.ts_usec);
+        out->crc        = ntohl(e->record.crc);
+    }
+    return archive->map + be64toh(e->offset);
+}
+
+
+size_t dxwifi_archive_objects(const dxwifi_archive* archive, uint32_t* ids, size_t max_ids) {
+    debug_assert(archive && (ids || max_ids == 0));
+
+    size_t count = 0;
+    for(size_t i = 0; i < archive->count; ) {
+        uint32_t id = ntohl(archive->index[i].record.object_id);
+        if(count < max_ids) {
+            ids[count] = id;
+        }
+        ++count;
+
+        size_t first = 0;
+        i += dxwifi_archive_lookup(archive, id, &first);
+    }
+    return count;
+}
@@ -0,0 +1,314 @@
+/**
+ *  archive.h - Indexed capture archives
+ *
+ *  DESCRIPTION: A raw capture is a bare concatenation of payloads. Finding the
+ *  frames of one object means scanning all of it and any misaligned write
+ *  throws off everything after it. An archive is an append-only log of frame
+ *  records, each tagged with the object id, ESI, RSSI and time of capture,
+ *  followed by a footer index sorted by object and ESI. Readers map the file
+ *  and binary search the index, so a re-decode or merge of one object only
+ *  touches the pages that hold its frames.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: The file layout is:
+ *
+ *    [      dxwifi_archive_hdr       ]
+ *    [ dxwifi_archive_record + frame ] <-- One per captured frame
+ *    [              ...              ]
+ *    [     dxwifi_archive_entry      ] <-- Index, sorted by object id and ESI
+ *    [              ...              ]
+ *    [    dxwifi_archive_trailer     ]
+ *
+ *  All fields are in network byte order. The index is only written when the
+ *  writer is closed, an archive without one (e.g. the receiver was killed) is
+ *  still readable, the index is rebuilt by scanning the records. Each record
+ *  carries a CRC so a scan stops at a torn write. Reopening an archive for
+ *  writing drops the index and appends after the last record.
+ *
+ */
+
+#ifndef LIBDXWIFI_ARCHIVE_H
+#define LIBDXWIFI_ARCHIVE_H
+
+/************************
+ *  Includes
+ ***********************/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+
+/************************
+ *  Constants
+ ***********************/
+
+// "DXAR", leads every archive
+#define DXWIFI_ARCHIVE_MAGIC 0x44584152
+
+// "DXIX", ends an archive with an index
+#define DXWIFI_ARCHIVE_INDEX_MAGIC 0x44584958
+
+#define DXWIFI_ARCHIVE_VERSION 1
+
+// Object id of frames whose DxWiFi header was damaged, the transmitter never
+// assigns it
+#define DXWIFI_ARCHIVE_OBJECT_UNKNOWN 0
+
+// ESI of frames whose OTI couldn't be read
+#define DXWIFI_ARCHIVE_ESI_UNKNOWN 0xffff
+
+// Record flags
+#define DXWIFI_ARCHIVE_FLAG_HDR_VALID   0x01    /* Object id is from a valid DxWiFi header  */
+#define DXWIFI_ARCHIVE_FLAG_FCS_VALID   0x02    /* Frame passed the 802.11 FCS              */
+
+
+/************************
+ *  Data structures
+ ***********************/
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;         /* DXWIFI_ARCHIVE_MAGIC                         */
+    uint8_t  version;       /* DXWIFI_ARCHIVE_VERSION                       */
+    uint8_t  reserved[3];   /* Always zero                                  */
+    uint32_t frame_size;    /* Size of every frame in the archive           */
+    uint32_t created;       /* Unix time the archive was created            */
+} dxwifi_archive_hdr;
+
+
+typedef struct __attribute__((packed)) {
+    uint32_t object_id;     /* Object the frame belongs to                  */
+    uint16_t esi;           /* Encoding symbol id from the frame's OTI      */
+    uint8_t  flags;         /* DXWIFI_ARCHIVE_FLAG_*                        */
+    int8_t   rssi;          /* Antenna signal in dBm                        */
+    uint32_t ts_sec;        /* Capture time                                 */
+    uint32_t ts_usec;
+    uint32_t crc;           /* CRC32 of all the fields above                */
+} dxwifi_archive_record;
+
+
+typedef struct __attribute__((packed)) {
+    dxwifi_archive_record record;   /* Copy of the record                   */
+    uint64_t              offset;   /* File offset of the record's frame    */
+} dxwifi_archive_entry;
+
+
+typedef struct __attribute__((packed)) {
+    uint64_t index_offset;  /* File offset of the first index entry         */
+    uint32_t count;         /* Number of index entries                      */
+    uint32_t crc;           /* CRC32 of the index entries                   */
+    uint32_t magic;         /* DXWIFI_ARCHIVE_INDEX_MAGIC                   */
+} dxwifi_archive_trailer;
+
+
+/**
+ *  Appends frames to an archive. The index is kept in memory until the writer
+ *  is closed.
+ */
+typedef struct {
+    int                     fd;         /* Archive file                     */
+    uint32_t                frame_size; /* Size of every frame              */
+    uint64_t                offset;     /* Where the next record goes       */
+    dxwifi_archive_entry*   index;      /* Entry for every record           */
+    size_t                  count;      /* Number of records                */
+    size_t                  capacity;   /* Allocated index entries          */
+} dxwifi_archive_writer;
+
+
+/**
+ *  A read only, memory mapped archive. Index entries are in network byte
+ *  order, use the accessor functions.
+ */
+typedef struct {
+    const uint8_t*              map;        /* Mapped archive               */
+    size_t                      size;       /* Size of the mapping          */
+    uint32_t                    frame_size; /* Size of every frame          */
+    const dxwifi_archive_entry* index;      /* Sorted index entries         */
+    size_t                      count;      /* Number of index entries      */
+    bool                        rebuilt;    /* Index was rebuilt by a scan  */
+} dxwifi_archive;
+
+
+/************************
+ *  Functions
+ ***********************/
+
+/**
+ *  DESCRIPTION:    Opens an archive for appending, creating it if needed
+ *
+ *  ARGUMENTS:
+ *
+ *      writer:     Pointer to an allocated writer object
+ *
+ *      path:       Archive to open
+ *
+ *      frame_size: Size of every frame that will be appended
+ *
+ *  RETURNS:
+ *
+ *      bool:       True if the archive was opened. False if it couldn't be
+ *                  opened or an existing archive holds frames of another size
+ *
+ */
+bool dxwifi_archive_writer_open(dxwifi_archive_writer* writer, const char* path, uint32_t frame_size);
+
+
+/**
+ *  DESCRIPTION:    Writes out the index and closes the archive
+ *
+ *  ARGUMENTS:
+ *
+ *      writer:     Pointer to an open writer object
+ *
+ */
+void dxwifi_archive_writer_close(dxwifi_archive_writer* writer);
+
+
+/**
+ *  DESCRIPTION:    Appends a captured frame to the archive
+ *
+ *  ARGUMENTS:
+ *
+ *      writer:     Pointer to an open writer object
+ *
+ *      record:     Object id, flags, RSSI and time of the frame in host byte
+ *                  order. The ESI and CRC are filled in by the writer
+ *
+ *      frame:      frame_size bytes of captured payload
+ *
+ *  RETURNS:
+ *
+ *      bool:       True if the whole record was written
+ *
+ */
+bool dxwifi_archive_append(dxwifi_archive_writer* writer, const dxwifi_archive_record* record, const uint8_t* frame);
+
+
+/**
+ *  DESCRIPTION:    Checks for the archive magic at the front of some data
+ *
+ *  ARGUMENTS:
+ *
+ *      data:       Start of a file
+ *
+ *      size:       Number of bytes available
+ *
+ *  RETURNS:
+ *
+ *      bool:       True if the data is an archive
+ *
+ */
+bool dxwifi_is_archive(const void* data, size_t size);
+
+
+/**
+ *  DESCRIPTION:    Maps an archive for reading
+ *
+ *  ARGUMENTS:
+ *
+ *      archive:    Pointer to an allocated archive object
+ *
+ *      path:       Archive to map
+ *
+ *  RETURNS:
+ *
+ *      bool:       True if the archive was mapped
+ *
+ *  NOTES: An archive whose index is missing or fails its CRC has the index
+ *  rebuilt from its records, a truncated last record is ignored.
+ *
+ */
+bool dxwifi_archive_map(dxwifi_archive* archive, const char* path);
+
+
+/**
+ *  DESCRIPTION:    Unmaps an archive and frees any rebuilt index
+ *
+ *  ARGUMENTS:
+ *
+ *      archive:    Pointer to a mapped archive object
+ *
+ */
+void dxwifi_archive_unmap(dxwifi_archive* archive);
+
+
+/**
+ *  DESCRIPTION:    Finds every frame captured of an object
+ *
+ *  ARGUMENTS:
+ *
+ *      archive:    Pointer to a mapped archive object
+ *
+ *      object_id:  Object to look up
+ *
+ *      first:      Set to the index of the object's first entry
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Number of entries, they are consecutive and sorted by ESI
+ *
+ */
+size_t dxwifi_archive_lookup(const dxwifi_archive* archive, uint32_t object_id, size_t* first);
+
+
+/**
+ *  DESCRIPTION:    Finds a frame by object and ESI
+ *
+ *  ARGUMENTS:
+ *
+ *      archive:    Pointer to a mapped archive object
+ *
+ *      object_id:  Object the frame belongs to
+ *
+ *      esi:        Encoding symbol id of the frame
+ *
+ *  RETURNS:
+ *
+ *      ssize_t:    Index of the first entry for the frame or -1 if it wasn't
+ *                  captured. Retransmitted frames have several entries
+ *
+ */
+ssize_t dxwifi_archive_find(const dxwifi_archive* archive, uint32_t object_id, uint16_t esi);
+
+
+/**
+ *  DESCRIPTION:    Reads an index entry
+ *
+ *  ARGUMENTS:
+ *
+ *      archive:    Pointer to a mapped archive object
+ *
+ *      entry:      Index of the entry, less than archive->count
+ *
+ *      out:        Filled with the entry's record in host byte order
+ *
+ *  RETURNS:
+ *
+ *      const uint8_t*: The entry's frame, points into the mapping
+ *
+ */
+const uint8_t* dxwifi_archive_entry_at(const dxwifi_archive* archive, size_t entry, dxwifi_archive_record* out);
+
+
+/**
+ *  DESCRIPTION:    Lists the distinct objects in an archive
+ *
+ *  ARGUMENTS:
+ *
+ *      archive:    Pointer to a mapped archive object
+ *
+ *      ids:        Filled with up to max_ids object ids in ascending order
+ *
+ *      max_ids:    Size of the ids array
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Number of distinct objects, may be more than max_ids
+ *
+ */
+size_t dxwifi_archive_objects(const dxwifi_archive* archive, uint32_t* ids, size_t max_ids);
+
+
+#endif // LIBDXWIFI_ARCHIVE_H
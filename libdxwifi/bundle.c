@@ -0,0 +1,198 @@
+/**
+ *  bundle.c - See bundle.h for description
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+
+#include <libdxwifi/bundle.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/logging.h>
+
+#define BUNDLE_INITIAL_CAPACITY 4096
+
+
+// Grow buffer to hold at least needed bytes
+static void reserve(uint8_t** buffer, size_t* capacity, size_t needed) {
+    if(needed > *capacity) {
+        size_t new_capacity = *capacity ? *capacity : BUNDLE_INITIAL_CAPACITY;
+        while(new_capacity < needed) {
+            new_capacity *= 2;
+        }
+        *buffer = realloc(*buffer, new_capacity);
+        assert_M(*buffer, "Failed to grow bundle - %s", strerror(errno));
+        *capacity = new_capacity;
+    }
+}
+
+
+//
+// See bundle.h for non-static function descriptions
+//
+
+void dxwifi_bundle_init(dxwifi_bundle* bundle) {
+    debug_assert(bundle);
+
+    memset(bundle, 0, sizeof(dxwifi_bundle));
+}
+
+
+void dxwifi_bundle_close(dxwifi_bundle* bundle) {
+    debug_assert(bundle);
+
+    free(bundle->manifest);
+    free(bundle->data);
+    dxwifi_bundle_init(bundle);
+}
+
+
+bool dxwifi_bundle_add(dxwifi_bundle* bundle, const char* name, const void* data, size_t size) {
+    debug_assert(bundle && name && (data || size == 0));
+
+    if(bundle->count == DXWIFI_BUNDLE_MAX_FILES || size > UINT32_MAX - bundle->data_size) {
+        return false;
+    }
+
+    const char* basename = strrchr(name, '/');
+    basename = basename ? basename + 1 : name;
+
+    size_t name_len = strlen(basename);
+    if(name_len > DXWIFI_BUNDLE_NAME_MAX) {
+        log_warning("Bundled file name truncated: %s", basename);
+        name_len = DXWIFI_BUNDLE_NAME_MAX;
+    }
+
+    dxwifi_bundle_entry_hdr entry = {
+        .size       = htonl(size),
+        .name_len   = name_len
+    };
+
+    reserve(&bundle->manifest, &bundle->manifest_capacity, bundle->manifest_size + sizeof(entry) + name_len);
+    memcpy(bundle->manifest + bundle->manifest_size, &entry, sizeof(entry));
+    memcpy(bundle->manifest + bundle->manifest_size + sizeof(entry), basename, name_len);
+    bundle->manifest_size += sizeof(entry) + name_len;
+
+    reserve(&bundle->data, &bundle->data_capacity, bundle->data_size + size);
+    memcpy(bundle->data + bundle->data_size, data, size);
+    bundle->data_size += size;
+
+    if(bundle->count++ == 0) {
+        bundle->opened = time(NULL);
+    }
+    return true;
+}
+
+
+size_t dxwifi_bundle_size(const dxwifi_bundle* bundle) {
+    debug_assert(bundle);
+
+    return bundle->count ? sizeof(dxwifi_bundle_hdr) + bundle->manifest_size + bundle->data_size : 0;
+}
+
+
+unsigned dxwifi_bundle_age(const dxwifi_bundle* bundle) {
+    debug_assert(bundle);
+
+    return bundle->count ? time(NULL) - bundle->opened : 0;
+}
+
+
+size_t dxwifi_bundle_pack(dxwifi_bundle* bundle, void** out) {
+    debug_assert(bundle && out);
+
+    size_t size = dxwifi_bundle_size(bundle);
+    if(size == 0) {
+        return 0;
+    }
+
+    dxwifi_bundle_hdr hdr = {
+        .magic      = htonl(DXWIFI_BUNDLE_MAGIC),
+        .version    = DXWIFI_BUNDLE_VERSION,
+        .reserved   = 0,
+        .count      = htons(bundle->count),
+        .data_size  = htonl(bundle->data_size)
+    };
+
+    uint8_t* packed = malloc(size);
+    assert_M(packed, "Failed to allocate bundle - %s", strerror(errno));
+
+    memcpy(packed, &hdr, sizeof(hdr));
+    memcpy(packed + sizeof(hdr), bundle->manifest, bundle->manifest_size);
+    memcpy(packed + sizeof(hdr) + bundle->manifest_size, bundle->data, bundle->data_size);
+
+    log_info("Packed %u files into a %zu byte bundle", bundle->count, size);
+
+    dxwifi_bundle_close(bundle);
+
+    *out = packed;
+    return size;
+}
+
+
+bool dxwifi_is_bundle(const void* message, size_t msglen) {
+    debug_assert(message);
+
+    const dxwifi_bundle_hdr* hdr = message;
+
+    return msglen >= sizeof(dxwifi_bundle_hdr)
+        && ntohl(hdr->magic) == DXWIFI_BUNDLE_MAGIC
+        && hdr->version == DXWIFI_BUNDLE_VERSION;
+}
+
+
+ssize_t dxwifi_bundle_unpack(const void* message, size_t msglen, dxwifi_bundle_entry_handler handler, void* user) {
+    debug_assert(message && handler);
+
+    if(!dxwifi_is_bundle(message, msglen)) {
+        return -1;
+    }
+
+    const uint8_t* bytes = message;
+    const dxwifi_bundle_hdr* hdr = message;
+
+    uint16_t count     = ntohs(hdr->count);
+    size_t   data_size = ntohl(hdr->data_size);
+
+    // Walk the manifest once to validate it before producing any files
+    size_t manifest_end = sizeof(dxwifi_bundle_hdr);
+    size_t total_size   = 0;
+    for(uint16_t i = 0; i < count; ++i) {
+        dxwifi_bundle_entry_hdr entry;
+        if(msglen - manifest_end < sizeof(entry)) {
+            return -1;
+        }
+        memcpy(&entry, bytes + manifest_end, sizeof(entry));
+        manifest_end += sizeof(entry) + entry.name_len;
+        total_size   += ntohl(entry.size);
+        if(manifest_end > msglen) {
+            return -1;
+        }
+    }
+    if(total_size != data_size || msglen - manifest_end < data_size) {
+        log_warning("Malformed bundle, manifest does not match the file data");
+        return -1;
+    }
+
+    char name[DXWIFI_BUNDLE_NAME_MAX + 1];
+
+    size_t entry_offset = sizeof(dxwifi_bundle_hdr);
+    size_t data_offset  = manifest_end;
+    for(uint16_t i = 0; i < count; ++i) {
+        dxwifi_bundle_entry_hdr entry;
+        memcpy(&entry, bytes + entry_offset, sizeof(entry));
+
+        memcpy(name, bytes + entry_offset + sizeof(entry), entry.name_len);
+        name[entry.name_len] = '\0';
+
+        size_t size = ntohl(entry.size);
+        handler(name, bytes + data_offset, size, user);
+
+        entry_offset += sizeof(entry) + entry.name_len;
+        data_offset  += size;
+    }
+    return count;
+}
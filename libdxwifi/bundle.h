@@ -0,0 +1,233 @@
+/**
+ *  bundle.h - Pack many small files into a single FEC object
+ *
+ *  DESCRIPTION: Small files make poor FEC objects, a file under a symbol in
+ *  size is still sent as a full LDPC object with its own control frames. A
+ *  bundle concatenates several files behind a compact manifest so they can be
+ *  encoded and transmitted as one object, and split back out on receipt.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: A packed bundle is laid out as
+ *
+ *      [ dxwifi_bundle_hdr ][ entry hdr + name ] ... [ file data ] ...
+ *
+ *  All fields are in network byte order. File data is stored in manifest order.
+ *
+ */
+
+#ifndef LIBDXWIFI_BUNDLE_H
+#define LIBDXWIFI_BUNDLE_H
+
+/************************
+ *  Includes
+ ***********************/
+
+#include <time.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include <libdxwifi/details/assert.h>
+
+
+/************************
+ *  Constants
+ ***********************/
+
+// "DXBN", identifies a decoded object as a bundle
+#define DXWIFI_BUNDLE_MAGIC 0x4458424e
+
+#define DXWIFI_BUNDLE_VERSION 1
+
+// Max number of files in a single bundle
+#define DXWIFI_BUNDLE_MAX_FILES UINT16_MAX
+
+// Longest file name kept in the manifest, longer names are truncated
+#define DXWIFI_BUNDLE_NAME_MAX UINT8_MAX
+
+
+/************************
+ *  Data structures
+ ***********************/
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;         /* DXWIFI_BUNDLE_MAGIC              */
+    uint8_t  version;       /* DXWIFI_BUNDLE_VERSION            */
+    uint8_t  reserved;      /* Always zero                      */
+    uint16_t count;         /* Number of files in the bundle    */
+    uint32_t data_size;     /* Total size of the file data      */
+} dxwifi_bundle_hdr;
+compiler_assert(sizeof(dxwifi_bundle_hdr) == 12, "Mismatch in actual bundle header size and calculated size");
+
+
+typedef struct __attribute__((packed)) {
+    uint32_t size;          /* Size of the file in bytes        */
+    uint8_t  name_len;      /* Length of the name that follows  */
+} dxwifi_bundle_entry_hdr;
+compiler_assert(sizeof(dxwifi_bundle_entry_hdr) == 5, "Mismatch in actual bundle entry size and calculated size");
+
+
+/**
+ *  A bundle under construction. Files are copied into the bundle as they are
+ *  added so the caller is free to unmap or close them straight away.
+ */
+typedef struct {
+    uint8_t*    manifest;           /* Entry headers and names          */
+    size_t      manifest_size;      /* Bytes used in the manifest       */
+    size_t      manifest_capacity;  /* Bytes allocated for the manifest */
+    uint8_t*    data;               /* Concatenated file contents       */
+    size_t      data_size;          /* Bytes used in data               */
+    size_t      data_capacity;      /* Bytes allocated for data         */
+    uint16_t    count;              /* Number of files in the bundle    */
+    time_t      opened;             /* When the first file was added    */
+} dxwifi_bundle;
+
+
+/**
+ *  Called for each file found while unpacking a bundle. The name is nul
+ *  terminated, and both the name and data are only valid during the call.
+ */
+typedef void (*dxwifi_bundle_entry_handler)(const char* name, const void* data, size_t size, void* user);
+
+
+/************************
+ *  Functions
+ ***********************/
+
+/**
+ *  DESCRIPTION:    Initializes an empty bundle
+ *
+ *  ARGUMENTS:
+ *
+ *      bundle:     Pointer to an allocated bundle object
+ *
+ */
+void dxwifi_bundle_init(dxwifi_bundle* bundle);
+
+
+/**
+ *  DESCRIPTION:    Tears down any resources associated with the bundle
+ *
+ *  ARGUMENTS:
+ *
+ *      bundle:     Pointer to an initialized bundle object
+ *
+ */
+void dxwifi_bundle_close(dxwifi_bundle* bundle);
+
+
+/**
+ *  DESCRIPTION:    Copies a file into the bundle
+ *
+ *  ARGUMENTS:
+ *
+ *      bundle:     Pointer to an initialized bundle object
+ *
+ *      name:       Name the file will be given on receipt, directories are
+ *                  stripped from the name
+ *
+ *      data:       File contents
+ *
+ *      size:       Size of the file in bytes
+ *
+ *  RETURNS:
+ *
+ *      bool:       False if the bundle already holds DXWIFI_BUNDLE_MAX_FILES
+ *                  files or the file is too large to be bundled
+ *
+ */
+bool dxwifi_bundle_add(dxwifi_bundle* bundle, const char* name, const void* data, size_t size);
+
+
+/**
+ *  DESCRIPTION:    Size the bundle would have if it were packed now
+ *
+ *  ARGUMENTS:
+ *
+ *      bundle:     Pointer to an initialized bundle object
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Packed size in bytes, zero for an empty bundle
+ *
+ */
+size_t dxwifi_bundle_size(const dxwifi_bundle* bundle);
+
+
+/**
+ *  DESCRIPTION:    Number of seconds since the first file was added
+ *
+ *  ARGUMENTS:
+ *
+ *      bundle:     Pointer to an initialized bundle object
+ *
+ *  RETURNS:
+ *
+ *      unsigned:   Age of the oldest file in the bundle, zero if empty
+ *
+ */
+unsigned dxwifi_bundle_age(const dxwifi_bundle* bundle);
+
+
+/**
+ *  DESCRIPTION:    Packs the bundle into a single message and empties it
+ *
+ *  ARGUMENTS:
+ *
+ *      bundle:     Pointer to an initialized bundle object
+ *
+ *      out:        Pointer to a void pointer which will contain the packed
+ *                  bundle on return. Must be freed by the caller
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Size of the packed bundle, zero if the bundle was empty in
+ *                  which case nothing is allocated
+ *
+ */
+size_t dxwifi_bundle_pack(dxwifi_bundle* bundle, void** out);
+
+
+/**
+ *  DESCRIPTION:    Checks whether a decoded message is a bundle
+ *
+ *  ARGUMENTS:
+ *
+ *      message:    Decoded message
+ *
+ *      msglen:     Size of the message in bytes
+ *
+ *  RETURNS:
+ *
+ *      bool:       True if the message starts with a bundle header
+ *
+ */
+bool dxwifi_is_bundle(const void* message, size_t msglen);
+
+
+/**
+ *  DESCRIPTION:    Splits a packed bundle back into its files
+ *
+ *  ARGUMENTS:
+ *
+ *      message:    Packed bundle
+ *
+ *      msglen:     Size of the packed bundle in bytes
+ *
+ *      handler:    Called once for each file in the bundle
+ *
+ *      user:       User arguments to forward to the handler
+ *
+ *  RETURNS:
+ *
+ *      ssize_t:    Number of files unpacked or -1 if the manifest is
+ *                  malformed. The manifest is validated before the handler is
+ *                  called, so a malformed bundle produces no files.
+ *
+ */
+ssize_t dxwifi_bundle_unpack(const void* message, size_t msglen, dxwifi_bundle_entry_handler handler, void* user);
+
+
+#endif // LIBDXWIFI_BUNDLE_H
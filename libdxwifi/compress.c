@@ -0,0 +1,285 @@
+/**
+ *  compress.c - See compress.h for description
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+
+#if defined(DXWIFI_HAVE_LZ4)
+#include <lz4.h>
+#endif
+
+#if defined(DXWIFI_HAVE_ZSTD)
+#include <zstd.h>
+#endif
+
+#include <libdxwifi/compress.h>
+#include <libdxwifi/details/crc32.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/memory.h>
+#include <libdxwifi/details/logging.h>
+
+
+// Magic bytes of formats that won't shrink any further
+static const struct {
+    const uint8_t   bytes[6];
+    size_t          len;
+} compressed_formats[] = {
+    { { 0xff, 0xd8, 0xff },                     3 }, // JPEG
+    { { 0x89, 'P', 'N', 'G', 0x0d, 0x0a },      6 }, // PNG
+    { { 0x1f, 0x8b },                           2 }, // gzip
+    { { 'P', 'K', 0x03, 0x04 },                 4 }, // zip
+    { { 0x28, 0xb5, 0x2f, 0xfd },               4 }, // Zstandard
+    { { 0x04, 0x22, 0x4d, 0x18 },               4 }, // LZ4 frame
+    { { 0xfd, '7', 'z', 'X', 'Z', 0x00 },       6 }, // xz
+    { { 'B', 'Z', 'h' },                        3 }, // bzip2
+    { { 0x44, 0x58, 0x43, 0x5a },               4 }, // Already a DxWiFi compressed object
+};
+
+
+// Compress into dst, returns the compressed size or zero on failure
+static size_t compress_block(dxwifi_compression_t algorithm, const void* src, size_t size, void* dst, size_t capacity) {
+#if !defined(DXWIFI_HAVE_LZ4) && !defined(DXWIFI_HAVE_ZSTD)
+    // Built without a codec, nothing is compressed
+    (void) src; (void) size; (void) dst; (void) capacity;
+#endif
+    switch (algorithm)
+    {
+#if defined(DXWIFI_HAVE_LZ4)
+    case DXWIFI_COMPRESSION_LZ4: {
+        int n = LZ4_compress_default(src, dst, size, capacity);
+        return n > 0 ? n : 0;
+    }
+#endif
+#if defined(DXWIFI_HAVE_ZSTD)
+    case DXWIFI_COMPRESSION_ZSTD: {
+        size_t n = ZSTD_compress(dst, capacity, src, size, DXWIFI_ZSTD_LEVEL);
+        return ZSTD_isError(n) ? 0 : n;
+    }
+#endif
+    default:
+        return 0;
+    }
+}
+
+
+// Worst case compressed size, zero if the algorithm isn't available
+static size_t compress_bound(dxwifi_compression_t algorithm, size_t size) {
+#if !defined(DXWIFI_HAVE_LZ4) && !defined(DXWIFI_HAVE_ZSTD)
+    (void) size;
+#endif
+    switch (algorithm)
+    {
+#if defined(DXWIFI_HAVE_LZ4)
+    case DXWIFI_COMPRESSION_LZ4:
+        return size <= LZ4_MAX_INPUT_SIZE ? LZ4_compressBound(size) : 0;
+#endif
+#if defined(DXWIFI_HAVE_ZSTD)
+    case DXWIFI_COMPRESSION_ZSTD:
+        return ZSTD_compressBound(size);
+#endif
+    default:
+        return 0;
+    }
+}
+
+
+// Decompress exactly size bytes into dst, returns false on any mismatch
+static bool decompress_block(dxwifi_compression_t algorithm, const void* src, size_t srclen, void* dst, size_t size) {
+#if !defined(DXWIFI_HAVE_LZ4) && !defined(DXWIFI_HAVE_ZSTD)
+    (void) src; (void) srclen; (void) dst; (void) size;
+#endif
+    switch (algorithm)
+    {
+#if defined(DXWIFI_HAVE_LZ4)
+    case DXWIFI_COMPRESSION_LZ4:
+        return srclen <= INT32_MAX && size <= INT32_MAX
+            && LZ4_decompress_safe(src, dst, srclen, size) == (int)size;
+#endif
+#if defined(DXWIFI_HAVE_ZSTD)
+    case DXWIFI_COMPRESSION_ZSTD: {
+        size_t n = ZSTD_decompress(dst, size, src, srclen);
+        return !ZSTD_isError(n) && n == size;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+
+//
+// See compress.h for non-static function descriptions
+//
+
+bool dxwifi_compression_supported(dxwifi_compression_t algorithm) {
+    switch (algorithm)
+    {
+    case DXWIFI_COMPRESSION_NONE:
+        return true;
+#if defined(DXWIFI_HAVE_LZ4)
+    case DXWIFI_COMPRESSION_LZ4:
+        return true;
+#endif
+#if defined(DXWIFI_HAVE_ZSTD)
+    case DXWIFI_COMPRESSION_ZSTD:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+
+const char* dxwifi_compression_to_str(dxwifi_compression_t algorithm) {
+    switch (algorithm)
+    {
+    case DXWIFI_COMPRESSION_NONE:
+        return "none";
+    case DXWIFI_COMPRESSION_LZ4:
+        return "lz4";
+    case DXWIFI_COMPRESSION_ZSTD:
+        return "zstd";
+    default:
+        return "unknown";
+    }
+}
+
+
+dxwifi_compression_t dxwifi_compression_from_str(const char* str) {
+    debug_assert(str);
+
+    int algorithm = DXWIFI_COMPRESSION_NONE;
+    for(; algorithm < DXWIFI_COMPRESSION_COUNT; ++algorithm) {
+        if(strcmp(str, dxwifi_compression_to_str(algorithm)) == 0) {
+            break;
+        }
+    }
+    return algorithm;
+}
+
+
+bool dxwifi_is_compressible(const void* data, size_t size) {
+    debug_assert(data || size == 0);
+
+    if(size < DXWIFI_COMPRESSION_MIN_SIZE) {
+        return false;
+    }
+    for(size_t i = 0; i < sizeof(compressed_formats) / sizeof(compressed_formats[0]); ++i) {
+        if(memcmp(data, compressed_formats[i].bytes, compressed_formats[i].len) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+size_t dxwifi_compress(const void* data, size_t size, dxwifi_compression_t algorithm, void** out) {
+    debug_assert((data || size == 0) && out);
+
+    if(algorithm == DXWIFI_COMPRESSION_NONE || size > UINT32_MAX || !dxwifi_is_compressible(data, size)) {
+        return 0;
+    }
+    if(!dxwifi_compression_supported(algorithm)) {
+        log_warning("%s compression is not supported by this build", dxwifi_compression_to_str(algorithm));
+        return 0;
+    }
+
+    size_t bound = compress_bound(algorithm, size);
+    if(bound == 0) {
+        return 0;
+    }
+
+    uint8_t* compressed = dxwifi_malloc(DXWIFI_MEM_COMPRESS, sizeof(dxwifi_compression_hdr) + bound);
+    if(!compressed) {
+        log_warning("Failed to allocate compression buffer, sending the object uncompressed");
+        return 0;
+    }
+
+    size_t nbytes = compress_block(algorithm, data, size, compressed + sizeof(dxwifi_compression_hdr), bound);
+
+    if(nbytes == 0 || sizeof(dxwifi_compression_hdr) + nbytes >= size) {
+        log_info("%s did not shrink the %zu byte object, sending it uncompressed", dxwifi_compression_to_str(algorithm), size);
+        dxwifi_free(DXWIFI_MEM_COMPRESS, compressed);
+        return 0;
+    }
+
+    dxwifi_compression_hdr hdr = {
+        .magic      = htonl(DXWIFI_COMPRESSION_MAGIC),
+        .version    = DXWIFI_COMPRESSION_VERSION,
+        .algorithm  = algorithm,
+        .reserved   = 0,
+        .size       = htonl(size),
+        .crc        = htonl(crc32(data, size))
+    };
+    memcpy(compressed, &hdr, sizeof(hdr));
+
+    nbytes += sizeof(hdr);
+    log_info("Compressed %zu bytes to %zu with %s (%.1f%%)", size, nbytes, dxwifi_compression_to_str(algorithm), 100.0 * nbytes / size);
+
+    dxwifi_mem_release(DXWIFI_MEM_COMPRESS, compressed);
+    *out = compressed;
+    return nbytes;
+}
+
+
+bool dxwifi_is_compressed(const void* message, size_t msglen) {
+    debug_assert(message || msglen == 0);
+
+    dxwifi_compression_hdr hdr;
+    if(msglen < sizeof(hdr)) {
+        return false;
+    }
+    memcpy(&hdr, message, sizeof(hdr));
+
+    return ntohl(hdr.magic) == DXWIFI_COMPRESSION_MAGIC
+        && hdr.version == DXWIFI_COMPRESSION_VERSION;
+}
+
+
+ssize_t dxwifi_decompress(const void* message, size_t msglen, void** out) {
+    debug_assert(out);
+
+    if(!dxwifi_is_compressed(message, msglen)) {
+        return -1;
+    }
+
+    dxwifi_compression_hdr hdr;
+    memcpy(&hdr, message, sizeof(hdr));
+
+    if(!dxwifi_compression_supported(hdr.algorithm) || hdr.algorithm == DXWIFI_COMPRESSION_NONE) {
+        log_error("Object was compressed with %s which this build does not support", dxwifi_compression_to_str(hdr.algorithm));
+        return -1;
+    }
+
+    size_t size = ntohl(hdr.size);
+
+    // malloc(0) may return NULL, always allocate at least a byte
+    uint8_t* data = dxwifi_malloc(DXWIFI_MEM_COMPRESS, size ? size : 1);
+    if(!data) {
+        log_error("Failed to allocate decompression buffer of %zu bytes", size);
+        return -1;
+    }
+
+    const uint8_t* src = (const uint8_t*) message + sizeof(hdr);
+    size_t srclen = msglen - sizeof(hdr);
+
+    if(!decompress_block(hdr.algorithm, src, srclen, data, size)) {
+        log_error("Failed to decompress %s object", dxwifi_compression_to_str(hdr.algorithm));
+        dxwifi_free(DXWIFI_MEM_COMPRESS, data);
+        return -1;
+    }
+    if(crc32(data, size) != ntohl(hdr.crc)) {
+        log_error("Decompressed object failed its CRC check");
+        dxwifi_free(DXWIFI_MEM_COMPRESS, data);
+        return -1;
+    }
+
+    dxwifi_mem_release(DXWIFI_MEM_COMPRESS, data);
+    *out = data;
+    return size;
+}
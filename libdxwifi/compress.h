@@ -0,0 +1,205 @@
+/**
+ *  compress.h - Optional compression stage ahead of FEC encoding
+ *
+ *  DESCRIPTION: Every byte saved before encoding is a symbol less to send and
+ *  a symbol less that can be lost. Objects can be compressed with LZ4 or
+ *  Zstandard before they are FEC encoded, and are decompressed after decoding.
+ *  Data that is already compressed (JPEG, PNG, archives) is detected by its
+ *  magic bytes and sent as is.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: A compressed object is laid out as
+ *
+ *      [ dxwifi_compression_hdr ][ compressed data ]
+ *
+ *  The header carries the decompressed size and its CRC-32, so the receiver
+ *  can tell compressed objects apart from raw ones without a control frame.
+ *  All fields are in network byte order. LZ4 and Zstandard support depends on
+ *  DXWIFI_HAVE_LZ4 and DXWIFI_HAVE_ZSTD, which are defined when the libraries
+ *  are found at build time.
+ *
+ */
+
+#ifndef LIBDXWIFI_COMPRESS_H
+#define LIBDXWIFI_COMPRESS_H
+
+/************************
+ *  Includes
+ ***********************/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include <libdxwifi/dxwifi.h>
+#include <libdxwifi/details/assert.h>
+
+
+/************************
+ *  Constants
+ ***********************/
+
+// "DXCZ", identifies a decoded object as compressed
+#define DXWIFI_COMPRESSION_MAGIC 0x4458435a
+
+#define DXWIFI_COMPRESSION_VERSION 1
+
+// Zstandard level, favors ratio since the link is far slower than the CPU
+#define DXWIFI_ZSTD_LEVEL 9
+
+// Objects smaller than this aren't worth compressing
+#define DXWIFI_COMPRESSION_MIN_SIZE 64
+
+
+/************************
+ *  Data structures
+ ***********************/
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;         /* DXWIFI_COMPRESSION_MAGIC         */
+    uint8_t  version;       /* DXWIFI_COMPRESSION_VERSION       */
+    uint8_t  algorithm;     /* dxwifi_compression_t             */
+    uint16_t reserved;      /* Always zero                      */
+    uint32_t size;          /* Decompressed size in bytes       */
+    uint32_t crc;           /* CRC-32 of the decompressed data  */
+} dxwifi_compression_hdr;
+compiler_assert(sizeof(dxwifi_compression_hdr) == 16, "Mismatch in actual compression header size and calculated size");
+
+
+/************************
+ *  Functions
+ ***********************/
+
+/**
+ *  DESCRIPTION:    Checks whether this build can use a compression algorithm
+ *
+ *  ARGUMENTS:
+ *
+ *      algorithm:  Compression algorithm
+ *
+ *  RETURNS:
+ *
+ *      bool:       True if the algorithm was compiled in. NONE is always
+ *                  supported
+ *
+ */
+bool dxwifi_compression_supported(dxwifi_compression_t algorithm);
+
+
+/**
+ *  DESCRIPTION:    Name of a compression algorithm
+ *
+ *  ARGUMENTS:
+ *
+ *      algorithm:  Compression algorithm
+ *
+ *  RETURNS:
+ *
+ *      const char*: "none", "lz4", "zstd" or "unknown"
+ *
+ */
+const char* dxwifi_compression_to_str(dxwifi_compression_t algorithm);
+
+
+/**
+ *  DESCRIPTION:    Parses the name of a compression algorithm
+ *
+ *  ARGUMENTS:
+ *
+ *      str:        Name as returned by dxwifi_compression_to_str
+ *
+ *  RETURNS:
+ *
+ *      dxwifi_compression_t: Matching algorithm or DXWIFI_COMPRESSION_COUNT
+ *      if the name is unknown
+ *
+ */
+dxwifi_compression_t dxwifi_compression_from_str(const char* str);
+
+
+/**
+ *  DESCRIPTION:    Guesses whether data is worth compressing
+ *
+ *  ARGUMENTS:
+ *
+ *      data:       Data to be sent
+ *
+ *      size:       Size of the data in bytes
+ *
+ *  RETURNS:
+ *
+ *      bool:       False for tiny objects and for data that starts with the
+ *                  magic bytes of an already compressed format
+ *
+ */
+bool dxwifi_is_compressible(const void* data, size_t size);
+
+
+/**
+ *  DESCRIPTION:    Compresses data and prepends a compression header
+ *
+ *  ARGUMENTS:
+ *
+ *      data:       Data to be compressed
+ *
+ *      size:       Size of the data in bytes
+ *
+ *      algorithm:  Compression algorithm to use
+ *
+ *      out:        Pointer to a void pointer which will contain the
+ *                  compressed object on return. Must be freed by the caller
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Size of the compressed object. Zero if the data was not
+ *                  compressed, in which case nothing is allocated and the data
+ *                  should be sent as is. That happens when the algorithm is
+ *                  NONE or unsupported, the data looks incompressible or the
+ *                  result would not be any smaller.
+ *
+ */
+size_t dxwifi_compress(const void* data, size_t size, dxwifi_compression_t algorithm, void** out);
+
+
+/**
+ *  DESCRIPTION:    Checks whether a decoded message is compressed
+ *
+ *  ARGUMENTS:
+ *
+ *      message:    Decoded message
+ *
+ *      msglen:     Size of the message in bytes
+ *
+ *  RETURNS:
+ *
+ *      bool:       True if the message starts with a compression header
+ *
+ */
+bool dxwifi_is_compressed(const void* message, size_t msglen);
+
+
+/**
+ *  DESCRIPTION:    Decompresses a message produced by dxwifi_compress
+ *
+ *  ARGUMENTS:
+ *
+ *      message:    Compressed object
+ *
+ *      msglen:     Size of the compressed object in bytes
+ *
+ *      out:        Pointer to a void pointer which will contain the
+ *                  decompressed data on return. Must be freed by the caller
+ *
+ *  RETURNS:
+ *
+ *      ssize_t:    Size of the decompressed data or -1 if the message is not
+ *                  compressed, uses an unsupported algorithm, is corrupt or
+ *                  fails its CRC. Nothing is allocated on failure.
+ *
+ */
+ssize_t dxwifi_decompress(const void* message, size_t msglen, void** out);
+
+
+#endif // LIBDXWIFI_COMPRESS_H
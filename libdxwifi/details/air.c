@@ -0,0 +1,674 @@
+/**
+ *  air.c
+ *
+ *  DESCRIPTION: See air.h for description
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ */
+
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include <libdxwifi/details/air.h>
+#include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/crc32.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/radiotap.h>
+
+
+#define AIR_MAGIC   0x44584149  // "DXAI"
+#define AIR_VERSION 2
+
+// Sequence of a slot nothing was written to yet, or that is being written
+#define SLOT_EMPTY      UINT64_MAX
+#define SLOT_WRITING    (UINT64_MAX - 1)
+
+// How long to wait on a medium another process is still creating
+#define ATTACH_RETRIES  100
+#define ATTACH_RETRY_NS 10000000
+
+
+typedef struct {
+    uint64_t    seq;            /* Sequence of the frame held, see SLOT_*       */
+    uint64_t    deliver_ns;     /* When the frame arrives at a receiver         */
+    uint32_t    len;            /* Size of the frame with its FCS               */
+    uint32_t    lost;           /* Lost to the transmitter's channel?           */
+    uint8_t     data[DXWIFI_AIR_FRAME_MAX];
+} air_slot;
+
+
+// Laid out the same by every process, the slots follow the header
+typedef struct {
+    uint32_t            magic;      /* Stored last once the medium is ready     */
+    uint32_t            version;
+    uint64_t            nslots;
+    uint64_t            head;       /* Sequence of the next frame sent          */
+    uint64_t            busy_until; /* End of the airtime reserved so far       */
+    uint32_t            published;  /* Futex bumped with every frame sent       */
+    uint32_t            reserved;
+    dxwifi_air_station  stations[DXWIFI_AIR_MAX_STATIONS];
+    air_slot            slots[];
+} air_medium;
+
+
+static size_t medium_size(size_t nslots) {
+    return sizeof(air_medium) + nslots * sizeof(air_slot);
+}
+
+
+static air_medium* medium_of(const dxwifi_air* air) {
+    return (air_medium*) air->__medium;
+}
+
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+// Wall clock time a monotonic time in the past happened at
+static struct timeval to_timeval(uint64_t mono_ns) {
+    struct timespec real;
+    clock_gettime(CLOCK_REALTIME, &real);
+
+    uint64_t real_ns = (uint64_t) real.tv_sec * 1000000000ull + real.tv_nsec - (now_ns() - mono_ns);
+    struct timeval tv = {
+        .tv_sec     = real_ns / 1000000000ull,
+        .tv_usec    = (real_ns % 1000000000ull) / 1000
+    };
+    return tv;
+}
+
+
+static struct timespec to_timespec(uint64_t ns) {
+    struct timespec ts = {
+        .tv_sec     = ns / 1000000000ull,
+        .tv_nsec    = ns % 1000000000ull
+    };
+    return ts;
+}
+
+
+// Sleeps until a monotonic time, false if interrupted by a signal
+static bool sleep_until(uint64_t deadline_ns) {
+    struct timespec ts = to_timespec(deadline_ns);
+    int status = 0;
+    while((status = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) != 0) {
+        if(status == EINTR) {
+            errno = EINTR;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Time a frame spends on air at a rate, none without a rate limit
+static uint64_t airtime_ns(size_t len, uint32_t rate_kbps) {
+    return rate_kbps ? (uint64_t) len * 8000000ull / rate_kbps : 0;
+}
+
+
+// Uniform in (0, 1)
+static double uniform(unsigned* seed) {
+    return (rand_r(seed) + 1.0) / (RAND_MAX + 2.0);
+}
+
+
+// Steps the Gilbert-Elliott model of a channel, true if the frame is lost
+static bool channel_loses_frame(const dxwifi_air_channel* channel, unsigned* seed, bool* fading) {
+    bool lost = uniform(seed) < (*fading ? channel->fade_loss : channel->loss);
+
+    if(*fading) {
+        *fading = !(uniform(seed) < channel->fade_exit);
+    }
+    else {
+        *fading = channel->fade_enter > 0 && uniform(seed) < channel->fade_enter;
+    }
+    return lost;
+}
+
+
+// Flips bits of a frame past its radiotap header, which the driver adds and
+// never goes over the air. The gap to the next error is drawn from a geometric
+// distribution rather than drawing for every bit. Returns the bits flipped
+static size_t channel_flip_bits(const dxwifi_air_channel* channel, unsigned* seed, uint8_t* frame, size_t len) {
+    if(channel->ber <= 0 || len < sizeof(ieee80211_radiotap_hdr)) {
+        return 0;
+    }
+    size_t rtap_len = ((const ieee80211_radiotap_hdr*) frame)->it_len;
+    if(rtap_len >= len) {
+        return 0;
+    }
+    double log_keep = log1p(-fmin(channel->ber, 1.0 - 1e-9));
+    size_t nbits    = (len - rtap_len) * 8;
+    size_t flipped  = 0;
+
+    double bit = floor(log(uniform(seed)) / log_keep);
+    while(bit < nbits) {
+        size_t i = (size_t) bit;
+        frame[rtap_len + i / 8] ^= 1 << (i % 8);
+        ++flipped;
+        bit += 1 + floor(log(uniform(seed)) / log_keep);
+    }
+    return flipped;
+}
+
+
+static void count_stat(uint64_t* counter, uint64_t n) {
+    __atomic_add_fetch(counter, n, __ATOMIC_RELAXED);
+}
+
+
+static long futex(uint32_t* word, int op, uint32_t val, const struct timespec* timeout) {
+    return syscall(SYS_futex, word, op, val, timeout, NULL, 0);
+}
+
+
+static bool take_station(dxwifi_air* air, dxwifi_air_role_t role) {
+    air_medium* medium = medium_of(air);
+    int32_t pid = getpid();
+
+    for(size_t i = 0; i < DXWIFI_AIR_MAX_STATIONS; ++i) {
+        dxwifi_air_station* station = &medium->stations[i];
+        int32_t free_pid = 0;
+        if(__atomic_compare_exchange_n(&station->pid, &free_pid, pid, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            memset((uint8_t*) station + sizeof(station->pid), 0x00, sizeof(dxwifi_air_station) - sizeof(station->pid));
+            station->role = role;
+            air->__station = station;
+            return true;
+        }
+    }
+    // Still works, the air daemon just can't report on this end
+    memset(&air->__local, 0x00, sizeof(air->__local));
+    air->__local.pid  = pid;
+    air->__local.role = role;
+    air->__station = &air->__local;
+    return false;
+}
+
+
+// Maps an existing medium, waiting for its creator to finish setting it up
+static air_medium* map_medium(const char* name, size_t* size) {
+    for(int attempt = 0; attempt < ATTACH_RETRIES; ++attempt) {
+        int fd = shm_open(name, O_RDWR, 0);
+        if(fd < 0) {
+            if(errno != ENOENT || !dxwifi_air_create(name, DXWIFI_AIR_DFLT_SLOTS)) {
+                log_error("Failed to open air interface %s: %s", name, strerror(errno));
+                return NULL;
+            }
+            continue;
+        }
+        struct stat st;
+        air_medium* medium = MAP_FAILED;
+        if(fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(air_medium)) {
+            medium = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+
+        if(medium != MAP_FAILED) {
+            if(__atomic_load_n(&medium->magic, __ATOMIC_ACQUIRE) == AIR_MAGIC) {
+                if(medium->version != AIR_VERSION || medium_size(medium->nslots) != (size_t) st.st_size) {
+                    log_error("Air interface %s was created by an incompatible version", name);
+                    munmap(medium, st.st_size);
+                    return NULL;
+                }
+                *size = st.st_size;
+                return medium;
+            }
+            munmap(medium, st.st_size);
+        }
+        struct timespec retry = to_timespec(ATTACH_RETRY_NS);
+        nanosleep(&retry, NULL);
+    }
+    log_error("Air interface %s was never set up", name);
+    return NULL;
+}
+
+
+// Skips the frames that were overwritten before this end got to them
+static void catch_up(dxwifi_air* air) {
+    air_medium* medium = medium_of(air);
+    uint64_t head = __atomic_load_n(&medium->head, __ATOMIC_ACQUIRE);
+
+    if(head > air->__cursor + medium->nslots) {
+        uint64_t missed = head - medium->nslots - air->__cursor;
+        count_stat(&air->__station->overruns, missed);
+        air->__cursor += missed;
+    }
+}
+
+
+// When the frame at the cursor can be delivered, 0 if it wasn't sent yet
+static uint64_t frame_due(dxwifi_air* air) {
+    air_medium* medium = medium_of(air);
+    air_slot*   slot   = &medium->slots[air->__cursor % medium->nslots];
+
+    if(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != air->__cursor) {
+        return 0;
+    }
+    uint64_t due = __atomic_load_n(&slot->deliver_ns, __ATOMIC_RELAXED) + (uint64_t) air->channel.delay_us * 1000;
+    return due > air->__next_free ? due : air->__next_free;
+}
+
+
+// Puts a frame on air, appending its FCS unless it already ends with one
+static ssize_t publish_frame(dxwifi_air* air, const void* frame, size_t len, bool has_fcs) {
+    air_medium* medium  = medium_of(air);
+    size_t      fcs_len = has_fcs ? 0 : IEEE80211_FCS_SIZE;
+
+    if(len + fcs_len > DXWIFI_AIR_FRAME_MAX || len < sizeof(ieee80211_radiotap_hdr)) {
+        return -1;
+    }
+    size_t   rtap_len = ((const ieee80211_radiotap_hdr*) frame)->it_len;
+    uint64_t start    = now_ns();
+    uint64_t on_air   = start;
+
+    // Reserve airtime after whatever other transmitters already reserved
+    uint64_t airtime = airtime_ns(len + fcs_len, air->channel.rate_kbps);
+    if(airtime > 0) {
+        // Frames sent back to back follow each other without a gap even if
+        // this process woke up a little late from the last one
+        uint64_t busy_until = __atomic_load_n(&medium->busy_until, __ATOMIC_RELAXED);
+        do {
+            on_air = (busy_until + airtime > start ? busy_until : start) + airtime;
+        } while(!__atomic_compare_exchange_n(&medium->busy_until, &busy_until, on_air, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+        // The airtime is spent even if interrupted, the frame still goes out
+        while(!sleep_until(on_air) && now_ns() < on_air) {}
+
+        count_stat(&air->__station->blocked_us, (now_ns() - start) / 1000);
+    }
+
+    uint64_t  seq  = __atomic_fetch_add(&medium->head, 1, __ATOMIC_ACQ_REL);
+    air_slot* slot = &medium->slots[seq % medium->nslots];
+
+    __atomic_store_n(&slot->seq, SLOT_WRITING, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy(slot->data, frame, len);
+    if(!has_fcs) {
+        uint32_t fcs = rtap_len < len ? crc32(slot->data + rtap_len, len - rtap_len) : 0;
+        memcpy(slot->data + len, &fcs, sizeof(fcs));
+    }
+    slot->len           = len + fcs_len;
+    slot->deliver_ns    = on_air + (uint64_t) air->channel.delay_us * 1000;
+    slot->lost          = channel_loses_frame(&air->channel, &air->__seed, &air->__fading);
+
+    if(slot->lost) {
+        count_stat(&air->__station->lost, 1);
+    }
+    else if(channel_flip_bits(&air->channel, &air->__seed, slot->data, slot->len) > 0) {
+        count_stat(&air->__station->corrupted, 1);
+    }
+
+    __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&medium->published, 1, __ATOMIC_RELEASE);
+    futex(&medium->published, FUTEX_WAKE, INT_MAX, NULL);
+
+    count_stat(&air->__station->frames, 1);
+    count_stat(&air->__station->bytes, len);
+    return len;
+}
+
+
+static bool parse_probability(const char* value, float* out) {
+    char* end = NULL;
+    float p = strtof(value, &end);
+    if(end == value || *end != '\0' || !(p >= 0.0f && p <= 1.0f)) {
+        return false;
+    }
+    *out = p;
+    return true;
+}
+
+
+static bool parse_uint(const char* value, uint32_t* out) {
+    char* end = NULL;
+    errno = 0;
+    unsigned long n = strtoul(value, &end, 10);
+    if(end == value || *end != '\0' || errno != 0 || n > UINT32_MAX || *value == '-') {
+        return false;
+    }
+    *out = n;
+    return true;
+}
+
+
+static bool parse_setting(char* setting, dxwifi_air_channel* out) {
+    char* value = strchr(setting, '=');
+    if(!value) {
+        return false;
+    }
+    *value++ = '\0';
+
+    if(strcmp(setting, "loss") == 0) {
+        return parse_probability(value, &out->loss);
+    }
+    if(strcmp(setting, "ber") == 0) {
+        return parse_probability(value, &out->ber);
+    }
+    if(strcmp(setting, "fade") == 0) {
+        char* save  = NULL;
+        char* enter = strtok_r(value, ":", &save);
+        char* exit  = strtok_r(NULL, ":", &save);
+        char* loss  = strtok_r(NULL, ":", &save);
+        return enter && exit && !strtok_r(NULL, ":", &save)
+            && parse_probability(enter, &out->fade_enter)
+            && parse_probability(exit, &out->fade_exit)
+            && (!loss || parse_probability(loss, &out->fade_loss));
+    }
+    if(strcmp(setting, "delay") == 0) {
+        uint32_t ms = 0;
+        if(!parse_uint(value, &ms) || ms > UINT32_MAX / 1000) {
+            return false;
+        }
+        out->delay_us = ms * 1000;
+        return true;
+    }
+    if(strcmp(setting, "rate") == 0) {
+        return parse_uint(value, &out->rate_kbps);
+    }
+    if(strcmp(setting, "seed") == 0) {
+        return parse_uint(value, &out->seed);
+    }
+    return false;
+}
+
+
+//
+// See air.h for non-static function descriptions
+//
+
+bool dxwifi_air_create(const char* name, size_t nslots) {
+    debug_assert(name);
+
+    if(nslots == 0) {
+        return false;
+    }
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0666);
+    if(fd < 0) {
+        return errno == EEXIST;
+    }
+    size_t size = medium_size(nslots);
+
+    // Any user's tx and rx may attach, whatever the umask of the creator
+    fchmod(fd, 0666);
+
+    air_medium* medium = MAP_FAILED;
+    if(ftruncate(fd, size) == 0) {
+        medium = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+
+    if(medium == MAP_FAILED) {
+        log_error("Failed to create air interface %s: %s", name, strerror(errno));
+        shm_unlink(name);
+        return false;
+    }
+    medium->version     = AIR_VERSION;
+    medium->nslots      = nslots;
+    medium->head        = 0;
+    medium->busy_until  = 0;
+    medium->published   = 0;
+    for(size_t i = 0; i < nslots; ++i) {
+        medium->slots[i].seq = SLOT_EMPTY;
+    }
+    __atomic_store_n(&medium->magic, AIR_MAGIC, __ATOMIC_RELEASE);
+
+    munmap(medium, size);
+    log_info("Created air interface %s with %zu slots", name, nslots);
+    return true;
+}
+
+
+void dxwifi_air_remove(const char* name) {
+    debug_assert(name);
+
+    if(shm_unlink(name) == 0) {
+        log_info("Removed air interface %s", name);
+    }
+}
+
+
+bool dxwifi_air_attach(dxwifi_air* air, const char* name, dxwifi_air_role_t role) {
+    debug_assert(air && name);
+
+    air_medium* medium = map_medium(name, &air->__size);
+    if(!medium) {
+        air->__medium = NULL;
+        return false;
+    }
+    air->__medium       = medium;
+    air->__cursor       = __atomic_load_n(&medium->head, __ATOMIC_ACQUIRE);
+    air->__next_free    = 0;
+    air->__fading       = false;
+    air->__seed         = air->channel.seed ? air->channel.seed : (unsigned) (now_ns() ^ getpid());
+    air->__station      = &air->__local;
+    memset(&air->__local, 0x00, sizeof(air->__local));
+
+    if(role != DXWIFI_AIR_MONITOR && !take_station(air, role)) {
+        log_warning("Air interface %s has no free station, this end won't be reported", name);
+    }
+    log_info("Attached to air interface %s with %" PRIu64 " slots", name, medium->nslots);
+    return true;
+}
+
+
+void dxwifi_air_detach(dxwifi_air* air) {
+    debug_assert(air);
+
+    air_medium* medium = medium_of(air);
+    if(!medium) {
+        return;
+    }
+    if(air->__station != &air->__local) {
+        air->__local = *air->__station;
+        __atomic_store_n(&air->__station->pid, 0, __ATOMIC_RELEASE);
+        air->__station = &air->__local;
+    }
+    munmap(medium, air->__size);
+    air->__medium = NULL;
+}
+
+
+ssize_t dxwifi_air_send(dxwifi_air* air, const void* frame, size_t len) {
+    debug_assert(air && air->__medium && frame);
+
+    return publish_frame(air, frame, len, false);
+}
+
+
+ssize_t dxwifi_air_send_raw(dxwifi_air* air, const void* frame, size_t len) {
+    debug_assert(air && air->__medium && frame);
+
+    return publish_frame(air, frame, len, true);
+}
+
+
+int dxwifi_air_wait(dxwifi_air* air, int timeout_ms) {
+    debug_assert(air && air->__medium);
+
+    air_medium* medium   = medium_of(air);
+    uint64_t    deadline = timeout_ms < 0 ? UINT64_MAX : now_ns() + (uint64_t) timeout_ms * 1000000ull;
+
+    while(true) {
+        uint32_t published = __atomic_load_n(&medium->published, __ATOMIC_ACQUIRE);
+
+        catch_up(air);
+        uint64_t due = frame_due(air);
+        uint64_t now = now_ns();
+
+        if(due != 0 && due <= now) {
+            return 1;
+        }
+        if(now >= deadline) {
+            return 0;
+        }
+        if(due != 0) {
+            if(!sleep_until(due < deadline ? due : deadline)) {
+                return -1;
+            }
+            continue;
+        }
+        struct timespec timeout = to_timespec(deadline - now);
+        if(futex(&medium->published, FUTEX_WAIT, published, deadline == UINT64_MAX ? NULL : &timeout) < 0 && errno == EINTR) {
+            return -1;
+        }
+    }
+}
+
+
+int dxwifi_air_dispatch(dxwifi_air* air, int count, pcap_handler callback, uint8_t* user, const struct bpf_program* filter) {
+    debug_assert(air && air->__medium && callback);
+
+    air_medium* medium    = medium_of(air);
+    int         delivered = 0;
+
+    while(count <= 0 || delivered < count) {
+        catch_up(air);
+
+        uint64_t due = frame_due(air);
+        if(due == 0 || due > now_ns()) {
+            break;
+        }
+        air_slot* slot = &medium->slots[air->__cursor % medium->nslots];
+        uint32_t  len  = slot->len;
+        bool      lost = slot->lost;
+        if(len > DXWIFI_AIR_FRAME_MAX) {
+            len = DXWIFI_AIR_FRAME_MAX;
+        }
+        memcpy(air->__frame, slot->data, len);
+
+        // The slot was overwritten while copying it, catch_up() accounts for it
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != air->__cursor) {
+            continue;
+        }
+        ++air->__cursor;
+
+        // Nobody heard the frame
+        if(lost) {
+            continue;
+        }
+        if(channel_loses_frame(&air->channel, &air->__seed, &air->__fading)) {
+            count_stat(&air->__station->lost, 1);
+            continue;
+        }
+        air->__next_free = due + airtime_ns(len, air->channel.rate_kbps);
+
+        if(channel_flip_bits(&air->channel, &air->__seed, air->__frame, len) > 0) {
+            count_stat(&air->__station->corrupted, 1);
+        }
+
+        // Stamped with its arrival like a capture, not when it was handled
+        struct pcap_pkthdr hdr;
+        hdr.ts      = to_timeval(due);
+        hdr.caplen  = len;
+        hdr.len     = len;
+
+        if(filter && pcap_offline_filter(filter, &hdr, air->__frame) == 0) {
+            continue;
+        }
+        callback(user, &hdr, air->__frame);
+
+        // Only this end writes its station, so the maximum needs no exchange
+        uint64_t latency_us = (now_ns() - due) / 1000;
+        if(latency_us > __atomic_load_n(&air->__station->latency_max_us, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&air->__station->latency_max_us, latency_us, __ATOMIC_RELAXED);
+        }
+        count_stat(&air->__station->latency_us, latency_us);
+        count_stat(&air->__station->frames, 1);
+        count_stat(&air->__station->bytes, len);
+        ++delivered;
+    }
+    return delivered;
+}
+
+
+void dxwifi_air_pcap_stats(const dxwifi_air* air, struct pcap_stat* out) {
+    debug_assert(air && out);
+
+    out->ps_recv    = __atomic_load_n(&air->__station->frames, __ATOMIC_RELAXED);
+    out->ps_drop    = __atomic_load_n(&air->__station->overruns, __ATOMIC_RELAXED);
+    out->ps_ifdrop  = __atomic_load_n(&air->__station->lost, __ATOMIC_RELAXED);
+}
+
+
+size_t dxwifi_air_stations(dxwifi_air* air, dxwifi_air_station* out, size_t max) {
+    debug_assert(air && air->__medium && out);
+
+    air_medium* medium = medium_of(air);
+    size_t      found  = 0;
+
+    for(size_t i = 0; i < DXWIFI_AIR_MAX_STATIONS && found < max; ++i) {
+        dxwifi_air_station* station = &medium->stations[i];
+
+        int32_t pid = __atomic_load_n(&station->pid, __ATOMIC_ACQUIRE);
+        if(pid == 0) {
+            continue;
+        }
+        if(kill(pid, 0) < 0 && errno == ESRCH) {
+            log_info("Station %d left the air interface without detaching", pid);
+            __atomic_compare_exchange_n(&station->pid, &pid, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+            continue;
+        }
+        out[found].pid          = pid;
+        out[found].role         = station->role;
+        out[found].frames       = __atomic_load_n(&station->frames, __ATOMIC_RELAXED);
+        out[found].bytes        = __atomic_load_n(&station->bytes, __ATOMIC_RELAXED);
+        out[found].lost         = __atomic_load_n(&station->lost, __ATOMIC_RELAXED);
+        out[found].corrupted    = __atomic_load_n(&station->corrupted, __ATOMIC_RELAXED);
+        out[found].overruns     = __atomic_load_n(&station->overruns, __ATOMIC_RELAXED);
+        out[found].blocked_us   = __atomic_load_n(&station->blocked_us, __ATOMIC_RELAXED);
+        out[found].latency_us   = __atomic_load_n(&station->latency_us, __ATOMIC_RELAXED);
+        out[found].latency_max_us = __atomic_load_n(&station->latency_max_us, __ATOMIC_RELAXED);
+        ++found;
+    }
+    return found;
+}
+
+
+uint64_t dxwifi_air_frames_sent(const dxwifi_air* air) {
+    debug_assert(air && air->__medium);
+
+    return __atomic_load_n(&medium_of(air)->head, __ATOMIC_ACQUIRE);
+}
+
+
+bool dxwifi_air_parse_channel(const char* spec, dxwifi_air_channel* out) {
+    debug_assert(spec && out);
+
+    char buffer[256];
+    if(strlen(spec) >= sizeof(buffer)) {
+        return false;
+    }
+    strcpy(buffer, spec);
+
+    dxwifi_air_channel channel = *out;
+    char* save = NULL;
+    for(char* setting = strtok_r(buffer, ",", &save); setting; setting = strtok_r(NULL, ",", &save)) {
+        if(!parse_setting(setting, &channel)) {
+            return false;
+        }
+    }
+    *out = channel;
+    return true;
+}
@@ -0,0 +1,328 @@
+/**
+ *  air.h
+ *
+ *  DESCRIPTION: Virtual air interface. A broadcast ring in POSIX shared memory
+ *  that any number of tx and rx processes attach to in place of a monitor mode
+ *  interface, so real-time transmitters and receivers can be load tested
+ *  together on one machine without radios. Every frame sent is seen by every
+ *  receiver, through a channel model of loss, bit errors, fades, delay and a
+ *  rate limit.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: The channel of a transmitter impairs its frames for every receiver,
+ *  e.g. the satellite's link budget. The channel of a receiver only impairs
+ *  its own copy, e.g. one ground station's fades. Transmitters share the
+ *  airtime of the medium and block until their frame is on air. Receivers
+ *  never hold up a transmitter, one that falls a whole ring behind misses the
+ *  frames that were overwritten and counts them as overruns.
+ *
+ *  Frames carry an FCS like a monitor mode capture does. It is computed before
+ *  any bit errors so a corrupted frame fails its check.
+ *
+ */
+
+#ifndef LIBDXWIFI_DETAILS_AIR_H
+#define LIBDXWIFI_DETAILS_AIR_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include <pcap.h>
+
+#include <libdxwifi/details/ieee80211.h>
+
+
+/************************
+ *  Constants
+ ***********************/
+
+// Shared memory object used when none is given
+#define DXWIFI_AIR_DFLT_NAME "/dxwifi-air"
+
+// Frames held by a medium created on demand
+#define DXWIFI_AIR_DFLT_SLOTS 4096
+
+// Largest frame the medium carries, radiotap header, MAC frame and FCS
+#define DXWIFI_AIR_FRAME_MAX (IEEE80211_MTU_MAX_LEN + 256)
+
+// Transmitters and receivers that can be attached at once
+#define DXWIFI_AIR_MAX_STATIONS 32
+
+
+/************************
+ *  Data structures
+ ***********************/
+
+typedef enum {
+    DXWIFI_AIR_TRANSMITTER,
+    DXWIFI_AIR_RECEIVER,
+    DXWIFI_AIR_MONITOR,         /* Only reads the station table */
+} dxwifi_air_role_t;
+
+
+/**
+ *  Channel model of one end of the air interface. Fades follow a two state
+ *  Gilbert-Elliott model, the state can change after each frame.
+ */
+typedef struct {
+    float       loss;           /* Probability a frame is lost                      */
+    float       ber;            /* Probability each bit of a frame is flipped       */
+    float       fade_enter;     /* Probability a fade starts after a frame          */
+    float       fade_exit;      /* Probability a fade ends after a frame            */
+    float       fade_loss;      /* Probability a frame is lost during a fade        */
+    uint32_t    delay_us;       /* Delay before a frame arrives                     */
+    uint32_t    rate_kbps;      /* Throughput limit, 0 for none                     */
+    uint32_t    seed;           /* Seed of the channel's randomness, 0 for any      */
+} dxwifi_air_channel;
+
+
+#define DXWIFI_AIR_CHANNEL_CLEAR {\
+    .loss       = 0.0f,\
+    .ber        = 0.0f,\
+    .fade_enter = 0.0f,\
+    .fade_exit  = 1.0f,\
+    .fade_loss  = 1.0f,\
+    .delay_us   = 0,\
+    .rate_kbps  = 0,\
+    .seed       = 0,\
+}\
+
+
+/**
+ *  Counters of each attached process, kept in shared memory so the air daemon
+ *  can report on every station
+ */
+typedef struct {
+    int32_t     pid;            /* Process attached, 0 for a free station           */
+    uint32_t    role;           /* dxwifi_air_role_t of the station                 */
+    uint64_t    frames;         /* Frames sent or delivered                         */
+    uint64_t    bytes;          /* Bytes sent or delivered                          */
+    uint64_t    lost;           /* Frames lost to this end's channel                */
+    uint64_t    corrupted;      /* Frames with bit errors from this end's channel   */
+    uint64_t    overruns;       /* Frames missed by falling a ring behind           */
+    uint64_t    blocked_us;     /* Time spent waiting for airtime                   */
+    uint64_t    latency_us;     /* Arrival to handled, summed over frames delivered */
+    uint64_t    latency_max_us; /* Longest a delivered frame waited to be handled   */
+} dxwifi_air_station;
+
+
+typedef struct {
+    dxwifi_air_channel  channel;        /* Channel model of this end            */
+
+    void*               __medium;       /* Shared mapping                       */
+    size_t              __size;         /* Size of the mapping                  */
+    dxwifi_air_station* __station;      /* Counters of this end                 */
+    dxwifi_air_station  __local;        /* Counters when the table is full      */
+    uint64_t            __cursor;       /* Next frame to read                   */
+    uint64_t            __next_free;    /* Earliest delivery of the next frame  */
+    unsigned            __seed;         /* State of the channel's randomness    */
+    bool                __fading;       /* Channel in a fade?                   */
+    uint8_t             __frame[DXWIFI_AIR_FRAME_MAX];
+                                        /* Copy of the frame being delivered    */
+} dxwifi_air;
+
+
+/************************
+ *  Functions
+ ***********************/
+
+/**
+ *  DESCRIPTION:    Creates a medium if it doesn't exist yet
+ *
+ *  ARGUMENTS:
+ *
+ *      name:       Name of the shared memory object, e.g. "/dxwifi-air"
+ *
+ *      nslots:     Number of frames the ring holds
+ *
+ *  RETURNS:
+ *
+ *      bool:       True if the medium exists on return
+ *
+ */
+bool dxwifi_air_create(const char* name, size_t nslots);
+
+
+/**
+ *  DESCRIPTION:    Removes a medium, processes attached keep their mapping
+ */
+void dxwifi_air_remove(const char* name);
+
+
+/**
+ *  DESCRIPTION:    Attaches to a medium, creating it with DXWIFI_AIR_DFLT_SLOTS
+ *                  if needed
+ *
+ *  ARGUMENTS:
+ *
+ *      air:        Handle to attach, its channel must be set beforehand
+ *
+ *      name:       Name of the shared memory object
+ *
+ *      role:       What this end does on the medium
+ *
+ *  RETURNS:
+ *
+ *      bool:       True if attached
+ *
+ *  NOTES: A receiver only sees frames sent after it attached
+ *
+ */
+bool dxwifi_air_attach(dxwifi_air* air, const char* name, dxwifi_air_role_t role);
+
+
+/**
+ *  DESCRIPTION:    Detaches from a medium and frees its station
+ */
+void dxwifi_air_detach(dxwifi_air* air);
+
+
+/**
+ *  DESCRIPTION:    Sends a frame to every receiver
+ *
+ *  ARGUMENTS:
+ *
+ *      air:        Handle attached as a transmitter
+ *
+ *      frame:      Radiotap header followed by the MAC frame, without an FCS
+ *
+ *      len:        Size of the frame
+ *
+ *  RETURNS:
+ *
+ *      ssize_t:    len once the frame is on air, even if the channel lost it,
+ *                  or -1 if the frame is too large
+ *
+ *  NOTES: Blocks until the airtime of the frame has passed when the channel
+ *  has a rate limit
+ *
+ */
+ssize_t dxwifi_air_send(dxwifi_air* air, const void* frame, size_t len);
+
+
+/**
+ *  DESCRIPTION:    Sends a frame that already ends with its FCS, e.g. one read
+ *                  back from a monitor mode capture
+ *
+ *  ARGUMENTS:
+ *
+ *      air:        Handle attached as a transmitter
+ *
+ *      frame:      Radiotap header followed by the MAC frame and its FCS
+ *
+ *      len:        Size of the frame with its FCS
+ *
+ *  RETURNS:
+ *
+ *      ssize_t:    Same as dxwifi_air_send()
+ *
+ *  NOTES: The FCS is sent as is, a frame captured with a bad FCS stays bad
+ *
+ */
+ssize_t dxwifi_air_send_raw(dxwifi_air* air, const void* frame, size_t len);
+
+
+/**
+ *  DESCRIPTION:    Waits for a frame to be ready for delivery
+ *
+ *  ARGUMENTS:
+ *
+ *      air:        Handle attached as a receiver
+ *
+ *      timeout_ms: Milliseconds to wait, negative to wait forever
+ *
+ *  RETURNS:
+ *
+ *      int:        Same as poll(), 1 if a frame is ready, 0 on timeout or -1
+ *                  with errno set, e.g. EINTR when interrupted by a signal
+ *
+ */
+int dxwifi_air_wait(dxwifi_air* air, int timeout_ms);
+
+
+/**
+ *  DESCRIPTION:    Delivers the frames that are ready, like pcap_dispatch
+ *
+ *  ARGUMENTS:
+ *
+ *      air:        Handle attached as a receiver
+ *
+ *      count:      Most frames to deliver, 0 or -1 for every ready frame
+ *
+ *      callback:   Called with each frame that passes the channel and filter
+ *
+ *      user:       Passed along to the callback
+ *
+ *      filter:     Compiled BPF filter or NULL
+ *
+ *  RETURNS:
+ *
+ *      int:        Number of frames delivered
+ *
+ */
+int dxwifi_air_dispatch(dxwifi_air* air, int count, pcap_handler callback, uint8_t* user, const struct bpf_program* filter);
+
+
+/**
+ *  DESCRIPTION:    Fills in pcap statistics of a receiver. Frames delivered are
+ *                  received, overruns are dropped and channel losses are
+ *                  dropped by the interface
+ */
+void dxwifi_air_pcap_stats(const dxwifi_air* air, struct pcap_stat* out);
+
+
+/**
+ *  DESCRIPTION:    Reads the station table, freeing stations of processes that
+ *                  exited without detaching
+ *
+ *  ARGUMENTS:
+ *
+ *      air:        Attached handle
+ *
+ *      out:        Filled with the attached stations
+ *
+ *      max:        Size of out
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Number of stations filled in
+ *
+ */
+size_t dxwifi_air_stations(dxwifi_air* air, dxwifi_air_station* out, size_t max);
+
+
+/**
+ *  DESCRIPTION:    Number of frames sent on the medium since it was created
+ */
+uint64_t dxwifi_air_frames_sent(const dxwifi_air* air);
+
+
+/**
+ *  DESCRIPTION:    Parses a channel model of comma separated settings
+ *
+ *  ARGUMENTS:
+ *
+ *      spec:       e.g. "loss=0.1,ber=1e-6,fade=0.01:0.2,delay=5,rate=6000"
+ *
+ *                  loss=<p>                Frame loss probability
+ *                  ber=<p>                 Bit error probability
+ *                  fade=<in>:<out>[:<p>]   Fade start and end probabilities and
+ *                                          the loss during a fade, 1 by default
+ *                  delay=<ms>              Delay before a frame arrives
+ *                  rate=<kbps>             Throughput limit
+ *                  seed=<n>                Seed of the channel's randomness
+ *
+ *      out:        Channel to update, settings not given are left as is
+ *
+ *  RETURNS:
+ *
+ *      bool:       True if every setting was valid
+ *
+ */
+bool dxwifi_air_parse_channel(const char* spec, dxwifi_air_channel* out);
+
+
+#endif // LIBDXWIFI_DETAILS_AIR_H
@@ -12,6 +12,7 @@
 #include <libdxwifi/details/heap.h>
 #include <libdxwifi/details/utils.h>
 #include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/memory.h>
 #include <libdxwifi/details/logging.h>
 
 
@@ -55,13 +56,14 @@ void init_heap(binary_heap* heap, size_t capacity, size_t step_size, comparator
     heap->capacity      = capacity;
     heap->compare       = compare;
 
-    heap->tree = calloc(capacity, step_size);
+    // The receiver's packet heap is the only heap
+    heap->tree = dxwifi_calloc(DXWIFI_MEM_RX, capacity, step_size);
     assert_M(heap->tree, "Failed to allocated heap with capacity: %ld", capacity);
 }
 
 
 void teardown_heap(binary_heap* heap) {
-    free(heap->tree);
+    dxwifi_free(DXWIFI_MEM_RX, heap->tree);
     heap->tree      = NULL;
     heap->count     = 0;
     heap->step_size = 0;
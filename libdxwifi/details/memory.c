@@ -0,0 +1,250 @@
+/**
+ *  memory.c
+ *
+ *  DESCRIPTION: See memory.h for description
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <malloc.h>
+#include <stdbool.h>
+
+#include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/memory.h>
+#include <libdxwifi/details/logging.h>
+
+// Slot of the overall usage
+#define MEM_TOTAL DXWIFI_MEM_SUBSYSTEM_COUNT
+
+// Counters are updated with atomics so any thread may allocate
+static dxwifi_mem_usage mem_usage[DXWIFI_MEM_SUBSYSTEM_COUNT + 1];
+
+static const char* subsystem_names[DXWIFI_MEM_SUBSYSTEM_COUNT + 1] = {
+    [DXWIFI_MEM_FEC]        = "fec",
+    [DXWIFI_MEM_OPENFEC]    = "openfec",
+    [DXWIFI_MEM_RX]         = "rx",
+    [DXWIFI_MEM_MERGE]      = "merge",
+    [DXWIFI_MEM_ARCHIVE]    = "archive",
+    [DXWIFI_MEM_COMPRESS]   = "compress",
+    [MEM_TOTAL]             = "total"
+};
+
+
+static dxwifi_mem_usage* usage_of(dxwifi_mem_subsystem_t subsystem) {
+    return &mem_usage[subsystem < DXWIFI_MEM_SUBSYSTEM_COUNT ? subsystem : MEM_TOTAL];
+}
+
+
+// Adds to the bytes held. When enforced an allocation over budget is backed
+// out and false returned
+static bool add_bytes(dxwifi_mem_usage* usage, ssize_t delta, bool enforce, size_t* current) {
+    *current = __atomic_add_fetch(&usage->current, (size_t) delta, __ATOMIC_RELAXED);
+    size_t budget = __atomic_load_n(&usage->budget, __ATOMIC_RELAXED);
+
+    if(enforce && delta > 0 && budget > 0 && *current > budget) {
+        __atomic_sub_fetch(&usage->current, (size_t) delta, __ATOMIC_RELAXED);
+        return false;
+    }
+    return true;
+}
+
+
+static void raise_peak(dxwifi_mem_usage* usage, size_t current) {
+    size_t peak = __atomic_load_n(&usage->peak, __ATOMIC_RELAXED);
+    while(current > peak && !__atomic_compare_exchange_n(&usage->peak, &peak, current, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        // peak was reloaded by the failed exchange
+    }
+}
+
+
+// Counts an allocation made or refused against a subsystem and the total
+static void count(dxwifi_mem_subsystem_t subsystem, bool refused) {
+    size_t* counter = refused ? &usage_of(subsystem)->refused : &usage_of(subsystem)->allocations;
+    size_t* total   = refused ? &mem_usage[MEM_TOTAL].refused : &mem_usage[MEM_TOTAL].allocations;
+
+    __atomic_add_fetch(counter, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(total, 1, __ATOMIC_RELAXED);
+}
+
+
+// Counts bytes against a subsystem and the total
+static bool account(dxwifi_mem_subsystem_t subsystem, ssize_t delta, bool enforce) {
+    debug_assert(subsystem < DXWIFI_MEM_SUBSYSTEM_COUNT);
+
+    dxwifi_mem_usage* usage = usage_of(subsystem);
+    dxwifi_mem_usage* total = &mem_usage[MEM_TOTAL];
+
+    size_t current = 0;
+    size_t total_current = 0;
+
+    if(!add_bytes(usage, delta, enforce, &current)) {
+        count(subsystem, true);
+        return false;
+    }
+    if(!add_bytes(total, delta, enforce, &total_current)) {
+        add_bytes(usage, -delta, false, &current);
+        count(subsystem, true);
+        return false;
+    }
+    // Peaks are only raised once both budgets let the bytes through
+    raise_peak(usage, current);
+    raise_peak(total, total_current);
+    return true;
+}
+
+
+// Reserves the requested size before allocating so that a budget is never
+// overrun, the allocator's rounding is settled after
+static bool reserve(dxwifi_mem_subsystem_t subsystem, size_t size) {
+    if(!account(subsystem, size, true)) {
+        log_warning("Refused %s allocation of %zu bytes, over budget", dxwifi_mem_subsystem_to_str(subsystem), size);
+        return false;
+    }
+    return true;
+}
+
+
+// Settles a reservation with the block that was allocated, or backs it out
+static void* settle(dxwifi_mem_subsystem_t subsystem, size_t reserved, void* block) {
+    if(!block) {
+        account(subsystem, -(ssize_t) reserved, false);
+        return NULL;
+    }
+    account(subsystem, (ssize_t) malloc_usable_size(block) - (ssize_t) reserved, false);
+    count(subsystem, false);
+    return block;
+}
+
+
+//
+// See memory.h for non-static function descriptions
+//
+
+void* dxwifi_malloc(dxwifi_mem_subsystem_t subsystem, size_t size) {
+    if(!reserve(subsystem, size)) {
+        return NULL;
+    }
+    return settle(subsystem, size, malloc(size));
+}
+
+
+void* dxwifi_calloc(dxwifi_mem_subsystem_t subsystem, size_t nmemb, size_t size) {
+    if(size != 0 && nmemb > SIZE_MAX / size) {
+        return NULL;
+    }
+    if(!reserve(subsystem, nmemb * size)) {
+        return NULL;
+    }
+    return settle(subsystem, nmemb * size, calloc(nmemb, size));
+}
+
+
+void* dxwifi_aligned_alloc(dxwifi_mem_subsystem_t subsystem, size_t alignment, size_t size) {
+    if(!reserve(subsystem, size)) {
+        return NULL;
+    }
+    void* block = NULL;
+    if(posix_memalign(&block, alignment, size) != 0) {
+        block = NULL;
+    }
+    return settle(subsystem, size, block);
+}
+
+
+void* dxwifi_realloc(dxwifi_mem_subsystem_t subsystem, void* ptr, size_t size) {
+    if(!ptr) {
+        return dxwifi_malloc(subsystem, size);
+    }
+    size_t held = malloc_usable_size(ptr);
+    size_t grow = size > held ? size - held : 0;
+
+    if(grow > 0 && !reserve(subsystem, grow)) {
+        return NULL;
+    }
+    void* block = realloc(ptr, size);
+    if(!block) {
+        account(subsystem, -(ssize_t) grow, false);
+        return NULL;
+    }
+    account(subsystem, (ssize_t) malloc_usable_size(block) - (ssize_t) held - (ssize_t) grow, false);
+    return block;
+}
+
+
+void dxwifi_free(dxwifi_mem_subsystem_t subsystem, void* ptr) {
+    if(ptr) {
+        dxwifi_mem_release(subsystem, ptr);
+        free(ptr);
+    }
+}
+
+
+void dxwifi_mem_release(dxwifi_mem_subsystem_t subsystem, void* ptr) {
+    if(ptr) {
+        account(subsystem, -(ssize_t) malloc_usable_size(ptr), false);
+    }
+}
+
+
+void dxwifi_mem_account(dxwifi_mem_subsystem_t subsystem, ssize_t delta) {
+    account(subsystem, delta, false);
+    if(delta > 0) {
+        count(subsystem, false);
+    }
+}
+
+
+void dxwifi_mem_get_usage(dxwifi_mem_subsystem_t subsystem, dxwifi_mem_usage* out) {
+    debug_assert(out);
+
+    const dxwifi_mem_usage* usage = usage_of(subsystem);
+
+    out->current     = __atomic_load_n(&usage->current, __ATOMIC_RELAXED);
+    out->peak        = __atomic_load_n(&usage->peak, __ATOMIC_RELAXED);
+    out->allocations = __atomic_load_n(&usage->allocations, __ATOMIC_RELAXED);
+    out->refused     = __atomic_load_n(&usage->refused, __ATOMIC_RELAXED);
+    out->budget      = __atomic_load_n(&usage->budget, __ATOMIC_RELAXED);
+}
+
+
+void dxwifi_mem_set_budget(dxwifi_mem_subsystem_t subsystem, size_t budget) {
+    __atomic_store_n(&usage_of(subsystem)->budget, budget, __ATOMIC_RELAXED);
+}
+
+
+void dxwifi_mem_reset_peak() {
+    for(size_t i = 0; i < NELEMS(mem_usage); ++i) {
+        __atomic_store_n(&mem_usage[i].peak, __atomic_load_n(&mem_usage[i].current, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    }
+}
+
+
+void dxwifi_mem_log_usage() {
+    dxwifi_mem_usage total;
+    dxwifi_mem_get_usage(DXWIFI_MEM_ALL_SUBSYSTEMS, &total);
+    if(total.allocations == 0 && total.refused == 0) {
+        return;
+    }
+    char report[1024];
+    int len = snprintf(report, sizeof(report), "Memory Usage\n\t%-10s %12s %12s %12s %8s %12s", "Subsystem", "Current", "Peak", "Allocations", "Refused", "Budget");
+
+    for(size_t i = 0; i < NELEMS(mem_usage) && len < (int) sizeof(report); ++i) {
+        dxwifi_mem_usage usage;
+        dxwifi_mem_get_usage(i, &usage);
+        if(usage.allocations == 0 && usage.refused == 0) {
+            continue;
+        }
+        len += snprintf(report + len, sizeof(report) - len, "\n\t%-10s %12zu %12zu %12zu %8zu %12zu",
+            subsystem_names[i], usage.current, usage.peak, usage.allocations, usage.refused, usage.budget);
+    }
+    log_info("%s", report);
+}
+
+
+const char* dxwifi_mem_subsystem_to_str(dxwifi_mem_subsystem_t subsystem) {
+    return subsystem_names[subsystem < DXWIFI_MEM_SUBSYSTEM_COUNT ? subsystem : MEM_TOTAL];
+}
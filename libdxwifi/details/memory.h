@@ -0,0 +1,172 @@
+/**
+ *  memory.h
+ *
+ *  DESCRIPTION: Tagged allocations. Every large allocation in libdxwifi, and
+ *  every allocation OpenFEC makes, is counted against the subsystem that made
+ *  it. Current and peak bytes are kept per subsystem and overall, and a budget
+ *  can be set on either so a runaway object fails its allocation instead of
+ *  taking the flight computer out of memory.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: Sizes are the usable size of each block as reported by the allocator,
+ *  so a block must be freed through the subsystem that allocated it. Buffers
+ *  handed back to the user, e.g. the output of dxwifi_encode, are released from
+ *  the accounting when the call returns and are freed with a plain free(). They
+ *  still count towards the peak of the call that made them.
+ *
+ */
+
+#ifndef LIBDXWIFI_DETAILS_MEMORY_H
+#define LIBDXWIFI_DETAILS_MEMORY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+
+typedef enum {
+    DXWIFI_MEM_FEC      = 0,    /* Frames, symbol tables and decoded messages   */
+    DXWIFI_MEM_OPENFEC  = 1,    /* OpenFEC codec instances and decoded symbols  */
+    DXWIFI_MEM_RX       = 2,    /* Receiver packet buffer and packet heap       */
+    DXWIFI_MEM_MERGE    = 3,    /* Frames held by the merger                    */
+    DXWIFI_MEM_ARCHIVE  = 4,    /* Archive indexes                              */
+    DXWIFI_MEM_COMPRESS = 5,    /* Compression buffers                          */
+
+    // Add new subsystems here
+
+    DXWIFI_MEM_SUBSYSTEM_COUNT,
+    DXWIFI_MEM_ALL_SUBSYSTEMS   /* Every subsystem together                     */
+} dxwifi_mem_subsystem_t;
+
+
+typedef struct {
+    size_t  current;        /* Bytes held right now                             */
+    size_t  peak;           /* Most bytes held at once since the last reset     */
+    size_t  allocations;    /* Number of allocations made                       */
+    size_t  refused;        /* Number of allocations refused by the budget      */
+    size_t  budget;         /* Limit on the bytes held, 0 for no limit          */
+} dxwifi_mem_usage;
+
+
+/**
+ *  DESCRIPTION:    Allocates a block counted against a subsystem
+ *
+ *  ARGUMENTS:
+ *
+ *      subsystem:  Subsystem making the allocation
+ *
+ *      size:       Size of the block in bytes
+ *
+ *  RETURNS:
+ *
+ *      void*:      The block or NULL if the allocation failed or would exceed
+ *                  the subsystem's or the overall budget
+ *
+ */
+void* dxwifi_malloc(dxwifi_mem_subsystem_t subsystem, size_t size);
+
+
+/**
+ *  DESCRIPTION:    Same as dxwifi_malloc but the block is zeroed
+ */
+void* dxwifi_calloc(dxwifi_mem_subsystem_t subsystem, size_t nmemb, size_t size);
+
+
+/**
+ *  DESCRIPTION:    Same as dxwifi_malloc but the block is aligned on alignment
+ *                  bytes, which must be a power of two
+ */
+void* dxwifi_aligned_alloc(dxwifi_mem_subsystem_t subsystem, size_t alignment, size_t size);
+
+
+/**
+ *  DESCRIPTION:    Resizes a block allocated by the same subsystem. NULL
+ *                  allocates a new one
+ *
+ *  RETURNS:
+ *
+ *      void*:      The resized block or NULL if it couldn't be resized, the
+ *                  original block is then left untouched
+ *
+ */
+void* dxwifi_realloc(dxwifi_mem_subsystem_t subsystem, void* ptr, size_t size);
+
+
+/**
+ *  DESCRIPTION:    Frees a block allocated by the same subsystem, NULL is
+ *                  ignored
+ */
+void dxwifi_free(dxwifi_mem_subsystem_t subsystem, void* ptr);
+
+
+/**
+ *  DESCRIPTION:    Stops counting a block that is handed over to the user, who
+ *                  frees it with free()
+ */
+void dxwifi_mem_release(dxwifi_mem_subsystem_t subsystem, void* ptr);
+
+
+/**
+ *  DESCRIPTION:    Counts bytes allocated or freed outside of the functions
+ *                  above, e.g. by a library with its own allocator
+ *
+ *  ARGUMENTS:
+ *
+ *      subsystem:  Subsystem the bytes belong to
+ *
+ *      delta:      Bytes allocated, negative for bytes freed
+ *
+ *  NOTES: The bytes are counted even over budget, as they are already
+ *  allocated. The next allocation through the functions above is refused.
+ *
+ */
+void dxwifi_mem_account(dxwifi_mem_subsystem_t subsystem, ssize_t delta);
+
+
+/**
+ *  DESCRIPTION:    Reads the usage of a subsystem
+ *
+ *  ARGUMENTS:
+ *
+ *      subsystem:  Subsystem or DXWIFI_MEM_ALL_SUBSYSTEMS for overall usage
+ *
+ *      out:        Filled with the usage
+ *
+ */
+void dxwifi_mem_get_usage(dxwifi_mem_subsystem_t subsystem, dxwifi_mem_usage* out);
+
+
+/**
+ *  DESCRIPTION:    Limits the bytes a subsystem may hold
+ *
+ *  ARGUMENTS:
+ *
+ *      subsystem:  Subsystem or DXWIFI_MEM_ALL_SUBSYSTEMS for an overall limit
+ *
+ *      budget:     Limit in bytes, 0 removes it
+ *
+ */
+void dxwifi_mem_set_budget(dxwifi_mem_subsystem_t subsystem, size_t budget);
+
+
+/**
+ *  DESCRIPTION:    Starts the peak of every subsystem over from its current
+ *                  usage, e.g. to measure a single call
+ */
+void dxwifi_mem_reset_peak();
+
+
+/**
+ *  DESCRIPTION:    Logs the usage of every subsystem that allocated anything
+ */
+void dxwifi_mem_log_usage();
+
+
+/**
+ *  DESCRIPTION:    Name of a subsystem, e.g. "fec"
+ */
+const char* dxwifi_mem_subsystem_to_str(dxwifi_mem_subsystem_t subsystem);
+
+
+#endif // LIBDXWIFI_DETAILS_MEMORY_H
@@ -0,0 +1,59 @@
+/**
+ *  probes.h
+ *
+ *  DESCRIPTION: Static tracepoints (USDT) of the "dxwifi" provider. Each probe
+ *  compiles to a single nop that perf, bpftrace or SystemTap can attach to in a
+ *  production binary, nothing is logged and no timing is disturbed until then.
+ *  Without sys/sdt.h the probes compile to nothing.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: Stages are bracketed by a __start and a __done probe so their
+ *  latency can be measured, see config/bpftrace/dxwifi-stages.bt. Probe
+ *  arguments must be integers or pointers and should be cheap to compute, they
+ *  are evaluated even when nothing is attached.
+ *
+ *      dxwifi:inject__start        (frame_no, nbytes)
+ *      dxwifi:inject__done         (frame_no, status)
+ *      dxwifi:capture__start       (caplen)
+ *      dxwifi:capture__done        (frame_no, payload_size)
+ *      dxwifi:decode__start        (nframes)
+ *      dxwifi:rs__frame            (index, corrected_symbols, uncorrectable_blocks)
+ *      dxwifi:rs__done             (nframes, errored_frames)
+ *      dxwifi:ldpc__start          (block, n, k)
+ *      dxwifi:ldpc__symbol         (esi, block)
+ *      dxwifi:ldpc__done           (block, decoded)
+ *      dxwifi:decode__done         (size or dxwifi_fec_error)
+ *      dxwifi:write__start         (fd, nbytes)
+ *      dxwifi:write__done          (fd, written)
+ *
+ *  The RS stage only checks every frame, errored frames are corrected later
+ *  when a block needs them. Their rs__frame probes fire as blocks are decoded,
+ *  clean frames fire theirs with no corrections during the RS stage.
+ *
+ *  OpenFEC has probes of its own in the "openfec" provider, see of_debug.h.
+ *
+ */
+
+#ifndef LIBDXWIFI_DETAILS_PROBES_H
+#define LIBDXWIFI_DETAILS_PROBES_H
+
+#if defined(DXWIFI_HAVE_SDT)
+
+#include <sys/sdt.h>
+
+#define DXWIFI_PROBE1(name, a)          DTRACE_PROBE1(dxwifi, name, a)
+#define DXWIFI_PROBE2(name, a, b)       DTRACE_PROBE2(dxwifi, name, a, b)
+#define DXWIFI_PROBE3(name, a, b, c)    DTRACE_PROBE3(dxwifi, name, a, b, c)
+
+#else
+
+// Arguments are still referenced so that variables kept only for a probe
+// don't warn, the compiler discards them
+#define DXWIFI_PROBE1(name, a)          ((void) (a))
+#define DXWIFI_PROBE2(name, a, b)       ((void) (a), (void) (b))
+#define DXWIFI_PROBE3(name, a, b, c)    ((void) (a), (void) (b), (void) (c))
+
+#endif // DXWIFI_HAVE_SDT
+
+#endif // LIBDXWIFI_DETAILS_PROBES_H
@@ -0,0 +1,932 @@
+/**
+ *  raptor.c
+ *
+ *  DESCRIPTION: See raptor.h for details
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ */
+
+#include <string.h>
+
+#include <libdxwifi/details/raptor.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/memory.h>
+
+
+// Alignment of the scratch symbols
+#define RAPTOR_SYMBOL_ALIGN 64
+
+// Highest LT degree, and most intermediate symbols in an encoding symbol
+#define RAPTOR_MAX_DEGREE   40
+#define RAPTOR_MAX_INDICES  (RAPTOR_MAX_DEGREE + 3)
+
+// Degree distribution of RFC 5053 5.4.4.2, a value drawn uniformly from
+// [0, 2^20) maps to the degree of the first bound it falls under
+static const uint32_t degree_bounds[] = { 10241, 491582, 712794, 831695, 948446, 1032189, 1048576 };
+static const uint32_t degree_values[] = { 1, 2, 3, 4, 10, 11, RAPTOR_MAX_DEGREE };
+
+
+// Column states while decoding
+enum { COL_ACTIVE, COL_RESOLVED, COL_INACTIVE };
+
+// Row states while decoding, rows still pending after peeling are spares for
+// solving the inactive symbols
+enum { ROW_PENDING, ROW_PIVOT };
+
+
+static bool is_prime(uint32_t n) {
+    if(n < 2) {
+        return false;
+    }
+    for(uint32_t d = 2; d * d <= n; ++d) {
+        if(n % d == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static uint32_t next_prime(uint32_t n) {
+    while(!is_prime(n)) {
+        ++n;
+    }
+    return n;
+}
+
+
+// Binomial coefficient, saturated so the HDPC size search can't overflow
+static uint64_t choose(uint32_t n, uint32_t k) {
+    uint64_t c = 1;
+    for(uint32_t i = 1; i <= k && c < UINT32_MAX; ++i) {
+        c = c * (n - k + i) / i;
+    }
+    return c;
+}
+
+
+// Uniform value in [0, m) for the ith draw of an ESI. A fixed integer hash so
+// that every platform derives the same triples
+static uint32_t raptor_rand(uint32_t j, uint32_t esi, uint32_t i, uint32_t m) {
+    uint32_t x = esi * 0x9e3779b1u + i * 0x85ebca77u + j * 0xc2b2ae3du + 0x165667b1u;
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return (uint32_t) (((uint64_t) x * m) >> 32);
+}
+
+
+// Intermediate symbols combined by the encoding symbol of an ESI. The LT part
+// is over the first W = K + S of them, then 2 or 3 of the H HDPC symbols are
+// added as in RFC 6330 5.3.5.4, those are permanently inactive. Without them a
+// few short rows, say degree 2 rows closing a cycle, are too often dependent
+// for the K source rows to have full rank. Steps are modulo a prime so the
+// indices are all distinct. Returns how many there are
+static uint32_t lt_indices(const raptor_code* code, uint32_t esi, uint32_t* out) {
+    uint32_t w = code->k + code->s;
+    uint32_t v = raptor_rand(code->j, esi, 0, 1 << 20);
+    uint32_t d = 0;
+    while(v >= degree_bounds[d]) {
+        ++d;
+    }
+    d = degree_values[d] < w ? degree_values[d] : w;
+
+    uint32_t a = 1 + raptor_rand(code->j, esi, 1, code->wp - 1);
+    uint32_t b = raptor_rand(code->j, esi, 2, code->wp);
+    for(uint32_t i = 0; i < d; ++i) {
+        if(i > 0) {
+            b = (b + a) % code->wp;
+        }
+        while(b >= w) {
+            b = (b + a) % code->wp;
+        }
+        out[i] = b;
+    }
+
+    uint32_t d1 = d < 4 ? 2 : 3;
+    d1 = d1 < code->h ? d1 : code->h;
+
+    uint32_t a1 = 1 + raptor_rand(code->j, esi, 3, code->hp - 1);
+    uint32_t b1 = raptor_rand(code->j, esi, 4, code->hp);
+    for(uint32_t i = 0; i < d1; ++i) {
+        if(i > 0) {
+            b1 = (b1 + a1) % code->hp;
+        }
+        while(b1 >= code->h) {
+            b1 = (b1 + a1) % code->hp;
+        }
+        out[d + i] = w + b1;
+    }
+    return d + d1;
+}
+
+
+// The three LDPC rows of one of the first K intermediate symbols, RFC 5053
+// 5.4.2.3
+static void ldpc_rows(const raptor_code* code, uint32_t c, uint32_t rows[3]) {
+    uint32_t a = 1 + (c / code->s) % (code->s - 1);
+    uint32_t b = c % code->s;
+
+    rows[0] = b;
+    rows[1] = (rows[0] + a) % code->s;
+    rows[2] = (rows[1] + a) % code->s;
+}
+
+
+static void xor_symbol(void* restrict dst, const void* restrict src, size_t size) {
+    uint64_t* d = dst;
+    const uint64_t* s = src;
+    for(size_t i = 0; i < size / sizeof(uint64_t); ++i) {
+        d[i] ^= s[i];
+    }
+}
+
+
+// HDPC sums of the first K + S intermediate symbols into out, NULL values are
+// skipped. Each row is in about half of the sums, so rather than adding every
+// value to each of its rows the values are gathered into one bucket per
+// pattern of RAPTOR_HDPC_GROUP_BITS rows, then the rows are summed from the
+// buckets. That's one XOR per value per group instead of one per row
+static bool hdpc_sums(const raptor_code* code, void* const* values, void* const* out, size_t size) {
+    const uint32_t nbuckets = 1 << RAPTOR_HDPC_GROUP_BITS;
+
+    uint8_t* buckets = dxwifi_aligned_alloc(DXWIFI_MEM_FEC, RAPTOR_SYMBOL_ALIGN, nbuckets * size);
+    if(!buckets) {
+        return false;
+    }
+
+    for(uint32_t first = 0; first < code->h; first += RAPTOR_HDPC_GROUP_BITS) {
+        uint32_t nrows = code->h - first < RAPTOR_HDPC_GROUP_BITS ? code->h - first : RAPTOR_HDPC_GROUP_BITS;
+        uint32_t mask  = (1u << nrows) - 1;
+
+        memset(buckets, 0, nbuckets * size);
+        for(uint32_t c = 0; c < code->k + code->s; ++c) {
+            uint32_t key = (code->hdpc[c] >> first) & mask;
+            if(key && values[c]) {
+                xor_symbol(buckets + key * size, values[c], size);
+            }
+        }
+        for(uint32_t t = 0; t < nrows; ++t) {
+            memset(out[first + t], 0, size);
+            for(uint32_t key = 1; key <= mask; ++key) {
+                if(key & (1u << t)) {
+                    xor_symbol(out[first + t], buckets + key * size, size);
+                }
+            }
+        }
+    }
+    dxwifi_free(DXWIFI_MEM_FEC, buckets);
+    return true;
+}
+
+
+/**
+ *  Decoder state. Every intermediate symbol is a column, every LDPC constraint
+ *  and received encoding symbol a sparse row over the columns. The HDPC rows
+ *  are dense so they are only brought in to solve the inactive columns.
+ *
+ *  Solving is split in two. The symbolic pass peels the rows and picks the
+ *  rows that determine the inactive columns, it never touches a symbol so it
+ *  doubles as the rank test of the systematic index search. The numeric pass
+ *  then replays it on the symbols.
+ */
+typedef struct {
+    const raptor_code* code;
+    uint32_t    nrows;          /* S LDPC rows then one per encoding symbol     */
+    uint32_t*   row_start;      /* Columns of each row                          */
+    uint32_t*   row_cols;
+    uint32_t*   col_start;      /* Rows of each column                          */
+    uint32_t*   col_rows;
+    uint32_t*   degree;         /* Active columns left in each row              */
+    uint32_t*   col_sum;        /* XOR of the active columns of each row        */
+    uint8_t*    row_state;
+    uint8_t*    col_state;
+    uint32_t*   col_index;      /* Pivot index of a resolved column or index of
+                                   an inactive one                              */
+    uint32_t*   pivot_row;      /* Rows that resolved each column, in order     */
+    uint32_t*   pivot_col;
+    uint32_t    npivots;
+    uint32_t*   inactive_col;   /* Column of each inactive index                */
+    uint32_t    ninactive;
+    uint32_t*   stack;          /* Rows down to a single active column          */
+    uint32_t    nstack;
+    size_t      words;          /* Words of a combination of inactive columns   */
+    uint64_t*   pivot_bits;     /* Inactive columns each resolved column is
+                                   offset by                                    */
+    uint64_t*   dense;          /* Inactive columns of each selected row        */
+    uint32_t*   selected;       /* Rows that determine the inactive columns,
+                                   HDPC row h is nrows + h                      */
+} raptor_decoder;
+
+
+static void free_decoder(raptor_decoder* dec) {
+    dxwifi_free(DXWIFI_MEM_FEC, dec->row_start);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->row_cols);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->col_start);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->col_rows);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->degree);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->col_sum);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->row_state);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->col_state);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->col_index);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->pivot_row);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->pivot_col);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->inactive_col);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->stack);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->pivot_bits);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->dense);
+    dxwifi_free(DXWIFI_MEM_FEC, dec->selected);
+}
+
+
+// Builds the sparse rows, the LDPC constraints then the triple of each ESI
+static bool build_rows(raptor_decoder* dec, const uint32_t* esi, size_t n) {
+    const raptor_code* code = dec->code;
+    uint32_t l = code->l;
+
+    dec->nrows = code->s + n;
+
+    dec->row_start  = dxwifi_calloc(DXWIFI_MEM_FEC, dec->nrows + 1, sizeof(uint32_t));
+    dec->col_start  = dxwifi_calloc(DXWIFI_MEM_FEC, l + 1, sizeof(uint32_t));
+    dec->degree     = dxwifi_calloc(DXWIFI_MEM_FEC, dec->nrows, sizeof(uint32_t));
+    dec->col_sum    = dxwifi_calloc(DXWIFI_MEM_FEC, dec->nrows, sizeof(uint32_t));
+    dec->row_state  = dxwifi_calloc(DXWIFI_MEM_FEC, dec->nrows, sizeof(uint8_t));
+    dec->col_state  = dxwifi_calloc(DXWIFI_MEM_FEC, l, sizeof(uint8_t));
+    dec->col_index  = dxwifi_calloc(DXWIFI_MEM_FEC, l, sizeof(uint32_t));
+    dec->pivot_row  = dxwifi_calloc(DXWIFI_MEM_FEC, l, sizeof(uint32_t));
+    dec->pivot_col  = dxwifi_calloc(DXWIFI_MEM_FEC, l, sizeof(uint32_t));
+    dec->inactive_col = dxwifi_calloc(DXWIFI_MEM_FEC, l, sizeof(uint32_t));
+    dec->stack      = dxwifi_calloc(DXWIFI_MEM_FEC, dec->nrows, sizeof(uint32_t));
+    if(!dec->row_start || !dec->col_start || !dec->degree || !dec->col_sum || !dec->row_state
+        || !dec->col_state || !dec->col_index || !dec->pivot_row || !dec->pivot_col
+        || !dec->inactive_col || !dec->stack) {
+        return false;
+    }
+
+    // Count the columns of each row, LDPC rows have their own LDPC column
+    // and the first K columns that are in them
+    uint32_t rows[3];
+    uint32_t indices[RAPTOR_MAX_INDICES];
+    for(uint32_t r = 0; r < code->s; ++r) {
+        dec->row_start[r + 1] = 1;
+    }
+    for(uint32_t c = 0; c < code->k; ++c) {
+        ldpc_rows(code, c, rows);
+        for(int i = 0; i < 3; ++i) {
+            ++dec->row_start[rows[i] + 1];
+        }
+    }
+    for(size_t i = 0; i < n; ++i) {
+        dec->row_start[code->s + i + 1] = lt_indices(code, esi[i], indices);
+    }
+    for(uint32_t r = 0; r < dec->nrows; ++r) {
+        dec->row_start[r + 1] += dec->row_start[r];
+    }
+
+    dec->row_cols = dxwifi_malloc(DXWIFI_MEM_FEC, dec->row_start[dec->nrows] * sizeof(uint32_t));
+    dec->col_rows = dxwifi_malloc(DXWIFI_MEM_FEC, dec->row_start[dec->nrows] * sizeof(uint32_t));
+    if(!dec->row_cols || !dec->col_rows) {
+        return false;
+    }
+
+    // Fill them in, degree doubles as the fill position of each row
+    for(uint32_t r = 0; r < code->s; ++r) {
+        dec->row_cols[dec->row_start[r]] = code->k + r;
+        dec->degree[r] = 1;
+    }
+    for(uint32_t c = 0; c < code->k; ++c) {
+        ldpc_rows(code, c, rows);
+        for(int i = 0; i < 3; ++i) {
+            dec->row_cols[dec->row_start[rows[i]] + dec->degree[rows[i]]++] = c;
+        }
+    }
+    for(size_t i = 0; i < n; ++i) {
+        uint32_t r = code->s + i;
+        dec->degree[r] = lt_indices(code, esi[i], dec->row_cols + dec->row_start[r]);
+    }
+
+    // Transpose into the rows of each column
+    for(uint32_t e = 0; e < dec->row_start[dec->nrows]; ++e) {
+        ++dec->col_start[dec->row_cols[e] + 1];
+    }
+    for(uint32_t c = 0; c < l; ++c) {
+        dec->col_start[c + 1] += dec->col_start[c];
+    }
+    uint32_t* fill = dec->col_index;
+    for(uint32_t r = 0; r < dec->nrows; ++r) {
+        for(uint32_t e = dec->row_start[r]; e < dec->row_start[r + 1]; ++e) {
+            uint32_t c = dec->row_cols[e];
+            dec->col_rows[dec->col_start[c] + fill[c]++] = r;
+            dec->col_sum[r] ^= c;
+        }
+    }
+    memset(fill, 0, l * sizeof(uint32_t));
+    return true;
+}
+
+
+// Takes an active column out of the rows it is in. Rows left with a single
+// active column are stacked to resolve it
+static void deactivate(raptor_decoder* dec, uint32_t c) {
+    for(uint32_t e = dec->col_start[c]; e < dec->col_start[c + 1]; ++e) {
+        uint32_t r = dec->col_rows[e];
+
+        dec->col_sum[r] ^= c;
+        if(--dec->degree[r] == 1 && dec->row_state[r] == ROW_PENDING) {
+            dec->stack[dec->nstack++] = r;
+        }
+    }
+}
+
+
+static void inactivate(raptor_decoder* dec, uint32_t c) {
+    dec->col_state[c] = COL_INACTIVE;
+    dec->col_index[c] = dec->ninactive;
+    dec->inactive_col[dec->ninactive++] = c;
+    deactivate(dec, c);
+}
+
+
+// Peels the rows down to the columns that have to be inactivated. Columns are
+// resolved in order, each by a row whose other columns are either resolved
+// before it or inactive
+static void peel(raptor_decoder* dec) {
+    const raptor_code* code = dec->code;
+
+    // HDPC columns are in most encoding symbols, they would be the first
+    // inactivated anyway
+    for(uint32_t c = code->k + code->s; c < code->l; ++c) {
+        inactivate(dec, c);
+    }
+    dec->nstack = 0;
+    for(uint32_t r = 0; r < dec->nrows; ++r) {
+        if(dec->degree[r] == 1) {
+            dec->stack[dec->nstack++] = r;
+        }
+    }
+
+    uint32_t scan = 0;
+    while(true) {
+        while(dec->nstack > 0) {
+            uint32_t r = dec->stack[--dec->nstack];
+            if(dec->row_state[r] != ROW_PENDING || dec->degree[r] != 1) {
+                continue;
+            }
+            uint32_t c = dec->col_sum[r];
+            debug_assert(dec->col_state[c] == COL_ACTIVE);
+
+            dec->row_state[r] = ROW_PIVOT;
+            dec->col_state[c] = COL_RESOLVED;
+            dec->col_index[c] = dec->npivots;
+            dec->pivot_row[dec->npivots] = r;
+            dec->pivot_col[dec->npivots++] = c;
+            deactivate(dec, c);
+        }
+
+        // Stalled, inactivate all but one column of a row with the fewest. The
+        // search resumes where the last one ended and stops at the first row
+        // of degree 2, the fewest a pending row can have
+        uint32_t best = dec->nrows;
+        for(uint32_t i = 0; i < dec->nrows && (best == dec->nrows || dec->degree[best] > 2); ++i) {
+            uint32_t r = (scan + i) % dec->nrows;
+            if(dec->row_state[r] == ROW_PENDING && dec->degree[r] >= 2 && (best == dec->nrows || dec->degree[r] < dec->degree[best])) {
+                best = r;
+            }
+        }
+        if(best == dec->nrows) {
+            break;
+        }
+        scan = best;
+
+        bool kept = false;
+        for(uint32_t e = dec->row_start[best]; e < dec->row_start[best + 1]; ++e) {
+            uint32_t c = dec->row_cols[e];
+            if(dec->col_state[c] == COL_ACTIVE) {
+                if(kept) {
+                    inactivate(dec, c);
+                }
+                kept = true;
+            }
+        }
+    }
+
+    // Columns no row could resolve
+    for(uint32_t c = 0; c < code->l; ++c) {
+        if(dec->col_state[c] == COL_ACTIVE) {
+            dec->col_state[c] = COL_INACTIVE;
+            dec->col_index[c] = dec->ninactive;
+            dec->inactive_col[dec->ninactive++] = c;
+        }
+    }
+}
+
+
+static void xor_bits(uint64_t* restrict dst, const uint64_t* restrict src, size_t words) {
+    for(size_t i = 0; i < words; ++i) {
+        dst[i] ^= src[i];
+    }
+}
+
+
+static bool bits_zero(const uint64_t* bits, size_t words) {
+    for(size_t i = 0; i < words; ++i) {
+        if(bits[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Adds a column to the inactive combination of a row, an inactive column is
+// itself and a resolved one the combination it is offset by
+static void add_column_bits(const raptor_decoder* dec, uint32_t c, uint64_t* bits) {
+    if(dec->col_state[c] == COL_INACTIVE) {
+        bits[dec->col_index[c] / 64] ^= 1ull << (dec->col_index[c] % 64);
+    }
+    else {
+        xor_bits(bits, dec->pivot_bits + dec->col_index[c] * dec->words, dec->words);
+    }
+}
+
+
+// Reduces a row against the basis in the order it was built. The row is added
+// to the basis if anything is left of it
+static bool reduce_into_basis(uint64_t* basis, uint32_t* basis_bit, uint32_t* nbasis, const uint64_t* row, size_t words) {
+    uint64_t* reduced = basis + *nbasis * words;
+    memcpy(reduced, row, words * sizeof(uint64_t));
+
+    for(uint32_t i = 0; i < *nbasis; ++i) {
+        if(reduced[basis_bit[i] / 64] & (1ull << (basis_bit[i] % 64))) {
+            xor_bits(reduced, basis + i * words, words);
+        }
+    }
+    for(size_t w = 0; w < words; ++w) {
+        if(reduced[w]) {
+            basis_bit[(*nbasis)++] = w * 64 + __builtin_ctzll(reduced[w]);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Symbolic half of solving. Works out which inactive columns each resolved
+// column is offset by, then picks rows that determine the inactive columns,
+// spare sparse rows first then the HDPC rows. Returns false if there aren't
+// enough of them, the pivot offsets are still filled in for a partial solve
+static bool select_rows(raptor_decoder* dec) {
+    const raptor_code* code = dec->code;
+    uint32_t ninactive = dec->ninactive;
+    size_t words = dec->words = (ninactive + 63) / 64;
+
+    dec->pivot_bits = dxwifi_calloc(DXWIFI_MEM_FEC, (size_t) dec->npivots * words + 1, sizeof(uint64_t));
+    if(!dec->pivot_bits) {
+        return false;
+    }
+    for(uint32_t t = 0; t < dec->npivots; ++t) {
+        uint32_t r = dec->pivot_row[t];
+        uint32_t c = dec->pivot_col[t];
+        for(uint32_t e = dec->row_start[r]; e < dec->row_start[r + 1]; ++e) {
+            if(dec->row_cols[e] != c) {
+                add_column_bits(dec, dec->row_cols[e], dec->pivot_bits + t * words);
+            }
+        }
+    }
+    if(ninactive == 0) {
+        return true;
+    }
+    if(dec->nrows - dec->npivots + code->h < ninactive) {
+        return false;
+    }
+
+    bool selected = false;
+    uint64_t* basis     = dxwifi_malloc(DXWIFI_MEM_FEC, (ninactive + 1) * words * sizeof(uint64_t));
+    uint64_t* hdpc_bits = dxwifi_calloc(DXWIFI_MEM_FEC, code->h * words, sizeof(uint64_t));
+    uint32_t* basis_bit = dxwifi_malloc(DXWIFI_MEM_FEC, (ninactive + 1) * sizeof(uint32_t));
+    dec->dense    = dxwifi_malloc(DXWIFI_MEM_FEC, ninactive * words * sizeof(uint64_t));
+    dec->selected = dxwifi_malloc(DXWIFI_MEM_FEC, ninactive * sizeof(uint32_t));
+    if(!basis || !hdpc_bits || !basis_bit || !dec->dense || !dec->selected) {
+        goto done;
+    }
+
+    uint32_t nbasis = 0;
+    for(uint32_t r = 0; r < dec->nrows && nbasis < ninactive; ++r) {
+        if(dec->row_state[r] != ROW_PENDING) {
+            continue;
+        }
+        uint64_t* bits = dec->dense + nbasis * words;
+        memset(bits, 0, words * sizeof(uint64_t));
+        for(uint32_t e = dec->row_start[r]; e < dec->row_start[r + 1]; ++e) {
+            add_column_bits(dec, dec->row_cols[e], bits);
+        }
+        if(reduce_into_basis(basis, basis_bit, &nbasis, bits, words)) {
+            dec->selected[nbasis - 1] = r;
+        }
+    }
+
+    if(nbasis < ninactive) {
+        for(uint32_t c = 0; c < code->k + code->s; ++c) {
+            for(uint32_t pattern = code->hdpc[c]; pattern; pattern &= pattern - 1) {
+                add_column_bits(dec, c, hdpc_bits + __builtin_ctz(pattern) * words);
+            }
+        }
+        for(uint32_t h = 0; h < code->h && nbasis < ninactive; ++h) {
+            uint64_t* bits = hdpc_bits + h * words;
+            add_column_bits(dec, code->k + code->s + h, bits);
+            if(reduce_into_basis(basis, basis_bit, &nbasis, bits, words)) {
+                memcpy(dec->dense + (nbasis - 1) * words, bits, words * sizeof(uint64_t));
+                dec->selected[nbasis - 1] = dec->nrows + h;
+            }
+        }
+    }
+    selected = nbasis == ninactive;
+
+done:
+    dxwifi_free(DXWIFI_MEM_FEC, basis);
+    dxwifi_free(DXWIFI_MEM_FEC, hdpc_bits);
+    dxwifi_free(DXWIFI_MEM_FEC, basis_bit);
+    return selected;
+}
+
+
+// Numeric half of solving, fills in the columns from the right hand sides of
+// the rows, NULL for the LDPC rows which are zero. Without a selection only
+// the resolved columns that aren't offset by any inactive one are solved, and
+// the others are marked inactive. Returns false if out of memory
+static bool solve_symbols(raptor_decoder* dec, bool selected, void* const* row_sym, void* const* col_sym, size_t size) {
+    const raptor_code* code = dec->code;
+    uint32_t ninactive = dec->ninactive;
+    size_t words = dec->words;
+
+    // Resolved columns with every inactive column zeroed
+    for(uint32_t t = 0; t < dec->npivots; ++t) {
+        uint32_t r = dec->pivot_row[t];
+        uint32_t c = dec->pivot_col[t];
+
+        if(row_sym[r]) {
+            memcpy(col_sym[c], row_sym[r], size);
+        }
+        else {
+            memset(col_sym[c], 0, size);
+        }
+        for(uint32_t e = dec->row_start[r]; e < dec->row_start[r + 1]; ++e) {
+            uint32_t other = dec->row_cols[e];
+            if(other != c && dec->col_state[other] == COL_RESOLVED) {
+                xor_symbol(col_sym[c], col_sym[other], size);
+            }
+        }
+    }
+    if(ninactive == 0) {
+        return true;
+    }
+    if(!selected) {
+        for(uint32_t t = 0; t < dec->npivots; ++t) {
+            if(!bits_zero(dec->pivot_bits + t * words, words)) {
+                dec->col_state[dec->pivot_col[t]] = COL_INACTIVE;
+            }
+        }
+        return true;
+    }
+
+    // Right hand sides of the selected rows with the resolved columns moved
+    // over, the HDPC ones are summed over every column at once
+    bool solved = false;
+    void**   rhs     = dxwifi_malloc(DXWIFI_MEM_FEC, ninactive * sizeof(void*));
+    void**   values  = dxwifi_malloc(DXWIFI_MEM_FEC, (code->k + code->s + code->h) * sizeof(void*));
+    uint8_t* scratch = dxwifi_aligned_alloc(DXWIFI_MEM_FEC, RAPTOR_SYMBOL_ALIGN, (ninactive + code->h) * size);
+    if(!rhs || !values || !scratch) {
+        goto done;
+    }
+    uint8_t* hdpc_rhs = scratch + ninactive * size;
+    bool use_hdpc = false;
+    for(uint32_t i = 0; i < ninactive; ++i) {
+        use_hdpc |= dec->selected[i] >= dec->nrows;
+    }
+    if(use_hdpc) {
+        for(uint32_t c = 0; c < code->k + code->s; ++c) {
+            values[c] = dec->col_state[c] == COL_INACTIVE ? NULL : col_sym[c];
+        }
+        void** hdpc_out = values + code->k + code->s;
+        for(uint32_t h = 0; h < code->h; ++h) {
+            hdpc_out[h] = hdpc_rhs + h * size;
+        }
+        if(!hdpc_sums(code, values, hdpc_out, size)) {
+            goto done;
+        }
+    }
+    for(uint32_t i = 0; i < ninactive; ++i) {
+        uint32_t r = dec->selected[i];
+        rhs[i] = scratch + i * size;
+
+        if(r >= dec->nrows) {
+            uint32_t h = r - dec->nrows;
+            uint32_t c = code->k + code->s + h;
+            memcpy(rhs[i], hdpc_rhs + h * size, size);
+            if(dec->col_state[c] == COL_RESOLVED) {
+                xor_symbol(rhs[i], col_sym[c], size);
+            }
+            continue;
+        }
+        if(row_sym[r]) {
+            memcpy(rhs[i], row_sym[r], size);
+        }
+        else {
+            memset(rhs[i], 0, size);
+        }
+        for(uint32_t e = dec->row_start[r]; e < dec->row_start[r + 1]; ++e) {
+            uint32_t c = dec->row_cols[e];
+            if(dec->col_state[c] == COL_RESOLVED) {
+                xor_symbol(rhs[i], col_sym[c], size);
+            }
+        }
+    }
+
+    // Gauss-Jordan elimination of the selected rows, row i ends up holding
+    // inactive column i
+    uint64_t* rows = dec->dense;
+    for(uint32_t i = 0; i < ninactive; ++i) {
+        uint64_t mask = 1ull << (i % 64);
+        uint32_t p = i;
+        while(!(rows[p * words + i / 64] & mask)) {
+            ++p;
+        }
+        if(p != i) {
+            for(size_t w = 0; w < words; ++w) {
+                uint64_t tmp = rows[p * words + w];
+                rows[p * words + w] = rows[i * words + w];
+                rows[i * words + w] = tmp;
+            }
+            void* tmp = rhs[p];
+            rhs[p] = rhs[i];
+            rhs[i] = tmp;
+        }
+        for(uint32_t q = 0; q < ninactive; ++q) {
+            if(q != i && (rows[q * words + i / 64] & mask)) {
+                xor_bits(rows + q * words + i / 64, rows + i * words + i / 64, words - i / 64);
+                xor_symbol(rhs[q], rhs[i], size);
+            }
+        }
+    }
+    for(uint32_t i = 0; i < ninactive; ++i) {
+        memcpy(col_sym[dec->inactive_col[i]], rhs[i], size);
+    }
+
+    // Put the inactive columns back into the resolved ones, by their
+    // combination or by their row, whichever is fewer symbols
+    for(uint32_t t = 0; t < dec->npivots; ++t) {
+        const uint64_t* bits = dec->pivot_bits + t * words;
+        uint32_t c = dec->pivot_col[t];
+        uint32_t r = dec->pivot_row[t];
+
+        uint32_t count = 0;
+        for(size_t w = 0; w < words; ++w) {
+            count += __builtin_popcountll(bits[w]);
+        }
+        if(count == 0) {
+            continue;
+        }
+        if(count < dec->row_start[r + 1] - dec->row_start[r]) {
+            for(size_t w = 0; w < words; ++w) {
+                for(uint64_t word = bits[w]; word; word &= word - 1) {
+                    xor_symbol(col_sym[c], col_sym[dec->inactive_col[w * 64 + __builtin_ctzll(word)]], size);
+                }
+            }
+        }
+        else {
+            if(row_sym[r]) {
+                memcpy(col_sym[c], row_sym[r], size);
+            }
+            else {
+                memset(col_sym[c], 0, size);
+            }
+            for(uint32_t e = dec->row_start[r]; e < dec->row_start[r + 1]; ++e) {
+                if(dec->row_cols[e] != c) {
+                    xor_symbol(col_sym[c], col_sym[dec->row_cols[e]], size);
+                }
+            }
+        }
+    }
+    for(uint32_t i = 0; i < ninactive; ++i) {
+        dec->col_state[dec->inactive_col[i]] = COL_RESOLVED;
+    }
+    solved = true;
+
+done:
+    dxwifi_free(DXWIFI_MEM_FEC, rhs);
+    dxwifi_free(DXWIFI_MEM_FEC, values);
+    dxwifi_free(DXWIFI_MEM_FEC, scratch);
+    return solved;
+}
+
+
+// Whether the source triples of the current systematic index and the precode
+// constraints determine every intermediate symbol, false if out of memory
+static bool systematic_full_rank(const raptor_code* code, const uint32_t* esi) {
+    raptor_decoder dec = { .code = code };
+
+    bool full = false;
+    if(build_rows(&dec, esi, code->k)) {
+        peel(&dec);
+        full = select_rows(&dec);
+    }
+    free_decoder(&dec);
+    return full;
+}
+
+
+//
+// See raptor.h for non-static function descriptions
+//
+
+bool raptor_init(raptor_code* code, uint32_t k) {
+    debug_assert(code);
+
+    memset(code, 0, sizeof(raptor_code));
+    if(k == 0 || k > RAPTOR_MAX_K) {
+        return false;
+    }
+
+    // Sizes of RFC 5053 5.4.2.3
+    uint32_t x = 1;
+    while(x * (x - 1) < 2 * k) {
+        ++x;
+    }
+    uint32_t s = next_prime((k + 99) / 100 + x);
+    uint32_t h = 1;
+    while(choose(h, (h + 1) / 2) < k + s) {
+        ++h;
+    }
+
+    code->k  = k;
+    code->s  = s;
+    code->h  = h;
+    code->l  = k + s + h;
+    code->wp = next_prime(k + s);
+    code->hp = next_prime(h);
+
+    code->hdpc = dxwifi_malloc(DXWIFI_MEM_FEC, (k + s) * sizeof(uint32_t));
+    uint32_t* esi = dxwifi_malloc(DXWIFI_MEM_FEC, k * sizeof(uint32_t));
+    if(!code->hdpc || !esi) {
+        dxwifi_free(DXWIFI_MEM_FEC, esi);
+        raptor_close(code);
+        return false;
+    }
+
+    // Column c of the HDPC rows is the cth Gray code word with ceil(H/2) bits set
+    uint32_t weight = (h + 1) / 2;
+    for(uint32_t i = 0, c = 0; c < k + s; ++i) {
+        uint32_t gray = i ^ (i >> 1);
+        if((uint32_t) __builtin_popcount(gray) == weight) {
+            code->hdpc[c++] = gray;
+        }
+    }
+
+    for(uint32_t i = 0; i < k; ++i) {
+        esi[i] = i;
+    }
+    bool full = false;
+    for(code->j = 0; code->j < RAPTOR_MAX_SYSTEMATIC_TRIES && !full; ++code->j) {
+        full = systematic_full_rank(code, esi);
+    }
+    --code->j;
+    dxwifi_free(DXWIFI_MEM_FEC, esi);
+
+    if(!full) {
+        raptor_close(code);
+    }
+    return full;
+}
+
+
+void raptor_close(raptor_code* code) {
+    debug_assert(code);
+
+    dxwifi_free(DXWIFI_MEM_FEC, code->hdpc);
+    memset(code, 0, sizeof(raptor_code));
+}
+
+
+bool raptor_precode(const raptor_code* code, void* const* source, void* const* intermediate, size_t size) {
+    debug_assert(code && source && intermediate && size % sizeof(uint64_t) == 0);
+
+    raptor_decoder dec = { .code = code };
+
+    bool solved = false;
+    uint32_t* esi     = dxwifi_malloc(DXWIFI_MEM_FEC, code->k * sizeof(uint32_t));
+    void**    row_sym = dxwifi_calloc(DXWIFI_MEM_FEC, code->s + code->k, sizeof(void*));
+    if(esi && row_sym) {
+        for(uint32_t i = 0; i < code->k; ++i) {
+            esi[i] = i;
+            row_sym[code->s + i] = source[i];
+        }
+        if(build_rows(&dec, esi, code->k)) {
+            peel(&dec);
+            solved = select_rows(&dec) && solve_symbols(&dec, true, row_sym, intermediate, size);
+        }
+    }
+    free_decoder(&dec);
+    dxwifi_free(DXWIFI_MEM_FEC, esi);
+    dxwifi_free(DXWIFI_MEM_FEC, row_sym);
+    return solved;
+}
+
+
+void raptor_encode(const raptor_code* code, void* const* intermediate, uint32_t esi, void* out, size_t size) {
+    debug_assert(code && intermediate && out && size % sizeof(uint64_t) == 0);
+
+    uint32_t indices[RAPTOR_MAX_INDICES];
+    uint32_t degree = lt_indices(code, esi, indices);
+
+    memcpy(out, intermediate[indices[0]], size);
+    for(uint32_t i = 1; i < degree; ++i) {
+        xor_symbol(out, intermediate[indices[i]], size);
+    }
+}
+
+
+bool raptor_decode(const raptor_code* code, void* const* source, bool* known, void* const* repair, const uint32_t* esi, size_t nrepair, size_t size) {
+    debug_assert(code && source && known && (repair || nrepair == 0) && size % sizeof(uint64_t) == 0);
+
+    uint32_t received = 0;
+    for(uint32_t c = 0; c < code->k; ++c) {
+        received += known[c];
+    }
+    if(received == code->k) {
+        return true;
+    }
+
+    raptor_decoder dec = { .code = code };
+
+    size_t n = received + nrepair;
+    uint32_t* esis         = dxwifi_malloc(DXWIFI_MEM_FEC, (n + 1) * sizeof(uint32_t));
+    void**    row_sym      = dxwifi_calloc(DXWIFI_MEM_FEC, code->s + n, sizeof(void*));
+    void**    intermediate = dxwifi_malloc(DXWIFI_MEM_FEC, code->l * sizeof(void*));
+    uint8_t*  symbols      = dxwifi_aligned_alloc(DXWIFI_MEM_FEC, RAPTOR_SYMBOL_ALIGN, code->l * size);
+
+    bool solved  = false;
+    bool decoded = false;
+    if(esis && row_sym && intermediate && symbols) {
+        size_t i = 0;
+        for(uint32_t c = 0; c < code->k; ++c) {
+            if(known[c]) {
+                row_sym[code->s + i] = source[c];
+                esis[i++] = c;
+            }
+        }
+        for(size_t r = 0; r < nrepair; ++r, ++i) {
+            debug_assert(esi[r] >= code->k);
+            row_sym[code->s + i] = repair[r];
+            esis[i] = esi[r];
+        }
+        for(uint32_t c = 0; c < code->l; ++c) {
+            intermediate[c] = symbols + c * size;
+        }
+
+        if(build_rows(&dec, esis, n)) {
+            peel(&dec);
+            bool selected = select_rows(&dec);
+            solved = dec.pivot_bits && solve_symbols(&dec, selected, row_sym, intermediate, size);
+        }
+
+        // Rebuild the missing source symbols from the intermediate symbols
+        // that could be solved
+        decoded = true;
+        uint32_t indices[RAPTOR_MAX_INDICES];
+        for(uint32_t c = 0; c < code->k; ++c) {
+            if(known[c]) {
+                continue;
+            }
+            uint32_t degree = lt_indices(code, c, indices);
+            bool resolved = solved;
+            for(uint32_t e = 0; e < degree && resolved; ++e) {
+                resolved = dec.col_state[indices[e]] == COL_RESOLVED;
+            }
+            if(resolved) {
+                raptor_encode(code, intermediate, c, source[c], size);
+                known[c] = true;
+            }
+            else {
+                memset(source[c], 0, size);
+                decoded = false;
+            }
+        }
+    }
+    else {
+        for(uint32_t c = 0; c < code->k; ++c) {
+            if(!known[c]) {
+                memset(source[c], 0, size);
+            }
+        }
+    }
+
+    free_decoder(&dec);
+    dxwifi_free(DXWIFI_MEM_FEC, esis);
+    dxwifi_free(DXWIFI_MEM_FEC, row_sym);
+    dxwifi_free(DXWIFI_MEM_FEC, intermediate);
+    dxwifi_free(DXWIFI_MEM_FEC, symbols);
+    return decoded;
+}
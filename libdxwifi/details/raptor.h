@@ -0,0 +1,187 @@
+/**
+ *  raptor.h
+ *
+ *  DESCRIPTION: Systematic Raptor fountain code. A block of K source symbols
+ *  is turned into L = K + S + H intermediate symbols that satisfy S LDPC and H
+ *  HDPC precode constraints, built as in RFC 5053. Every encoding symbol is the
+ *  XOR of a few intermediate symbols picked by the LT triple of its ESI, and
+ *  the intermediate symbols are solved so that the encoding symbols with an
+ *  ESI below K are the source symbols themselves. Every ESI from K up is a
+ *  repair symbol, they depend on nothing but their ESI so any number of fresh
+ *  ones can be made on demand and there is no fixed N.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: The triples come from a hash rather than the RFC tables and the
+ *  systematic index is searched for when the code is set up rather than read
+ *  from a table, so this is not interoperable with RFC 5053 or RFC 6330. The
+ *  search is deterministic, both ends find the same index for the same K.
+ *
+ */
+
+
+#ifndef LIBDXWIFI_DETAILS_RAPTOR_H
+#define LIBDXWIFI_DETAILS_RAPTOR_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+
+/************************
+ *  Constants
+ ***********************/
+
+// Largest source block, ESIs are 16 bits on air so this leaves as many repair
+// ESIs as there are source symbols
+#define RAPTOR_MAX_K 32768
+
+// HDPC rows computed together in one pass over the intermediate symbols
+#define RAPTOR_HDPC_GROUP_BITS 6
+
+// Systematic indices tried before giving up on a K
+#define RAPTOR_MAX_SYSTEMATIC_TRIES 256
+
+
+/************************
+ *  Data structures
+ ***********************/
+
+/**
+ *  Code parameters, they only depend on K
+ */
+typedef struct {
+    uint32_t    k;          /* Number of source symbols                     */
+    uint32_t    s;          /* Number of LDPC symbols                       */
+    uint32_t    h;          /* Number of HDPC symbols                       */
+    uint32_t    l;          /* Number of intermediate symbols, K + S + H    */
+    uint32_t    wp;         /* Smallest prime at least K + S                */
+    uint32_t    hp;         /* Smallest prime at least H                    */
+    uint32_t    j;          /* Systematic index, seeds the LT triples       */
+    uint32_t*   hdpc;       /* HDPC rows each of the first K + S
+                               intermediate symbols is in, one bit per row  */
+} raptor_code;
+
+
+/************************
+ *  Functions
+ ***********************/
+
+/**
+ *  DESCRIPTION:    Sets up the code for a source block
+ *
+ *  ARGUMENTS:
+ *
+ *      code:       Code to initialize
+ *
+ *      k:          Number of source symbols, 1 to RAPTOR_MAX_K
+ *
+ *  RETURNS:
+ *
+ *      bool:       False if K is out of range, no systematic index was found
+ *                  or out of memory
+ *
+ *  NOTES: Searches for the first systematic index whose K source triples and
+ *  precode constraints have full rank. That's a symbolic elimination with no
+ *  symbols involved, a few are usually tried.
+ *
+ */
+bool raptor_init(raptor_code* code, uint32_t k);
+
+
+/**
+ *  DESCRIPTION:    Releases the resources of a code
+ *
+ *  ARGUMENTS:
+ *
+ *      code:       Initialized code
+ *
+ */
+void raptor_close(raptor_code* code);
+
+
+/**
+ *  DESCRIPTION:    Solves the intermediate symbols of a source block
+ *
+ *  ARGUMENTS:
+ *
+ *      code:           Initialized code
+ *
+ *      source:         K source symbols
+ *
+ *      intermediate:   L symbols, overwritten with the intermediate symbols
+ *
+ *      size:           Size of every symbol, a multiple of 8 bytes
+ *
+ *  RETURNS:
+ *
+ *      bool:           False if out of memory
+ *
+ *  NOTES: Same work as decoding a block with every source symbol received.
+ *
+ */
+bool raptor_precode(const raptor_code* code, void* const* source, void* const* intermediate, size_t size);
+
+
+/**
+ *  DESCRIPTION:    Builds an encoding symbol
+ *
+ *  ARGUMENTS:
+ *
+ *      code:           Initialized code
+ *
+ *      intermediate:   Intermediate symbols from raptor_precode
+ *
+ *      esi:            ESI of the symbol, any value
+ *
+ *      out:            Filled with the symbol
+ *
+ *      size:           Size of every symbol, a multiple of 8 bytes
+ *
+ *  NOTES: One XOR per intermediate symbol combined, fewer than 5 on average.
+ *  An ESI below K gives back its source symbol, which is cheaper to copy.
+ *
+ */
+void raptor_encode(const raptor_code* code, void* const* intermediate, uint32_t esi, void* out, size_t size);
+
+
+/**
+ *  DESCRIPTION:    Recovers the missing source symbols of a block
+ *
+ *  ARGUMENTS:
+ *
+ *      code:       Initialized code
+ *
+ *      source:     K source symbol slots, missing ones are filled in
+ *
+ *      known:      K flags, set for the source symbols that were received.
+ *                  Updated with the source symbols that could be recovered
+ *
+ *      repair:     Received repair symbols, left untouched
+ *
+ *      esi:        ESI of each repair symbol, all distinct and at least K
+ *
+ *      nrepair:    Number of repair symbols
+ *
+ *      size:       Size of every symbol, a multiple of 8 bytes
+ *
+ *  RETURNS:
+ *
+ *      bool:       True if every source symbol is known
+ *
+ *  NOTES: Inactivation decoding. The sparse equations are peeled, and when
+ *  no equation is left with a single unknown the fewest unknowns are set
+ *  aside as inactive so peeling can go on. Only the inactive symbols are
+ *  solved by Gaussian elimination, with the dense HDPC equations added if the
+ *  sparse ones fall short, then everything else follows by substitution. When
+ *  the block can't be solved the source symbols that don't depend on the
+ *  inactive symbols are still recovered and the rest are zero filled.
+ *
+ *  The odds of failing roughly halve with each distinct encoding symbol past
+ *  K, about 2% with K + 5 and next to none with K + 10.
+ *
+ */
+bool raptor_decode(const raptor_code* code, void* const* source, bool* known, void* const* repair, const uint32_t* esi, size_t nrepair, size_t size);
+
+
+#endif // LIBDXWIFI_DETAILS_RAPTOR_H
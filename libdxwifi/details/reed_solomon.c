@@ -0,0 +1,336 @@
+/**
+ *  reed_solomon.c
+ *
+ *  DESCRIPTION: See reed_solomon.h for details
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ */
+
+#include <string.h>
+#include <pthread.h>
+
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/reed_solomon.h>
+
+
+// Antilog table, doubled so the sum of two logs never needs reducing
+static const uint8_t gf_exp[512] = {
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1d, 0x3a, 0x74, 0xe8, 0xcd, 0x87, 0x13, 0x26,
+    0x4c, 0x98, 0x2d, 0x5a, 0xb4, 0x75, 0xea, 0xc9, 0x8f, 0x03, 0x06, 0x0c, 0x18, 0x30, 0x60, 0xc0,
+    0x9d, 0x27, 0x4e, 0x9c, 0x25, 0x4a, 0x94, 0x35, 0x6a, 0xd4, 0xb5, 0x77, 0xee, 0xc1, 0x9f, 0x23,
+    0x46, 0x8c, 0x05, 0x0a, 0x14, 0x28, 0x50, 0xa0, 0x5d, 0xba, 0x69, 0xd2, 0xb9, 0x6f, 0xde, 0xa1,
+    0x5f, 0xbe, 0x61, 0xc2, 0x99, 0x2f, 0x5e, 0xbc, 0x65, 0xca, 0x89, 0x0f, 0x1e, 0x3c, 0x78, 0xf0,
+    0xfd, 0xe7, 0xd3, 0xbb, 0x6b, 0xd6, 0xb1, 0x7f, 0xfe, 0xe1, 0xdf, 0xa3, 0x5b, 0xb6, 0x71, 0xe2,
+    0xd9, 0xaf, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0d, 0x1a, 0x34, 0x68, 0xd0, 0xbd, 0x67, 0xce,
+    0x81, 0x1f, 0x3e, 0x7c, 0xf8, 0xed, 0xc7, 0x93, 0x3b, 0x76, 0xec, 0xc5, 0x97, 0x33, 0x66, 0xcc,
+    0x85, 0x17, 0x2e, 0x5c, 0xb8, 0x6d, 0xda, 0xa9, 0x4f, 0x9e, 0x21, 0x42, 0x84, 0x15, 0x2a, 0x54,
+    0xa8, 0x4d, 0x9a, 0x29, 0x52, 0xa4, 0x55, 0xaa, 0x49, 0x92, 0x39, 0x72, 0xe4, 0xd5, 0xb7, 0x73,
+    0xe6, 0xd1, 0xbf, 0x63, 0xc6, 0x91, 0x3f, 0x7e, 0xfc, 0xe5, 0xd7, 0xb3, 0x7b, 0xf6, 0xf1, 0xff,
+    0xe3, 0xdb, 0xab, 0x4b, 0x96, 0x31, 0x62, 0xc4, 0x95, 0x37, 0x6e, 0xdc, 0xa5, 0x57, 0xae, 0x41,
+    0x82, 0x19, 0x32, 0x64, 0xc8, 0x8d, 0x07, 0x0e, 0x1c, 0x38, 0x70, 0xe0, 0xdd, 0xa7, 0x53, 0xa6,
+    0x51, 0xa2, 0x59, 0xb2, 0x79, 0xf2, 0xf9, 0xef, 0xc3, 0x9b, 0x2b, 0x56, 0xac, 0x45, 0x8a, 0x09,
+    0x12, 0x24, 0x48, 0x90, 0x3d, 0x7a, 0xf4, 0xf5, 0xf7, 0xf3, 0xfb, 0xeb, 0xcb, 0x8b, 0x0b, 0x16,
+    0x2c, 0x58, 0xb0, 0x7d, 0xfa, 0xe9, 0xcf, 0x83, 0x1b, 0x36, 0x6c, 0xd8, 0xad, 0x47, 0x8e, 0x01,
+    0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1d, 0x3a, 0x74, 0xe8, 0xcd, 0x87, 0x13, 0x26, 0x4c,
+    0x98, 0x2d, 0x5a, 0xb4, 0x75, 0xea, 0xc9, 0x8f, 0x03, 0x06, 0x0c, 0x18, 0x30, 0x60, 0xc0, 0x9d,
+    0x27, 0x4e, 0x9c, 0x25, 0x4a, 0x94, 0x35, 0x6a, 0xd4, 0xb5, 0x77, 0xee, 0xc1, 0x9f, 0x23, 0x46,
+    0x8c, 0x05, 0x0a, 0x14, 0x28, 0x50, 0xa0, 0x5d, 0xba, 0x69, 0xd2, 0xb9, 0x6f, 0xde, 0xa1, 0x5f,
+    0xbe, 0x61, 0xc2, 0x99, 0x2f, 0x5e, 0xbc, 0x65, 0xca, 0x89, 0x0f, 0x1e, 0x3c, 0x78, 0xf0, 0xfd,
+    0xe7, 0xd3, 0xbb, 0x6b, 0xd6, 0xb1, 0x7f, 0xfe, 0xe1, 0xdf, 0xa3, 0x5b, 0xb6, 0x71, 0xe2, 0xd9,
+    0xaf, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0d, 0x1a, 0x34, 0x68, 0xd0, 0xbd, 0x67, 0xce, 0x81,
+    0x1f, 0x3e, 0x7c, 0xf8, 0xed, 0xc7, 0x93, 0x3b, 0x76, 0xec, 0xc5, 0x97, 0x33, 0x66, 0xcc, 0x85,
+    0x17, 0x2e, 0x5c, 0xb8, 0x6d, 0xda, 0xa9, 0x4f, 0x9e, 0x21, 0x42, 0x84, 0x15, 0x2a, 0x54, 0xa8,
+    0x4d, 0x9a, 0x29, 0x52, 0xa4, 0x55, 0xaa, 0x49, 0x92, 0x39, 0x72, 0xe4, 0xd5, 0xb7, 0x73, 0xe6,
+    0xd1, 0xbf, 0x63, 0xc6, 0x91, 0x3f, 0x7e, 0xfc, 0xe5, 0xd7, 0xb3, 0x7b, 0xf6, 0xf1, 0xff, 0xe3,
+    0xdb, 0xab, 0x4b, 0x96, 0x31, 0x62, 0xc4, 0x95, 0x37, 0x6e, 0xdc, 0xa5, 0x57, 0xae, 0x41, 0x82,
+    0x19, 0x32, 0x64, 0xc8, 0x8d, 0x07, 0x0e, 0x1c, 0x38, 0x70, 0xe0, 0xdd, 0xa7, 0x53, 0xa6, 0x51,
+    0xa2, 0x59, 0xb2, 0x79, 0xf2, 0xf9, 0xef, 0xc3, 0x9b, 0x2b, 0x56, 0xac, 0x45, 0x8a, 0x09, 0x12,
+    0x24, 0x48, 0x90, 0x3d, 0x7a, 0xf4, 0xf5, 0xf7, 0xf3, 0xfb, 0xeb, 0xcb, 0x8b, 0x0b, 0x16, 0x2c,
+    0x58, 0xb0, 0x7d, 0xfa, 0xe9, 0xcf, 0x83, 0x1b, 0x36, 0x6c, 0xd8, 0xad, 0x47, 0x8e, 0x01, 0x02,
+};
+
+// Log table, log(0) is undefined and never looked up
+static const uint8_t gf_log[256] = {
+    0x00, 0x00, 0x01, 0x19, 0x02, 0x32, 0x1a, 0xc6, 0x03, 0xdf, 0x33, 0xee, 0x1b, 0x68, 0xc7, 0x4b,
+    0x04, 0x64, 0xe0, 0x0e, 0x34, 0x8d, 0xef, 0x81, 0x1c, 0xc1, 0x69, 0xf8, 0xc8, 0x08, 0x4c, 0x71,
+    0x05, 0x8a, 0x65, 0x2f, 0xe1, 0x24, 0x0f, 0x21, 0x35, 0x93, 0x8e, 0xda, 0xf0, 0x12, 0x82, 0x45,
+    0x1d, 0xb5, 0xc2, 0x7d, 0x6a, 0x27, 0xf9, 0xb9, 0xc9, 0x9a, 0x09, 0x78, 0x4d, 0xe4, 0x72, 0xa6,
+    0x06, 0xbf, 0x8b, 0x62, 0x66, 0xdd, 0x30, 0xfd, 0xe2, 0x98, 0x25, 0xb3, 0x10, 0x91, 0x22, 0x88,
+    0x36, 0xd0, 0x94, 0xce, 0x8f, 0x96, 0xdb, 0xbd, 0xf1, 0xd2, 0x13, 0x5c, 0x83, 0x38, 0x46, 0x40,
+    0x1e, 0x42, 0xb6, 0xa3, 0xc3, 0x48, 0x7e, 0x6e, 0x6b, 0x3a, 0x28, 0x54, 0xfa, 0x85, 0xba, 0x3d,
+    0xca, 0x5e, 0x9b, 0x9f, 0x0a, 0x15, 0x79, 0x2b, 0x4e, 0xd4, 0xe5, 0xac, 0x73, 0xf3, 0xa7, 0x57,
+    0x07, 0x70, 0xc0, 0xf7, 0x8c, 0x80, 0x63, 0x0d, 0x67, 0x4a, 0xde, 0xed, 0x31, 0xc5, 0xfe, 0x18,
+    0xe3, 0xa5, 0x99, 0x77, 0x26, 0xb8, 0xb4, 0x7c, 0x11, 0x44, 0x92, 0xd9, 0x23, 0x20, 0x89, 0x2e,
+    0x37, 0x3f, 0xd1, 0x5b, 0x95, 0xbc, 0xcf, 0xcd, 0x90, 0x87, 0x97, 0xb2, 0xdc, 0xfc, 0xbe, 0x61,
+    0xf2, 0x56, 0xd3, 0xab, 0x14, 0x2a, 0x5d, 0x9e, 0x84, 0x3c, 0x39, 0x53, 0x47, 0x6d, 0x41, 0xa2,
+    0x1f, 0x2d, 0x43, 0xd8, 0xb7, 0x7b, 0xa4, 0x76, 0xc4, 0x17, 0x49, 0xec, 0x7f, 0x0c, 0x6f, 0xf6,
+    0x6c, 0xa1, 0x3b, 0x52, 0x29, 0x9d, 0x55, 0xaa, 0xfb, 0x60, 0x86, 0xb1, 0xbb, 0xcc, 0x3e, 0x5a,
+    0xcb, 0x59, 0x5f, 0xb0, 0x9c, 0xa9, 0xa0, 0x51, 0x0b, 0xf5, 0x16, 0xeb, 0x7a, 0x75, 0x2c, 0xd7,
+    0x4f, 0xae, 0xd5, 0xe9, 0xe6, 0xe7, 0xad, 0xe8, 0x74, 0xd6, 0xf4, 0xea, 0xa8, 0x50, 0x58, 0xaf,
+};
+
+
+// Logs of the generator polynomial coefficients g_0 .. g_31, where
+// g(x) = (x + a^1)(x + a^2)..(x + a^32) is monic
+static const uint8_t gen_log[RSCODE_NPAR] = {
+    0x12, 0xfb, 0xd7, 0x1c, 0x50, 0x6b, 0xf8, 0x35, 0x54, 0xc2, 0x5b, 0x3b, 0xb0, 0x63, 0xcb, 0x89,
+    0x2b, 0x68, 0x89, 0x00, 0x2c, 0x95, 0x94, 0xda, 0x4b, 0x0b, 0xad, 0xfe, 0xc2, 0x6d, 0x08, 0x0b,
+};
+compiler_assert(RSCODE_NPAR == 32, "Generator polynomial table is built for 32 parity bytes");
+
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b) {
+    return (a && b) ? gf_exp[gf_log[a] + gf_log[b]] : 0;
+}
+
+
+static inline uint8_t gf_div(uint8_t a, uint8_t b) {
+    return a ? gf_exp[gf_log[a] + 255 - gf_log[b]] : 0;
+}
+
+
+// Berlekamp-Massey, returns the number of errors L and the locator in lambda
+static int berlekamp_massey(const uint8_t syndromes[RSCODE_NPAR], uint8_t lambda[RSCODE_NPAR + 1]) {
+    uint8_t prev[RSCODE_NPAR + 1] = { 1 };
+    uint8_t temp[RSCODE_NPAR + 1];
+
+    memset(lambda, 0, RSCODE_NPAR + 1);
+    lambda[0] = 1;
+
+    int     L = 0;  /* Current number of errors             */
+    int     m = 1;  /* Steps since prev was last updated    */
+    uint8_t b = 1;  /* Discrepancy when prev was updated    */
+
+    for(int n = 0; n < RSCODE_NPAR; ++n) {
+        uint8_t d = syndromes[n];
+        for(int i = 1; i <= L; ++i) {
+            d ^= gf_mul(lambda[i], syndromes[n - i]);
+        }
+
+        if(d == 0) {
+            ++m;
+            continue;
+        }
+
+        uint8_t coef = gf_div(d, b);
+        if(2 * L <= n) {
+            memcpy(temp, lambda, sizeof(temp));
+            for(int i = 0; i + m <= RSCODE_NPAR; ++i) {
+                lambda[i + m] ^= gf_mul(coef, prev[i]);
+            }
+            L = n + 1 - L;
+            memcpy(prev, temp, sizeof(prev));
+            b = d;
+            m = 1;
+        }
+        else {
+            for(int i = 0; i + m <= RSCODE_NPAR; ++i) {
+                lambda[i + m] ^= gf_mul(coef, prev[i]);
+            }
+            ++m;
+        }
+    }
+    return L;
+}
+
+
+// Chien search, positions are powers of the codeword polynomial. Each term of 
+// lambda keeps its log at the start of the current block of positions, and a 
+// block of RS_CHIEN_LANES positions is evaluated per pass over the terms.
+static int chien_search(const uint8_t lambda[RSCODE_NPAR + 1], int L, size_t csize, uint8_t positions[RS_MAX_CORRECTABLE]) {
+    int     nterms = 0;
+    uint8_t term_log[RSCODE_NPAR];
+    uint8_t term_step[RSCODE_NPAR][RS_CHIEN_LANES + 1];
+
+    // lambda(a^-i) = sum lambda_k * a^(-ik)
+    for(int k = 1; k <= L; ++k) {
+        if(lambda[k]) {
+            term_log[nterms] = gf_log[lambda[k]];
+            for(int p = 0; p <= RS_CHIEN_LANES; ++p) {
+                term_step[nterms][p] = (255 - (k * p) % 255) % 255;
+            }
+            ++nterms;
+        }
+    }
+
+    int nroots = 0;
+    for(size_t base = 0; base < csize && nroots < L; base += RS_CHIEN_LANES) {
+        uint8_t sums[RS_CHIEN_LANES];
+        memset(sums, lambda[0], sizeof(sums));
+
+        for(int t = 0; t < nterms; ++t) {
+            const uint8_t* exp  = &gf_exp[term_log[t]];
+            const uint8_t* step = term_step[t];
+            for(int p = 0; p < RS_CHIEN_LANES; ++p) {
+                sums[p] ^= exp[step[p]];
+            }
+            term_log[t] = (term_log[t] + step[RS_CHIEN_LANES]) % 255;
+        }
+
+        for(int p = 0; p < RS_CHIEN_LANES && base + p < csize; ++p) {
+            if(sums[p] == 0) {
+                if(nroots == L) {
+                    return RS_UNCORRECTABLE;
+                }
+                positions[nroots++] = base + p;
+            }
+        }
+    }
+    return nroots;
+}
+
+
+// Every multiple of the generator, b * g_31 .. b * g_0 for each byte b, eight
+// coefficients per word with the highest degree one in the top byte
+static uint64_t gen_mul[256][RSCODE_NPAR / 8];
+static pthread_once_t gen_mul_once = PTHREAD_ONCE_INIT;
+
+static void init_gen_mul() {
+    for(int b = 1; b < 256; ++b) {
+        for(int k = 0; k < RSCODE_NPAR; ++k) {
+            uint64_t coef = gf_exp[gf_log[b] + gen_log[RSCODE_NPAR - 1 - k]];
+            gen_mul[b][k / 8] |= coef << (56 - 8 * (k % 8));
+        }
+    }
+}
+
+
+// Divide a codeword by the generator, rem holds coefficients x^31 .. x^0. A
+// codeword is a multiple of the generator so a clean one leaves no remainder,
+// returns non-zero if any coefficient is left. The remainder is kept in four
+// words so each byte costs a shift and an XOR with a multiple of the generator
+static int generator_remainder(const uint8_t* codeword, size_t csize, uint8_t rem[RSCODE_NPAR]) {
+    pthread_once(&gen_mul_once, init_gen_mul);
+
+    uint64_t r0 = 0, r1 = 0, r2 = 0, r3 = 0;
+
+    for(size_t i = 0; i < csize; ++i) {
+        const uint64_t* g = gen_mul[r0 >> 56];
+
+        r0 = ((r0 << 8) | (r1 >> 56)) ^ g[0];
+        r1 = ((r1 << 8) | (r2 >> 56)) ^ g[1];
+        r2 = ((r2 << 8) | (r3 >> 56)) ^ g[2];
+        r3 = ((r3 << 8) | codeword[i]) ^ g[3];
+    }
+
+    const uint64_t words[RSCODE_NPAR / 8] = { r0, r1, r2, r3 };
+    for(int k = 0; k < RSCODE_NPAR; ++k) {
+        rem[k] = words[k / 8] >> (56 - 8 * (k % 8));
+    }
+    return (r0 | r1 | r2 | r3) != 0;
+}
+
+
+//
+// See reed_solomon.h for non-static function descriptions
+//
+
+void rs_encode(const uint8_t* message, size_t msize, uint8_t* codeword) {
+    debug_assert(message && codeword && msize <= RSCODE_MAX_MSG_LEN);
+
+    // Parity is message * x^NPAR mod the generator, same division as below
+    uint8_t* parity = codeword + msize;
+    memset(parity, 0, RSCODE_NPAR);
+
+    for(size_t i = 0; i < msize; ++i) {
+        uint8_t fb = message[i] ^ parity[0];
+        memmove(parity, parity + 1, RSCODE_NPAR - 1);
+        parity[RSCODE_NPAR - 1] = 0;
+
+        if(fb) {
+            uint8_t fb_log = gf_log[fb];
+            for(int k = 0; k < RSCODE_NPAR; ++k) {
+                parity[k] ^= gf_exp[fb_log + gen_log[RSCODE_NPAR - 1 - k]];
+            }
+        }
+    }
+    memcpy(codeword, message, msize);
+}
+
+
+int rs_check(const uint8_t* codeword, size_t csize) {
+    uint8_t rem[RSCODE_NPAR];
+    return generator_remainder(codeword, csize, rem);
+}
+
+
+int rs_compute_syndromes(const uint8_t* codeword, size_t csize, uint8_t syndromes[RSCODE_NPAR]) {
+    uint8_t rem[RSCODE_NPAR];
+
+    if(!generator_remainder(codeword, csize, rem)) {
+        memset(syndromes, 0, RSCODE_NPAR);
+        return 0;
+    }
+
+    // The generator vanishes at its roots so S_j = c(a^j) = rem(a^j)
+    for(int j = 0; j < RSCODE_NPAR; ++j) {
+        uint8_t s = 0;
+        for(int k = 0; k < RSCODE_NPAR; ++k) {
+            if(rem[k]) {
+                s ^= gf_exp[gf_log[rem[k]] + ((j + 1) * (RSCODE_NPAR - 1 - k)) % 255];
+            }
+        }
+        syndromes[j] = s;
+    }
+    return 1;
+}
+
+
+int rs_correct_errors(uint8_t* codeword, size_t csize) {
+    uint8_t syndromes[RSCODE_NPAR];
+    uint8_t lambda[RSCODE_NPAR + 1];
+    uint8_t positions[RS_MAX_CORRECTABLE];
+    uint8_t errors[RS_MAX_CORRECTABLE];
+
+    if(!rs_compute_syndromes(codeword, csize, syndromes)) {
+        return 0;
+    }
+
+    int L = berlekamp_massey(syndromes, lambda);
+    if(L > RS_MAX_CORRECTABLE) {
+        return RS_UNCORRECTABLE;
+    }
+
+    // The locator must split into L distinct roots inside the codeword
+    if(chien_search(lambda, L, csize, positions) != L) {
+        return RS_UNCORRECTABLE;
+    }
+
+    // Error evaluator omega = S * lambda mod x^NPAR, only L terms are non-zero
+    uint8_t omega[RS_MAX_CORRECTABLE];
+    for(int j = 0; j < L; ++j) {
+        omega[j] = 0;
+        for(int i = 0; i <= j; ++i) {
+            omega[j] ^= gf_mul(lambda[i], syndromes[j - i]);
+        }
+    }
+
+    // Forney, e = omega(X^-1) / lambda'(X^-1) for the error locator X = a^i
+    for(int r = 0; r < L; ++r) {
+        int xinv = (255 - positions[r]) % 255;
+
+        uint8_t num = 0;
+        for(int j = 0; j < L; ++j) {
+            if(omega[j]) {
+                num ^= gf_exp[gf_log[omega[j]] + (xinv * j) % 255];
+            }
+        }
+
+        uint8_t den = 0;
+        for(int k = 1; k <= L; k += 2) {
+            if(lambda[k]) {
+                den ^= gf_exp[gf_log[lambda[k]] + (xinv * (k - 1)) % 255];
+            }
+        }
+        if(den == 0) {
+            return RS_UNCORRECTABLE;
+        }
+        errors[r] = gf_div(num, den);
+    }
+
+    for(int r = 0; r < L; ++r) {
+        codeword[csize - 1 - positions[r]] ^= errors[r];
+    }
+    return L;
+}
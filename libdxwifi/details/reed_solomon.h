@@ -0,0 +1,124 @@
+/**
+ *  reed_solomon.h
+ *
+ *  DESCRIPTION: Table driven Reed-Solomon error correction over GF(2^8). The
+ *  code is the same one rscode encodes: field polynomial x^8+x^4+x^3+x^2+1,
+ *  RSCODE_NPAR parity bytes and generator roots a^1 .. a^RSCODE_NPAR. The
+ *  first byte of a codeword is its highest degree coefficient.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ */
+
+
+#ifndef LIBDXWIFI_DETAILS_REED_SOLOMON_H
+#define LIBDXWIFI_DETAILS_REED_SOLOMON_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <rscode/ecc.h>
+
+
+/************************
+ *  Constants
+ ***********************/
+
+// Max number of symbol errors that can be corrected in a codeword
+#define RS_MAX_CORRECTABLE (RSCODE_NPAR / 2)
+
+// Number of roots evaluated together on each pass of the Chien search
+#define RS_CHIEN_LANES 16
+
+// Returned when a codeword has more errors than can be corrected
+#define RS_UNCORRECTABLE (-1)
+
+
+/************************
+ *  Functions
+ ***********************/
+
+/**
+ *  DESCRIPTION:    Encode a message into a codeword
+ *
+ *  ARGUMENTS:
+ *
+ *      message:    Message to encode
+ *
+ *      msize:      Size of the message, at most RSCODE_MAX_MSG_LEN
+ *
+ *      codeword:   Filled with the message followed by RSCODE_NPAR parity
+ *                  bytes, may not overlap the message
+ *
+ *  NOTES: Produces the same codeword as rscode's encode_data but keeps no
+ *  state, so frames can be encoded from several threads at once.
+ *
+ */
+void rs_encode(const uint8_t* message, size_t msize, uint8_t* codeword);
+
+
+/**
+ *  DESCRIPTION:    Check a codeword for errors without locating them
+ *
+ *  ARGUMENTS:
+ *
+ *      codeword:   Codeword, data followed by RSCODE_NPAR parity bytes
+ *
+ *      csize:      Size of the codeword, at most RSCODE_MAX_LEN
+ *
+ *  RETURNS:
+ *
+ *      int:        Non-zero if the codeword has errors
+ *
+ *  NOTES: Only divides the codeword by the generator, the syndromes aren't 
+ *  evaluated. That's all a clean codeword would cost rs_correct_errors anyway,
+ *  but an errored one can be set aside and corrected later if it's needed.
+ *
+ */
+int rs_check(const uint8_t* codeword, size_t csize);
+
+
+/**
+ *  DESCRIPTION:    Compute the RSCODE_NPAR syndromes of a codeword
+ *
+ *  ARGUMENTS:
+ *
+ *      codeword:   Codeword, data followed by RSCODE_NPAR parity bytes
+ *
+ *      csize:      Size of the codeword, at most RSCODE_MAX_LEN
+ *
+ *      syndromes:  Filled with S_1 .. S_NPAR on return
+ *
+ *  RETURNS:
+ *
+ *      int:        Non-zero if any syndrome is non-zero, i.e the codeword has
+ *                  errors
+ *
+ */
+int rs_compute_syndromes(const uint8_t* codeword, size_t csize, uint8_t syndromes[RSCODE_NPAR]);
+
+
+/**
+ *  DESCRIPTION:    Find and correct errors in a codeword in place
+ *
+ *  ARGUMENTS:
+ *
+ *      codeword:   Codeword, data followed by RSCODE_NPAR parity bytes
+ *
+ *      csize:      Size of the codeword, at most RSCODE_MAX_LEN
+ *
+ *  RETURNS:
+ *
+ *      int:        Number of symbols corrected, zero for a clean codeword or
+ *                  RS_UNCORRECTABLE
+ *
+ *  NOTES: The error locator is found with Berlekamp-Massey, its roots with a
+ *  Chien search and the error values with Forney's algorithm. The codeword is
+ *  only modified when every error could be located, an uncorrectable codeword
+ *  is left as it was received.
+ *
+ */
+int rs_correct_errors(uint8_t* codeword, size_t csize);
+
+
+#endif // LIBDXWIFI_DETAILS_REED_SOLOMON_H
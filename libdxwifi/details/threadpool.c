@@ -0,0 +1,362 @@
+/**
+ *  threadpool.c
+ *
+ *  DESCRIPTION: See threadpool.h for description
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdbool.h>
+
+#include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/threadpool.h>
+
+
+typedef struct {
+    dxwifi_task_fn      fn;
+    void*               arg;
+    size_t              begin;
+    size_t              end;
+    dxwifi_task_group*  group;
+} pool_task;
+
+
+// Owner pushes and pops at the bottom, thieves take from the top. Indices only
+// grow, a slot is the index modulo the capacity
+typedef struct {
+    pthread_mutex_t lock;
+    size_t          top;
+    size_t          bottom;
+    pool_task       tasks[DXWIFI_POOL_DEQUE_CAPACITY];
+} task_deque;
+
+
+static struct {
+    pthread_mutex_t config_lock;    /* Serializes starting and stopping         */
+    pthread_mutex_t lock;           /* Guards sleeping on work and done         */
+    pthread_cond_t  work;           /* Signalled when a task is queued          */
+    pthread_cond_t  done;           /* Signalled when a task group finishes     */
+    pthread_t       threads[DXWIFI_POOL_MAX_WORKERS];
+    task_deque*     deques;         /* One per worker then one for other threads*/
+    size_t          nworkers;
+    size_t          queued;         /* Tasks sitting in any deque               */
+    bool            stopping;
+    bool            started;
+} pool = {
+    .config_lock    = PTHREAD_MUTEX_INITIALIZER,
+    .lock           = PTHREAD_MUTEX_INITIALIZER,
+    .work           = PTHREAD_COND_INITIALIZER,
+    .done           = PTHREAD_COND_INITIALIZER
+};
+
+// Deque of the running thread, the shared one for threads outside the pool
+static __thread int worker_id = -1;
+
+#if defined(DXWIFI_TESTS)
+static int failing_worker = -1;
+#endif
+
+
+static bool push_task(const pool_task* task) {
+    task_deque* deque = &pool.deques[worker_id >= 0 ? (size_t) worker_id : pool.nworkers];
+
+    pthread_mutex_lock(&deque->lock);
+    if(deque->bottom - deque->top == DXWIFI_POOL_DEQUE_CAPACITY) {
+        pthread_mutex_unlock(&deque->lock);
+        return false;
+    }
+    deque->tasks[deque->bottom % DXWIFI_POOL_DEQUE_CAPACITY] = *task;
+    ++deque->bottom;
+    pthread_mutex_unlock(&deque->lock);
+
+    __atomic_add_fetch(&pool.queued, 1, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&pool.lock);
+    pthread_cond_signal(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+    return true;
+}
+
+
+// Takes the newest task of a deque when own is set, the oldest otherwise
+static bool take_task(task_deque* deque, bool own, pool_task* out) {
+    bool found = false;
+
+    pthread_mutex_lock(&deque->lock);
+    if(deque->bottom > deque->top) {
+        if(own) {
+            --deque->bottom;
+            *out = deque->tasks[deque->bottom % DXWIFI_POOL_DEQUE_CAPACITY];
+        }
+        else {
+            *out = deque->tasks[deque->top % DXWIFI_POOL_DEQUE_CAPACITY];
+            ++deque->top;
+        }
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    if(found) {
+        __atomic_sub_fetch(&pool.queued, 1, __ATOMIC_RELAXED);
+    }
+    return found;
+}
+
+
+// Own deque first, then steal going round from the next deque over
+static bool find_task(pool_task* out) {
+    if(__atomic_load_n(&pool.queued, __ATOMIC_ACQUIRE) == 0) {
+        return false;
+    }
+    size_t ndeques = pool.nworkers + 1;
+    size_t self    = worker_id >= 0 ? (size_t) worker_id : pool.nworkers;
+
+    if(take_task(&pool.deques[self], true, out)) {
+        return true;
+    }
+    for(size_t i = 1; i < ndeques; ++i) {
+        if(take_task(&pool.deques[(self + i) % ndeques], false, out)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static void run_task(const pool_task* task) {
+    task->fn(task->arg, task->begin, task->end);
+
+    // The group may be gone once pending reaches zero, it's not touched after
+    if(__atomic_sub_fetch(&task->group->__pending, 1, __ATOMIC_ACQ_REL) == 0) {
+        pthread_mutex_lock(&pool.lock);
+        pthread_cond_broadcast(&pool.done);
+        pthread_mutex_unlock(&pool.lock);
+    }
+}
+
+
+static void* worker_main(void* arg) {
+    worker_id = (int) (intptr_t) arg;
+
+    pool_task task;
+    while(true) {
+        if(find_task(&task)) {
+            run_task(&task);
+            continue;
+        }
+        pthread_mutex_lock(&pool.lock);
+        while(__atomic_load_n(&pool.queued, __ATOMIC_ACQUIRE) == 0 && !pool.stopping) {
+            pthread_cond_wait(&pool.work, &pool.lock);
+        }
+        bool stop = pool.stopping && __atomic_load_n(&pool.queued, __ATOMIC_ACQUIRE) == 0;
+        pthread_mutex_unlock(&pool.lock);
+
+        if(stop) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+
+static size_t default_workers() {
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return ncpus > 1 ? ncpus - 1 : 0;
+}
+
+
+static int start_worker(size_t index) {
+#if defined(DXWIFI_TESTS)
+    if(failing_worker >= 0 && index == (size_t) failing_worker) {
+        return EAGAIN;
+    }
+#endif
+    return pthread_create(&pool.threads[index], NULL, worker_main, (void*) (intptr_t) index);
+}
+
+
+// Called with the config lock held
+static void start_workers(size_t nworkers) {
+    nworkers = nworkers > DXWIFI_POOL_MAX_WORKERS ? DXWIFI_POOL_MAX_WORKERS : nworkers;
+
+    pool.deques = calloc(nworkers + 1, sizeof(task_deque));
+    assert_M(pool.deques, "Failed to allocate thread pool");
+
+    for(size_t i = 0; i <= nworkers; ++i) {
+        pthread_mutex_init(&pool.deques[i].lock, NULL);
+    }
+    pool.stopping = false;
+    pool.nworkers = nworkers;
+
+    for(size_t i = 0; i < nworkers; ++i) {
+        if(start_worker(i) != 0) {
+            // Nothing is queued yet, the empty deque of the worker that didn't
+            // start becomes the shared one
+            log_warning("Failed to start thread pool worker %zu, running with %zu", i, i);
+            for(size_t j = i + 1; j <= nworkers; ++j) {
+                pthread_mutex_destroy(&pool.deques[j].lock);
+            }
+            pool.nworkers = i;
+            break;
+        }
+    }
+    __atomic_store_n(&pool.started, true, __ATOMIC_RELEASE);
+    log_debug("Thread pool started with %zu workers", pool.nworkers);
+}
+
+
+// Called with the config lock held
+static void stop_workers() {
+    if(!pool.started) {
+        return;
+    }
+    pthread_mutex_lock(&pool.lock);
+    pool.stopping = true;
+    pthread_cond_broadcast(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+
+    for(size_t i = 0; i < pool.nworkers; ++i) {
+        pthread_join(pool.threads[i], NULL);
+    }
+    for(size_t i = 0; i <= pool.nworkers; ++i) {
+        pthread_mutex_destroy(&pool.deques[i].lock);
+    }
+    free(pool.deques);
+    pool.deques   = NULL;
+    pool.nworkers = 0;
+    __atomic_store_n(&pool.started, false, __ATOMIC_RELEASE);
+}
+
+
+static void ensure_started() {
+    if(!__atomic_load_n(&pool.started, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&pool.config_lock);
+        if(!pool.started) {
+            start_workers(default_workers());
+        }
+        pthread_mutex_unlock(&pool.config_lock);
+    }
+}
+
+
+//
+// See threadpool.h for non-static function descriptions
+//
+
+void dxwifi_pool_set_workers(int nworkers) {
+    pthread_mutex_lock(&pool.config_lock);
+    stop_workers();
+    start_workers(nworkers < 0 ? default_workers() : (size_t) nworkers);
+    pthread_mutex_unlock(&pool.config_lock);
+}
+
+
+#if defined(DXWIFI_TESTS)
+void dxwifi_pool_fail_worker_start(int index) {
+    pthread_mutex_lock(&pool.config_lock);
+    failing_worker = index;
+    pthread_mutex_unlock(&pool.config_lock);
+}
+#endif // DXWIFI_TESTS
+
+
+size_t dxwifi_pool_workers() {
+    ensure_started();
+    return pool.nworkers;
+}
+
+
+void dxwifi_task_group_init(dxwifi_task_group* group) {
+    debug_assert(group);
+
+    group->__pending = 0;
+}
+
+
+void dxwifi_task_group_spawn(dxwifi_task_group* group, dxwifi_task_fn fn, void* arg, size_t begin, size_t end) {
+    debug_assert(group && fn);
+
+    ensure_started();
+
+    pool_task task = {
+        .fn     = fn,
+        .arg    = arg,
+        .begin  = begin,
+        .end    = end,
+        .group  = group
+    };
+
+    if(pool.nworkers > 0) {
+        __atomic_add_fetch(&group->__pending, 1, __ATOMIC_RELAXED);
+        if(push_task(&task)) {
+            return;
+        }
+        __atomic_sub_fetch(&group->__pending, 1, __ATOMIC_RELAXED);
+    }
+    fn(arg, begin, end);
+}
+
+
+void dxwifi_task_group_wait(dxwifi_task_group* group) {
+    debug_assert(group);
+
+    pool_task task;
+    while(__atomic_load_n(&group->__pending, __ATOMIC_ACQUIRE) > 0) {
+        if(find_task(&task)) {
+            run_task(&task);
+            continue;
+        }
+        pthread_mutex_lock(&pool.lock);
+        while(__atomic_load_n(&group->__pending, __ATOMIC_ACQUIRE) > 0 && __atomic_load_n(&pool.queued, __ATOMIC_ACQUIRE) == 0) {
+            pthread_cond_wait(&pool.done, &pool.lock);
+        }
+        pthread_mutex_unlock(&pool.lock);
+    }
+}
+
+
+void dxwifi_parallel_for(size_t count, size_t grain, dxwifi_task_fn fn, void* arg) {
+    debug_assert(fn);
+
+    if(count == 0) {
+        return;
+    }
+    grain = grain ? grain : 1;
+
+    size_t nthreads = dxwifi_pool_workers() + 1;
+    size_t nchunks  = (count + grain - 1) / grain;
+
+    if(nthreads == 1 || nchunks == 1) {
+        fn(arg, 0, count);
+        return;
+    }
+    if(nchunks > nthreads * DXWIFI_POOL_CHUNKS_PER_THREAD) {
+        nchunks = nthreads * DXWIFI_POOL_CHUNKS_PER_THREAD;
+    }
+
+    dxwifi_task_group group;
+    dxwifi_task_group_init(&group);
+
+    // Chunks differ by at most one item, the first is kept for this thread
+    size_t step  = count / nchunks;
+    size_t extra = count % nchunks;
+    size_t first = step + (extra > 0);
+
+    size_t begin = first;
+    for(size_t i = 1; i < nchunks; ++i) {
+        size_t end = begin + step + (i < extra);
+        dxwifi_task_group_spawn(&group, fn, arg, begin, end);
+        begin = end;
+    }
+    fn(arg, 0, first);
+
+    dxwifi_task_group_wait(&group);
+}
@@ -0,0 +1,144 @@
+/**
+ *  threadpool.h
+ *
+ *  DESCRIPTION: Shared work-stealing thread pool for the compute stages of
+ *  libdxwifi, e.g. RS coding every frame of an object. Each worker keeps a
+ *  deque of tasks, it runs its newest task first and steals the oldest task of
+ *  another worker once it runs out. A thread waiting on a task group runs
+ *  queued tasks while it waits, so tasks may spawn and wait on tasks of their
+ *  own.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: The pool starts on first use with one worker less than the number of
+ *  online CPUs, the spawning thread being the last one. With no workers, e.g.
+ *  on a single core board, every task runs inline in the thread that spawned
+ *  it and the results are the same.
+ *
+ */
+
+#ifndef LIBDXWIFI_DETAILS_THREADPOOL_H
+#define LIBDXWIFI_DETAILS_THREADPOOL_H
+
+#include <stdlib.h>
+
+
+/************************
+ *  Constants
+ ***********************/
+
+// Most workers the pool will start
+#define DXWIFI_POOL_MAX_WORKERS 32
+
+// Tasks each worker can have queued, a task spawned on a full deque runs inline
+#define DXWIFI_POOL_DEQUE_CAPACITY 256
+
+// A parallel for is split in this many chunks per thread so that stealing can
+// even out chunks that take longer than others
+#define DXWIFI_POOL_CHUNKS_PER_THREAD 4
+
+// Use the pool's default worker count
+#define DXWIFI_POOL_DFLT_WORKERS (-1)
+
+
+/************************
+ *  Data structures
+ ***********************/
+
+// Runs items [begin, end) of a task
+typedef void (*dxwifi_task_fn)(void* arg, size_t begin, size_t end);
+
+typedef struct {
+    size_t __pending;   /* Tasks spawned that haven't finished */
+} dxwifi_task_group;
+
+
+/************************
+ *  Functions
+ ***********************/
+
+/**
+ *  DESCRIPTION:    Stops the current workers and starts new ones
+ *
+ *  ARGUMENTS:
+ *
+ *      nworkers:   Number of workers, 0 runs every task inline or
+ *                  DXWIFI_POOL_DFLT_WORKERS
+ *
+ *  NOTES: Must not be called while tasks are running
+ *
+ */
+void dxwifi_pool_set_workers(int nworkers);
+
+
+/**
+ *  DESCRIPTION:    Number of workers running, starts the pool if needed
+ */
+size_t dxwifi_pool_workers();
+
+
+/**
+ *  DESCRIPTION:    Initializes an empty task group
+ */
+void dxwifi_task_group_init(dxwifi_task_group* group);
+
+
+/**
+ *  DESCRIPTION:    Queues a task for the pool
+ *
+ *  ARGUMENTS:
+ *
+ *      group:      Task group the task is counted in
+ *
+ *      fn:         Task to run
+ *
+ *      arg:        Passed along to fn, must outlive the task
+ *
+ *      begin:      First item of the task
+ *
+ *      end:        One past the last item of the task
+ *
+ */
+void dxwifi_task_group_spawn(dxwifi_task_group* group, dxwifi_task_fn fn, void* arg, size_t begin, size_t end);
+
+
+/**
+ *  DESCRIPTION:    Waits for every task of a group to finish, running queued
+ *                  tasks in the meantime
+ */
+void dxwifi_task_group_wait(dxwifi_task_group* group);
+
+
+/**
+ *  DESCRIPTION:    Runs fn over items [0, count) split in chunks across the
+ *                  pool and waits for them
+ *
+ *  ARGUMENTS:
+ *
+ *      count:      Number of items
+ *
+ *      grain:      Smallest chunk worth handing to another thread
+ *
+ *      fn:         Run on each chunk, chunks never overlap
+ *
+ *      arg:        Passed along to fn
+ *
+ */
+void dxwifi_parallel_for(size_t count, size_t grain, dxwifi_task_fn fn, void* arg);
+
+
+#if defined(DXWIFI_TESTS)
+/**
+ *  DESCRIPTION:    Fails the start of a worker as if its thread couldn't be
+ *                  created, for every start of the pool from now on
+ *
+ *  ARGUMENTS:
+ *
+ *      index:      Worker that fails to start, -1 for none
+ *
+ */
+void dxwifi_pool_fail_worker_start(int index);
+#endif // DXWIFI_TESTS
+
+
+#endif // LIBDXWIFI_DETAILS_THREADPOOL_H
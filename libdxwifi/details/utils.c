@@ -17,8 +17,16 @@
 #include <string.h>
 #include <sys/stat.h>
 
+#include <arpa/inet.h>
+
 #include <libdxwifi/dxwifi.h>
 #include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/crc32.h>
+#include <libdxwifi/details/assert.h>
+
+
+compiler_assert(sizeof(dxwifi_control_frame) == DXWIFI_FRAME_CONTROL_SIZE, "Mismatch in actual control frame size and calculated size");
+compiler_assert(sizeof(dxwifi_frame_hdr) == DXWIFI_FRAME_HEADER_SIZE, "Mismatch in actual frame header size and calculated size");
 
 
 inline void set_bits32(uint32_t* word, uint32_t mask, uint32_t value) {
@@ -80,6 +88,93 @@ const char* control_frame_type_to_str(dxwifi_control_frame_t type) {
 }
 
 
+void pack_control_frame(dxwifi_control_frame* frame, dxwifi_control_frame_t type, const dxwifi_object_manifest* manifest) {
+    frame->magic        = htonl(DXWIFI_CONTROL_MAGIC);
+    frame->version      = DXWIFI_CONTROL_VERSION;
+    frame->type         = type;
+    frame->codec        = manifest->codec;
+    frame->compression  = manifest->compression;
+    frame->object_id    = htonl(manifest->object_id);
+    frame->size         = htonl(manifest->size);
+    frame->hash         = htonl(manifest->hash);
+    frame->k            = htons(manifest->k);
+    frame->n            = htons(manifest->n);
+    frame->crc          = htonl(crc32((uint8_t*) frame, offsetof(dxwifi_control_frame, crc)));
+    memset(frame->fill, type, sizeof(frame->fill));
+}
+
+
+// Type held by most of a control frame's fill, for frames that fail the CRC
+static dxwifi_control_frame_t control_fill_type(const dxwifi_control_frame* frame) {
+    unsigned eot        = 0;
+    unsigned preamble   = 0;
+
+    for(size_t i = 0; i < sizeof(frame->fill); ++i) {
+        eot         += frame->fill[i] == DXWIFI_CONTROL_FRAME_EOT;
+        preamble    += frame->fill[i] == DXWIFI_CONTROL_FRAME_PREAMBLE;
+    }
+    if(eot > DXWIFI_CONTROL_FILL_THRESHOLD * sizeof(frame->fill)) {
+        return DXWIFI_CONTROL_FRAME_EOT;
+    }
+    if(preamble > DXWIFI_CONTROL_FILL_THRESHOLD * sizeof(frame->fill)) {
+        return DXWIFI_CONTROL_FRAME_PREAMBLE;
+    }
+    return DXWIFI_CONTROL_FRAME_UNKNOWN;
+}
+
+
+dxwifi_control_frame_t unpack_control_frame(const uint8_t* payload, dxwifi_object_manifest* manifest, bool* has_manifest) {
+    dxwifi_control_frame frame;
+    memcpy(&frame, payload, sizeof(frame));
+
+    *has_manifest = false;
+
+    if(ntohl(frame.magic) != DXWIFI_CONTROL_MAGIC 
+        || frame.version != DXWIFI_CONTROL_VERSION 
+        || ntohl(frame.crc) != crc32(payload, offsetof(dxwifi_control_frame, crc))) {
+        return control_fill_type(&frame);
+    }
+    if(frame.type != DXWIFI_CONTROL_FRAME_PREAMBLE && frame.type != DXWIFI_CONTROL_FRAME_EOT) {
+        return DXWIFI_CONTROL_FRAME_UNKNOWN;
+    }
+
+    manifest->object_id = ntohl(frame.object_id);
+    manifest->size      = ntohl(frame.size);
+    manifest->hash      = ntohl(frame.hash);
+    manifest->k         = ntohs(frame.k);
+    manifest->n         = ntohs(frame.n);
+    manifest->codec     = frame.codec;
+    manifest->compression = frame.compression;
+
+    *has_manifest = true;
+
+    return frame.type;
+}
+
+
+void pack_frame_header(dxwifi_frame_hdr* hdr, uint8_t flags, uint32_t object_id, uint32_t seq) {
+    hdr->version    = DXWIFI_FRAME_VERSION;
+    hdr->flags      = flags;
+    hdr->reserved   = 0;
+    hdr->object_id  = htonl(object_id);
+    hdr->seq        = htonl(seq);
+    hdr->crc        = htonl(crc32((uint8_t*) hdr, offsetof(dxwifi_frame_hdr, crc)));
+}
+
+
+bool unpack_frame_header(const uint8_t* payload, dxwifi_frame_hdr* hdr) {
+    memcpy(hdr, payload, sizeof(dxwifi_frame_hdr));
+
+    if(hdr->version != DXWIFI_FRAME_VERSION || ntohl(hdr->crc) != crc32(payload, offsetof(dxwifi_frame_hdr, crc))) {
+        return false;
+    }
+    hdr->object_id  = ntohl(hdr->object_id);
+    hdr->seq        = ntohl(hdr->seq);
+    hdr->crc        = ntohl(hdr->crc);
+    return true;
+}
+
+
 int msleep(unsigned msec, bool require_elapsed) {
     int status;
     struct timespec ts = {
@@ -126,6 +126,76 @@ off_t get_file_size(const char* path);
 const char* control_frame_type_to_str(dxwifi_control_frame_t type);
 
 
+/**
+ *  DESCRIPTION:    Packs a control frame announcing an object
+ * 
+ *  ARGUMENTS: 
+ *      
+ *      frame:      Control frame to fill
+ * 
+ *      type:       Control frame type
+ * 
+ *      manifest:   Object the control frame announces
+ * 
+ */
+void pack_control_frame(dxwifi_control_frame* frame, dxwifi_control_frame_t type, const dxwifi_object_manifest* manifest);
+
+
+/**
+ *  DESCRIPTION:    Validates a control frame payload and unpacks its manifest
+ * 
+ *  ARGUMENTS: 
+ *      
+ *      payload:    Captured payload of exactly DXWIFI_FRAME_CONTROL_SIZE bytes
+ * 
+ *      manifest:   Filled with the announced object if the frame is valid
+ * 
+ *      has_manifest: Set if the manifest was filled
+ * 
+ *  RETURNS:    
+ *      
+ *      dxwifi_control_frame_t: The type of the control frame or 
+ *      DXWIFI_CONTROL_FRAME_UNKNOWN if the magic, version or CRC do not check 
+ *      out and the fill doesn't hold a clear majority of one type
+ * 
+ */
+dxwifi_control_frame_t unpack_control_frame(const uint8_t* payload, dxwifi_object_manifest* manifest, bool* has_manifest);
+
+
+/**
+ *  DESCRIPTION:    Packs the DxWiFi header of a frame
+ * 
+ *  ARGUMENTS: 
+ *      
+ *      hdr:        Header to fill
+ * 
+ *      flags:      DXWIFI_FRAME_FLAG_* bits
+ * 
+ *      object_id:  Object the frame belongs to
+ * 
+ *      seq:        Index of the frame within the object
+ * 
+ */
+void pack_frame_header(dxwifi_frame_hdr* hdr, uint8_t flags, uint32_t object_id, uint32_t seq);
+
+
+/**
+ *  DESCRIPTION:    Validates the DxWiFi header at the start of a payload
+ * 
+ *  ARGUMENTS: 
+ *      
+ *      payload:    Captured payload, at least DXWIFI_FRAME_HEADER_SIZE bytes
+ * 
+ *      hdr:        Filled with the header fields in host byte order
+ * 
+ *  RETURNS:    
+ *      
+ *      bool:       True if the version and CRC check out
+ * 
+ */
+bool unpack_frame_header(const uint8_t* payload, dxwifi_frame_hdr* hdr);
+
+
 /**
  *  DESCRIPTION:    Millisecond sleep
  * 
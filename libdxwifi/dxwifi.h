@@ -20,6 +20,13 @@
 #endif // LIBDXWIFI_VERSION
 
 
+/************************
+ *  Includes
+ ***********************/
+
+#include <stdint.h>
+
+
 /************************
  *  Constants
  ***********************/
@@ -31,6 +38,21 @@
 
 #define DXWIFI_FRAME_CONTROL_SIZE 256
 
+// Bytes of a control frame's fill that must hold its type when the CRC fails
+#define DXWIFI_CONTROL_FILL_THRESHOLD 0.66
+
+// "DXCF", leads every control frame payload
+#define DXWIFI_CONTROL_MAGIC 0x44584346
+
+#define DXWIFI_CONTROL_VERSION 1
+
+#define DXWIFI_FRAME_HEADER_SIZE 16
+
+#define DXWIFI_FRAME_VERSION 1
+
+// Frame header flags
+#define DXWIFI_FRAME_FLAG_CONTROL 0x01  /* Payload is a dxwifi_control_frame */
+
 #define DXWIFI_DFLT_SENDER_ADDR { 0xF1, 0xF1, 0xF1, 0xF1, 0xF1, 0xF1 }
 
 /************************
@@ -49,4 +71,86 @@ typedef enum {
 } dxwifi_control_frame_t;
 
 
+/**
+ *  How the object announced by a control frame was encoded
+ */
+typedef enum {
+    DXWIFI_CODEC_NONE         = 0x00, /* Raw bytes                            */
+    DXWIFI_CODEC_LDPC_RS      = 0x01, /* LDPC with the RS inner code          */
+    DXWIFI_CODEC_LDPC_CRC     = 0x02, /* LDPC with CRC checked frames         */
+    DXWIFI_CODEC_LDPC         = 0x03, /* LDPC without an inner code           */
+    DXWIFI_CODEC_FOUNTAIN_RS  = 0x04, /* Raptor with the RS inner code        */
+    DXWIFI_CODEC_FOUNTAIN_CRC = 0x05, /* Raptor with CRC checked frames       */
+    DXWIFI_CODEC_FOUNTAIN     = 0x06  /* Raptor without an inner code         */
+} dxwifi_codec_t;
+
+
+/**
+ *  Compression applied to an object before it was encoded, see compress.h
+ */
+typedef enum {
+    DXWIFI_COMPRESSION_NONE = 0x00,
+    DXWIFI_COMPRESSION_LZ4  = 0x01, /* Fast, light on CPU                   */
+    DXWIFI_COMPRESSION_ZSTD = 0x02, /* Slower, better ratio                 */
+    DXWIFI_COMPRESSION_COUNT
+} dxwifi_compression_t;
+
+
+/**
+ *  The object manifest describes the object a transmission carries so that the
+ *  receiver can size its buffers before the first data frame arrives. Unknown 
+ *  fields are left zero, e.g. a stream has no size or hash up front.
+ */
+typedef struct {
+    uint32_t        object_id;  /* Same for every retransmission of an object */
+    uint32_t        size;       /* Size of the object before encoding       */
+    uint32_t        hash;       /* CRC32 of the object before encoding      */
+    uint16_t        k;          /* Number of source symbols                 */
+    uint16_t        n;          /* Total number of symbols, frames on air   */
+    dxwifi_codec_t  codec;      /* Encoding of the data frames              */
+    dxwifi_compression_t compression;
+                                /* Compression applied before encoding      */
+} dxwifi_object_manifest;
+
+
+/**
+ *  Control frames carry the manifest in network byte order. The CRC covers 
+ *  every preceding field. The rest of the frame is filled with the type, so a
+ *  frame that fails the CRC is still known by the majority of its fill bytes,
+ *  only without a manifest.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;         /* DXWIFI_CONTROL_MAGIC                     */
+    uint8_t  version;       /* DXWIFI_CONTROL_VERSION                   */
+    uint8_t  type;          /* dxwifi_control_frame_t                   */
+    uint8_t  codec;         /* dxwifi_codec_t                           */
+    uint8_t  compression;   /* dxwifi_compression_t                     */
+    uint32_t object_id;
+    uint32_t size;
+    uint32_t hash;
+    uint16_t k;
+    uint16_t n;
+    uint32_t crc;           /* CRC32 of all the fields above            */
+    uint8_t  fill[228];     /* Type repeated up to the frame size       */
+} dxwifi_control_frame;
+
+
+
+/**
+ *  Every frame's payload starts with the DxWiFi header. It ties the frame to 
+ *  an object and its position within it so the receiver can demultiplex and 
+ *  order frames without looking at the MAC header. Fields are in network byte
+ *  order and the CRC covers the preceding fields only, a frame with a damaged
+ *  payload still has a usable header.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t  version;       /* DXWIFI_FRAME_VERSION                     */
+    uint8_t  flags;         /* DXWIFI_FRAME_FLAG_*                      */
+    uint16_t reserved;      /* Always zero                              */
+    uint32_t object_id;     /* Object the frame belongs to              */
+    uint32_t seq;           /* Index of the data frame within the object */
+    uint32_t crc;           /* CRC32 of all the fields above            */
+} dxwifi_frame_hdr;
+
+
 #endif // LIBDXWIFI_H
\ No newline at end of file
@@ -5,7 +5,11 @@
  */
 
 #include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <string.h>
 
+#include <pthread.h>
 #include <arpa/inet.h>
 
 #include <rscode/ecc.h>
@@ -15,14 +19,47 @@
 #include <libdxwifi/details/utils.h>
 #include <libdxwifi/details/crc32.h>
 #include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/memory.h>
 #include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/probes.h>
+#include <libdxwifi/details/threadpool.h>
+#include <libdxwifi/details/reed_solomon.h>
 
 #define FEC_PRNG 1804289383
 
+// Throughput of ML decoding on one core, for the predicted cost of a block.
+// Measured on an x86-64 ground station, where OpenFEC adds several symbols in
+// one pass over the destination. Slower machines only defer blocks sooner
+#define ML_XOR_BYTES_PER_SEC    12e9
+#define ML_WORD_OPS_PER_SEC     1e9
+
+// Under a decode budget, ML decoding isn't tried on a core less likely than
+// this to have full rank. The CPU time is better left to the other blocks
+#define ML_MIN_FULL_RANK_ODDS   0.5
+
+// Size of the symbols carried by each frame with the given inner code
+static size_t inner_code_symbol_size(dxwifi_fec_inner_code_t inner_code) {
+    return inner_code == DXWIFI_FEC_INNER_RS ? DXWIFI_FEC_SYMBOL_SIZE : DXWIFI_FEC_RAW_SYMBOL_SIZE;
+}
+
+
+// Number of source and total symbols for a message. The repair count is 
+// raised to N1 min so even tiny messages, like a critical block or a well
+// compressed object, can be LDPC encoded
+static void symbol_counts(size_t msglen, float coderate, dxwifi_fec_inner_code_t inner_code, uint16_t* k, uint16_t* n) {
+    *k = ceil((float) msglen / inner_code_symbol_size(inner_code));
+    *n = *k / coderate;
+    if(*n - *k < DXWIFI_LDPC_N1_MIN) {
+        *n = *k + DXWIFI_LDPC_N1_MIN;
+    }
+}
+
+
 // TODO Add function comments
-static void log_codec_params(const of_ldpc_parameters_t* params) {
+static void log_codec_params(const of_ldpc_parameters_t* params, dxwifi_fec_inner_code_t inner_code) {
     log_info(
         "DxWiFi Codec\n"
+        "\tInner Code:          %s\n"
         "\tK:                   %d\n"
         "\tN-K:                 %d\n"
         "\tN1:                  %d\n"
@@ -30,24 +67,27 @@ static void log_codec_params(const of_ldpc_parameters_t* params) {
         "\tRSCODE NPAR:         %d\n"
         "\tRSCODE Blocks/Frame: %d\n"
         "\tFEC Symbol Size:     %d\n"
+        "\tFEC Symbol Stride:   %d\n"
         "\tLDPC Frame Size:     %d\n"
         "\tRS-LDPC Frame Size:  %d\n",
+        dxwifi_fec_inner_code_to_str(inner_code),
         params->nb_source_symbols,
         params->nb_repair_symbols,
         params->N1,
         params->prng_seed,
         RSCODE_NPAR,
         DXWIFI_RSCODE_BLOCKS_PER_FRAME,
-        DXWIFI_FEC_SYMBOL_SIZE,
+        inner_code_symbol_size(inner_code),
+        params->encoding_symbol_length,
         DXWIFI_LDPC_FRAME_SIZE,
         DXWIFI_RS_LDPC_FRAME_SIZE
     );
 }
 
 
-static void log_ldpc_data_frame(dxwifi_ldpc_frame* frame) {
-    log_debug("(LDPC Frame) ESI: %u, CRC: 0x%x", ntohl(frame->oti.esi), ntohl(frame->oti.crc));
-    log_hexdump((uint8_t*)frame, sizeof(dxwifi_ldpc_frame));
+static void log_ldpc_data_frame(const dxwifi_oti* frame, size_t frame_size) {
+    log_debug("(LDPC Frame) ESI: %u, CRC: 0x%x", ntohs(frame->esi), ntohl(frame->crc));
+    log_hexdump((uint8_t*)frame, frame_size);
 }
 
 
@@ -57,257 +97,1659 @@ static void log_rs_ldpc_data_frame(dxwifi_rs_ldpc_frame* frame) {
 }
 
 
-// Caculate N,K values, initialize openfec session
-static of_session_t* init_openfec(uint32_t n, uint32_t k, of_codec_type_t type) {
-    of_status_t status = OF_STATUS_OK;
-
-    of_session_t* openfec_session = NULL;
-
+// LDPC parameters for an N, K code. The parity check matrix only depends on
+// N, K and the seed, any symbol length gives the same code
+static of_ldpc_parameters_t ldpc_params(uint32_t n, uint32_t k, uint32_t symbol_length) {
     of_ldpc_parameters_t codec_params = {
         .nb_source_symbols      = k,
         .nb_repair_symbols      = n - k,
-        .encoding_symbol_length = DXWIFI_FEC_SYMBOL_SIZE,
+        .encoding_symbol_length = symbol_length,
         .prng_seed              = FEC_PRNG, 
         .N1                     = (n-k) > DXWIFI_LDPC_N1_MAX ? DXWIFI_LDPC_N1_MAX : (n-k) 
     };
-    log_codec_params(&codec_params);
+    return codec_params;
+}
 
-    if(codec_params.N1 >= DXWIFI_LDPC_N1_MIN) {
-        status = of_create_codec_instance(&openfec_session, OF_CODEC_LDPC_STAIRCASE_STABLE, type, 2); // TODO magic number
-        assert_M(status == OF_STATUS_OK, "Failed to initialize OpenFEC session");
 
-        status = of_set_fec_parameters(openfec_session, (of_parameters_t*) &codec_params);
-        assert_M(status == OF_STATUS_OK, "Failed to set codec parameters");
-    }
-    return openfec_session;
+// OpenFEC allocation callback, every block the codec holds is counted. OpenFEC
+// can't be refused memory, but over budget it fails the next libdxwifi allocation
+static void account_openfec(void* context, INT64 delta) {
+    (void) context;
+    dxwifi_mem_account(DXWIFI_MEM_OPENFEC, delta);
 }
 
 
-//
-// See fec.h for non-static function descriptions
-//
+// OpenFEC builds the parity check matrix from a global PRNG, sessions are
+// created one at a time so blocks can be coded from several threads
+static pthread_mutex_t openfec_lock = PTHREAD_MUTEX_INITIALIZER;
 
-const char* dxwifi_fec_error_to_str(dxwifi_fec_error_t err) {
-    switch (err)
-    {
-    case FEC_ERROR_EXCEEDED_MAX_SYMBOLS:
-        return "N exceeds maximum number of symbols. Possible solution, decrease the coderate";
+// The allocation callback is global to OpenFEC, it's registered once
+static pthread_once_t openfec_once = PTHREAD_ONCE_INIT;
 
-    case FEC_ERROR_BELOW_N1_MIN:
-        return "N - K is below the N1 minimum. Possible solution, increase the coderate";
 
-    case FEC_ERROR_NO_OTI_FOUND:
-        return "No OTI Header found in the encoded message.";
+// CPU seconds a call to dxwifi_decode may spend, 0 for no limit
+static double decode_budget = 0;
 
-    case FEC_ERROR_DECODE_NOT_POSSIBLE:
-        return "Decode failed, not enough repair symbols";
-    
-    default:
-        return "Unknown error";
-    }
+// Thread CPU time past which the decode running on this thread is cancelled,
+// 0 when it has no limit, and whether a block was left for lack of time
+static __thread double decode_deadline = 0;
+static __thread bool decode_deferred = false;
+
+
+static double thread_cpu_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
 }
 
-// TODO refactor the individual algorithms of the encode routine into seperate 
-// functions
-ssize_t dxwifi_encode(void* message, size_t msglen, float coderate, void** out) {
-    debug_assert(message && out);
-    debug_assert(0.0 < coderate && coderate <= 1.0);
 
-    uint16_t rem = msglen % DXWIFI_FEC_SYMBOL_SIZE;
-    uint16_t k   = ceil((float) msglen / DXWIFI_FEC_SYMBOL_SIZE);
-    uint16_t n   = k / coderate;  
+// OpenFEC cancel callback, polled by ML decoding on the decoding thread
+static UINT32 decode_cancelled(void* context) {
+    (void) context;
+    return decode_deadline > 0 && thread_cpu_seconds() > decode_deadline;
+}
 
-    if(rem) {
-        log_info("Encoded msg will be zero padded with %d bytes", DXWIFI_FEC_SYMBOL_SIZE - rem);
+
+static void register_openfec_callback() {
+    of_set_mem_callback(account_openfec, NULL);
+    of_set_cancel_callback(decode_cancelled, NULL);
+}
+
+
+// Open an openfec session. Fails with FEC_ERROR_BELOW_N1_MIN if N1 is below
+// the minimum or FEC_ERROR_OUT_OF_MEMORY if the codec couldn't be allocated
+static int open_openfec(of_ldpc_parameters_t* codec_params, of_codec_type_t type, of_session_t** out) {
+    of_status_t status = OF_STATUS_OK;
+
+    of_session_t* openfec_session = NULL;
+
+    if(codec_params->N1 < DXWIFI_LDPC_N1_MIN) {
+        return FEC_ERROR_BELOW_N1_MIN;
     }
+    pthread_once(&openfec_once, register_openfec_callback);
 
-    //check if N > Max Symbols
-    if(n > OFEC_MAX_SYMBOLS) {
-        return FEC_ERROR_EXCEEDED_MAX_SYMBOLS;
+    pthread_mutex_lock(&openfec_lock);
+
+    status = of_create_codec_instance(&openfec_session, OF_CODEC_LDPC_STAIRCASE_STABLE, type, 2); // TODO magic number
+    if(status == OF_STATUS_OK) {
+        status = of_set_fec_parameters(openfec_session, (of_parameters_t*) codec_params);
+        if(status != OF_STATUS_OK) {
+            log_error("Failed to set codec parameters");
+            of_release_codec_instance(openfec_session);
+        }
     }
-    
-    of_session_t* openfec_session = init_openfec(n, k, OF_ENCODER);
-    if(!openfec_session) {
-        return FEC_ERROR_BELOW_N1_MIN;
+    else {
+        log_error("Failed to initialize OpenFEC session");
     }
+    pthread_mutex_unlock(&openfec_lock);
 
-    dxwifi_ldpc_frame* ldpc_frames = calloc(n, sizeof(dxwifi_ldpc_frame));
-    assert_M(ldpc_frames, "Failed to allocate memory for LDPC Frames");
+    if(status != OF_STATUS_OK) {
+        return FEC_ERROR_OUT_OF_MEMORY;
+    }
+    *out = openfec_session;
+    return 0;
+}
 
-    // Setup symbol table and CRCs
-    uint32_t crcs[n];
-    void* symbol_table[n];
 
-    // Load source symbols into symbol table, and calculate CRCs
-    for(uint16_t esi = 0; esi < k - 1; ++esi) { 
-        dxwifi_ldpc_frame* frame = &ldpc_frames[esi];
+// Caculate N,K values, initialize openfec session
+static int init_openfec(uint32_t n, uint32_t k, dxwifi_fec_inner_code_t inner_code, of_codec_type_t type, of_session_t** out) {
+    of_ldpc_parameters_t codec_params = ldpc_params(n, k, DXWIFI_FEC_STRIDE(inner_code_symbol_size(inner_code)));
+    log_codec_params(&codec_params, inner_code);
 
-        // Copy symbol size bytes from the original message
-        memcpy(frame->symbol, offset(message, esi, DXWIFI_FEC_SYMBOL_SIZE), DXWIFI_FEC_SYMBOL_SIZE);
+    return open_openfec(&codec_params, type, out);
+}
 
-        symbol_table[esi] = frame->symbol;
 
-        crcs[esi] = crc32(frame->symbol, DXWIFI_FEC_SYMBOL_SIZE);
+// Allocate a zeroed, aligned table of nsymbols padded symbols, NULL if the
+// allocation failed or is over budget
+static void* alloc_symbol_table(size_t nsymbols, size_t stride) {
+    void* symbols = dxwifi_aligned_alloc(DXWIFI_MEM_FEC, DXWIFI_FEC_SYMBOL_ALIGN, nsymbols * stride);
+    if(!symbols) {
+        log_error("Failed to allocate symbol table of %zu symbols", nsymbols);
+        return NULL;
     }
+    memset(symbols, 0, nsymbols * stride);
+    return symbols;
+}
 
-    // Special handling for Kth symbol since it may not be of length symbol size
-    dxwifi_ldpc_frame* frame = &ldpc_frames[k-1];
-    memcpy(frame->symbol, offset(message, k-1, DXWIFI_FEC_SYMBOL_SIZE), rem ? rem : DXWIFI_FEC_SYMBOL_SIZE);
 
-    symbol_table[k-1] = frame->symbol;
+// Fill in an OTI header in network byte order, the inner code and source block
+// ride in rem
+static void pack_oti(dxwifi_oti* oti, uint16_t esi, uint16_t n, uint16_t k, uint16_t rem, dxwifi_fec_inner_code_t inner_code, dxwifi_fec_block_t block, uint32_t crc) {
+    oti->esi = htons(esi);
+    oti->n   = htons(n);
+    oti->k   = htons(k);
+    oti->rem = htons(rem | (block << DXWIFI_OTI_BLOCK_SHIFT) | (inner_code << DXWIFI_OTI_INNER_CODE_SHIFT));
+    oti->crc = htonl(crc);
+}
 
-    crcs[k-1] = crc32(frame->symbol, DXWIFI_FEC_SYMBOL_SIZE);
 
+// Inner code signaled by an OTI header, the header may not be trustworthy yet
+static dxwifi_fec_inner_code_t oti_inner_code(const dxwifi_oti* oti) {
+    return ntohs(oti->rem) >> DXWIFI_OTI_INNER_CODE_SHIFT;
+}
 
-    // Build repair symbols and calculate CRCs
-    of_status_t status = OF_STATUS_OK;
-    for(size_t esi = k; esi < n; ++esi) {
-        dxwifi_ldpc_frame* frame = &ldpc_frames[esi];
-        symbol_table[esi] = frame->symbol;
 
-        status = of_build_repair_symbol(openfec_session, symbol_table, esi);
-        assert_continue(status == OF_STATUS_OK, "Failed to build repair symbol. esi=%d", esi);
+// Source block a frame belongs to
+static dxwifi_fec_block_t oti_block(const dxwifi_oti* oti) {
+    return (ntohs(oti->rem) >> DXWIFI_OTI_BLOCK_SHIFT) & 1;
+}
+
+
+// Majority vote of the inner code over every frame header. Before the inner
+// code is known the header can only be read raw, RS is systematic so the OTI is
+// in the same place either way. Ties are resolved in favour of RS.
+static dxwifi_fec_inner_code_t detect_inner_code(uint8_t* frames, size_t nframes) {
+    size_t votes[1 << (16 - DXWIFI_OTI_INNER_CODE_SHIFT)] = { 0 };
 
-        crcs[esi] = crc32(symbol_table[esi], DXWIFI_FEC_SYMBOL_SIZE);
+    for(size_t i = 0; i < nframes; ++i) {
+        const dxwifi_oti* oti = (const dxwifi_oti*) offset(frames, i, DXWIFI_RS_LDPC_FRAME_SIZE);
+        ++votes[oti_inner_code(oti)];
+    }
+
+    dxwifi_fec_inner_code_t inner_code = DXWIFI_FEC_INNER_RS;
+    for(int code = DXWIFI_FEC_INNER_RS; code < DXWIFI_FEC_INNER_CODE_COUNT; ++code) {
+        if(votes[code] > votes[inner_code]) {
+            inner_code = code;
+        }
     }
+    return inner_code;
+}
 
-    initialize_ecc();
 
-    dxwifi_rs_ldpc_frame* rs_ldpc_frames = calloc(n, sizeof(dxwifi_rs_ldpc_frame));
+// Frames RS checked or corrected by each task of the thread pool
+#define RS_DECODE_GRAIN 16
 
-    // Fill out OTI headers and RS Encode each LDPC Frame
-    for(uint16_t esi = 0; esi < n; ++esi) {
-        dxwifi_ldpc_frame* ldpc_frame = &ldpc_frames[esi];
-        ldpc_frame->oti.esi           = htons(esi);
-        ldpc_frame->oti.n             = htons(n);
-        ldpc_frame->oti.k             = htons(k);
-        ldpc_frame->oti.rem           = htons(rem);
-        ldpc_frame->oti.crc           = htonl(crcs[esi]);
+// Symbols a block is given before it's first decoded, past K. Errored frames
+// are only corrected until the block has that many distinct intact symbols
+#define RS_DEMAND_OVERHEAD  0.2
+#define RS_DEMAND_MIN_EXTRA 16
 
-        dxwifi_rs_ldpc_frame* rs_ldpc_frame = &rs_ldpc_frames[esi];
-        for(size_t i = 0; i < DXWIFI_RSCODE_BLOCKS_PER_FRAME; ++i) {
-            void* message  = offset(ldpc_frame, i, RSCODE_MAX_MSG_LEN);
-            void* codeword = &rs_ldpc_frame->blocks[i];
+// What is known of a frame after the syndrome check
+typedef enum {
+    RS_FRAME_CLEAN,             /* No errors, decoded as is                 */
+    RS_FRAME_ERRORED,           /* Errors left, OTI unknown                 */
+    RS_FRAME_ERRORED_OTI,       /* Errors left, OTI block clean so readable */
+    RS_FRAME_CORRECTED,         /* Errors corrected                         */
+    RS_FRAME_UNCORRECTABLE      /* Some errors couldn't be corrected        */
+} rs_frame_state;
 
-            encode_data(message, RSCODE_MAX_MSG_LEN, codeword);
-        }
-        log_ldpc_data_frame(ldpc_frame);
-        log_rs_ldpc_data_frame(rs_ldpc_frame);
-    }
+typedef struct {
+    dxwifi_rs_ldpc_frame*   rs_ldpc_frames;
+    dxwifi_ldpc_frame*      ldpc_frames;
+    size_t                  nframes;
+    uint8_t*                state;
+    size_t*                 batch;
+    size_t                  errored_frames;
+    size_t                  corrected_symbols;
+    size_t                  corrected_blocks;
+    size_t                  uncorrectable_blocks;
+} rs_decode_job;
 
-    *out = rs_ldpc_frames;
 
-    free(ldpc_frames);
+// Syndrome check frames [begin, end). Every frame is copied out, those with
+// errors as received so their CRC fails until they're corrected
+static void rs_check_range(void* arg, size_t begin, size_t end) {
+    rs_decode_job* job = arg;
 
-    of_release_codec_instance(openfec_session);
-    return n * DXWIFI_RS_LDPC_FRAME_SIZE;
-}
+    size_t errored_frames = 0;
 
-// TODO Refactor the individual algorithms of the decode routine into seperate
-// functions. 
-ssize_t dxwifi_decode(void* encoded_msg, size_t msglen, void** out) {
-    debug_assert(encoded_msg && out);
+    for(size_t i = begin; i < end; ++i) {
 
-    if( msglen % DXWIFI_RS_LDPC_FRAME_SIZE != 0) {
-        log_warning("Misaligned, msglen (%u) is not divisible by RS-LDPC frame size");
+        dxwifi_rs_ldpc_frame* rs_ldpc_frame = &job->rs_ldpc_frames[i];
+        dxwifi_ldpc_frame* ldpc_frame = &job->ldpc_frames[i];
+
+        uint8_t state = RS_FRAME_CLEAN;
+        for(size_t j = 0; j < DXWIFI_RSCODE_BLOCKS_PER_FRAME; ++j) {
+            void* message  = offset(ldpc_frame, j, RSCODE_MAX_MSG_LEN);
+            void* codeword = &rs_ldpc_frame->blocks[j];
+
+            if(state == RS_FRAME_CLEAN && rs_check(codeword, RSCODE_MAX_LEN)) {
+                state = j == 0 ? RS_FRAME_ERRORED : RS_FRAME_ERRORED_OTI;
+                ++errored_frames;
+            }
+            memcpy(message, codeword, RSCODE_MAX_MSG_LEN);
+        }
+        job->state[i] = state;
+
+        if(state == RS_FRAME_CLEAN) {
+            DXWIFI_PROBE3(rs__frame, i, 0, 0);
+            log_ldpc_data_frame(&ldpc_frame->oti, sizeof(dxwifi_ldpc_frame));
+            log_rs_ldpc_data_frame(rs_ldpc_frame);
+        }
     }
+    __atomic_add_fetch(&job->errored_frames, errored_frames, __ATOMIC_RELAXED);
+}
 
-    initialize_ecc();
 
-    size_t nframes = msglen / DXWIFI_RS_LDPC_FRAME_SIZE;
+// Correct the frames in batch [begin, end), totals are added once per task
+static void rs_correct_range(void* arg, size_t begin, size_t end) {
+    rs_decode_job* job = arg;
 
-    dxwifi_ldpc_frame* ldpc_frames = calloc(nframes, sizeof(dxwifi_ldpc_frame));
+    size_t corrected_symbols    = 0;
+    size_t corrected_blocks     = 0;
+    size_t uncorrectable_blocks = 0;
 
-    dxwifi_rs_ldpc_frame* rs_ldpc_frames = encoded_msg;
+    for(size_t b = begin; b < end; ++b) {
+        size_t i = job->batch[b];
 
-    // Decode outer RS shell and populate the LDPC Frames
-    for(size_t i = 0; i < nframes; ++i) {
+        dxwifi_rs_ldpc_frame* rs_ldpc_frame = &job->rs_ldpc_frames[i];
+        dxwifi_ldpc_frame* ldpc_frame = &job->ldpc_frames[i];
 
-        dxwifi_rs_ldpc_frame* rs_ldpc_frame = &rs_ldpc_frames[i];
-        dxwifi_ldpc_frame* ldpc_frame = &ldpc_frames[i];
+        size_t frame_corrected      = corrected_symbols;
+        size_t frame_uncorrectable  = uncorrectable_blocks;
 
         for(size_t j = 0; j < DXWIFI_RSCODE_BLOCKS_PER_FRAME; ++j) {
             void* message  = offset(ldpc_frame, j, RSCODE_MAX_MSG_LEN);
             void* codeword = &rs_ldpc_frame->blocks[j];
 
-            decode_data(codeword, RSCODE_MAX_LEN);
-
-            if(check_syndrome() != 0) {
-                correct_errors_erasures(codeword, RSCODE_MAX_LEN, 0, NULL);
+            int corrected = rs_correct_errors(codeword, RSCODE_MAX_LEN);
+            if(corrected == RS_UNCORRECTABLE) {
+                ++uncorrectable_blocks;
+            }
+            else if(corrected > 0) {
+                corrected_symbols += corrected;
+                ++corrected_blocks;
             }
             memcpy(message, codeword, RSCODE_MAX_MSG_LEN);
         }
-        log_ldpc_data_frame(ldpc_frame);
+        job->state[i] = uncorrectable_blocks > frame_uncorrectable ? RS_FRAME_UNCORRECTABLE : RS_FRAME_CORRECTED;
+        DXWIFI_PROBE3(rs__frame, i, corrected_symbols - frame_corrected, uncorrectable_blocks - frame_uncorrectable);
+
+        log_ldpc_data_frame(&ldpc_frame->oti, sizeof(dxwifi_ldpc_frame));
         log_rs_ldpc_data_frame(rs_ldpc_frame);
     }
+    __atomic_add_fetch(&job->corrected_symbols, corrected_symbols, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&job->corrected_blocks, corrected_blocks, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&job->uncorrectable_blocks, uncorrectable_blocks, __ATOMIC_RELAXED);
+}
 
-    // Search for first valid OTI header 
-    size_t idx = 0;
-    for(; idx < nframes; ++idx) {
-    	dxwifi_ldpc_frame* frame = &ldpc_frames[idx];
 
-    	uint32_t crc = crc32(frame->symbol, DXWIFI_FEC_SYMBOL_SIZE); 
+// Syndrome check each frame into an array of LDPC frames, NULL if it couldn't
+// be allocated. Only clean frames are decoded, errored ones are left to
+// rs_demand_frames
+static dxwifi_ldpc_frame* rs_check_frames(dxwifi_rs_ldpc_frame* rs_ldpc_frames, size_t nframes, rs_decode_job* job) {
 
-    	if(crc == ntohl(frame->oti.crc)){
-            break;
-    	}
-    	else { 
-            log_warning("Frame %d CRC mistmatch, actual: 0x%x expected: 0x%x", idx, crc, ntohl(frame->oti.crc)); 
-        }
-	} 
-    if(idx >= nframes){
-        free(ldpc_frames);
-        return FEC_ERROR_NO_OTI_FOUND;
-	}
+    *job = (rs_decode_job) {
+        .rs_ldpc_frames = rs_ldpc_frames,
+        .nframes        = nframes,
+        .ldpc_frames    = dxwifi_calloc(DXWIFI_MEM_FEC, nframes ? nframes : 1, sizeof(dxwifi_ldpc_frame)),
+        .state          = dxwifi_calloc(DXWIFI_MEM_FEC, nframes ? nframes : 1, sizeof(uint8_t)),
+        .batch          = dxwifi_calloc(DXWIFI_MEM_FEC, nframes ? nframes : 1, sizeof(size_t))
+    };
+    if(!job->ldpc_frames || !job->state || !job->batch) {
+        dxwifi_free(DXWIFI_MEM_FEC, job->ldpc_frames);
+        dxwifi_free(DXWIFI_MEM_FEC, job->state);
+        dxwifi_free(DXWIFI_MEM_FEC, job->batch);
+        return NULL;
+    }
+    dxwifi_parallel_for(nframes, RS_DECODE_GRAIN, rs_check_range, job);
 
-	dxwifi_oti* oti = &ldpc_frames[idx].oti;
-    uint16_t esi    = ntohs(oti->esi);
-    uint16_t n      = ntohs(oti->n);
-    uint16_t k      = ntohs(oti->k);
-    uint16_t rem    = ntohs(oti->rem);
-    log_info("OTI Found: esi=%d, n=%d, k=%d, rem=%d", esi, n, k, rem);
+    log_info("RS Check: %zu/%zu frames have errors", job->errored_frames, nframes);
+    DXWIFI_PROBE2(rs__done, nframes, job->errored_frames);
 
-    of_session_t* openfec_session = init_openfec(n, k, OF_DECODER);
+    return job->ldpc_frames;
+}
 
-    // Decode LDPC Frames
-    of_status_t status = OF_STATUS_OK;
-    for (size_t i = 0; i < nframes; ++i) {
-        dxwifi_ldpc_frame* frame = &ldpc_frames[i];
 
-        uint16_t esi = ntohs(frame->oti.esi);
-        if(esi > n) {
-            log_debug("Invalid ESI: %u, N: %u", esi, n);
-        } else {
-            of_decode_with_new_symbol(openfec_session, frame->symbol, esi);
+// Whether the OTI of a frame can be trusted, i.e. its RS block had no errors
+// or was corrected
+static bool rs_oti_known(const rs_decode_job* job, size_t i) {
+    return job->state[i] != RS_FRAME_ERRORED;
+}
+
+
+// Whether a frame has errors that weren't corrected yet, never without RS
+static bool rs_frame_pending(const uint8_t* rs_state, size_t i) {
+    return rs_state && (rs_state[i] == RS_FRAME_ERRORED || rs_state[i] == RS_FRAME_ERRORED_OTI);
+}
+
+
+// Correct errored frames that may belong to a block until it has target
+// distinct intact symbols, or all of them if its K isn't known yet. Returns
+// the number of frames corrected
+static size_t rs_demand_frames(rs_decode_job* job, dxwifi_fec_block_t block, bool all) {
+    size_t total = 0;
+
+    for(;;) {
+        uint8_t seen[(UINT16_MAX + 1) / 8] = { 0 };
+        size_t  have    = 0;
+        size_t  target  = SIZE_MAX;
+        size_t  nbatch  = 0;
+
+        for(size_t i = 0; i < job->nframes; ++i) {
+            const dxwifi_oti* oti = &job->ldpc_frames[i].oti;
+            uint8_t state = job->state[i];
+
+            if(state == RS_FRAME_UNCORRECTABLE || (rs_oti_known(job, i) && oti_block(oti) != block)) {
+                continue;
+            }
+            if(state == RS_FRAME_ERRORED || state == RS_FRAME_ERRORED_OTI) {
+                job->batch[nbatch++] = i;
+                continue;
+            }
+
+            uint16_t esi = ntohs(oti->esi);
+            if(!(seen[esi / 8] & (1 << (esi % 8)))) {
+                seen[esi / 8] |= 1 << (esi % 8);
+                ++have;
+            }
+            if(target == SIZE_MAX && !all) {
+                size_t k     = ntohs(oti->k);
+                size_t extra = k * RS_DEMAND_OVERHEAD;
+                target = k + (extra > RS_DEMAND_MIN_EXTRA ? extra : RS_DEMAND_MIN_EXTRA);
+            }
+        }
+        if(have >= target || nbatch == 0) {
+            return total;
         }
+
+        // Errored frames may turn out uncorrectable, duplicates or of another
+        // block, more are corrected on the next pass if so
+        if(target != SIZE_MAX && nbatch > target - have) {
+            nbatch = target - have;
+        }
+        dxwifi_parallel_for(nbatch, RS_DECODE_GRAIN, rs_correct_range, job);
+        total += nbatch;
     }
-    if(!of_is_decoding_complete(openfec_session)) {
-        status = of_finish_decoding(openfec_session);
-        if(status != OF_STATUS_OK) {
-            free(ldpc_frames);
-            of_release_codec_instance(openfec_session);
-            return FEC_ERROR_DECODE_NOT_POSSIBLE;
+}
+
+
+// Log what RS decoding took and release the job, the LDPC frames excepted
+static void rs_finish_frames(rs_decode_job* job) {
+    size_t uncorrected = 0;
+    for(size_t i = 0; i < job->nframes; ++i) {
+        uncorrected += job->state[i] == RS_FRAME_ERRORED || job->state[i] == RS_FRAME_ERRORED_OTI;
+    }
+    log_info(
+        "RS Decode: %zu symbols corrected in %zu/%zu blocks, %zu blocks uncorrectable, %zu/%zu errored frames not needed", 
+        job->corrected_symbols, 
+        job->corrected_blocks, 
+        job->nframes * DXWIFI_RSCODE_BLOCKS_PER_FRAME, 
+        job->uncorrectable_blocks,
+        uncorrected,
+        job->errored_frames
+    );
+    dxwifi_free(DXWIFI_MEM_FEC, job->state);
+    dxwifi_free(DXWIFI_MEM_FEC, job->batch);
+}
+
+
+// OpenFEC callback, source symbols are decoded in place in the symbol table
+static void* decoded_source_symbol_slot(void* symbols, uint32_t size, uint32_t esi) {
+    return offset(symbols, esi, size);
+}
+
+
+// Frames or symbols handled by each task of the thread pool when encoding
+#define ENCODE_GRAIN 16
+
+typedef struct {
+    void*                   message;
+    void**                  symbol_table;
+    uint32_t*               crcs;
+    void*                   frames;
+    size_t                  symbol_size;
+    uint16_t                n;
+    uint16_t                k;
+    uint16_t                rem;
+    dxwifi_fec_inner_code_t inner_code;
+    dxwifi_fec_block_t      block;
+} encode_job;
+
+
+// Load source symbols [begin, end) into the symbol table and calculate CRCs
+static void load_source_symbols(void* arg, size_t begin, size_t end) {
+    encode_job* job = arg;
+
+    for(size_t esi = begin; esi < end; ++esi) {
+        // The Kth symbol may not be of length symbol size
+        size_t len = (esi == job->k - 1U && job->rem) ? job->rem : job->symbol_size;
+
+        memcpy(job->symbol_table[esi], offset(job->message, esi, job->symbol_size), len);
+
+        job->crcs[esi] = crc32(job->symbol_table[esi], job->symbol_size);
+    }
+}
+
+
+// Calculate CRCs of repair symbols [begin, end), counted from the first one
+static void crc_repair_symbols(void* arg, size_t begin, size_t end) {
+    encode_job* job = arg;
+
+    for(size_t esi = job->k + begin; esi < job->k + end; ++esi) {
+        job->crcs[esi] = crc32(job->symbol_table[esi], job->symbol_size);
+    }
+}
+
+
+// Serialize a symbol with its OTI header into frame i and apply the inner code
+static void serialize_frame(void* frames, size_t i, const void* symbol, uint16_t esi, uint16_t n, uint16_t k, uint16_t rem, dxwifi_fec_inner_code_t inner_code, dxwifi_fec_block_t block, uint32_t crc) {
+    if(inner_code == DXWIFI_FEC_INNER_RS) {
+        dxwifi_rs_ldpc_frame* rs_ldpc_frame = offset(frames, i, sizeof(dxwifi_rs_ldpc_frame));
+
+        // RS Encode the LDPC Frame
+        dxwifi_ldpc_frame ldpc_frame;
+        pack_oti(&ldpc_frame.oti, esi, n, k, rem, inner_code, block, crc);
+        memcpy(ldpc_frame.symbol, symbol, DXWIFI_FEC_SYMBOL_SIZE);
+
+        for(size_t j = 0; j < DXWIFI_RSCODE_BLOCKS_PER_FRAME; ++j) {
+            void* message  = offset(&ldpc_frame, j, RSCODE_MAX_MSG_LEN);
+            void* codeword = &rs_ldpc_frame->blocks[j];
+
+            rs_encode(message, RSCODE_MAX_MSG_LEN, codeword);
         }
+        log_ldpc_data_frame(&ldpc_frame.oti, sizeof(dxwifi_ldpc_frame));
+        log_rs_ldpc_data_frame(rs_ldpc_frame);
+    }
+    else {
+        // The CRC is the only check
+        dxwifi_raw_ldpc_frame* frame = offset(frames, i, sizeof(dxwifi_raw_ldpc_frame));
+
+        pack_oti(&frame->oti, esi, n, k, rem, inner_code, block, crc);
+        memcpy(frame->symbol, symbol, DXWIFI_FEC_RAW_SYMBOL_SIZE);
+
+        log_ldpc_data_frame(&frame->oti, sizeof(dxwifi_raw_ldpc_frame));
+    }
+}
+
+
+// Serialize symbols [begin, end) with their OTI header and apply the inner code
+static void serialize_frames(void* arg, size_t begin, size_t end) {
+    encode_job* job = arg;
+
+    for(size_t esi = begin; esi < end; ++esi) {
+        serialize_frame(job->frames, esi, job->symbol_table[esi], esi, job->n, job->k, job->rem, job->inner_code, job->block, job->crcs[esi]);
+    }
+}
+
+
+// Encode a single source block of k symbols into n frames. Frames are tagged
+// with their source block so several blocks can share one encoded message
+static ssize_t encode_block(void* message, size_t msglen, uint16_t k, uint16_t n, dxwifi_fec_inner_code_t inner_code, dxwifi_fec_block_t block, void** out) {
+    size_t symbol_size = inner_code_symbol_size(inner_code);
+    size_t stride      = DXWIFI_FEC_STRIDE(symbol_size);
+
+    uint16_t rem = msglen % symbol_size;
+
+    if(rem) {
+        log_info("Encoded msg will be zero padded with %d bytes", symbol_size - rem);
+    }
+
+    //check if N > Max Symbols
+    if(n > OFEC_MAX_SYMBOLS) {
+        return FEC_ERROR_EXCEEDED_MAX_SYMBOLS;
+    }
+    
+    of_session_t* openfec_session = NULL;
+    int err = init_openfec(n, k, inner_code, OF_ENCODER, &openfec_session);
+    if(err < 0) {
+        return err;
+    }
+
+    // Symbols are padded to the stride, only symbol_size bytes go out
+    void* symbols = alloc_symbol_table(n, stride);
+    if(!symbols) {
+        of_release_codec_instance(openfec_session);
+        return FEC_ERROR_OUT_OF_MEMORY;
     }
 
+    // Setup symbol table and CRCs
+    uint32_t crcs[n];
     void* symbol_table[n];
-    of_get_source_symbols_tab(openfec_session, symbol_table);
+    for(uint16_t esi = 0; esi < n; ++esi) {
+        symbol_table[esi] = offset(symbols, esi, stride);
+    }
 
-    // Copy out the decoded message
-    void* decoded_msg = calloc(k, DXWIFI_FEC_SYMBOL_SIZE);
-    for(uint16_t esi = 0; esi < (k - 1); ++esi) {
-        void* symbol = offset(decoded_msg, esi, DXWIFI_FEC_SYMBOL_SIZE);
-        memcpy(symbol, symbol_table[esi], DXWIFI_FEC_SYMBOL_SIZE);
+    encode_job job = {
+        .message        = message,
+        .symbol_table   = symbol_table,
+        .crcs           = crcs,
+        .symbol_size    = symbol_size,
+        .n              = n,
+        .k              = k,
+        .rem            = rem,
+        .inner_code     = inner_code,
+        .block          = block
+    };
+
+    // Load source symbols into symbol table, and calculate CRCs
+    dxwifi_parallel_for(k, ENCODE_GRAIN, load_source_symbols, &job);
+
+    // Build repair symbols. Each staircase repair symbol depends on the one
+    // before it, so only their CRCs are calculated in parallel
+    of_status_t status = OF_STATUS_OK;
+    for(size_t esi = k; esi < n; ++esi) {
+        status = of_build_repair_symbol(openfec_session, symbol_table, esi);
+        assert_continue(status == OF_STATUS_OK, "Failed to build repair symbol. esi=%d", esi);
     }
+    dxwifi_parallel_for(n - k, ENCODE_GRAIN, crc_repair_symbols, &job);
 
-    // Special handling for Kth symbol since it may not be of length symbol size
-    uint16_t nbytes = rem ? rem : DXWIFI_FEC_SYMBOL_SIZE;
-    void* symbol = offset(decoded_msg, k-1, DXWIFI_FEC_SYMBOL_SIZE);
-    memcpy(symbol, symbol_table[k-1], nbytes);
+    void* frames = dxwifi_calloc(DXWIFI_MEM_FEC, n, DXWIFI_RS_LDPC_FRAME_SIZE);
+    if(!frames) {
+        dxwifi_free(DXWIFI_MEM_FEC, symbols);
+        of_release_codec_instance(openfec_session);
+        return FEC_ERROR_OUT_OF_MEMORY;
+    }
 
-    *out = decoded_msg;
+    // Serialize each symbol with its OTI header
+    job.frames = frames;
+    dxwifi_parallel_for(n, ENCODE_GRAIN, serialize_frames, &job);
+
+    *out = frames;
+
+    dxwifi_free(DXWIFI_MEM_FEC, symbols);
 
-    free(ldpc_frames);
     of_release_codec_instance(openfec_session);
-    return ((k-1) * DXWIFI_FEC_SYMBOL_SIZE) + nbytes;
+    return n * DXWIFI_RS_LDPC_FRAME_SIZE;
+}
+
+
+// ESI of the ith frame from first. Past the last 16 bit ESI the repair
+// symbols start over, source symbols are only sent once
+static uint16_t fountain_esi(uint32_t k, uint16_t first, size_t i) {
+    size_t esi = first + i;
+    if(esi > UINT16_MAX) {
+        esi = k + (esi - (UINT16_MAX + 1)) % (UINT16_MAX + 1 - k);
+    }
+    return esi;
+}
+
+
+typedef struct {
+    const dxwifi_fountain_encoder*  encoder;
+    void*                           frames;
+    uint16_t                        first;
+} fountain_job;
+
+
+// Encode and serialize frames [begin, end) of a fountain job
+static void encode_fountain_frames(void* arg, size_t begin, size_t end) {
+    fountain_job* job = arg;
+    const dxwifi_fountain_encoder* encoder = job->encoder;
+
+    size_t symbol_size = inner_code_symbol_size(encoder->inner_code);
+    size_t stride      = DXWIFI_FEC_STRIDE(symbol_size);
+
+    uint64_t symbol[DXWIFI_FEC_RAW_SYMBOL_STRIDE / sizeof(uint64_t)];
+
+    for(size_t i = begin; i < end; ++i) {
+        uint16_t esi = fountain_esi(encoder->code.k, job->first, i);
+
+        raptor_encode(&encoder->code, encoder->__table, esi, symbol, stride);
+
+        uint32_t crc = crc32((uint8_t*) symbol, symbol_size);
+        serialize_frame(job->frames, i, symbol, esi, DXWIFI_FOUNTAIN_OTI_N, encoder->code.k, encoder->rem, encoder->inner_code, DXWIFI_FEC_BLOCK_BULK, crc);
+    }
+}
+
+
+// Frames CRC checked by each task of the thread pool when decoding
+#define CRC_CHECK_GRAIN 64
+
+typedef struct {
+    uint8_t*        frames;
+    size_t          frame_size;
+    size_t          symbol_size;
+    const uint8_t*  rs_state;
+    bool*           intact;
+} crc_check_job;
+
+
+// Check the CRC of frames [begin, end). Frames with RS errors not corrected
+// yet aren't intact whatever their CRC, their OTI may be wrong
+static void check_frame_crcs(void* arg, size_t begin, size_t end) {
+    crc_check_job* job = arg;
+
+    for(size_t i = begin; i < end; ++i) {
+        dxwifi_oti* frame = offset(job->frames, i, job->frame_size);
+        void* symbol = frame + 1;
+
+        job->intact[i] = !rs_frame_pending(job->rs_state, i) && crc32(symbol, job->symbol_size) == ntohl(frame->crc);
+    }
+}
+
+
+// Copy the k source symbols of a block out into a new message. The Kth symbol
+// may not be of length symbol size
+static ssize_t gather_message(void* const* symbol_table, uint16_t k, size_t symbol_size, uint16_t rem, void** out) {
+    uint16_t nbytes = rem ? rem : symbol_size;
+
+    void* message = dxwifi_calloc(DXWIFI_MEM_FEC, k, symbol_size);
+    if(!message) {
+        return FEC_ERROR_OUT_OF_MEMORY;
+    }
+    for(uint16_t esi = 0; esi < (k - 1); ++esi) {
+        memcpy(offset(message, esi, symbol_size), symbol_table[esi], symbol_size);
+    }
+    memcpy(offset(message, k - 1, symbol_size), symbol_table[k - 1], nbytes);
+
+    *out = message;
+    return ((k - 1) * symbol_size) + nbytes;
+}
+
+
+// Release the symbol table and lists of decode_fountain_block, any may be NULL
+static void free_fountain_symbols(void* symbols, void** source, bool* known, void** repair, uint32_t* repair_esi) {
+    dxwifi_free(DXWIFI_MEM_FEC, symbols);
+    dxwifi_free(DXWIFI_MEM_FEC, source);
+    dxwifi_free(DXWIFI_MEM_FEC, known);
+    dxwifi_free(DXWIFI_MEM_FEC, repair);
+    dxwifi_free(DXWIFI_MEM_FEC, repair_esi);
+}
+
+
+// Decode fountain coded frames, those with N = 0 in the OTI. Any distinct
+// ESIs will do so the frames are indexed over the whole ESI space, then the 
+// Raptor decoder fills in the missing source symbols. Partial decoding works
+// as in decode_block
+static ssize_t decode_fountain_block(uint8_t* frames, size_t nframes, size_t frame_size, const bool* intact, dxwifi_fec_inner_code_t inner_code, uint16_t k, uint16_t rem, bool partial, bool* complete, void** out) {
+    size_t symbol_size = inner_code_symbol_size(inner_code);
+    size_t stride      = DXWIFI_FEC_STRIDE(symbol_size);
+
+    const void** by_esi = dxwifi_calloc(DXWIFI_MEM_FEC, UINT16_MAX + 1, sizeof(void*));
+    if(!by_esi) {
+        return FEC_ERROR_OUT_OF_MEMORY;
+    }
+
+    // Index the first intact copy of each symbol by its ESI
+    uint16_t nsource = 0;
+    uint16_t nrepair = 0;
+    for(size_t i = 0; i < nframes; ++i) {
+        dxwifi_oti* frame = offset(frames, i, frame_size);
+
+        if(inner_code != DXWIFI_FEC_INNER_NONE && !intact[i]) {
+            log_debug("Frame %d CRC mismatch, dropped", i);
+            continue;
+        }
+        if(oti_block(frame) != DXWIFI_FEC_BLOCK_BULK || ntohs(frame->n) != DXWIFI_FOUNTAIN_OTI_N || ntohs(frame->k) != k) {
+            continue;
+        }
+
+        uint16_t esi = ntohs(frame->esi);
+        if(!by_esi[esi]) {
+            by_esi[esi] = frame + 1;
+            nsource += esi < k;
+            nrepair += esi >= k;
+            DXWIFI_PROBE2(ldpc__symbol, esi, DXWIFI_FEC_BLOCK_BULK);
+        }
+    }
+
+    if(nsource + nrepair < k && !partial) {
+        dxwifi_free(DXWIFI_MEM_FEC, by_esi);
+        DXWIFI_PROBE2(ldpc__done, DXWIFI_FEC_BLOCK_BULK, false);
+        log_warning("Fountain has %u/%u symbols, too few to decode", nsource + nrepair, k);
+        return FEC_ERROR_DECODE_NOT_POSSIBLE;
+    }
+
+    // Raptor works on whole strides, so every symbol is copied to a padded
+    // slot. Source symbols go in their slot by ESI, repair symbols follow
+    // The symbol lists are sized by K, which can be far more than fits on a
+    // thread pool worker's stack
+    void*     symbols    = alloc_symbol_table(k + nrepair, stride);
+    void**    source     = dxwifi_calloc(DXWIFI_MEM_FEC, k, sizeof(void*));
+    bool*     known      = dxwifi_calloc(DXWIFI_MEM_FEC, k, sizeof(bool));
+    void**    repair     = dxwifi_calloc(DXWIFI_MEM_FEC, nrepair + 1, sizeof(void*));
+    uint32_t* repair_esi = dxwifi_calloc(DXWIFI_MEM_FEC, nrepair + 1, sizeof(uint32_t));
+    if(!symbols || !source || !known || !repair || !repair_esi) {
+        dxwifi_free(DXWIFI_MEM_FEC, by_esi);
+        free_fountain_symbols(symbols, source, known, repair, repair_esi);
+        return FEC_ERROR_OUT_OF_MEMORY;
+    }
+    for(uint16_t esi = 0; esi < k; ++esi) {
+        source[esi] = offset(symbols, esi, stride);
+        known[esi]  = by_esi[esi] != NULL;
+        if(known[esi]) {
+            memcpy(source[esi], by_esi[esi], symbol_size);
+        }
+    }
+    for(uint32_t esi = k, r = 0; esi <= UINT16_MAX; ++esi) {
+        if(by_esi[esi]) {
+            repair[r] = offset(symbols, k + r, stride);
+            memcpy(repair[r], by_esi[esi], symbol_size);
+            repair_esi[r++] = esi;
+        }
+    }
+    dxwifi_free(DXWIFI_MEM_FEC, by_esi);
+
+    bool decoded = nsource == k;
+    if(!decoded) {
+        raptor_code code;
+        if(!raptor_init(&code, k)) {
+            free_fountain_symbols(symbols, source, known, repair, repair_esi);
+            return FEC_ERROR_DECODE_NOT_POSSIBLE;
+        }
+        decoded = raptor_decode(&code, source, known, repair, repair_esi, nrepair, stride);
+        raptor_close(&code);
+    }
+    DXWIFI_PROBE2(ldpc__done, DXWIFI_FEC_BLOCK_BULK, decoded);
+
+    if(!decoded && !partial) {
+        free_fountain_symbols(symbols, source, known, repair, repair_esi);
+        return FEC_ERROR_DECODE_NOT_POSSIBLE;
+    }
+    if(!decoded) {
+        size_t recovered = 0;
+        for(uint16_t esi = 0; esi < k; ++esi) {
+            recovered += known[esi];
+        }
+        log_warning("Fountain only partially decoded, %zu/%u source symbols recovered", recovered, k);
+    }
+
+    void* decoded_msg = NULL;
+    ssize_t decoded_size = gather_message(source, k, symbol_size, rem, &decoded_msg);
+    free_fountain_symbols(symbols, source, known, repair, repair_esi);
+    if(decoded_size < 0) {
+        return decoded_size;
+    }
+    if(complete) {
+        *complete = decoded;
+    }
+    *out = decoded_msg;
+
+    return decoded_size;
+}
+
+
+// Odds that a random binary matrix has full column rank, none with fewer rows
+// than columns, otherwise the product of 1 - 2^-j for j from rows - cols + 1
+// to rows
+static double full_rank_odds(uint32_t rows, uint32_t cols) {
+    if(rows < cols) {
+        return 0.0;
+    }
+    double odds = 1.0;
+    for(uint32_t j = rows - cols + 1; j <= rows && j < 64; ++j) {
+        odds *= 1.0 - ldexp(1.0, -(int) j);
+    }
+    return odds;
+}
+
+
+// Finish decoding a block stalled after iterative decoding. The system left
+// is peeled first, without touching any symbol, which tells the unknowns apart
+// from the equations and the size of the dense core. ML decoding is skipped
+// when the core can't be solved. Under a decode budget it's deferred when the
+// core is unlikely to be solved, or its predicted cost doesn't fit in what is
+// left of the budget
+static bool finish_decoding(of_session_t* openfec_session, dxwifi_fec_block_t block, size_t symbol_size) {
+    of_ml_estimate_t estimate;
+    if(of_get_control_parameter(openfec_session, OF_CTRL_GET_ML_ESTIMATE, &estimate, sizeof(estimate)) != OF_STATUS_OK) {
+        if(decode_cancelled(NULL)) {
+            log_warning("Block %d ML decoding deferred, over the decode budget", block);
+            decode_deferred = true;
+            return false;
+        }
+        return of_finish_decoding(openfec_session) == OF_STATUS_OK;
+    }
+    double odds = full_rank_odds(estimate.nb_core_rows, estimate.nb_inactive);
+    if(odds == 0.0) {
+        log_info(
+            "Block %d ML decoding skipped: %u unknowns, %u equations, %ux%u core can't be solved", 
+            block, estimate.nb_unknowns, estimate.nb_equations, estimate.nb_core_rows, estimate.nb_inactive
+        );
+        return false;
+    }
+
+    double cost = estimate.nb_symbol_ops * symbol_size / ML_XOR_BYTES_PER_SEC + estimate.nb_word_ops / ML_WORD_OPS_PER_SEC;
+    log_info(
+        "Block %d ML decoding: %u unknowns, %u equations, %ux%u core, %.1f%% odds, %.3fs predicted", 
+        block, estimate.nb_unknowns, estimate.nb_equations, estimate.nb_core_rows, estimate.nb_inactive, odds * 100, cost
+    );
+
+    if(decode_deadline > 0 && odds < ML_MIN_FULL_RANK_ODDS) {
+        log_warning("Block %d ML decoding deferred, %.1f%% odds aren't worth the decode budget", block, odds * 100);
+        decode_deferred = true;
+        return false;
+    }
+
+    double start = thread_cpu_seconds();
+    if(decode_deadline > 0 && start + cost > decode_deadline) {
+        log_warning("Block %d ML decoding deferred, %.3fs left of the decode budget", block, decode_deadline - start);
+        decode_deferred = true;
+        return false;
+    }
+
+    bool decoded = of_finish_decoding(openfec_session) == OF_STATUS_OK;
+    if(!decoded && decode_cancelled(NULL)) {
+        log_warning("Block %d ML decoding cancelled, over the decode budget", block);
+        decode_deferred = true;
+    }
+    log_debug("Block %d ML decoding took %.3fs", block, thread_cpu_seconds() - start);
+    return decoded;
+}
+
+
+// Decode the frames of one source block. The whole capture is in memory, so
+// every intact symbol is gathered first and submitted to OpenFEC at once, which
+// then only runs the decoders the block needs. Frames with RS errors that
+// weren't corrected yet, as told by rs_state, are erasures. When partial is
+// set and the block can't be fully recovered the source symbols that are known
+// are returned with zeros in place of the missing ones, and complete is cleared
+static ssize_t decode_block(uint8_t* frames, size_t nframes, size_t frame_size, const uint8_t* rs_state, dxwifi_fec_inner_code_t inner_code, dxwifi_fec_block_t block, bool partial, bool* complete, void** out) {
+    size_t symbol_size = inner_code_symbol_size(inner_code);
+    size_t stride      = DXWIFI_FEC_STRIDE(symbol_size);
+
+    // Search for first valid OTI header 
+    size_t idx = 0;
+    for(; idx < nframes; ++idx) {
+        dxwifi_oti* frame = offset(frames, idx, frame_size);
+        void* symbol = frame + 1;
+
+        if(rs_frame_pending(rs_state, idx)) {
+            continue;
+        }
+        uint32_t crc = crc32((uint8_t*) symbol, symbol_size); 
+
+        if(crc == ntohl(frame->crc) && oti_inner_code(frame) == inner_code && oti_block(frame) == block){
+            break;
+        }
+        else if(crc != ntohl(frame->crc)) { 
+            log_warning("Frame %d CRC mistmatch, actual: 0x%x expected: 0x%x", idx, crc, ntohl(frame->crc)); 
+        }
+    } 
+    if(idx >= nframes){
+        return FEC_ERROR_NO_OTI_FOUND;
+    }
+
+    dxwifi_oti* oti = offset(frames, idx, frame_size);
+    uint16_t esi    = ntohs(oti->esi);
+    uint16_t n      = ntohs(oti->n);
+    uint16_t k      = ntohs(oti->k);
+    uint16_t rem    = ntohs(oti->rem) & DXWIFI_OTI_REM_MASK;
+    log_info("OTI Found: esi=%d, n=%d, k=%d, rem=%d, inner code=%s, block=%d", esi, n, k, rem, dxwifi_fec_inner_code_to_str(inner_code), block);
+
+    DXWIFI_PROBE3(ldpc__start, block, n, k);
+
+    // CRCs are checked across the thread pool before symbols are gathered
+    bool intact[nframes];
+    if(inner_code != DXWIFI_FEC_INNER_NONE) {
+        crc_check_job job = {
+            .frames         = frames,
+            .frame_size     = frame_size,
+            .symbol_size    = symbol_size,
+            .rs_state       = rs_state,
+            .intact         = intact
+        };
+        dxwifi_parallel_for(nframes, CRC_CHECK_GRAIN, check_frame_crcs, &job);
+    }
+
+    if(n == DXWIFI_FOUNTAIN_OTI_N) {
+        return decode_fountain_block(frames, nframes, frame_size, intact, inner_code, k, rem, partial, complete, out);
+    }
+
+    // Index the first intact copy of each symbol by its ESI
+    void* symbol_table[n];
+    memset(symbol_table, 0, sizeof(symbol_table));
+    uint16_t nsource = 0;
+    uint16_t nrepair = 0;
+
+    for (size_t i = 0; i < nframes; ++i) {
+        dxwifi_oti* frame = offset(frames, i, frame_size);
+
+        // A frame with a bad CRC, e.g. one RS could not correct, is treated as
+        // an erasure. The LDPC decoder cannot recover from corrupt symbols
+        if(inner_code != DXWIFI_FEC_INNER_NONE && !intact[i]) {
+            log_debug("Frame %d CRC mismatch, dropped", i);
+            continue;
+        }
+        if(oti_block(frame) != block) {
+            continue;
+        }
+
+        uint16_t esi = ntohs(frame->esi);
+        if(esi >= n) {
+            log_debug("Invalid ESI: %u, N: %u", esi, n);
+        } else if(!symbol_table[esi]) {
+            symbol_table[esi] = frame + 1;
+            nsource += esi < k;
+            nrepair += esi >= k;
+            DXWIFI_PROBE2(ldpc__symbol, esi, block);
+        }
+    }
+
+    // Without k symbols no decoder can recover the whole block
+    if(nsource + nrepair < k && !partial) {
+        DXWIFI_PROBE2(ldpc__done, block, false);
+        log_warning("Block %d has %u/%u symbols, too few to decode", block, nsource + nrepair, k);
+        return FEC_ERROR_DECODE_NOT_POSSIBLE;
+    }
+
+    // OpenFEC reads whole strides, so every symbol is copied to a padded slot.
+    // Source symbols go in their slot by ESI, repair symbols follow in order
+    void* symbols = alloc_symbol_table(k + nrepair, stride);
+    if(!symbols) {
+        return FEC_ERROR_OUT_OF_MEMORY;
+    }
+    bool received[k];
+    for(uint32_t esi = 0, repair = k; esi < n; ++esi) {
+        if(esi < k) {
+            received[esi] = symbol_table[esi] != NULL;
+        }
+        if(symbol_table[esi]) {
+            void* slot = offset(symbols, esi < k ? esi : repair++, stride);
+            memcpy(slot, symbol_table[esi], symbol_size);
+            symbol_table[esi] = slot;
+        }
+    }
+
+    // Nothing to decode when every source symbol arrived, otherwise IT
+    // decoding runs over the whole table and ML decoding only if that stalls
+    // with enough symbols left to solve the block
+    of_session_t* openfec_session = NULL;
+    bool decoded = nsource == k;
+
+    if(!decoded) {
+        int err = init_openfec(n, k, inner_code, OF_DECODER, &openfec_session);
+        if(err < 0) {
+            dxwifi_free(DXWIFI_MEM_FEC, symbols);
+            return err;
+        }
+        of_set_callback_functions(openfec_session, decoded_source_symbol_slot, NULL, symbols);
+        of_set_available_symbols(openfec_session, symbol_table);
+
+        decoded = of_is_decoding_complete(openfec_session);
+        if(!decoded) {
+            // Note which source symbols are known before ML decoding is attempted
+            of_get_source_symbols_tab(openfec_session, symbol_table);
+            for(uint16_t esi = 0; esi < k; ++esi) {
+                received[esi] = symbol_table[esi] != NULL;
+            }
+            if(nsource + nrepair >= k) {
+                decoded = finish_decoding(openfec_session, block, symbol_size);
+            }
+        }
+    }
+    DXWIFI_PROBE2(ldpc__done, block, decoded);
+
+    if(!decoded && !partial) {
+        dxwifi_free(DXWIFI_MEM_FEC, symbols);
+        of_release_codec_instance(openfec_session);
+        return FEC_ERROR_DECODE_NOT_POSSIBLE;
+    }
+
+    if(decoded && openfec_session) {
+        of_get_source_symbols_tab(openfec_session, symbol_table);
+    }
+    else if(!decoded) {
+        // Only the symbols that were received, or solved by iterative decoding
+        // in their slot, are known. The rest stay zeroed
+        for(uint16_t esi = 0; esi < k; ++esi) {
+            symbol_table[esi] = offset(symbols, esi, stride);
+        }
+    }
+
+    // Copy out the decoded message. Symbols solved by ML decoding are not in
+    // their slot and belong to us once the codec hands them out.
+    void* decoded_msg = NULL;
+    ssize_t decoded_size = gather_message(symbol_table, k, symbol_size, rem, &decoded_msg);
+
+    if(decoded) {
+        for(uint16_t esi = 0; esi < k; ++esi) {
+            if(symbol_table[esi] != offset(symbols, esi, stride)) {
+                dxwifi_free(DXWIFI_MEM_OPENFEC, symbol_table[esi]);
+            }
+        }
+    }
+    else {
+        size_t known = 0;
+        for(uint16_t esi = 0; esi < k; ++esi) {
+            known += received[esi];
+        }
+        log_warning("Block %d only partially decoded, %zu/%u source symbols recovered", block, known, k);
+    }
+
+    dxwifi_free(DXWIFI_MEM_FEC, symbols);
+    if(openfec_session) {
+        of_release_codec_instance(openfec_session);
+    }
+
+    if(decoded_size < 0) {
+        return decoded_size;
+    }
+    if(complete) {
+        *complete = decoded;
+    }
+    *out = decoded_msg;
+
+    return decoded_size;
+}
+
+
+// Decode a block, RS correcting errored frames only as it needs them. The
+// block is first tried with a few symbols past K, and again with every frame
+// that may belong to it corrected if that wasn't enough. Without the RS inner
+// code this is just decode_block
+static ssize_t demand_decode_block(rs_decode_job* rs, uint8_t* frames, size_t nframes, size_t frame_size, dxwifi_fec_inner_code_t inner_code, dxwifi_fec_block_t block, bool partial, bool* complete, void** out) {
+    if(!rs) {
+        return decode_block(frames, nframes, frame_size, NULL, inner_code, block, partial, complete, out);
+    }
+    rs_demand_frames(rs, block, false);
+
+    bool decoded = false;
+    ssize_t decoded_size = decode_block(frames, nframes, frame_size, rs->state, inner_code, block, partial, &decoded, out);
+
+    bool retry = decoded_size == FEC_ERROR_DECODE_NOT_POSSIBLE || decoded_size == FEC_ERROR_NO_OTI_FOUND || (decoded_size >= 0 && !decoded);
+    if(retry && !decode_cancelled(NULL) && rs_demand_frames(rs, block, true) > 0) {
+        log_info("Block %d needs more symbols, decoding again with every errored frame corrected", block);
+        if(decoded_size >= 0) {
+            dxwifi_free(DXWIFI_MEM_FEC, *out);
+            *out = NULL;
+        }
+        decoded = false;
+        decoded_size = decode_block(frames, nframes, frame_size, rs->state, inner_code, block, partial, &decoded, out);
+    }
+    if(complete) {
+        *complete = decoded;
+    }
+    return decoded_size;
+}
+
+
+// Copy the critical ranges carried by a decoded critical block over the bulk
+// message. The bulk message is allocated, zero filled, if it was never found
+static ssize_t apply_critical_block(const uint8_t* critical, size_t critical_size, void** bulk, ssize_t bulk_size) {
+    dxwifi_uep_hdr hdr;
+    if(critical_size < sizeof(hdr)) {
+        return bulk_size;
+    }
+    memcpy(&hdr, critical, sizeof(hdr));
+
+    size_t msglen  = ntohl(hdr.msglen);
+    size_t nranges = ntohs(hdr.count);
+    size_t data_offset = sizeof(hdr) + nranges * sizeof(dxwifi_priority_range);
+    if(data_offset > critical_size) {
+        log_warning("Malformed critical block, range table is truncated");
+        return bulk_size;
+    }
+
+    if(bulk_size < 0) {
+        *bulk = dxwifi_calloc(DXWIFI_MEM_FEC, msglen ? msglen : 1, 1);
+        if(!*bulk) {
+            return FEC_ERROR_OUT_OF_MEMORY;
+        }
+        bulk_size = msglen;
+    }
+    else if((size_t) bulk_size != msglen) {
+        log_warning("Critical block describes a %zu byte message, decoded %zd bytes", msglen, bulk_size);
+        return bulk_size;
+    }
+
+    const dxwifi_priority_range* ranges = (const dxwifi_priority_range*)(critical + sizeof(hdr));
+    for(size_t i = 0; i < nranges; ++i) {
+        dxwifi_priority_range range;
+        memcpy(&range, &ranges[i], sizeof(range));
+        range.offset = ntohl(range.offset);
+        range.length = ntohl(range.length);
+
+        if(range.offset > msglen || range.length > msglen - range.offset || range.length > critical_size - data_offset) {
+            log_warning("Malformed critical block, range %zu is out of bounds", i);
+            break;
+        }
+        memcpy((uint8_t*) *bulk + range.offset, critical + data_offset, range.length);
+        data_offset += range.length;
+    }
+    return bulk_size;
+}
+
+
+// Read an OTI header into host byte order
+static void unpack_oti(const void* frame, dxwifi_oti* oti) {
+    memcpy(oti, frame, sizeof(dxwifi_oti));
+
+    oti->esi = ntohs(oti->esi);
+    oti->n   = ntohs(oti->n);
+    oti->k   = ntohs(oti->k);
+    oti->rem = ntohs(oti->rem);
+    oti->crc = ntohl(oti->crc);
+}
+
+
+// Source symbols known to an estimator's decoder, received or rebuilt
+static uint32_t source_symbols_ready(of_session_t* openfec_session) {
+    uint32_t ready = 0;
+    of_get_control_parameter(openfec_session, OF_CRTL_LDPC_STAIRCASE_GET_NB_SOURCE_SYMBOLS_READY, &ready, sizeof(ready));
+    return ready;
+}
+
+
+//
+// See fec.h for non-static function descriptions
+//
+
+const char* dxwifi_fec_error_to_str(dxwifi_fec_error_t err) {
+    switch (err)
+    {
+    case FEC_ERROR_EXCEEDED_MAX_SYMBOLS:
+        return "N exceeds maximum number of symbols. Possible solution, decrease the coderate";
+
+    case FEC_ERROR_BELOW_N1_MIN:
+        return "N - K is below the N1 minimum. Possible solution, increase the coderate";
+
+    case FEC_ERROR_NO_OTI_FOUND:
+        return "No OTI Header found in the encoded message.";
+
+    case FEC_ERROR_DECODE_NOT_POSSIBLE:
+        return "Decode failed, not enough repair symbols";
+
+    case FEC_ERROR_OUT_OF_MEMORY:
+        return "Out of memory or over the memory budget";
+
+    case FEC_ERROR_DECODE_DEFERRED:
+        return "Decode deferred, ML decoding would exceed the decode budget";
+    
+    default:
+        return "Unknown error";
+    }
+}
+
+
+int dxwifi_check_frame(void* frame, dxwifi_fec_inner_code_t inner_code, dxwifi_oti* oti) {
+    debug_assert(frame && oti);
+
+    if(inner_code != DXWIFI_FEC_INNER_RS) {
+        const dxwifi_raw_ldpc_frame* raw = frame;
+        unpack_oti(frame, oti);
+        return crc32(raw->symbol, DXWIFI_FEC_RAW_SYMBOL_SIZE) == oti->crc ? 0 : -1;
+    }
+
+    dxwifi_rs_ldpc_frame* rs_ldpc_frame = frame;
+    dxwifi_ldpc_frame ldpc_frame;
+
+    int corrected = 0;
+    for(size_t i = 0; i < DXWIFI_RSCODE_BLOCKS_PER_FRAME; ++i) {
+        int count = rs_correct_errors((uint8_t*) &rs_ldpc_frame->blocks[i], RSCODE_MAX_LEN);
+        corrected += count == RS_UNCORRECTABLE ? 0 : count;
+        memcpy(offset(&ldpc_frame, i, RSCODE_MAX_MSG_LEN), rs_ldpc_frame->blocks[i].data, RSCODE_MAX_MSG_LEN);
+    }
+    unpack_oti(&ldpc_frame.oti, oti);
+
+    return crc32(ldpc_frame.symbol, DXWIFI_FEC_SYMBOL_SIZE) == oti->crc ? corrected : -1;
+}
+
+
+bool dxwifi_fec_estimator_init(dxwifi_fec_estimator* estimator, uint16_t n, uint16_t k) {
+    debug_assert(estimator);
+
+    memset(estimator, 0, sizeof(dxwifi_fec_estimator));
+
+    if(k == 0 || k >= n || n > OFEC_MAX_SYMBOLS) {
+        return false;
+    }
+
+    of_ldpc_parameters_t codec_params = ldpc_params(n, k, DXWIFI_FEC_ESTIMATOR_SYMBOL_SIZE);
+
+    of_session_t* openfec_session = NULL;
+    if(open_openfec(&codec_params, OF_DECODER, &openfec_session) < 0) {
+        return false;
+    }
+
+    // Same layout as decode_block, source slots indexed by ESI then a scratch
+    // slot for repair symbols. The stand-in symbols are never read
+    estimator->__session  = openfec_session;
+    estimator->__symbols  = alloc_symbol_table(k + 1, DXWIFI_FEC_ESTIMATOR_SYMBOL_SIZE);
+    estimator->__received = dxwifi_calloc(DXWIFI_MEM_FEC, (n + 7) / 8, sizeof(uint8_t));
+    if(!estimator->__symbols || !estimator->__received) {
+        dxwifi_fec_estimator_close(estimator);
+        return false;
+    }
+
+    of_set_callback_functions(openfec_session, decoded_source_symbol_slot, NULL, estimator->__symbols);
+
+    estimator->estimate.n     = n;
+    estimator->estimate.k     = k;
+    estimator->estimate.state = DXWIFI_DECODABILITY_UNLIKELY;
+    estimator->estimate.rank_deficit = k + DXWIFI_LDPC_ML_OVERHEAD;
+    return true;
+}
+
+
+void dxwifi_fec_estimator_close(dxwifi_fec_estimator* estimator) {
+    debug_assert(estimator);
+
+    if(estimator->__session) {
+        of_release_codec_instance(estimator->__session);
+    }
+    dxwifi_free(DXWIFI_MEM_FEC, estimator->__symbols);
+    dxwifi_free(DXWIFI_MEM_FEC, estimator->__received);
+    memset(estimator, 0, sizeof(dxwifi_fec_estimator));
+}
+
+
+bool dxwifi_fec_estimator_add(dxwifi_fec_estimator* estimator, uint16_t esi) {
+    debug_assert(estimator && estimator->__session);
+
+    dxwifi_fec_estimate* estimate = &estimator->estimate;
+
+    if(esi >= estimate->n || (estimator->__received[esi / 8] & (1 << (esi % 8)))) {
+        return false;
+    }
+    estimator->__received[esi / 8] |= 1 << (esi % 8);
+
+    void* slot = NULL;
+    if(esi < estimate->k) {
+        ++estimate->source_received;
+        slot = offset(estimator->__symbols, esi, DXWIFI_FEC_ESTIMATOR_SYMBOL_SIZE);
+    }
+    else {
+        ++estimate->repair_received;
+        slot = offset(estimator->__symbols, estimate->k, DXWIFI_FEC_ESTIMATOR_SYMBOL_SIZE);
+    }
+
+    dxwifi_decodability_t previous = estimate->state;
+
+    if(estimate->state == DXWIFI_DECODABILITY_COMPLETE) {
+        estimate->resolved = estimate->k - estimate->source_received;
+    }
+    else {
+        of_decode_with_new_symbol(estimator->__session, slot, esi);
+
+        estimate->resolved = source_symbols_ready(estimator->__session) - estimate->source_received;
+
+        // Iterative decoding only fails when the received symbols form stopping
+        // sets, ML decoding then needs about DXWIFI_LDPC_ML_OVERHEAD more than K
+        int received = estimate->source_received + estimate->repair_received;
+        int deficit  = estimate->k + DXWIFI_LDPC_ML_OVERHEAD - received;
+
+        if(of_is_decoding_complete(estimator->__session)) {
+            estimate->state        = DXWIFI_DECODABILITY_COMPLETE;
+            estimate->resolved     = estimate->k - estimate->source_received;
+            estimate->rank_deficit = 0;
+        }
+        else {
+            estimate->rank_deficit = deficit > 0 ? deficit : 0;
+            estimate->state        = deficit > 0 ? DXWIFI_DECODABILITY_UNLIKELY : DXWIFI_DECODABILITY_LIKELY;
+        }
+    }
+    return estimate->state != previous;
+}
+
+
+const char* dxwifi_decodability_to_str(dxwifi_decodability_t state) {
+    switch (state)
+    {
+    case DXWIFI_DECODABILITY_UNLIKELY:
+        return "unlikely";
+
+    case DXWIFI_DECODABILITY_LIKELY:
+        return "likely";
+
+    case DXWIFI_DECODABILITY_COMPLETE:
+        return "complete";
+
+    default:
+        return "unknown";
+    }
+}
+
+
+const char* dxwifi_fec_inner_code_to_str(dxwifi_fec_inner_code_t inner_code) {
+    switch (inner_code)
+    {
+    case DXWIFI_FEC_INNER_RS:
+        return "rs";
+
+    case DXWIFI_FEC_INNER_CRC:
+        return "crc";
+
+    case DXWIFI_FEC_INNER_NONE:
+        return "none";
+
+    default:
+        return NULL;
+    }
+}
+
+
+dxwifi_fec_inner_code_t dxwifi_fec_inner_code_from_str(const char* str) {
+    int code = DXWIFI_FEC_INNER_RS;
+    for(; code < DXWIFI_FEC_INNER_CODE_COUNT; ++code) {
+        if(strcmp(str, dxwifi_fec_inner_code_to_str(code)) == 0) {
+            break;
+        }
+    }
+    return code;
+}
+
+void dxwifi_fec_manifest(const void* message, size_t msglen, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_object_manifest* manifest) {
+    debug_assert(message && manifest);
+    debug_assert(0 <= inner_code && inner_code < DXWIFI_FEC_INNER_CODE_COUNT);
+
+    static const dxwifi_codec_t codecs[DXWIFI_FEC_INNER_CODE_COUNT] = {
+        [DXWIFI_FEC_INNER_RS]   = DXWIFI_CODEC_LDPC_RS,
+        [DXWIFI_FEC_INNER_CRC]  = DXWIFI_CODEC_LDPC_CRC,
+        [DXWIFI_FEC_INNER_NONE] = DXWIFI_CODEC_LDPC
+    };
+
+    manifest->object_id = 0;
+    manifest->size      = msglen;
+    manifest->hash      = crc32(message, msglen);
+    manifest->codec     = codecs[inner_code];
+    manifest->compression = DXWIFI_COMPRESSION_NONE;
+    symbol_counts(msglen, coderate, inner_code, &manifest->k, &manifest->n);
+}
+
+
+
+ssize_t dxwifi_encode(void* message, size_t msglen, float coderate, dxwifi_fec_inner_code_t inner_code, void** out) {
+    debug_assert(message && out);
+    debug_assert(0.0 < coderate && coderate <= 1.0);
+    debug_assert(0 <= inner_code && inner_code < DXWIFI_FEC_INNER_CODE_COUNT);
+
+    uint16_t k, n;
+    symbol_counts(msglen, coderate, inner_code, &k, &n);
+
+    ssize_t encoded_size = encode_block(message, msglen, k, n, inner_code, DXWIFI_FEC_BLOCK_BULK, out);
+    if(encoded_size >= 0) {
+        dxwifi_mem_release(DXWIFI_MEM_FEC, *out);
+    }
+    return encoded_size;
+}
+
+
+ssize_t dxwifi_encode_uep(void* message, size_t msglen, const dxwifi_priority_range* ranges, size_t nranges, float critical_coderate, float coderate, dxwifi_fec_inner_code_t inner_code, void** out) {
+    debug_assert(message && out && (ranges || nranges == 0));
+    debug_assert(0.0 < critical_coderate && critical_coderate <= 1.0);
+    debug_assert(nranges <= DXWIFI_UEP_MAX_RANGES);
+
+    // Gather the critical ranges behind a table describing where they go
+    size_t critical_size = sizeof(dxwifi_uep_hdr) + nranges * sizeof(dxwifi_priority_range);
+    for(size_t i = 0; i < nranges; ++i) {
+        debug_assert(ranges[i].offset <= msglen && ranges[i].length <= msglen - ranges[i].offset);
+        critical_size += ranges[i].length;
+    }
+    if(nranges == 0 || msglen > UINT32_MAX) {
+        return dxwifi_encode(message, msglen, coderate, inner_code, out);
+    }
+
+    uint8_t* critical = dxwifi_malloc(DXWIFI_MEM_FEC, critical_size);
+    if(!critical) {
+        return FEC_ERROR_OUT_OF_MEMORY;
+    }
+
+    dxwifi_uep_hdr hdr = {
+        .msglen = htonl(msglen),
+        .count  = htons(nranges)
+    };
+    memcpy(critical, &hdr, sizeof(hdr));
+
+    size_t data_offset = sizeof(hdr) + nranges * sizeof(dxwifi_priority_range);
+    for(size_t i = 0; i < nranges; ++i) {
+        dxwifi_priority_range range = {
+            .offset = htonl(ranges[i].offset),
+            .length = htonl(ranges[i].length)
+        };
+        memcpy(critical + sizeof(hdr) + i * sizeof(range), &range, sizeof(range));
+        memcpy(critical + data_offset, (uint8_t*) message + ranges[i].offset, ranges[i].length);
+        data_offset += ranges[i].length;
+    }
+
+    uint16_t k, n;
+    symbol_counts(critical_size, critical_coderate, inner_code, &k, &n);
+    log_info("Critical block: %zu bytes in %zu ranges, K: %u, N: %u", critical_size, nranges, k, n);
+
+    void* critical_frames = NULL;
+    ssize_t critical_frames_size = encode_block(critical, critical_size, k, n, inner_code, DXWIFI_FEC_BLOCK_CRITICAL, &critical_frames);
+    dxwifi_free(DXWIFI_MEM_FEC, critical);
+    if(critical_frames_size < 0) {
+        return critical_frames_size;
+    }
+
+    symbol_counts(msglen, coderate, inner_code, &k, &n);
+
+    void* bulk_frames = NULL;
+    ssize_t bulk_frames_size = encode_block(message, msglen, k, n, inner_code, DXWIFI_FEC_BLOCK_BULK, &bulk_frames);
+    if(bulk_frames_size < 0) {
+        dxwifi_free(DXWIFI_MEM_FEC, critical_frames);
+        return bulk_frames_size;
+    }
+
+    // The first copy of the critical block goes ahead of the message so it is
+    // on air early, the others are spread through it so one burst of loss 
+    // can't take out every copy. Duplicate frames are ignored by the decoder
+    size_t nbulk = bulk_frames_size / DXWIFI_RS_LDPC_FRAME_SIZE;
+    size_t encoded_size = DXWIFI_UEP_CRITICAL_COPIES * critical_frames_size + bulk_frames_size;
+
+    uint8_t* encoded = dxwifi_malloc(DXWIFI_MEM_FEC, encoded_size);
+    if(!encoded) {
+        dxwifi_free(DXWIFI_MEM_FEC, critical_frames);
+        dxwifi_free(DXWIFI_MEM_FEC, bulk_frames);
+        return FEC_ERROR_OUT_OF_MEMORY;
+    }
+
+    uint8_t* pos = encoded;
+    size_t sent = 0;
+    for(size_t copy = 0; copy < DXWIFI_UEP_CRITICAL_COPIES; ++copy) {
+        size_t until = copy * nbulk / DXWIFI_UEP_CRITICAL_COPIES;
+        memcpy(pos, offset(bulk_frames, sent, DXWIFI_RS_LDPC_FRAME_SIZE), (until - sent) * DXWIFI_RS_LDPC_FRAME_SIZE);
+        pos += (until - sent) * DXWIFI_RS_LDPC_FRAME_SIZE;
+        sent = until;
+
+        memcpy(pos, critical_frames, critical_frames_size);
+        pos += critical_frames_size;
+    }
+    memcpy(pos, offset(bulk_frames, sent, DXWIFI_RS_LDPC_FRAME_SIZE), (nbulk - sent) * DXWIFI_RS_LDPC_FRAME_SIZE);
+
+    dxwifi_free(DXWIFI_MEM_FEC, critical_frames);
+    dxwifi_free(DXWIFI_MEM_FEC, bulk_frames);
+
+    dxwifi_mem_release(DXWIFI_MEM_FEC, encoded);
+    *out = encoded;
+    return encoded_size;
+}
+
+int dxwifi_fountain_init(dxwifi_fountain_encoder* encoder, const void* message, size_t msglen, dxwifi_fec_inner_code_t inner_code) {
+    debug_assert(encoder && message && msglen > 0);
+    debug_assert(0 <= inner_code && inner_code < DXWIFI_FEC_INNER_CODE_COUNT);
+
+    memset(encoder, 0, sizeof(dxwifi_fountain_encoder));
+
+    size_t symbol_size = inner_code_symbol_size(inner_code);
+    size_t stride      = DXWIFI_FEC_STRIDE(symbol_size);
+    size_t k           = (msglen + symbol_size - 1) / symbol_size;
+
+    if(k > DXWIFI_FOUNTAIN_MAX_K) {
+        return FEC_ERROR_EXCEEDED_MAX_SYMBOLS;
+    }
+    if(!raptor_init(&encoder->code, k)) {
+        return FEC_ERROR_OUT_OF_MEMORY;
+    }
+    encoder->inner_code = inner_code;
+    encoder->rem        = msglen % symbol_size;
+
+    // The message is only needed as padded source symbols until the 
+    // intermediate symbols are solved
+    void* source     = alloc_symbol_table(k, stride);
+    void** table     = dxwifi_malloc(DXWIFI_MEM_FEC, k * sizeof(void*));
+    encoder->__symbols = alloc_symbol_table(encoder->code.l, stride);
+    encoder->__table   = dxwifi_malloc(DXWIFI_MEM_FEC, encoder->code.l * sizeof(void*));
+
+    bool precoded = false;
+    if(source && table && encoder->__symbols && encoder->__table) {
+        for(size_t esi = 0; esi < k; ++esi) {
+            size_t len = (esi == k - 1 && encoder->rem) ? encoder->rem : symbol_size;
+            table[esi] = offset(source, esi, stride);
+            memcpy(table[esi], (const uint8_t*) message + esi * symbol_size, len);
+        }
+        for(uint32_t c = 0; c < encoder->code.l; ++c) {
+            encoder->__table[c] = offset(encoder->__symbols, c, stride);
+        }
+        precoded = raptor_precode(&encoder->code, table, encoder->__table, stride);
+    }
+    dxwifi_free(DXWIFI_MEM_FEC, source);
+    dxwifi_free(DXWIFI_MEM_FEC, table);
+
+    if(!precoded) {
+        dxwifi_fountain_close(encoder);
+        return FEC_ERROR_OUT_OF_MEMORY;
+    }
+    log_info("Fountain: K: %u, S: %u, H: %u, systematic index: %u", encoder->code.k, encoder->code.s, encoder->code.h, encoder->code.j);
+    return 0;
+}
+
+
+ssize_t dxwifi_fountain_encode(dxwifi_fountain_encoder* encoder, size_t nframes, void** out) {
+    debug_assert(encoder && encoder->__table && out);
+
+    void* frames = dxwifi_calloc(DXWIFI_MEM_FEC, nframes ? nframes : 1, DXWIFI_RS_LDPC_FRAME_SIZE);
+    if(!frames) {
+        return FEC_ERROR_OUT_OF_MEMORY;
+    }
+
+    fountain_job job = {
+        .encoder    = encoder,
+        .frames     = frames,
+        .first      = encoder->next_esi
+    };
+    dxwifi_parallel_for(nframes, ENCODE_GRAIN, encode_fountain_frames, &job);
+
+    encoder->next_esi = fountain_esi(encoder->code.k, encoder->next_esi, nframes);
+
+    dxwifi_mem_release(DXWIFI_MEM_FEC, frames);
+    *out = frames;
+    return nframes * DXWIFI_RS_LDPC_FRAME_SIZE;
+}
+
+
+void dxwifi_fountain_close(dxwifi_fountain_encoder* encoder) {
+    debug_assert(encoder);
+
+    raptor_close(&encoder->code);
+    dxwifi_free(DXWIFI_MEM_FEC, encoder->__symbols);
+    dxwifi_free(DXWIFI_MEM_FEC, encoder->__table);
+    memset(encoder, 0, sizeof(dxwifi_fountain_encoder));
+}
+
+
+ssize_t dxwifi_encode_fountain(void* message, size_t msglen, float coderate, dxwifi_fec_inner_code_t inner_code, void** out) {
+    debug_assert(message && out);
+    debug_assert(0.0 < coderate && coderate <= 1.0);
+
+    dxwifi_fountain_encoder encoder;
+    int err = dxwifi_fountain_init(&encoder, message, msglen, inner_code);
+    if(err < 0) {
+        return err;
+    }
+
+    ssize_t encoded_size = dxwifi_fountain_encode(&encoder, encoder.code.k / coderate, out);
+
+    dxwifi_fountain_close(&encoder);
+    return encoded_size;
+}
+
+
+void dxwifi_fountain_manifest(const void* message, size_t msglen, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_object_manifest* manifest) {
+    static const dxwifi_codec_t codecs[DXWIFI_FEC_INNER_CODE_COUNT] = {
+        [DXWIFI_FEC_INNER_RS]   = DXWIFI_CODEC_FOUNTAIN_RS,
+        [DXWIFI_FEC_INNER_CRC]  = DXWIFI_CODEC_FOUNTAIN_CRC,
+        [DXWIFI_FEC_INNER_NONE] = DXWIFI_CODEC_FOUNTAIN
+    };
+
+    dxwifi_fec_manifest(message, msglen, coderate, inner_code, manifest);
+    manifest->codec = codecs[inner_code];
+}
+
+
+void dxwifi_fec_set_decode_budget(double seconds) {
+    decode_budget = seconds > 0 ? seconds : 0;
+}
+
+
+ssize_t dxwifi_decode(void* encoded_msg, size_t msglen, void** out) {
+    debug_assert(encoded_msg && out);
+
+    if( msglen % DXWIFI_RS_LDPC_FRAME_SIZE != 0) {
+        log_warning("Misaligned, msglen (%u) is not divisible by RS-LDPC frame size");
+    }
+
+    size_t nframes = msglen / DXWIFI_RS_LDPC_FRAME_SIZE;
+
+    DXWIFI_PROBE1(decode__start, nframes);
+
+    decode_deadline = decode_budget > 0 ? thread_cpu_seconds() + decode_budget : 0;
+    decode_deferred = false;
+
+    dxwifi_fec_inner_code_t inner_code = detect_inner_code(encoded_msg, nframes);
+
+    // Each frame is an OTI followed by its symbol. With the RS inner code the 
+    // frames are decoded into a new array, otherwise they are read in place
+    dxwifi_ldpc_frame* ldpc_frames = NULL;
+    uint8_t* frames     = encoded_msg;
+    size_t   frame_size = sizeof(dxwifi_raw_ldpc_frame);
+
+    rs_decode_job  rs_job;
+    rs_decode_job* rs = NULL;
+
+    if(inner_code == DXWIFI_FEC_INNER_RS) {
+        ldpc_frames = rs_check_frames(encoded_msg, nframes, &rs_job);
+        rs = &rs_job;
+        if(!ldpc_frames) {
+            DXWIFI_PROBE1(decode__done, FEC_ERROR_OUT_OF_MEMORY);
+            return FEC_ERROR_OUT_OF_MEMORY;
+        }
+        frames      = (uint8_t*) ldpc_frames;
+        frame_size  = sizeof(dxwifi_ldpc_frame);
+    }
+
+    // A critical block only matters when the bulk of the message can't be
+    // decoded, it then patches the critical ranges into what was recovered.
+    // Frames whose OTI is still errored may turn out to be critical once
+    // corrected, until then the bulk block is decoded as if there were some
+    bool has_critical = false;
+    bool oti_unknown  = false;
+    for(size_t i = 0; i < nframes && !has_critical; ++i) {
+        if(rs && !rs_oti_known(rs, i)) {
+            oti_unknown = true;
+            continue;
+        }
+        has_critical = oti_block(offset(frames, i, frame_size)) == DXWIFI_FEC_BLOCK_CRITICAL;
+    }
+
+    void* decoded_msg = NULL;
+    bool complete = false;
+    ssize_t decoded_size = demand_decode_block(rs, frames, nframes, frame_size, inner_code, DXWIFI_FEC_BLOCK_BULK, has_critical || oti_unknown, &complete, &decoded_msg);
+
+    if(!complete && !has_critical && oti_unknown) {
+        for(size_t i = 0; i < nframes && !has_critical; ++i) {
+            has_critical = rs_oti_known(rs, i) && oti_block(offset(frames, i, frame_size)) == DXWIFI_FEC_BLOCK_CRITICAL;
+        }
+        if(!has_critical && decoded_size >= 0) {
+            dxwifi_free(DXWIFI_MEM_FEC, decoded_msg);
+            decoded_msg  = NULL;
+            decoded_size = FEC_ERROR_DECODE_NOT_POSSIBLE;
+        }
+    }
+
+    if(has_critical && !complete) {
+        void* critical = NULL;
+        ssize_t critical_size = demand_decode_block(rs, frames, nframes, frame_size, inner_code, DXWIFI_FEC_BLOCK_CRITICAL, false, NULL, &critical);
+
+        if(critical_size > 0) {
+            log_warning("Message could not be fully decoded, critical ranges recovered");
+            decoded_size = apply_critical_block(critical, critical_size, &decoded_msg, decoded_size);
+            dxwifi_free(DXWIFI_MEM_FEC, critical);
+        }
+        else {
+            // Without its critical ranges a partial message isn't usable
+            dxwifi_free(DXWIFI_MEM_FEC, decoded_msg);
+            decoded_msg  = NULL;
+            decoded_size = decoded_size < 0 ? decoded_size : FEC_ERROR_DECODE_NOT_POSSIBLE;
+        }
+    }
+    if(rs) {
+        rs_finish_frames(rs);
+    }
+    dxwifi_free(DXWIFI_MEM_FEC, ldpc_frames);
+    decode_deadline = 0;
+
+    if(decoded_size == FEC_ERROR_DECODE_NOT_POSSIBLE && decode_deferred) {
+        decoded_size = FEC_ERROR_DECODE_DEFERRED;
+    }
+    if(decoded_size >= 0) {
+        dxwifi_mem_release(DXWIFI_MEM_FEC, decoded_msg);
+        *out = decoded_msg;
+    }
+    DXWIFI_PROBE1(decode__done, decoded_size);
+
+    return decoded_size;
 }
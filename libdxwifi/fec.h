@@ -18,7 +18,9 @@
 
 #include <ldpc_staircase/of_codec_profile.h>
 
+#include <libdxwifi/dxwifi.h>
 #include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/raptor.h>
 
 /************************
  *  Constants
@@ -39,15 +41,104 @@
 // Total size of the LDPC encoded symbol with RS encoding and OTI
 #define DXWIFI_RS_LDPC_FRAME_SIZE ((DXWIFI_RSCODE_BLOCKS_PER_FRAME * RSCODE_NPAR) + DXWIFI_LDPC_FRAME_SIZE)
 
+// Size in bytes of each symbol when there is no RS inner code. The symbol takes
+// the room of the RS parity so frames stay DXWIFI_RS_LDPC_FRAME_SIZE on air
+#define DXWIFI_FEC_RAW_SYMBOL_SIZE (DXWIFI_RS_LDPC_FRAME_SIZE - sizeof(dxwifi_oti))
+
+// Symbols are kept in aligned buffers padded to a multiple of the alignment 
+// while they are in the codec. The padding is always zero and never transmitted
+#define DXWIFI_FEC_SYMBOL_ALIGN 64
+#define DXWIFI_FEC_STRIDE(size) (((size) + DXWIFI_FEC_SYMBOL_ALIGN - 1) & ~(DXWIFI_FEC_SYMBOL_ALIGN - 1))
+#define DXWIFI_FEC_SYMBOL_STRIDE DXWIFI_FEC_STRIDE(DXWIFI_FEC_SYMBOL_SIZE)
+#define DXWIFI_FEC_RAW_SYMBOL_STRIDE DXWIFI_FEC_STRIDE(DXWIFI_FEC_RAW_SYMBOL_SIZE)
+
+// The two most significant bits of the OTI rem field carry the inner code, and
+// the next bit the source block the frame belongs to
+#define DXWIFI_OTI_INNER_CODE_SHIFT 14
+#define DXWIFI_OTI_BLOCK_SHIFT 13
+#define DXWIFI_OTI_REM_MASK ((1 << DXWIFI_OTI_BLOCK_SHIFT) - 1)
+
+// Max number of critical ranges in an unequal error protection encoding
+#define DXWIFI_UEP_MAX_RANGES 16
+
+// Default coderate of the critical block
+#define DXWIFI_UEP_DFLT_CODERATE 0.25
+
+// Number of times the encoded critical block is sent. Critical blocks are often
+// a single symbol where the staircase code does little better than repetition
+#define DXWIFI_UEP_CRITICAL_COPIES 2
+
 // https://tools.ietf.org/html/rfc6816 - N1 definition
 #define DXWIFI_LDPC_N1_MAX 10
 #define DXWIFI_LDPC_N1_MIN 3
 
+// Symbols beyond K that ML decoding needs for ~95% of blocks to decode. It's
+// about the same for any K or coderate
+#define DXWIFI_LDPC_ML_OVERHEAD 6
+
+// Size of the stand-in symbols fed to the decodability estimator's decoder,
+// only the structure of the code matters to it
+#define DXWIFI_FEC_ESTIMATOR_SYMBOL_SIZE 8
+
+// A fountain has no fixed number of symbols, its frames carry N = 0 in the OTI
+#define DXWIFI_FOUNTAIN_OTI_N 0
+
+// Max number of source symbols of a fountain coded message. ESIs are 16 bits, 
+// so this leaves at least as many repair symbols as source symbols
+#define DXWIFI_FOUNTAIN_MAX_K RAPTOR_MAX_K
+
 
 /************************
  *  Data structures
  ***********************/
 
+/**
+ *  Inner code protecting each LDPC frame on air. RS corrects bit errors at the 
+ *  cost of RSCODE_NPAR bytes per block, the other modes trade that protection 
+ *  for a larger symbol when the link is good.
+ */
+typedef enum {
+    DXWIFI_FEC_INNER_RS     = 0,    /* RS encoded blocks, see dxwifi_rs_ldpc_frame  */
+    DXWIFI_FEC_INNER_CRC    = 1,    /* Frames failing the OTI CRC become erasures   */
+    DXWIFI_FEC_INNER_NONE   = 2,    /* Every frame is handed to the LDPC decoder    */
+    DXWIFI_FEC_INNER_CODE_COUNT
+} dxwifi_fec_inner_code_t;
+
+
+/**
+ *  Source block a frame belongs to. Unequal error protection sends the critical
+ *  ranges of a message as a separate, more heavily protected, source block.
+ */
+typedef enum {
+    DXWIFI_FEC_BLOCK_BULK       = 0,    /* The whole message                    */
+    DXWIFI_FEC_BLOCK_CRITICAL   = 1,    /* Copies of the critical ranges        */
+} dxwifi_fec_block_t;
+
+
+/**
+ *  A range of the message that is critical for it to be usable, such as an
+ *  image header. Host byte order when passed to dxwifi_encode_uep.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t offset;    /* Offset of the range in the message   */
+    uint32_t length;    /* Length of the range in bytes         */
+} dxwifi_priority_range;
+
+
+/**
+ *  The critical block is laid out as
+ *
+ *      [ dxwifi_uep_hdr ][ dxwifi_priority_range ] ... [ range data ] ...
+ *
+ *  All fields are in network byte order.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t msglen;    /* Size of the whole message            */
+    uint16_t count;     /* Number of ranges that follow         */
+} dxwifi_uep_hdr;
+compiler_assert(sizeof(dxwifi_uep_hdr) == 6, "Mismatch in actual UEP header size and calculated size");
+
+
 /** 
  *  The OTI header (Object Transmission Info) stores important parameters 
  *  regarding how the message was encoded. Since these parameters are critical
@@ -58,11 +149,12 @@ typedef struct __attribute__((packed)) {
     uint16_t esi;   /* Encoding Symbol ID           */
     uint16_t n;     /* Total number of symbols      */
     uint16_t k;     /* Number of source symbols     */
-    uint16_t rem;   /* Length of Kth symbol         */
+    uint16_t rem;   /* Length of Kth symbol and inner code */
     uint32_t crc;   /* Computed CRC of the symbol   */
 } dxwifi_oti; 
 compiler_assert(sizeof(dxwifi_oti) == 12, "Mismatch in actual OTI size and calculated size");
 compiler_assert(65536 > OFEC_MAX_SYMBOLS, "Max number of symbols exceed storage capacity of uint16_t");
+compiler_assert(DXWIFI_FEC_RAW_SYMBOL_SIZE <= DXWIFI_OTI_REM_MASK, "Symbol size exceeds storage capacity of the OTI rem field");
 
 
 /**
@@ -100,6 +192,18 @@ typedef struct __attribute__((packed)) {
 compiler_assert(sizeof(dxwifi_rs_ldpc_frame) == DXWIFI_RS_LDPC_FRAME_SIZE, "Mismatch in actual RS-LDPC Frame size and calculated size");
 
 
+/**
+ *  Without the RS inner code the LDPC frame is sent as is, with a symbol of
+ *  size `DXWIFI_FEC_RAW_SYMBOL_SIZE` so that it fills the whole payload.
+ */
+typedef struct __attribute__((packed)) {
+    dxwifi_oti oti;     /* Object Transmission Info */
+    uint8_t symbol[DXWIFI_FEC_RAW_SYMBOL_SIZE]; 
+                        /* Actual symbol data       */
+} dxwifi_raw_ldpc_frame;
+compiler_assert(sizeof(dxwifi_raw_ldpc_frame) == DXWIFI_RS_LDPC_FRAME_SIZE, "Mismatch in actual raw LDPC Frame size and calculated size");
+
+
 /**
  *  FEC error status codes
  */
@@ -108,8 +212,65 @@ typedef enum {
     FEC_ERROR_BELOW_N1_MIN          = -2,
     FEC_ERROR_NO_OTI_FOUND          = -3,
     FEC_ERROR_DECODE_NOT_POSSIBLE   = -4,
+    FEC_ERROR_OUT_OF_MEMORY         = -5,
+    FEC_ERROR_DECODE_DEFERRED       = -6,
 } dxwifi_fec_error_t;
 
+/**
+ *  How likely a source block is to decode with the symbols received so far
+ */
+typedef enum {
+    DXWIFI_DECODABILITY_UNLIKELY    = 0,    /* More symbols are needed                  */
+    DXWIFI_DECODABILITY_LIKELY      = 1,    /* Enough symbols for ML decoding           */
+    DXWIFI_DECODABILITY_COMPLETE    = 2     /* Iterative decoding recovered every source 
+                                               symbol already                           */
+} dxwifi_decodability_t;
+
+
+/**
+ *  Running estimate of a source block's decodability
+ */
+typedef struct {
+    uint16_t    n;                  /* Total number of symbols                      */
+    uint16_t    k;                  /* Number of source symbols                     */
+    uint16_t    source_received;    /* Distinct source symbols received             */
+    uint16_t    repair_received;    /* Distinct repair symbols received             */
+    uint16_t    resolved;           /* Source symbols rebuilt by iterative decoding */
+    uint16_t    rank_deficit;       /* Estimated symbols still needed               */
+    dxwifi_decodability_t state;
+} dxwifi_fec_estimate;
+
+
+/**
+ *  Tracks decodability as symbols arrive by running the iterative decoder on
+ *  stand-in symbols. The code's structure only depends on N and K, so the
+ *  decoder resolves exactly the symbols the real decoder would without the
+ *  cost of the real symbols.
+ */
+typedef struct {
+    dxwifi_fec_estimate estimate;   /* Current estimate                     */
+    uint8_t*    __received;         /* Bitmap of the ESIs received          */
+    uint8_t*    __symbols;          /* Stand-in source symbols and scratch  */
+    void*       __session;          /* OpenFEC decoder                      */
+} dxwifi_fec_estimator;
+
+
+/**
+ *  Streams the fountain coded frames of a message. The first K frames carry 
+ *  the source symbols, every frame after that a repair symbol that was never
+ *  sent before. Once the 16 bit ESIs run out they wrap around to the first
+ *  repair symbol.
+ */
+typedef struct {
+    raptor_code code;               /* Raptor code for K                    */
+    dxwifi_fec_inner_code_t inner_code;
+    uint16_t    rem;                /* Length of the Kth symbol             */
+    uint16_t    next_esi;           /* ESI of the next frame                */
+    uint8_t*    __symbols;          /* Intermediate symbols, padded         */
+    void**      __table;            /* Pointer to each intermediate symbol  */
+} dxwifi_fountain_encoder;
+
+
 /************************
  *  Functions
  ***********************/
@@ -126,6 +287,8 @@ typedef enum {
  *
  *      coderate:       Rate at which to add repair symbols for each source symbol
  * 
+ *      inner_code:     Code protecting each LDPC frame, signaled in the OTI
+ * 
  *      out:            Pointer to a void pointer which will contain the encoded
  *                      message on function return. 
  * 
@@ -140,12 +303,224 @@ typedef enum {
  *      the out parameter.
  * 
  */
-ssize_t dxwifi_encode(void *message, size_t msglen, float coderate, void **out);
+ssize_t dxwifi_encode(void *message, size_t msglen, float coderate, dxwifi_fec_inner_code_t inner_code, void **out);
+
+
+/**
+ *  DESCRIPTION:        FEC Encodes a message with unequal error protection
+ * 
+ *  ARGUMENTS:
+ *      
+ *      message:        Message data to be encoded
+ * 
+ *      msglen:         Size of the message in bytes
+ *
+ *      ranges:         Critical ranges of the message, see priority.h to find
+ *                      them automatically
+ *
+ *      nranges:        Number of ranges, at most DXWIFI_UEP_MAX_RANGES
+ *
+ *      critical_coderate:
+ *                      Coderate of the critical block, lower than the coderate
+ *                      of the message for it to be any better protected
+ *
+ *      coderate:       Coderate of the whole message
+ * 
+ *      inner_code:     Code protecting each LDPC frame, signaled in the OTI
+ * 
+ *      out:            Pointer to a void pointer which will contain the encoded
+ *                      message on function return. 
+ * 
+ *  RETURNS:
+ * 
+ *      ssize_t:         Size of the encoded message in bytes or dxwifi_fec_error
+ * 
+ *  NOTES:
+ * 
+ *      The critical ranges are copied into a separate source block that is
+ *      encoded at the critical coderate. It is placed ahead of the message, so
+ *      it is sent first, and repeated DXWIFI_UEP_CRITICAL_COPIES times through
+ *      the message. The message itself is encoded exactly as dxwifi_encode
+ *      would. When the message can't be decoded, dxwifi_decode falls back to 
+ *      the source symbols it did get with the critical ranges patched in. With
+ *      no ranges this is the same as dxwifi_encode.
+ * 
+ */
+ssize_t dxwifi_encode_uep(void* message, size_t msglen, const dxwifi_priority_range* ranges, size_t nranges, float critical_coderate, float coderate, dxwifi_fec_inner_code_t inner_code, void** out);
+
+
+/**
+ *  DESCRIPTION:        Sets up a fountain encoder for a message
+ * 
+ *  ARGUMENTS:
+ *      
+ *      encoder:        Pointer to an allocated encoder object
+ * 
+ *      message:        Message data to be encoded, not referenced after this
+ *                      returns
+ * 
+ *      msglen:         Size of the message in bytes, at least one
+ * 
+ *      inner_code:     Code protecting each frame, signaled in the OTI
+ * 
+ *  RETURNS:
+ * 
+ *      int:            0 or a dxwifi_fec_error
+ * 
+ *  NOTES: All of the encoding work is done here, solving the intermediate 
+ *  symbols costs about as much as decoding the message. Frames are then cheap
+ *  to make in any number.
+ * 
+ */
+int dxwifi_fountain_init(dxwifi_fountain_encoder* encoder, const void* message, size_t msglen, dxwifi_fec_inner_code_t inner_code);
+
+
+/**
+ *  DESCRIPTION:        Encodes the next frames of a message
+ * 
+ *  ARGUMENTS:
+ *      
+ *      encoder:        Pointer to an initialized encoder object
+ * 
+ *      nframes:        Number of frames to encode
+ * 
+ *      out:            Pointer to a void pointer which will contain the frames
+ *                      on function return
+ * 
+ *  RETURNS:
+ * 
+ *      ssize_t:        Size of the frames in bytes or dxwifi_fec_error
+ * 
+ *  NOTES: It is the users responsibility to free the frames. Frames from 
+ *  every call can be decoded together by dxwifi_decode, in any order, and any 
+ *  K or a few more distinct ones are enough to rebuild the message.
+ * 
+ */
+ssize_t dxwifi_fountain_encode(dxwifi_fountain_encoder* encoder, size_t nframes, void** out);
+
+
+/**
+ *  DESCRIPTION:        Tears down any resources associated with the encoder
+ * 
+ *  ARGUMENTS:
+ *      
+ *      encoder:        Pointer to an initialized encoder object
+ * 
+ */
+void dxwifi_fountain_close(dxwifi_fountain_encoder* encoder);
+
+
+/**
+ *  DESCRIPTION:        Fountain encodes a message, the fountain counterpart of
+ *                      dxwifi_encode
+ * 
+ *  ARGUMENTS:
+ *      
+ *      message:        Message data to be encoded
+ * 
+ *      msglen:         Size of the message in bytes
+ *
+ *      coderate:       Sets how many frames are made, K / coderate
+ * 
+ *      inner_code:     Code protecting each frame, signaled in the OTI
+ * 
+ *      out:            Pointer to a void pointer which will contain the encoded
+ *                      message on function return
+ * 
+ *  RETURNS:
+ * 
+ *      ssize_t:        Size of the encoded message in bytes or dxwifi_fec_error
+ * 
+ *  NOTES: Same as the first frames of a dxwifi_fountain_encoder. Use the
+ *  encoder directly to keep sending fresh repair symbols after these.
+ * 
+ */
+ssize_t dxwifi_encode_fountain(void* message, size_t msglen, float coderate, dxwifi_fec_inner_code_t inner_code, void** out);
+
+
+/**
+ *  DESCRIPTION:        Describes the object dxwifi_encode would produce for a
+ *                      message, for announcing it in control frames
+ * 
+ *  ARGUMENTS:
+ *      
+ *      message:        Message data to be encoded
+ * 
+ *      msglen:         Size of the message in bytes
+ *
+ *      coderate:       Rate at which to add repair symbols for each source symbol
+ * 
+ *      inner_code:     Code protecting each LDPC frame
+ * 
+ *      manifest:       Filled with the size, hash, symbol counts and codec of 
+ *                      the object. The object id is set to zero
+ * 
+ */
+void dxwifi_fec_manifest(const void* message, size_t msglen, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_object_manifest* manifest);
+
+
+/**
+ *  DESCRIPTION:        Describes one pass of a fountain coded message, the 
+ *                      fountain counterpart of dxwifi_fec_manifest
+ * 
+ *  ARGUMENTS:
+ *      
+ *      See dxwifi_fec_manifest
+ * 
+ *  NOTES: N is the number of frames per pass, K / coderate. A fountain has no
+ *  fixed N, it only tells the receiver how many frames to expect.
+ * 
+ */
+void dxwifi_fountain_manifest(const void* message, size_t msglen, float coderate, dxwifi_fec_inner_code_t inner_code, dxwifi_object_manifest* manifest);
+
+
+/**
+ *  DESCRIPTION:    Sets the CPU time ML decoding may take per message
+ * 
+ *  ARGUMENTS:
+ * 
+ *      seconds:    CPU seconds of the thread calling dxwifi_decode, counted
+ *                  from the start of the call. 0 for no limit, the default
+ * 
+ *  NOTES: Applies to every later call to dxwifi_decode, from any thread. 
+ *  Before ML decoding a block its cost is predicted from the system iterative
+ *  decoding left, and the block is deferred if that doesn't fit in what is 
+ *  left of the budget, or if its dense core is unlikely to have full rank.
+ *  ML decoding that overruns the budget anyway is cancelled.
+ * 
+ */
+void dxwifi_fec_set_decode_budget(double seconds);
 
 
 /**
  *  DESCRIPTION:  TODO
  * 
+ *  NOTES:
+ * 
+ *      The inner code is taken from the majority of the OTI headers so that a 
+ *      few corrupted frames cannot change how the whole message is decoded.
+ *
+ *      Messages encoded with dxwifi_encode_uep that can't be fully decoded 
+ *      are still returned if their critical block decodes. Missing symbols are
+ *      zero filled and the critical ranges are restored.
+ *
+ *      The symbols of each block are handed to the LDPC decoder all at once.
+ *      No decoder runs when every source symbol arrived, and ML decoding is
+ *      only tried when iterative decoding stalls with at least k symbols.
+ *      Even then it's skipped if the unknowns left outnumber the equations
+ *      that could solve them. Messages left undecoded because of the decode
+ *      budget fail with FEC_ERROR_DECODE_DEFERRED, they may decode without it.
+ *
+ *      Fountain coded messages, those with N = 0 in the OTI, are told apart 
+ *      by their OTI and decoded with the Raptor decoder instead.
+ *
+ *      With the RS inner code every frame is only checked for errors at
+ *      first. Errored frames are corrected while a block has fewer than 
+ *      K + 20% distinct intact symbols, and all of them are if it still 
+ *      doesn't decode. Those not needed are never corrected, so the more
+ *      frames were received past what the object needs the less RS decoding
+ *      is done.
+ * 
  */
 ssize_t dxwifi_decode(void* encoded_message, size_t msglen, void** out);
 
@@ -156,4 +531,125 @@ ssize_t dxwifi_decode(void* encoded_message, size_t msglen, void** out);
  */
 const char* dxwifi_fec_error_to_str(dxwifi_fec_error_t err);
 
+
+/**
+ *  DESCRIPTION:    Corrects a single frame with its inner code and checks its
+ *                  symbol against the CRC in the OTI
+ * 
+ *  ARGUMENTS:
+ * 
+ *      frame:      DXWIFI_RS_LDPC_FRAME_SIZE bytes, corrected in place
+ * 
+ *      inner_code: Inner code the frame was encoded with
+ * 
+ *      oti:        Filled with the frame's OTI in host byte order
+ * 
+ *  RETURNS:
+ * 
+ *      int:        Number of bytes the RS inner code corrected or -1 if the
+ *                  symbol failed its CRC
+ * 
+ *  NOTES: The RS inner code is systematic, a corrected frame is still a valid 
+ *  RS-LDPC frame.
+ * 
+ */
+int dxwifi_check_frame(void* frame, dxwifi_fec_inner_code_t inner_code, dxwifi_oti* oti);
+
+
+/**
+ *  DESCRIPTION:    Starts estimating the decodability of a source block
+ * 
+ *  ARGUMENTS:
+ * 
+ *      estimator:  Pointer to an allocated estimator object
+ * 
+ *      n:          Total number of symbols
+ * 
+ *      k:          Number of source symbols
+ * 
+ *  RETURNS:
+ * 
+ *      bool:       False if N and K don't describe an LDPC code
+ * 
+ */
+bool dxwifi_fec_estimator_init(dxwifi_fec_estimator* estimator, uint16_t n, uint16_t k);
+
+
+/**
+ *  DESCRIPTION:    Tears down any resources associated with the estimator
+ * 
+ *  ARGUMENTS:
+ * 
+ *      estimator:  Pointer to an initialized estimator object
+ * 
+ */
+void dxwifi_fec_estimator_close(dxwifi_fec_estimator* estimator);
+
+
+/**
+ *  DESCRIPTION:    Updates the estimate with a received symbol
+ * 
+ *  ARGUMENTS:
+ * 
+ *      estimator:  Pointer to an initialized estimator object
+ * 
+ *      esi:        ESI of a symbol that passed its CRC
+ * 
+ *  RETURNS:
+ * 
+ *      bool:       True if the decodability state changed
+ * 
+ *  NOTES: Duplicates cost a bitmap lookup. Iterative decoding work is bounded
+ *  by the number of edges in the code, so the cost is constant per symbol on 
+ *  average.
+ * 
+ */
+bool dxwifi_fec_estimator_add(dxwifi_fec_estimator* estimator, uint16_t esi);
+
+
+/**
+ *  DESCRIPTION:    Name of a decodability state
+ * 
+ *  ARGUMENTS:
+ * 
+ *      state:      Decodability state
+ * 
+ *  RETURNS:
+ * 
+ *      const char*: "unlikely", "likely" or "complete"
+ * 
+ */
+const char* dxwifi_decodability_to_str(dxwifi_decodability_t state);
+
+
+/**
+ *  DESCRIPTION:    Name of an inner code, as accepted on the command line
+ * 
+ *  ARGUMENTS:
+ * 
+ *      inner_code: Inner code to name
+ * 
+ *  RETURNS:
+ * 
+ *      const char*: "rs", "crc", "none" or NULL if the inner code is unknown
+ * 
+ */
+const char* dxwifi_fec_inner_code_to_str(dxwifi_fec_inner_code_t inner_code);
+
+
+/**
+ *  DESCRIPTION:    Parse the name of an inner code
+ * 
+ *  ARGUMENTS:
+ * 
+ *      str:        One of "rs", "crc" or "none"
+ * 
+ *  RETURNS:
+ * 
+ *      dxwifi_fec_inner_code_t: Matching inner code or DXWIFI_FEC_INNER_CODE_COUNT
+ *      if the name is unknown
+ * 
+ */
+dxwifi_fec_inner_code_t dxwifi_fec_inner_code_from_str(const char* str);
+
 #endif // LIBDXWIFI_FEC_H
@@ -0,0 +1,298 @@
+/**
+ *  merge.c - See merge.h for description
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+
+#include <libdxwifi/merge.h>
+#include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/memory.h>
+#include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/reed_solomon.h>
+
+// Quality of a frame whose symbol passed its CRC without any RS corrections
+#define MERGE_QUALITY_BEST (DXWIFI_RSCODE_BLOCKS_PER_FRAME * RS_MAX_CORRECTABLE + 1)
+
+#define MERGE_INITIAL_CAPACITY 4
+
+
+// Reads the OTI at the front of a frame into host byte order
+static dxwifi_oti read_oti(const uint8_t* frame) {
+    dxwifi_oti oti;
+    memcpy(&oti, frame, sizeof(oti));
+
+    oti.esi = ntohs(oti.esi);
+    oti.n   = ntohs(oti.n);
+    oti.k   = ntohs(oti.k);
+    oti.rem = ntohs(oti.rem);
+    oti.crc = ntohl(oti.crc);
+    return oti;
+}
+
+
+// Corrects a frame in place and rates it. Zero when the symbol fails its CRC,
+// up to MERGE_QUALITY_BEST with fewer RS corrections rating higher
+static int rate_frame(uint8_t* frame, dxwifi_oti* oti) {
+    dxwifi_oti raw = read_oti(frame);
+
+    int corrected = dxwifi_check_frame(frame, raw.rem >> DXWIFI_OTI_INNER_CODE_SHIFT, oti);
+
+    return corrected < 0 ? 0 : MERGE_QUALITY_BEST - corrected;
+}
+
+
+// Finds the object a frame belongs to, creating it when create is set. NULL if
+// there is no such object or it couldn't be allocated
+static dxwifi_merge_object* find_object(dxwifi_merger* merger, const dxwifi_oti* oti, bool create) {
+    for(size_t i = 0; i < merger->count; ++i) {
+        dxwifi_merge_object* object = &merger->objects[i];
+        if(object->n == oti->n && object->k == oti->k && object->rem == oti->rem) {
+            return object;
+        }
+    }
+    if(!create) {
+        return NULL;
+    }
+
+    if(merger->count == merger->capacity) {
+        size_t capacity = merger->capacity ? merger->capacity * 2 : MERGE_INITIAL_CAPACITY;
+        dxwifi_merge_object* objects = dxwifi_realloc(DXWIFI_MEM_MERGE, merger->objects, capacity * sizeof(dxwifi_merge_object));
+        if(!objects) {
+            log_error("Failed to grow merger - %s", strerror(errno));
+            return NULL;
+        }
+        merger->objects  = objects;
+        merger->capacity = capacity;
+    }
+
+    dxwifi_merge_object* object = &merger->objects[merger->count];
+    object->n       = oti->n;
+    object->k       = oti->k;
+    object->rem     = oti->rem;
+    object->count   = 0;
+    object->frames  = dxwifi_malloc(DXWIFI_MEM_MERGE, (size_t) oti->n * DXWIFI_RS_LDPC_FRAME_SIZE);
+    object->quality = dxwifi_malloc(DXWIFI_MEM_MERGE, oti->n * sizeof(int));
+    if(!object->frames || !object->quality) {
+        log_error("Failed to allocate merge object - %s", strerror(errno));
+        dxwifi_free(DXWIFI_MEM_MERGE, object->frames);
+        dxwifi_free(DXWIFI_MEM_MERGE, object->quality);
+        return NULL;
+    }
+    ++merger->count;
+
+    for(uint16_t esi = 0; esi < oti->n; ++esi) {
+        object->quality[esi] = -1;
+    }
+    log_info("Merging new object: n=%u, k=%u, rem=0x%x", oti->n, oti->k, oti->rem);
+    return object;
+}
+
+
+static bool is_critical(const dxwifi_merge_object* object) {
+    return ((object->rem >> DXWIFI_OTI_BLOCK_SHIFT) & 1) == DXWIFI_FEC_BLOCK_CRITICAL;
+}
+
+
+// Appends every frame held for an object
+static uint8_t* append_frames(uint8_t* dst, const dxwifi_merge_object* object) {
+    for(uint16_t esi = 0; esi < object->n; ++esi) {
+        if(object->quality[esi] >= 0) {
+            memcpy(dst, offset(object->frames, esi, DXWIFI_RS_LDPC_FRAME_SIZE), DXWIFI_RS_LDPC_FRAME_SIZE);
+            dst += DXWIFI_RS_LDPC_FRAME_SIZE;
+        }
+    }
+    return dst;
+}
+
+
+// Adds a run of archive entries, skipping frames of another size
+static size_t add_archive_entries(dxwifi_merger* merger, const dxwifi_archive* archive, size_t first, size_t count) {
+    if(archive->frame_size != DXWIFI_RS_LDPC_FRAME_SIZE) {
+        log_error("Archive holds %u byte frames, expected %zu", archive->frame_size, DXWIFI_RS_LDPC_FRAME_SIZE);
+        return 0;
+    }
+    for(size_t i = first; i < first + count; ++i) {
+        dxwifi_merger_add_frame(merger, dxwifi_archive_entry_at(archive, i, NULL));
+    }
+    return count;
+}
+
+
+//
+// See merge.h for non-static function descriptions
+//
+
+void dxwifi_merger_init(dxwifi_merger* merger) {
+    debug_assert(merger);
+
+    memset(merger, 0, sizeof(dxwifi_merger));
+}
+
+
+void dxwifi_merger_close(dxwifi_merger* merger) {
+    debug_assert(merger);
+
+    for(size_t i = 0; i < merger->count; ++i) {
+        dxwifi_free(DXWIFI_MEM_MERGE, merger->objects[i].frames);
+        dxwifi_free(DXWIFI_MEM_MERGE, merger->objects[i].quality);
+    }
+    dxwifi_free(DXWIFI_MEM_MERGE, merger->objects);
+    dxwifi_merger_init(merger);
+}
+
+
+bool dxwifi_merger_add_frame(dxwifi_merger* merger, const uint8_t* frame) {
+    debug_assert(merger && frame);
+
+    ++merger->frames;
+
+    uint8_t copy[DXWIFI_RS_LDPC_FRAME_SIZE];
+    memcpy(copy, frame, sizeof(copy));
+
+    dxwifi_oti oti;
+    int quality = rate_frame(copy, &oti);
+
+    // A fountain has no N to size and index its objects by, so its frames
+    // are refused rather than passed off as noise
+    if(quality > 0 && oti.n == DXWIFI_FOUNTAIN_OTI_N && oti.k > 0) {
+        ++merger->fountain;
+        return false;
+    }
+
+    // Zero filled noise frames and mangled headers are dropped here. Only a
+    // frame that passed its CRC may introduce a new object
+    if(oti.n == 0 || oti.k == 0 || oti.k > oti.n || oti.esi >= oti.n || oti.n > OFEC_MAX_SYMBOLS
+        || (oti.rem >> DXWIFI_OTI_INNER_CODE_SHIFT) >= DXWIFI_FEC_INNER_CODE_COUNT) {
+        ++merger->rejected;
+        return false;
+    }
+    dxwifi_merge_object* object = find_object(merger, &oti, quality > 0);
+    if(!object) {
+        ++merger->rejected;
+        return false;
+    }
+
+    int held = object->quality[oti.esi];
+    if(held >= 0) {
+        ++merger->duplicates;
+        if(quality <= held) {
+            return false;
+        }
+        ++merger->replaced;
+    }
+    else {
+        ++object->count;
+    }
+    memcpy(offset(object->frames, oti.esi, DXWIFI_RS_LDPC_FRAME_SIZE), copy, DXWIFI_RS_LDPC_FRAME_SIZE);
+    object->quality[oti.esi] = quality;
+    return true;
+}
+
+
+ssize_t dxwifi_merger_add_capture(dxwifi_merger* merger, int fd) {
+    debug_assert(merger && fd >= 0);
+
+    uint8_t buffer[DXWIFI_MERGE_READ_FRAMES * DXWIFI_RS_LDPC_FRAME_SIZE];
+    size_t  buffered = 0;
+    ssize_t nframes  = 0;
+    ssize_t nbytes   = 0;
+
+    while((nbytes = read(fd, buffer + buffered, sizeof(buffer) - buffered)) > 0) {
+        buffered += nbytes;
+
+        size_t whole = buffered / DXWIFI_RS_LDPC_FRAME_SIZE;
+        for(size_t i = 0; i < whole; ++i) {
+            dxwifi_merger_add_frame(merger, offset(buffer, i, DXWIFI_RS_LDPC_FRAME_SIZE));
+        }
+        nframes += whole;
+
+        // Keep a partial frame for the next read
+        buffered -= whole * DXWIFI_RS_LDPC_FRAME_SIZE;
+        memmove(buffer, offset(buffer, whole, DXWIFI_RS_LDPC_FRAME_SIZE), buffered);
+    }
+    if(nbytes < 0) {
+        log_error("Failed to read capture - %s", strerror(errno));
+        return -1;
+    }
+    if(buffered > 0) {
+        log_warning("Capture ends in a partial frame, %zu bytes ignored", buffered);
+    }
+    return nframes;
+}
+
+
+size_t dxwifi_merger_add_archive(dxwifi_merger* merger, const dxwifi_archive* archive) {
+    debug_assert(merger && archive);
+
+    return add_archive_entries(merger, archive, 0, archive->count);
+}
+
+
+size_t dxwifi_merger_add_archived_object(dxwifi_merger* merger, const dxwifi_archive* archive, uint32_t object_id) {
+    debug_assert(merger && archive);
+
+    size_t first = 0;
+    size_t count = dxwifi_archive_lookup(archive, object_id, &first);
+
+    return add_archive_entries(merger, archive, first, count);
+}
+
+
+size_t dxwifi_merger_object_count(const dxwifi_merger* merger) {
+    debug_assert(merger);
+
+    size_t count = 0;
+    for(size_t i = 0; i < merger->count; ++i) {
+        count += !is_critical(&merger->objects[i]);
+    }
+    return count;
+}
+
+
+ssize_t dxwifi_merger_decode(const dxwifi_merger* merger, size_t index, void** out) {
+    debug_assert(merger && out);
+
+    const dxwifi_merge_object* target = NULL;
+    size_t nframes = 0;
+
+    for(size_t i = 0; i < merger->count; ++i) {
+        const dxwifi_merge_object* object = &merger->objects[i];
+        if(is_critical(object)) {
+            nframes += object->count;
+        }
+        else if(index-- == 0) {
+            target = object;
+            nframes += object->count;
+        }
+    }
+    debug_assert(target);
+
+    log_info("Decoding merged object: n=%u, k=%u, %zu/%u frames held", target->n, target->k, target->count, target->n);
+
+    uint8_t* frames = dxwifi_malloc(DXWIFI_MEM_MERGE, nframes * DXWIFI_RS_LDPC_FRAME_SIZE);
+    if(!frames) {
+        return FEC_ERROR_OUT_OF_MEMORY;
+    }
+
+    // Critical blocks only help the object they were sent with, dxwifi_decode
+    // discards one that describes a message of another size
+    uint8_t* pos = frames;
+    for(size_t i = 0; i < merger->count; ++i) {
+        if(is_critical(&merger->objects[i])) {
+            pos = append_frames(pos, &merger->objects[i]);
+        }
+    }
+    append_frames(pos, target);
+
+    ssize_t msglen = dxwifi_decode(frames, nframes * DXWIFI_RS_LDPC_FRAME_SIZE, out);
+
+    dxwifi_free(DXWIFI_MEM_MERGE, frames);
+    return msglen;
+}
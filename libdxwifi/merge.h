@@ -0,0 +1,214 @@
+/**
+ *  merge.h - Merge FEC frames from many captures of the same objects
+ *
+ *  DESCRIPTION: Every ground station and every pass produces its own capture.
+ *  Two captures that each hold 60% of an object can't be decoded alone, but
+ *  their union can. The merger streams through raw captures, the frames that
+ *  dxwifi_decode consumes, or archives (see archive.h) and indexes each frame
+ *  by its object and ESI. Only the best copy of a frame is kept so memory is
+ *  bounded by the size of the encoded objects, not the number of captures.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: Raw captures carry no object id, frames are grouped by the OTI
+ *  parameters (N, K, remainder and inner code) instead. Frames of a critical
+ *  block (see dxwifi_encode_uep) are kept apart and handed to the decoder with
+ *  every object. Fountain coded objects (see dxwifi_fountain_encoder) can't be
+ *  merged, their frames are refused and counted.
+ *
+ */
+
+#ifndef LIBDXWIFI_MERGE_H
+#define LIBDXWIFI_MERGE_H
+
+/************************
+ *  Includes
+ ***********************/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include <libdxwifi/fec.h>
+#include <libdxwifi/archive.h>
+
+
+/************************
+ *  Constants
+ ***********************/
+
+// Number of frames read from a capture at a time
+#define DXWIFI_MERGE_READ_FRAMES 64
+
+
+/************************
+ *  Data structures
+ ***********************/
+
+/**
+ *  Every frame seen of one FEC source block, indexed by ESI
+ */
+typedef struct {
+    uint16_t    n;          /* Total number of symbols                      */
+    uint16_t    k;          /* Number of source symbols                     */
+    uint16_t    rem;        /* OTI rem field, remainder, block, inner code  */
+    uint8_t*    frames;     /* n frames of DXWIFI_RS_LDPC_FRAME_SIZE        */
+    int*        quality;    /* Quality of the kept copy of each frame, < 0
+                               when no copy has been seen                   */
+    size_t      count;      /* Number of distinct frames held               */
+} dxwifi_merge_object;
+
+
+typedef struct {
+    dxwifi_merge_object*    objects;    /* Source blocks seen so far        */
+    size_t                  count;      /* Number of source blocks          */
+    size_t                  capacity;   /* Allocated source blocks          */
+    size_t                  frames;     /* Frames ingested                  */
+    size_t                  duplicates; /* Frames already held              */
+    size_t                  replaced;   /* Duplicates better than the copy
+                                           that was held                    */
+    size_t                  rejected;   /* Frames without a usable OTI      */
+    size_t                  fountain;   /* Fountain coded frames, which have
+                                           no N to be indexed by            */
+} dxwifi_merger;
+
+
+/************************
+ *  Functions
+ ***********************/
+
+/**
+ *  DESCRIPTION:    Initializes an empty merger
+ *
+ *  ARGUMENTS:
+ *
+ *      merger:     Pointer to an allocated merger object
+ *
+ */
+void dxwifi_merger_init(dxwifi_merger* merger);
+
+
+/**
+ *  DESCRIPTION:    Tears down any resources associated with the merger
+ *
+ *  ARGUMENTS:
+ *
+ *      merger:     Pointer to an initialized merger object
+ *
+ */
+void dxwifi_merger_close(dxwifi_merger* merger);
+
+
+/**
+ *  DESCRIPTION:    Adds a single frame to the merger
+ *
+ *  ARGUMENTS:
+ *
+ *      merger:     Pointer to an initialized merger object
+ *
+ *      frame:      DXWIFI_RS_LDPC_FRAME_SIZE bytes of a raw capture
+ *
+ *  RETURNS:
+ *
+ *      bool:       True if the frame was kept, false if it was rejected or a
+ *                  copy at least as good was already held
+ *
+ *  NOTES: Frames are ranked by whether their symbol passes its CRC and by how
+ *  many symbols the RS inner code had to correct. A frame that is kept is
+ *  stored RS corrected.
+ *
+ */
+bool dxwifi_merger_add_frame(dxwifi_merger* merger, const uint8_t* frame);
+
+
+/**
+ *  DESCRIPTION:    Streams every frame of a raw capture into the merger
+ *
+ *  ARGUMENTS:
+ *
+ *      merger:     Pointer to an initialized merger object
+ *
+ *      fd:         Open file descriptor of the capture, read to the end
+ *
+ *  RETURNS:
+ *
+ *      ssize_t:    Number of frames read or -1 on a read error
+ *
+ */
+ssize_t dxwifi_merger_add_capture(dxwifi_merger* merger, int fd);
+
+
+/**
+ *  DESCRIPTION:    Adds every frame of an archive to the merger
+ *
+ *  ARGUMENTS:
+ *
+ *      merger:     Pointer to an initialized merger object
+ *
+ *      archive:    Pointer to a mapped archive object
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Number of frames read
+ *
+ */
+size_t dxwifi_merger_add_archive(dxwifi_merger* merger, const dxwifi_archive* archive);
+
+
+/**
+ *  DESCRIPTION:    Adds the frames of a single object from an archive
+ *
+ *  ARGUMENTS:
+ *
+ *      merger:     Pointer to an initialized merger object
+ *
+ *      archive:    Pointer to a mapped archive object
+ *
+ *      object_id:  Object to add, frames of other objects are never touched
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Number of frames read
+ *
+ */
+size_t dxwifi_merger_add_archived_object(dxwifi_merger* merger, const dxwifi_archive* archive, uint32_t object_id);
+
+
+/**
+ *  DESCRIPTION:    Number of objects that can be decoded, critical blocks
+ *                  aren't counted
+ *
+ *  ARGUMENTS:
+ *
+ *      merger:     Pointer to an initialized merger object
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Number of objects
+ *
+ */
+size_t dxwifi_merger_object_count(const dxwifi_merger* merger);
+
+
+/**
+ *  DESCRIPTION:    Decodes the union of every frame held for an object
+ *
+ *  ARGUMENTS:
+ *
+ *      merger:     Pointer to an initialized merger object
+ *
+ *      index:      Object to decode, less than dxwifi_merger_object_count
+ *
+ *      out:        Pointer to a void pointer which will contain the decoded
+ *                  message on return. Must be freed by the caller
+ *
+ *  RETURNS:
+ *
+ *      ssize_t:    Size of the decoded message or dxwifi_fec_error
+ *
+ */
+ssize_t dxwifi_merger_decode(const dxwifi_merger* merger, size_t index, void** out);
+
+
+#endif // LIBDXWIFI_MERGE_H
@@ -0,0 +1,155 @@
+/**
+ *  priority.c - See priority.h for description
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ */
+
+#include <string.h>
+
+#include <arpa/inet.h>
+
+#include <libdxwifi/bundle.h>
+#include <libdxwifi/priority.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/logging.h>
+
+#define JPEG_MARKER_SOI 0xd8
+#define JPEG_MARKER_EOI 0xd9
+#define JPEG_MARKER_SOS 0xda
+#define JPEG_MARKER_TEM 0x01
+#define JPEG_MARKER_RST0 0xd0
+#define JPEG_MARKER_RST7 0xd7
+
+static const uint8_t png_signature[8] = { 0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a };
+
+
+static uint16_t read_be16(const uint8_t* p) {
+    return (p[0] << 8) | p[1];
+}
+
+
+static uint32_t read_be32(const uint8_t* p) {
+    return ((uint32_t) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+
+// Length of the JPEG header, every segment up to and including the first SOS.
+// Zero if the header is malformed
+static size_t jpeg_header_length(const uint8_t* data, size_t size) {
+    size_t pos = 2; // Past SOI
+
+    while(pos + 4 <= size) {
+        if(data[pos] != 0xff) {
+            return 0;
+        }
+        uint8_t marker = data[pos + 1];
+
+        // Markers may be padded with any number of fill bytes
+        if(marker == 0xff) {
+            ++pos;
+            continue;
+        }
+        // Standalone markers have no length field
+        if(marker == JPEG_MARKER_TEM || (JPEG_MARKER_RST0 <= marker && marker <= JPEG_MARKER_RST7)) {
+            pos += 2;
+            continue;
+        }
+        if(marker == JPEG_MARKER_SOI || marker == JPEG_MARKER_EOI) {
+            return 0;
+        }
+
+        size_t length = read_be16(data + pos + 2);
+        if(length < 2 || pos + 2 + length > size) {
+            return 0;
+        }
+        pos += 2 + length;
+
+        if(marker == JPEG_MARKER_SOS) {
+            return pos;
+        }
+    }
+    return 0;
+}
+
+
+// Length of the PNG header, the signature and every chunk before the first
+// IDAT. Zero if the header is malformed
+static size_t png_header_length(const uint8_t* data, size_t size) {
+    size_t pos = sizeof(png_signature);
+
+    while(pos + 8 <= size) {
+        size_t length = read_be32(data + pos);
+        if(memcmp(data + pos + 4, "IDAT", 4) == 0) {
+            return pos;
+        }
+        // Length, type and CRC fields around the chunk data
+        if(length > size - pos - 12) {
+            return 0;
+        }
+        pos += 12 + length;
+    }
+    return 0;
+}
+
+
+// Length of a bundle's header and manifest. Zero if the manifest is malformed
+static size_t bundle_manifest_length(const uint8_t* data, size_t size) {
+    dxwifi_bundle_hdr hdr;
+    memcpy(&hdr, data, sizeof(hdr));
+
+    size_t pos = sizeof(hdr);
+    for(uint16_t i = 0; i < ntohs(hdr.count); ++i) {
+        dxwifi_bundle_entry_hdr entry;
+        if(size - pos < sizeof(entry)) {
+            return 0;
+        }
+        memcpy(&entry, data + pos, sizeof(entry));
+        pos += sizeof(entry) + entry.name_len;
+        if(pos > size) {
+            return 0;
+        }
+    }
+    return pos;
+}
+
+
+//
+// See priority.h for non-static function descriptions
+//
+
+size_t dxwifi_find_critical_ranges(const void* data, size_t size, dxwifi_priority_range* ranges, size_t max_ranges) {
+    debug_assert((data || size == 0) && ranges);
+
+    const uint8_t* bytes = data;
+    const char* format = NULL;
+    size_t length = 0;
+
+    if(max_ranges == 0 || size > UINT32_MAX) {
+        return 0;
+    }
+
+    if(size >= 2 && bytes[0] == 0xff && bytes[1] == JPEG_MARKER_SOI) {
+        format = "JPEG";
+        length = jpeg_header_length(bytes, size);
+    }
+    else if(size >= sizeof(png_signature) && memcmp(bytes, png_signature, sizeof(png_signature)) == 0) {
+        format = "PNG";
+        length = png_header_length(bytes, size);
+    }
+    else if(dxwifi_is_bundle(data, size)) {
+        format = "bundle";
+        length = bundle_manifest_length(bytes, size);
+    }
+
+    if(length == 0) {
+        if(format) {
+            log_warning("Malformed %s header, no critical ranges found", format);
+        }
+        return 0;
+    }
+    log_info("Found %zu byte %s header", length, format);
+
+    ranges[0].offset = 0;
+    ranges[0].length = length;
+    return 1;
+}
@@ -0,0 +1,55 @@
+/**
+ *  priority.h - Find the byte ranges a file can't be used without
+ *
+ *  DESCRIPTION: A lost piece of an image header makes the whole image useless
+ *  while a lost piece of the scan data only degrades it. These routines pick
+ *  out the headers of formats we know so they can be given extra protection
+ *  with dxwifi_encode_uep.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: Recognized formats are JPEG (everything up to the start of scan
+ *  data), PNG (every chunk ahead of the first IDAT) and DxWiFi bundles (the
+ *  bundle manifest).
+ *
+ */
+
+#ifndef LIBDXWIFI_PRIORITY_H
+#define LIBDXWIFI_PRIORITY_H
+
+/************************
+ *  Includes
+ ***********************/
+
+#include <stdlib.h>
+
+#include <libdxwifi/fec.h>
+
+
+/************************
+ *  Functions
+ ***********************/
+
+/**
+ *  DESCRIPTION:    Finds the critical ranges of a file by its format
+ *
+ *  ARGUMENTS:
+ *
+ *      data:       File contents
+ *
+ *      size:       Size of the file in bytes
+ *
+ *      ranges:     Filled with the critical ranges found
+ *
+ *      max_ranges: Number of ranges that fit in the ranges array
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Number of ranges found, zero when the format isn't
+ *                  recognized or the header is malformed
+ *
+ */
+size_t dxwifi_find_critical_ranges(const void* data, size_t size, dxwifi_priority_range* ranges, size_t max_ranges);
+
+
+#endif // LIBDXWIFI_PRIORITY_H
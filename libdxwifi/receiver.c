@@ -20,9 +20,12 @@
 #include <libdxwifi/receiver.h>
 #include <libdxwifi/transmitter.h>
 #include <libdxwifi/details/heap.h>
+#include <libdxwifi/details/utils.h>
 #include <libdxwifi/details/crc32.h>
 #include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/memory.h>
 #include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/probes.h>
 
 
 #define DXWIFI_RX_PACKET_HEAP_CAPACITY ((DXWIFI_RX_PACKET_BUFFER_SIZE_MAX / DXWIFI_TX_BLOCKSIZE) + 1)
@@ -46,8 +49,14 @@ typedef struct {
     bool                    eot_reached;    /* EOT signalled?                 */
     bool                    preamble_recv;  /* Received preamble?             */
     bool                    end_capture;    /* eot && preamble?               */
+    bool                    object_known;   /* Seen the current object's id?  */
+    uint32_t                object_id;      /* Object being captured          */
     const dxwifi_receiver*  rx;             /* Reference to owning receiver   */
     dxwifi_rx_stats         rx_stats;       /* Capture statistics             */
+    dxwifi_fec_estimator    estimator;      /* Decodability of the object     */
+    bool                    estimating;     /* Estimator initialized?         */
+    bool                    fountain;       /* Object is fountain coded?      */
+    uint64_t                cpu_mark;       /* Thread CPU time last charged   */
     int                     fd;             /* Sink to write out data         */
 } frame_controller;
 
@@ -64,6 +73,26 @@ typedef struct {
  *      bool:       true if the lhs frame number is less than the rhs
  *  
  */
+static uint64_t thread_cpu_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+// Charges the thread CPU time since the last charge to a stage. Runs of the
+// capture stage are the frames handled and are counted by process_frame()
+static void charge_stage(frame_controller* fc, dxwifi_rx_stage_t stage) {
+    uint64_t now = thread_cpu_ns();
+    fc->rx_stats.stages[stage].cpu_ns += now - fc->cpu_mark;
+    fc->cpu_mark = now;
+
+    if(stage != DXWIFI_RX_STAGE_CAPTURE) {
+        ++fc->rx_stats.stages[stage].runs;
+    }
+}
+
+
 static bool order_by_frame_number_desc(const uint8_t* lhs, const uint8_t* rhs) {
     packet_heap_node* node1 = (packet_heap_node*) lhs;
     packet_heap_node* node2 = (packet_heap_node*) rhs;
@@ -72,21 +101,6 @@ static bool order_by_frame_number_desc(const uint8_t* lhs, const uint8_t* rhs) {
 }
 
 
-/**
- *  DESCRIPTION:    Grabs the packed frame number from the correct field in the
- *                  MAC header
- * 
- *  ARGUMENTS:
- * 
- *      mac_hdr:    MAC layer header of the captured packet
- * 
- */
-static uint32_t extract_frame_number(const ieee80211_hdr* mac_hdr) {
-    // Packed Frame number is in the last four bytes of address 1 field
-    return ntohl(*(uint32_t*)(mac_hdr->addr1 + 2));
-}
-
-
 /**
  *  DESCRIPTION:    Initializes and allocates any frame controller resources
  * 
@@ -108,12 +122,17 @@ static void init_frame_controller(frame_controller* fc, const dxwifi_receiver* r
     fc->end_capture     = 0;
     fc->eot_reached     = false;
     fc->preamble_recv   = false;
+    fc->object_known    = false;
+    fc->object_id       = 0;
+    fc->estimating      = false;
+    fc->fountain        = false;
     fc->pb_size         = rx->packet_buffer_size;
 
     memset(&fc->rx_stats, 0x00, sizeof(dxwifi_rx_stats));
     fc->rx_stats.capture_state = DXWIFI_RX_NORMAL;
+    fc->cpu_mark = thread_cpu_ns();
     
-    fc->packet_buffer = calloc(fc->pb_size, sizeof(uint8_t));
+    fc->packet_buffer = dxwifi_calloc(DXWIFI_MEM_RX, fc->pb_size, sizeof(uint8_t));
     assert_M(fc->packet_buffer, "Failed to allocate Packet Buffer of size: %ld", fc->pb_size);
 
     init_heap(&fc->packet_heap, DXWIFI_RX_PACKET_HEAP_CAPACITY, sizeof(packet_heap_node), order_by_frame_number_desc);
@@ -131,7 +150,11 @@ static void teardown_frame_controller(frame_controller* fc) {
     debug_assert(fc);
 
     teardown_heap(&fc->packet_heap);
-    free(fc->packet_buffer);
+    dxwifi_free(DXWIFI_MEM_RX, fc->packet_buffer);
+    if(fc->estimating) {
+        dxwifi_fec_estimator_close(&fc->estimator);
+        fc->estimating = false;
+    }
     fc->packet_buffer   = NULL;
     fc->pb_size         = 0;
     fc->index           = 0;
@@ -149,24 +172,24 @@ static void teardown_frame_controller(frame_controller* fc) {
  * 
  *      data:       Captured frame of data
  * 
+ *      has_fcs:    Does the frame end with an FCS? Savefiles written by test
+ *                  builds of tx don't have one
+ * 
  *  RETURNS:
  *      
  *      dxwifi_rx_frame: Structural representation of the data. All fields point
  *      into the provided data buffer and should not be freed or modified.
  *  
  */
-static dxwifi_rx_frame parse_rx_frame_fields(const struct pcap_pkthdr* pkt_stats, const uint8_t* data) {
+static dxwifi_rx_frame parse_rx_frame_fields(const struct pcap_pkthdr* pkt_stats, const uint8_t* data, bool has_fcs) {
     dxwifi_rx_frame frame;
 
     frame.__frame   = data;
     frame.rtap_hdr  = (ieee80211_radiotap_hdr*) data;
     frame.mac_hdr   = (ieee80211_hdr*)(data + frame.rtap_hdr->it_len);
-    frame.payload   = data + frame.rtap_hdr->it_len + sizeof(ieee80211_hdr);
-#if defined(DXWIFI_TESTS)
-    frame.fcs       = data + pkt_stats->caplen;
-#else
-    frame.fcs       = data + pkt_stats->caplen - IEEE80211_FCS_SIZE;
-#endif
+    frame.dxwifi_hdr= (dxwifi_frame_hdr*)(data + frame.rtap_hdr->it_len + sizeof(ieee80211_hdr));
+    frame.payload   = data + frame.rtap_hdr->it_len + sizeof(ieee80211_hdr) + sizeof(dxwifi_frame_hdr);
+    frame.fcs       = data + pkt_stats->caplen - (has_fcs ? IEEE80211_FCS_SIZE : 0);
     return frame;
 }
 
@@ -212,52 +235,32 @@ static void log_frame_stats(dxwifi_rx_frame* frame, int32_t frame_no, dxwifi_rx_
  * 
  *      frame:      Captured frame of data
  * 
- *      pkt_stats:  Information about the current capture
+ *      payload_size: Size of the payload following the DxWiFi header
  * 
- *      check_threshold: Percentage of data that must match with a control data
- *                       value for us to consider this frame as a "control frame"
+ *      hdr:        Unpacked DxWiFi header or NULL if the header is damaged
+ * 
+ *      manifest:   Filled with the announced object for valid control frames
+ * 
+ *      has_manifest: Set if the manifest was filled, a damaged control frame 
+ *                  may still be known by its fill
  * 
  *  RETURNS:
  *      dxwifi_control_frame_t: The type of the control frame
  *  
  */
-static dxwifi_control_frame_t check_frame_control(const uint8_t* frame, const struct pcap_pkthdr* pkt_stats, float check_threshold) {
-    // Get info we need from the raw data frame
-    const ieee80211_radiotap_hdr* rtap = (const ieee80211_radiotap_hdr*)frame;
-    const uint8_t* payload = frame + rtap->it_len + sizeof(ieee80211_hdr);
-#if defined(DXWIFI_TESTS)
-    size_t payload_size = pkt_stats->caplen - rtap->it_len - sizeof(ieee80211_hdr);
-#else
-    size_t payload_size = pkt_stats->caplen - rtap->it_len - sizeof(ieee80211_hdr) - IEEE80211_FCS_SIZE;
-#endif
-
-    unsigned eot                = 0;
-    unsigned preamble           = 0;
+static dxwifi_control_frame_t check_frame_control(const dxwifi_rx_frame* frame, ssize_t payload_size, const dxwifi_frame_hdr* hdr, dxwifi_object_manifest* manifest, bool* has_manifest) {
     dxwifi_control_frame_t type = DXWIFI_CONTROL_FRAME_NONE;
 
-    if(payload_size == DXWIFI_FRAME_CONTROL_SIZE) {
-        type = DXWIFI_CONTROL_FRAME_UNKNOWN;
-        for(size_t i = 0; i < DXWIFI_TX_PAYLOAD_SIZE; ++i) {
-            switch (payload[i])
-            {
-            case DXWIFI_CONTROL_FRAME_PREAMBLE:
-                ++preamble;
-                break;
-            
-            case DXWIFI_CONTROL_FRAME_EOT:
-                ++eot;
-                break;
+    *has_manifest = false;
 
-            default:
-                break;
-            }
-        } 
-        if(((float)eot / payload_size) > check_threshold) {
-            type = DXWIFI_CONTROL_FRAME_EOT;
-        }
-        else if (((float)preamble / payload_size) > check_threshold) {
-            type = DXWIFI_CONTROL_FRAME_PREAMBLE;
-        }
+    if(hdr && (hdr->flags & DXWIFI_FRAME_FLAG_CONTROL)) {
+        type = (payload_size == DXWIFI_FRAME_CONTROL_SIZE) 
+             ? unpack_control_frame(frame->payload, manifest, has_manifest) 
+             : DXWIFI_CONTROL_FRAME_UNKNOWN;
+    }
+    // Without a header a control frame is still known by its size
+    else if(!hdr && payload_size == DXWIFI_FRAME_CONTROL_SIZE) {
+        type = unpack_control_frame(frame->payload, manifest, has_manifest);
     }
     // Payload size is incorrect, do not process frame
     else if(payload_size != DXWIFI_TX_PAYLOAD_SIZE) {
@@ -267,6 +270,63 @@ static dxwifi_control_frame_t check_frame_control(const uint8_t* frame, const st
 }
 
 
+/**
+ *  DESCRIPTION:    Checks whether a data frame belongs to the object after the
+ *                  one being captured
+ * 
+ *  ARGUMENTS:
+ * 
+ *      fc:         Frame controller for the current capture
+ * 
+ *      hdr:        Unpacked DxWiFi header of the frame
+ * 
+ *  RETURNS:
+ *      bool:       True if the frame belongs to the next object
+ *  
+ */
+static bool is_next_object(frame_controller* fc, const dxwifi_frame_hdr* hdr) {
+    if(!fc->object_known || fc->rx_stats.num_packets_processed == 0) {
+        fc->object_known    = true;
+        fc->object_id       = hdr->object_id;
+    }
+    return fc->object_id != hdr->object_id;
+}
+
+
+/**
+ *  DESCRIPTION:    Grows the packet buffer so that the whole announced object 
+ *                  fits, keeping its frames in a single ordered dump
+ * 
+ *  ARGUMENTS:
+ * 
+ *      fc:         Frame controller with an empty packet buffer
+ * 
+ *      manifest:   Announced object
+ * 
+ *      ctrl_caplen: Capture length of the control frame, used to find the 
+ *                   capture overhead of each frame
+ *  
+ */
+static void size_packet_buffer(frame_controller* fc, const dxwifi_object_manifest* manifest, uint32_t ctrl_caplen) {
+    debug_assert(fc && manifest && fc->index == 0);
+
+    size_t frame_caplen = ctrl_caplen - DXWIFI_FRAME_CONTROL_SIZE + DXWIFI_TX_PAYLOAD_SIZE;
+    size_t needed = (size_t) manifest->n * frame_caplen + DXWIFI_TX_PAYLOAD_SIZE;
+
+    if(needed > DXWIFI_RX_PACKET_BUFFER_SIZE_MAX) {
+        needed = DXWIFI_RX_PACKET_BUFFER_SIZE_MAX;
+    }
+    if(needed > fc->pb_size) {
+        uint8_t* packet_buffer = dxwifi_realloc(DXWIFI_MEM_RX, fc->packet_buffer, needed);
+        if(packet_buffer) {
+            log_debug("Packet buffer grown to %ld bytes for object %u", needed, manifest->object_id);
+            fc->packet_buffer   = packet_buffer;
+            fc->pb_size         = needed;
+        }
+    }
+}
+
+
 /**
  *  DESCRIPTION:    Perform an action based on what type of control frame was 
  *                  received
@@ -277,9 +337,14 @@ static dxwifi_control_frame_t check_frame_control(const uint8_t* frame, const st
  *                  capture
  * 
  *      type:       The type of control frame received
+ * 
+ *      manifest:   Object announced by the control frame, NULL if the frame
+ *                  failed its CRC and was only known by its fill
+ * 
+ *      caplen:     Capture length of the control frame
  *  
  */
-static void handle_frame_control(frame_controller* fc, dxwifi_control_frame_t type) {
+static void handle_frame_control(frame_controller* fc, dxwifi_control_frame_t type, const dxwifi_object_manifest* manifest, uint32_t caplen) {
     debug_assert(fc);
 
     switch (type) 
@@ -293,13 +358,28 @@ static void handle_frame_control(frame_controller* fc, dxwifi_control_frame_t ty
     // the EOT was found so that they can do some action like opening a new 
     // file for capture.
     case DXWIFI_CONTROL_FRAME_PREAMBLE:
-        if(fc->rx_stats.num_packets_processed > 0) {
+        if(fc->rx_stats.num_packets_processed > 0 && fc->fountain && (!manifest || manifest->object_id == fc->object_id)) {
+            // Each pass of a fountain carries fresh repair symbols, they all go to one capture
+            log_debug("Next pass of object %u", fc->object_id);
+        }
+        else if(fc->rx_stats.num_packets_processed > 0) {
             // Somehow we have run into the next files capture.
             fc->end_capture = true;
             //pcap_breakloop(fc->rx->__handle);
         }
-        else if(!fc->preamble_recv){
-            log_info("Uplink established!");
+        else if(!manifest) {
+            if(!fc->preamble_recv){
+                log_info("Uplink established! Damaged preamble, object unknown");
+            }
+        }
+        else {
+            if(!fc->preamble_recv){
+                log_info("Uplink established! Object %u, Size: %u, k: %u, n: %u", manifest->object_id, manifest->size, manifest->k, manifest->n);
+            }
+            fc->rx_stats.manifest   = *manifest;
+            fc->object_known        = true;
+            fc->object_id           = manifest->object_id;
+            size_packet_buffer(fc, manifest, caplen);
         }
         fc->preamble_recv = true;
         break;
@@ -310,6 +390,10 @@ static void handle_frame_control(frame_controller* fc, dxwifi_control_frame_t ty
             //fc->end_capture = true;
             //pcap_breakloop(fc->rx->__handle);
         }
+        // A stream only knows its size once it has ended
+        if(manifest && (!fc->preamble_recv || fc->rx_stats.manifest.object_id == manifest->object_id)) {
+            fc->rx_stats.manifest = *manifest;
+        }
         fc->eot_reached = true;
         break;
 
@@ -332,6 +416,8 @@ static void handle_frame_control(frame_controller* fc, dxwifi_control_frame_t ty
 static void dump_packet_buffer(frame_controller* fc) {
     debug_assert(fc);
 
+    charge_stage(fc, DXWIFI_RX_STAGE_CAPTURE);
+
     int nbytes = 0;
     packet_heap_node node;
     int32_t expected_frame = ((packet_heap_node*)fc->packet_heap.tree)->frame_number;
@@ -356,19 +442,24 @@ static void dump_packet_buffer(frame_controller* fc) {
             fc->rx_stats.total_blocks_lost += missing_blocks;
         }
 
+        DXWIFI_PROBE2(write__start, fc->fd, DXWIFI_TX_PAYLOAD_SIZE);
         nbytes = write(fc->fd, node.data, DXWIFI_TX_PAYLOAD_SIZE);
+        DXWIFI_PROBE2(write__done, fc->fd, nbytes);
         debug_assert_continue(nbytes == DXWIFI_TX_PAYLOAD_SIZE, "Partial write: %d - %s", nbytes, strerror(errno));
 
         fc->rx_stats.total_writelen += nbytes;
         expected_frame = node.frame_number + 1;
     }
     fc->index = 0; // Reset the write position and reuse the buffer
+
+    charge_stage(fc, DXWIFI_RX_STAGE_WRITE);
 }
 
 
 /**
  *  DESCRIPTION:    Checks the IEEE header address fields to verify that the 
- *                  packet orignated from OreSat
+ *                  packet orignated from OreSat. Only needed for frames whose
+ *                  DxWiFi header is damaged
  * 
  *  ARGUMENTS:
  * 
@@ -470,6 +561,144 @@ dxwifi_rx_radiotap_hdr parse_radiotap_header(const uint8_t* frame, uint32_t capl
     return rtap;
 }
 
+/**
+ *  DESCRIPTION:    Appends a data frame to the receiver's archive
+ * 
+ *  ARGUMENTS:
+ * 
+ *      fc:         Frame controller with an archive attached
+ * 
+ *      pkt_stats:  Info about the current capture
+ * 
+ *      frame:      Captured data frame
+ * 
+ *      rx_frame:   Parsed fields of the frame
+ * 
+ *      hdr:        The frame's DxWiFi header or NULL if it was damaged
+ * 
+ */
+static void archive_frame(frame_controller* fc, const struct pcap_pkthdr* pkt_stats, const uint8_t* frame, const dxwifi_rx_frame* rx_frame, const dxwifi_frame_hdr* hdr) {
+    uint32_t crc = crc32((uint8_t*)rx_frame->mac_hdr, DXWIFI_TX_PAYLOAD_SIZE + sizeof(dxwifi_frame_hdr) + sizeof(ieee80211_hdr));
+
+    dxwifi_archive_record record = {
+        .object_id  = hdr ? hdr->object_id : DXWIFI_ARCHIVE_OBJECT_UNKNOWN,
+        .flags      = (hdr ? DXWIFI_ARCHIVE_FLAG_HDR_VALID : 0) | (crc == *rx_frame->fcs ? DXWIFI_ARCHIVE_FLAG_FCS_VALID : 0),
+        .rssi       = parse_radiotap_header(frame, pkt_stats->caplen).ant_signal,
+        .ts_sec     = pkt_stats->ts.tv_sec,
+        .ts_usec    = pkt_stats->ts.tv_usec
+    };
+    if(!dxwifi_archive_append(fc->rx->archive, &record, rx_frame->payload)) {
+        log_warning("Failed to archive frame");
+    }
+}
+
+
+/**
+ *  DESCRIPTION:    Marks the object being captured as fountain coded
+ * 
+ *  ARGUMENTS:
+ * 
+ *      fc:         Frame controller for the current capture
+ * 
+ *      object_id:  Id of the object, zero if unknown
+ * 
+ *  NOTES: Fountain coded frames have no fixed N. Archives are only read back
+ *  through the merger, which indexes frames by N, and the estimator models the
+ *  LDPC code, so neither takes the object's frames. Every further pass of the
+ *  object is kept in the same capture.
+ * 
+ */
+static void mark_fountain(frame_controller* fc, uint32_t object_id) {
+    if(fc->fountain) {
+        return;
+    }
+    fc->fountain = true;
+
+    if(fc->rx->archive) {
+        log_error("Object %u is fountain coded and can't be merged, its frames are not archived", object_id);
+    }
+    log_warning("Object %u is fountain coded, its decodability is not estimated", object_id);
+}
+
+
+/**
+ *  DESCRIPTION:    Updates the decodability estimate of the object with a 
+ *                  data frame and reports it to the user
+ * 
+ *  ARGUMENTS:
+ * 
+ *      fc:         Frame controller for the current capture
+ * 
+ *      payload:    Payload of a data frame
+ * 
+ *  NOTES: The estimator is started by the first bulk frame that passes its CRC.
+ *  Frames of other source blocks, e.g. a critical block, are ignored.
+ * 
+ */
+static void estimate_frame(frame_controller* fc, const uint8_t* payload) {
+    static const dxwifi_fec_inner_code_t inner_codes[] = {
+        [DXWIFI_CODEC_LDPC_RS]  = DXWIFI_FEC_INNER_RS,
+        [DXWIFI_CODEC_LDPC_CRC] = DXWIFI_FEC_INNER_CRC,
+        [DXWIFI_CODEC_LDPC]     = DXWIFI_FEC_INNER_NONE
+    };
+    const dxwifi_object_manifest* manifest = &fc->rx_stats.manifest;
+
+    // Raw transmissions carry no OTI, and the estimator only models LDPC
+    if(fc->fountain || (manifest->n > 0 && (manifest->codec == DXWIFI_CODEC_NONE || manifest->codec > DXWIFI_CODEC_LDPC))) {
+        return;
+    }
+
+    uint8_t frame[DXWIFI_RS_LDPC_FRAME_SIZE];
+    memcpy(frame, payload, sizeof(frame));
+
+    dxwifi_oti oti;
+    memcpy(&oti, frame, sizeof(oti));
+
+    dxwifi_fec_inner_code_t inner_code = manifest->n > 0 
+        ? inner_codes[manifest->codec] 
+        : ntohs(oti.rem) >> DXWIFI_OTI_INNER_CODE_SHIFT;
+
+    if(dxwifi_check_frame(frame, inner_code, &oti) < 0 
+        || ((oti.rem >> DXWIFI_OTI_BLOCK_SHIFT) & 1) != DXWIFI_FEC_BLOCK_BULK) {
+        return;
+    }
+    // Without a manifest a fountain is only known by its frames
+    if(oti.n == DXWIFI_FOUNTAIN_OTI_N) {
+        mark_fountain(fc, fc->object_id);
+        return;
+    }
+
+    if(!fc->estimating) {
+        fc->estimating = dxwifi_fec_estimator_init(&fc->estimator, oti.n, oti.k);
+        if(!fc->estimating) {
+            return;
+        }
+    }
+    dxwifi_fec_estimate* estimate = &fc->estimator.estimate;
+    if(oti.n != estimate->n || oti.k != estimate->k) {
+        return;
+    }
+
+    bool changed = dxwifi_fec_estimator_add(&fc->estimator, oti.esi);
+    fc->rx_stats.estimate = *estimate;
+
+    if(changed) {
+        log_info(
+            "Object %u is %s to decode, %u/%u symbols received, %u resolved",
+            fc->object_id,
+            dxwifi_decodability_to_str(estimate->state),
+            estimate->source_received + estimate->repair_received,
+            estimate->n,
+            estimate->resolved
+        );
+    }
+    if(fc->rx->on_estimate && (changed || fc->rx_stats.num_packets_processed % DXWIFI_RX_ESTIMATE_INTERVAL == 0)) {
+        dxwifi_mem_get_usage(DXWIFI_MEM_ALL_SUBSYSTEMS, &fc->rx_stats.memory);
+        fc->rx->on_estimate(&fc->rx_stats, fc->rx->estimate_user);
+    }
+}
+
+
 /**
  *  DESCRIPTION:    Callback for PCAP dispatch. Called each time a frame is
  *                  matching the BPF expression is captured
@@ -487,65 +716,95 @@ dxwifi_rx_radiotap_hdr parse_radiotap_header(const uint8_t* frame, uint32_t capl
 static void process_frame(uint8_t* args, const struct pcap_pkthdr* pkt_stats, const uint8_t* frame) { 
     frame_controller* fc = (frame_controller*) args;
 
-    if(verify_sender(frame, fc->rx->sender_addr, fc->rx->max_hamming_dist)) {
-        dxwifi_control_frame_t ctrl_frame = check_frame_control(frame, pkt_stats, 0.66);
+    DXWIFI_PROBE1(capture__start, pkt_stats->caplen);
+
+    ++fc->rx_stats.stages[DXWIFI_RX_STAGE_CAPTURE].runs;
+
+    dxwifi_rx_frame rx_frame = parse_rx_frame_fields(pkt_stats, frame, fc->rx->__has_fcs);
+
+    ssize_t payload_size = rx_frame.fcs - rx_frame.payload;
+
+    dxwifi_frame_hdr hdr;
+    bool hdr_valid = payload_size >= 0 && unpack_frame_header((const uint8_t*) rx_frame.dxwifi_hdr, &hdr);
+
+    // A valid header identifies the sender, the addresses are only checked as a fallback
+    if(hdr_valid || verify_sender(frame, fc->rx->sender_addr, fc->rx->max_hamming_dist)) {
+        bool has_manifest = false;
+        dxwifi_object_manifest manifest;
+        dxwifi_control_frame_t ctrl_frame = check_frame_control(&rx_frame, payload_size, hdr_valid ? &hdr : NULL, &manifest, &has_manifest);
+
+        if(has_manifest && manifest.codec >= DXWIFI_CODEC_FOUNTAIN_RS) {
+            mark_fountain(fc, manifest.object_id);
+        }
+
+        // Archive every data frame, even the ones this capture won't keep
+        if(ctrl_frame == DXWIFI_CONTROL_FRAME_NONE && fc->rx->archive && !fc->fountain) {
+            charge_stage(fc, DXWIFI_RX_STAGE_CAPTURE);
+            archive_frame(fc, pkt_stats, frame, &rx_frame, hdr_valid ? &hdr : NULL);
+            charge_stage(fc, DXWIFI_RX_STAGE_ARCHIVE);
+        }
 
         if(ctrl_frame == DXWIFI_CONTROL_FRAME_UNKNOWN) {
-            // Payload size is incorrect, log the frame but don't process it
+            // Payload size is incorrect or the control frame is corrupt, log the frame but don't process it
             log_warning("Warning, unknown frame encountered. caplen: %d, len: %d", pkt_stats->caplen, pkt_stats->len);
             log_hexdump(frame, pkt_stats->caplen);
         }
         else if(ctrl_frame != DXWIFI_CONTROL_FRAME_NONE) {
-            handle_frame_control(fc, ctrl_frame);
+            handle_frame_control(fc, ctrl_frame, has_manifest ? &manifest : NULL, pkt_stats->caplen);
+        }
+        else if(hdr_valid && is_next_object(fc, &hdr)) {
+            // Somehow we have run into the next files capture.
+            fc->end_capture = true;
+        }
+        else if(!hdr_valid && fc->rx->ordered) {
+            // Without a sequence number the frame can't be placed, it will be counted as lost
+            log_debug("Dropped frame with a damaged header");
+            ++fc->rx_stats.packets_dropped;
         }
         else {
-
-            dxwifi_rx_frame rx_frame = parse_rx_frame_fields(pkt_stats, frame);
-
             fc->rx_stats.rtap = parse_radiotap_header(frame, pkt_stats->caplen);
 
-            ssize_t payload_size = rx_frame.fcs - rx_frame.payload;
+            // Buffer is full, write it out first
+            if( fc->index + DXWIFI_TX_PAYLOAD_SIZE >= fc->pb_size ) {
+                dump_packet_buffer(fc);
+            }
 
-            if(payload_size != DXWIFI_TX_PAYLOAD_SIZE) {
-                log_warning("Payload size does not match expected: %d / %d", payload_size, DXWIFI_TX_PAYLOAD_SIZE);
-            } else {
+            // Next available slot in the packet buffer
+            uint8_t* write_idx = fc->packet_buffer + fc->index;
 
-                // Buffer is full, write it out first
-                if( fc->index + DXWIFI_TX_PAYLOAD_SIZE >= fc->pb_size ) {
-                    dump_packet_buffer(fc);
-                }
+            // Copy the entire frame into the packet buffer
+            memcpy(write_idx, rx_frame.payload, DXWIFI_TX_PAYLOAD_SIZE);
 
-                // Next available slot in the packet buffer
-                uint8_t* write_idx = fc->packet_buffer + fc->index;
+            int32_t frame_number = (fc->rx->ordered 
+                ? (int32_t) hdr.seq
+                : (int32_t) fc->rx_stats.num_packets_processed);
 
-                // Copy the entire frame into the packet buffer
-                memcpy(write_idx, rx_frame.payload, DXWIFI_TX_PAYLOAD_SIZE);
+            uint32_t crc = crc32((uint8_t*)rx_frame.mac_hdr, DXWIFI_TX_PAYLOAD_SIZE + sizeof(dxwifi_frame_hdr) + sizeof(ieee80211_hdr));
+            bool crc_valid = (crc == *rx_frame.fcs);
 
-                int32_t frame_number = (fc->rx->ordered 
-                    ? extract_frame_number(rx_frame.mac_hdr) 
-                    : fc->rx_stats.num_packets_processed);
+            // Heap node only points to the payload data
+            packet_heap_node node = {
+                .frame_number   = frame_number,
+                .data           = write_idx,
+                .crc_valid      = crc_valid
+            };
+            heap_push(&fc->packet_heap, &node);
 
-                uint32_t crc = crc32((uint8_t*)rx_frame.mac_hdr, DXWIFI_TX_PAYLOAD_SIZE + sizeof(ieee80211_hdr));
-                bool crc_valid = (crc == *rx_frame.fcs);
+            // Update next write position and stats
+            fc->index                           += pkt_stats->caplen; 
+            fc->rx_stats.total_caplen           += pkt_stats->caplen;
+            fc->rx_stats.total_payload_size     += payload_size;
+            fc->rx_stats.num_packets_processed  += 1;
+            fc->rx_stats.bad_crcs               += !crc_valid ? 0 : 1;
+            memcpy(&fc->rx_stats.pkt_stats, pkt_stats, sizeof(struct pcap_pkthdr));
 
-                // Heap node only points to the payload data
-                packet_heap_node node = {
-                    .frame_number   = frame_number,
-                    .data           = write_idx,
-                    .crc_valid      = crc_valid
-                };
-                heap_push(&fc->packet_heap, &node);
+            log_frame_stats(&rx_frame, frame_number, &fc->rx_stats);
 
-                // Update next write position and stats
-                fc->index                           += pkt_stats->caplen; 
-                fc->rx_stats.total_caplen           += pkt_stats->caplen;
-                fc->rx_stats.total_payload_size     += payload_size;
-                fc->rx_stats.num_packets_processed  += 1;
-                fc->rx_stats.bad_crcs               += !crc_valid ? 0 : 1;
-                memcpy(&fc->rx_stats.pkt_stats, pkt_stats, sizeof(struct pcap_pkthdr));
+            charge_stage(fc, DXWIFI_RX_STAGE_CAPTURE);
+            estimate_frame(fc, rx_frame.payload);
+            charge_stage(fc, DXWIFI_RX_STAGE_ESTIMATE);
 
-                log_frame_stats(&rx_frame, frame_number, &fc->rx_stats);
-            }
+            DXWIFI_PROBE2(capture__done, frame_number, payload_size);
         }
     }
     else {
@@ -553,6 +812,65 @@ static void process_frame(uint8_t* args, const struct pcap_pkthdr* pkt_stats, co
     }
 }
 
+/**
+ *  DESCRIPTION:    Attaches the receiver to a virtual air interface. The pcap
+ *                  handle is only used to compile the filter
+ * 
+ *  ARGUMENTS:
+ * 
+ *      rx:         Receiver with an air interface set
+ * 
+ */
+static void open_air_interface(dxwifi_receiver* rx) {
+    rx->__handle    = pcap_open_dead(DLT_IEEE802_11_RADIO, rx->snaplen);
+    rx->__has_fcs   = true;
+    assert_M(rx->__handle != NULL, "Failed to open a pcap handle for the air interface");
+
+    rx->__air.channel = rx->air_channel;
+    bool attached = dxwifi_air_attach(&rx->__air, rx->air, DXWIFI_AIR_RECEIVER);
+    assert_M(attached, "Failed to attach to air interface %s", rx->air);
+
+    if(rx->filter != NULL) {
+        int status = pcap_compile(rx->__handle, &rx->__filter, rx->filter, rx->optimize, PCAP_NETMASK_UNKNOWN);
+        assert_M(status != PCAP_ERROR, "Failed to compile filter %s: %s", rx->filter, pcap_geterr(rx->__handle));
+    }
+}
+
+
+/**
+ *  DESCRIPTION:    Waits for frames on the device or air interface
+ * 
+ *  RETURNS:
+ * 
+ *      int:        Same as poll()
+ * 
+ */
+static int wait_for_frames(dxwifi_receiver* rx, struct pollfd* request) {
+    int timeout_ms = rx->capture_timeout * 1000;
+    if(rx->air) {
+        return dxwifi_air_wait(&rx->__air, timeout_ms);
+    }
+    return poll(request, 1, timeout_ms);
+}
+
+
+/**
+ *  DESCRIPTION:    Processes the frames that are ready on the device or air 
+ *                  interface
+ * 
+ *  RETURNS:
+ * 
+ *      int:        Same as pcap_dispatch()
+ * 
+ */
+static int dispatch_frames(dxwifi_receiver* rx, frame_controller* fc) {
+    if(rx->air) {
+        return dxwifi_air_dispatch(&rx->__air, rx->dispatch_count, process_frame, (uint8_t*)fc, rx->filter ? &rx->__filter : NULL);
+    }
+    return pcap_dispatch(rx->__handle, rx->dispatch_count, process_frame, (uint8_t*)fc);
+}
+
+
 //
 // See receiver.h for description of non-static functions
 //
@@ -589,6 +907,23 @@ static void log_rx_configuration(const dxwifi_receiver* rx, const char* dev_name
 }
 
 
+const char* dxwifi_rx_stage_to_str(dxwifi_rx_stage_t stage) {
+    switch (stage)
+    {
+    case DXWIFI_RX_STAGE_CAPTURE:
+        return "capture";
+    case DXWIFI_RX_STAGE_ARCHIVE:
+        return "archive";
+    case DXWIFI_RX_STAGE_ESTIMATE:
+        return "estimate";
+    case DXWIFI_RX_STAGE_WRITE:
+        return "write";
+    default:
+        return "unknown";
+    }
+}
+
+
 void init_receiver(dxwifi_receiver* rx, const char* device_name) {
     debug_assert(rx);
 
@@ -596,7 +931,15 @@ void init_receiver(dxwifi_receiver* rx, const char* device_name) {
     char err_buff[PCAP_ERRBUF_SIZE];
 
     rx->__activated = false;
+
+    if(rx->air) {
+        open_air_interface(rx);
+        log_rx_configuration(rx, rx->air);
+        return;
+    }
+    rx->__has_fcs = true;
 #if defined(DXWIFI_TESTS)
+    rx->__has_fcs = false;
     if(rx->savefile) {
         rx->__handle = pcap_open_offline(rx->savefile, err_buff);
     }
@@ -639,6 +982,12 @@ void init_receiver(dxwifi_receiver* rx, const char* device_name) {
 void close_receiver(dxwifi_receiver* receiver) {
     debug_assert(receiver && receiver->__handle);
 
+    if(receiver->air) {
+        dxwifi_air_detach(&receiver->__air);
+        if(receiver->filter) {
+            pcap_freecode(&receiver->__filter);
+        }
+    }
     pcap_close(receiver->__handle);
 
     log_info("DxWiFi receiver closed");
@@ -652,11 +1001,11 @@ void receiver_activate_capture(dxwifi_receiver* rx, int fd, dxwifi_rx_stats* out
     frame_controller fc;
 
     struct pollfd request = {
-        .fd         = pcap_get_selectable_fd(rx->__handle),
+        .fd         = rx->air ? -1 : pcap_get_selectable_fd(rx->__handle),
         .events     = POLLIN,
         .revents    = 0
     };
-    assert_M(request.fd >= 0, "Receiver handle cannot be polled");
+    assert_M(rx->air || request.fd >= 0, "Receiver handle cannot be polled");
 
     init_frame_controller(&fc, rx, fd);
 
@@ -665,7 +1014,7 @@ void receiver_activate_capture(dxwifi_receiver* rx, int fd, dxwifi_rx_stats* out
 
     while(rx->__activated && !fc.end_capture) {
 
-        status = poll(&request, 1, rx->capture_timeout * 1000);
+        status = wait_for_frames(rx, &request);
 
         if(status == 0) {
             log_info("Receiver timeout occured");
@@ -682,11 +1031,11 @@ void receiver_activate_capture(dxwifi_receiver* rx, int fd, dxwifi_rx_stats* out
             }
         }
         else {
-            status = pcap_dispatch(rx->__handle, rx->dispatch_count, process_frame, (uint8_t*)&fc);
+            status = dispatch_frames(rx, &fc);
 
 #if defined(DXWIFI_TESTS)
             // When reading from a savefile, 0 denotes that there are no more packets
-            if(status == 0) {
+            if(status == 0 && !rx->air) {
                 rx->__activated = false;
                 fc.rx_stats.capture_state = DXWIFI_RX_DEACTIVATED;
             }
@@ -699,10 +1048,17 @@ void receiver_activate_capture(dxwifi_receiver* rx, int fd, dxwifi_rx_stats* out
 
     dump_packet_buffer(&fc); // Flush out whatever's leftover in the buffer
 
-    if( pcap_stats(rx->__handle, &fc.rx_stats.pcap_stats) == PCAP_ERROR) {
+    charge_stage(&fc, DXWIFI_RX_STAGE_CAPTURE);
+
+    if(rx->air) {
+        dxwifi_air_pcap_stats(&rx->__air, &fc.rx_stats.pcap_stats);
+    }
+    else if( pcap_stats(rx->__handle, &fc.rx_stats.pcap_stats) == PCAP_ERROR) {
         log_warning("Failed to gather capture stats from PCAP");
     }
 
+    dxwifi_mem_get_usage(DXWIFI_MEM_ALL_SUBSYSTEMS, &fc.rx_stats.memory);
+
     if(out) {
         *out = fc.rx_stats;
     }
@@ -20,6 +20,9 @@
 #include <pcap.h>
 
 #include <libdxwifi/fec.h>
+#include <libdxwifi/archive.h>
+#include <libdxwifi/details/air.h>
+#include <libdxwifi/details/memory.h>
 #include <libdxwifi/details/radiotap.h>
 #include <libdxwifi/details/ieee80211.h>
 
@@ -31,6 +34,10 @@
 #define DXWIFI_RX_PACKET_BUFFER_SIZE_MIN IEEE80211_MTU_MAX_LEN
 #define DXWIFI_RX_PACKET_BUFFER_SIZE_MAX (1024 * 1024 * 5)  // 5mb
 
+// Number of data frames between decodability updates. Changes of state are
+// always reported right away
+#define DXWIFI_RX_ESTIMATE_INTERVAL 16
+
 
 /************************
  *  Data structures
@@ -80,7 +87,8 @@ typedef struct {
  * 
  * 
  *    [ radiotap header + radiotap fields ] <--
- *    [         ieee80211 header          ]   |- All allocated on the same block
+ *    [         ieee80211 header          ]   |
+ *    [          DxWiFi header            ]   |- All allocated on the same block
  *    [             payload               ]   |
  *    [       frame check sequence        ] <--
  *   
@@ -92,6 +100,7 @@ typedef struct {
 typedef struct {
     const ieee80211_radiotap_hdr  *rtap_hdr;  /* packed radiotap header       */
     const ieee80211_hdr           *mac_hdr;   /* link-layer header            */
+    const dxwifi_frame_hdr        *dxwifi_hdr;/* object id and sequence       */
     const uint8_t                 *payload;   /* packet data                  */
     const uint8_t                 *fcs;       /* frame check sequence         */
 
@@ -99,6 +108,25 @@ typedef struct {
 } dxwifi_rx_frame;
 
 
+/**
+ *  Stages a captured frame goes through. CPU time is charged to one stage at a
+ *  time, so the stages add up to the time spent handling frames.
+ */
+typedef enum {
+    DXWIFI_RX_STAGE_CAPTURE,    /* Parsing and buffering frames             */
+    DXWIFI_RX_STAGE_ARCHIVE,    /* Appending frames to the archive          */
+    DXWIFI_RX_STAGE_ESTIMATE,   /* Updating the decodability estimate       */
+    DXWIFI_RX_STAGE_WRITE,      /* Writing buffered payloads to the sink    */
+    DXWIFI_RX_STAGE_COUNT
+} dxwifi_rx_stage_t;
+
+
+typedef struct {
+    uint64_t    cpu_ns;         /* Thread CPU time spent in the stage       */
+    uint32_t    runs;           /* Number of times the stage ran            */
+} dxwifi_rx_stage_stats;
+
+
 /**
  *  The stats object is used to track information about each data frame captured
  *  as well as overall capture statistics.
@@ -116,18 +144,35 @@ typedef struct {
     struct pcap_pkthdr      pkt_stats;              /* Stats for the current capture    */
     struct pcap_stat        pcap_stats;             /* Pcap statistics                  */
     dxwifi_rx_radiotap_hdr  rtap;                   /* Radiotap metadata                */
+    dxwifi_object_manifest  manifest;               /* Object announced by the tx       */
+    dxwifi_fec_estimate     estimate;               /* Decodability of the object       */
+    dxwifi_mem_usage        memory;                 /* Memory held by libdxwifi         */
+    dxwifi_rx_stage_stats   stages[DXWIFI_RX_STAGE_COUNT];
+                                                    /* CPU time of each stage           */
 } dxwifi_rx_stats;
 
 
+/**
+ *  Called during a capture with the stats of the current object whenever its
+ *  decodability estimate changes state and every DXWIFI_RX_ESTIMATE_INTERVAL
+ *  data frames. Called from inside the capture loop, keep it short.
+ */
+typedef void (*dxwifi_rx_estimate_cb)(const dxwifi_rx_stats* stats, void* user);
+
+
 /**
  *  Receiver is responsible for handling packet capture. The receiver must be
  *  initialized before use and torn down after. It is the user's responsibility 
  *  to fill in the fields with the correct capture settings they want. 
  * 
- *  NOTES: add_noise is only used if the ordered flag is set. When receiving an
- *  "ordered" transmission it's important that the frame number is stuffed into 
- *  the last four bytes of the MAC header's addr1 field. If the frame number 
- *  is not present then the receiver will not be able to sort the packet data.
+ *  NOTES: add_noise is only used if the ordered flag is set. Ordered captures 
+ *  sort frames by the sequence number in the DxWiFi header, frames whose header
+ *  is damaged are dropped and show up as lost blocks. When an archive is set
+ *  every data frame from the sender is appended to it as it arrives, including
+ *  the ones an ordered capture drops. The decodability of the object being
+ *  captured is tracked from the OTI of each data frame, see 
+ *  dxwifi_fec_estimator. When air is set frames are captured from that virtual
+ *  air interface instead of the device, see air.h.
  * 
  */
 typedef struct {
@@ -140,6 +185,12 @@ typedef struct {
     uint8_t     sender_addr[IEEE80211_MAC_ADDR_LEN];
                                     /* Transmitters MAC address               */
     uint32_t    max_hamming_dist;   /* Max number of bit errors in address    */
+    dxwifi_archive_writer* archive; /* Archive for every data frame or NULL   */
+    dxwifi_rx_estimate_cb on_estimate;
+                                    /* Decodability updates or NULL           */
+    void*       estimate_user;      /* Passed along to on_estimate            */
+    const char* air;                /* Virtual air interface or NULL          */
+    dxwifi_air_channel air_channel; /* Channel model of this receiver         */
 
     // https://www.tcpdump.org/manpages/pcap.3pcap.html
     const char *filter;             /* BPF Program string                     */
@@ -149,6 +200,9 @@ typedef struct {
 
     volatile bool   __activated;    /* Currently capturing packets?           */
     pcap_t*         __handle;       /* Pcap session handle                    */
+    dxwifi_air      __air;          /* Air interface session                  */
+    struct bpf_program __filter;    /* Filter applied to air interface frames */
+    bool            __has_fcs;      /* Captured frames end with an FCS?       */
 
 #if defined(DXWIFI_TESTS)
     const char*     savefile;       /* Name of file to read packets from      */
@@ -166,6 +220,11 @@ typedef struct {
     .noise_value        = 0xff,\
     .sender_addr        = DXWIFI_DFLT_SENDER_ADDR,\
     .max_hamming_dist   = 5,\
+    .archive            = NULL,\
+    .on_estimate        = NULL,\
+    .estimate_user      = NULL,\
+    .air                = NULL,\
+    .air_channel        = DXWIFI_AIR_CHANNEL_CLEAR,\
     .filter             = NULL,\
     .optimize           = true,\
     .snaplen            = DXWIFI_SNAPLEN_MAX,\
@@ -177,6 +236,11 @@ typedef struct {
  *  Functions
  ***********************/
 
+/**
+ *  DESCRIPTION:    Name of a stage for logging
+ */
+const char* dxwifi_rx_stage_to_str(dxwifi_rx_stage_t stage);
+
 
 /**
  *  DESCRIPTION:    Initializes the receiver object
@@ -23,8 +23,10 @@
 #include <libdxwifi/power_amp.h>
 #include <libdxwifi/transmitter.h>
 #include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/crc32.h>
 #include <libdxwifi/details/assert.h>
 #include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/probes.h>
 
 
 /**
@@ -214,7 +216,8 @@ static bool invoke_handlers(dxwifi_tx_frame_handler* pipeline, dxwifi_tx_frame*
  *  NOTES:
  * 
  *      If runninng a test build this function will dump the frame to a savefile
- *      instead of using pcap_inject
+ *      instead of using pcap_inject. Frames go on the air interface instead
+ *      when one is set
  * 
  */
 static int inject_packet(dxwifi_transmitter* tx, dxwifi_tx_frame* frame, dxwifi_tx_stats* stats) {
@@ -228,16 +231,23 @@ static int inject_packet(dxwifi_transmitter* tx, dxwifi_tx_frame* frame, dxwifi_
     }
 
     if(transmit) {
+        DXWIFI_PROBE2(inject__start, stats->data_frame_count, frame_size);
+        if(tx->air) {
+            status = dxwifi_air_send(&tx->__air, frame, frame_size);
+        }
+        else {
 #if defined(DXWIFI_TESTS)
-        struct pcap_pkthdr pcap_hdr;
-        gettimeofday(&pcap_hdr.ts, NULL);
-        pcap_hdr.caplen = frame_size;
-        pcap_hdr.len = pcap_hdr.caplen;
-        pcap_dump((uint8_t*)tx->dumper, &pcap_hdr, (void*)frame);
-        status = pcap_hdr.caplen;
+            struct pcap_pkthdr pcap_hdr;
+            gettimeofday(&pcap_hdr.ts, NULL);
+            pcap_hdr.caplen = frame_size;
+            pcap_hdr.len = pcap_hdr.caplen;
+            pcap_dump((uint8_t*)tx->dumper, &pcap_hdr, (void*)frame);
+            status = pcap_hdr.caplen;
 #else
-        status = pcap_inject(tx->__handle, frame, frame_size);
+            status = pcap_inject(tx->__handle, frame, frame_size);
 #endif
+        }
+        DXWIFI_PROBE2(inject__done, stats->data_frame_count, status);
     }
     assert_continue(status != PCAP_ERROR, "Injection failure: %s", pcap_statustostr(status));
 
@@ -256,25 +266,28 @@ static int inject_packet(dxwifi_transmitter* tx, dxwifi_tx_frame* frame, dxwifi_
  * 
  *      type:       The kind of control frame we are sending
  * 
+ *      manifest:   Object being transmitted
+ * 
  *  NOTES:
  *      
- *      The current control frame strategy is very simple. Just send a block of
- *      repeating data. Each control frame type corresponds to a data value, 
- *      that value is repeated N number times, packaged up into the data frame
- *      and sent over the wire X times for redundancy.
+ *      Control frames are flagged in the DxWiFi header and carry the object 
+ *      manifest behind a magic number and a CRC, see dxwifi_control_frame. The frame is sent X times 
+ *      for redundancy, copies that fail the CRC are still known by their fill.
  * 
  */
-static void send_control_frame(dxwifi_transmitter* tx, dxwifi_tx_frame* frame, dxwifi_control_frame_t type, dxwifi_tx_stats* stats) {
-    debug_assert(tx && tx->__handle && frame);
+static void send_control_frame(dxwifi_transmitter* tx, dxwifi_tx_frame* frame, dxwifi_control_frame_t type, const dxwifi_object_manifest* manifest, dxwifi_tx_stats* stats) {
+    debug_assert(tx && tx->__handle && frame && manifest);
 
     dxwifi_control_frame_t prev_type = stats->frame_type;
 
     stats->frame_type = type;
 
-    uint8_t control_data[DXWIFI_FRAME_CONTROL_SIZE];
-    memset(control_data, type, DXWIFI_FRAME_CONTROL_SIZE);
+    pack_frame_header(&frame->dxwifi_hdr, DXWIFI_FRAME_FLAG_CONTROL, manifest->object_id, 0);
+
+    dxwifi_control_frame control_frame;
+    pack_control_frame(&control_frame, type, manifest);
 
-    memcpy(frame->payload, control_data, DXWIFI_FRAME_CONTROL_SIZE);
+    memcpy(frame->payload, &control_frame, DXWIFI_FRAME_CONTROL_SIZE);
 
     for (int i = 0; i < tx->redundant_ctrl_frames + 1; ++i) {
 
@@ -289,6 +302,23 @@ static void send_control_frame(dxwifi_transmitter* tx, dxwifi_tx_frame* frame, d
 }
 
 
+/**
+ *  DESCRIPTION:    Hands out the next object id, zero is never used so that it
+ *                  can mean "assign one"
+ * 
+ *  ARGUMENTS: 
+ * 
+ *      tx:         Initialized transmitter
+ * 
+ */
+static uint32_t next_object_id(dxwifi_transmitter* tx) {
+    if(++tx->__object_id == 0) {
+        ++tx->__object_id;
+    }
+    return tx->__object_id;
+}
+
+
 /**
  *  DESCRIPTION:    Logs transmitter settings afer initialization
  * 
@@ -320,6 +350,29 @@ static void log_tx_configuration(const dxwifi_transmitter* tx, const char* devic
 }
 
 
+/**
+ *  DESCRIPTION:    Attaches the transmitter to a virtual air interface. The
+ *                  pcap handle is opened dead so the rest of the transmitter 
+ *                  works the same
+ * 
+ *  ARGUMENTS:
+ * 
+ *      tx:         Transmitter with an air interface set
+ * 
+ */
+static void open_air_interface(dxwifi_transmitter* tx) {
+    tx->__handle = pcap_open_dead(DLT_IEEE802_11_RADIO, DXWIFI_SNAPLEN_MAX);
+    assert_M(tx->__handle != NULL, "Failed to open a pcap handle for the air interface");
+
+#if defined(DXWIFI_TESTS)
+    tx->dumper = NULL;
+#endif
+    tx->__air.channel = tx->air_channel;
+    bool attached = dxwifi_air_attach(&tx->__air, tx->air, DXWIFI_AIR_TRANSMITTER);
+    assert_M(attached, "Failed to attach to air interface %s", tx->air);
+}
+
+
 //
 // See transmitter.h for description of non-static functions
 //
@@ -330,10 +383,17 @@ void init_transmitter(dxwifi_transmitter* tx, const char* device_name) {
     char err_buff[PCAP_ERRBUF_SIZE];
 
     tx->__activated = false;
+    tx->__object_id = rand();
 
     memset(tx->__preinjection,  0x00, sizeof(dxwifi_tx_frame_handler) * DXWIFI_TX_FRAME_HANDLER_MAX);
     memset(tx->__postinjection, 0x00, sizeof(dxwifi_tx_frame_handler) * DXWIFI_TX_FRAME_HANDLER_MAX);
 
+    if(tx->air) {
+        open_air_interface(tx);
+        log_tx_configuration(tx, tx->air);
+        return;
+    }
+
 #if defined(DXWIFI_TESTS)
     tx->__handle = pcap_open_dead(DLT_IEEE802_11_RADIO, DXWIFI_SNAPLEN_MAX);
     if(tx->savefile) {
@@ -373,7 +433,10 @@ void close_transmitter(dxwifi_transmitter* tx) {
 
     pcap_close(tx->__handle);
 
-    if(tx->enable_pa) {
+    if(tx->air) {
+        dxwifi_air_detach(&tx->__air);
+    }
+    else if(tx->enable_pa) {
         pa_error_t status = close_power_amplifier();
         if(status != PA_OKAY) {
             log_error("%s", pa_error_to_str(status));
@@ -386,7 +449,9 @@ void close_transmitter(dxwifi_transmitter* tx) {
     log_info("DxWifi transmitter closed");
 
 #if defined(DXWIFI_TESTS)
-    pcap_dump_close(tx->dumper);
+    if(tx->dumper) {
+        pcap_dump_close(tx->dumper);
+    }
 #endif
 }
 
@@ -452,7 +517,13 @@ void start_transmission(dxwifi_transmitter* tx, int fd, dxwifi_tx_stats* out) {
 
     tx->__activated = true;
 
-    send_control_frame(tx, &data_frame, DXWIFI_CONTROL_FRAME_PREAMBLE, &stats);
+    // Size and hash of a stream aren't known until it ends
+    dxwifi_object_manifest manifest = {
+        .object_id  = next_object_id(tx),
+        .codec      = DXWIFI_CODEC_NONE
+    };
+
+    send_control_frame(tx, &data_frame, DXWIFI_CONTROL_FRAME_PREAMBLE, &manifest, &stats);
 
     do {
         status = poll(&request, 1, tx->transmit_timeout * 1000);
@@ -483,6 +554,8 @@ void start_transmission(dxwifi_transmitter* tx, int fd, dxwifi_tx_stats* out) {
                         );
                 }
 
+                pack_frame_header(&data_frame.dxwifi_hdr, 0, manifest.object_id, stats.data_frame_count);
+
                 stats.prev_bytes_sent = inject_packet(tx, &data_frame, &stats);
 
                 stats.total_bytes_read += stats.prev_bytes_read;
@@ -494,12 +567,15 @@ void start_transmission(dxwifi_transmitter* tx, int fd, dxwifi_tx_stats* out) {
         }
     } while(tx->__activated && stats.prev_bytes_read > 0);
 
-    send_control_frame(tx, &data_frame, DXWIFI_CONTROL_FRAME_EOT, &stats);
+    manifest.size = stats.total_bytes_read;
+    send_control_frame(tx, &data_frame, DXWIFI_CONTROL_FRAME_EOT, &manifest, &stats);
 
     log_info("DxWiFI Transmission stopped");
 
 #if defined(DXWIFI_TESTS)
-    pcap_dump_flush(tx->dumper);
+    if(tx->dumper) {
+        pcap_dump_flush(tx->dumper);
+    }
 #endif 
 
     if(stats.tx_state == DXWIFI_TX_NORMAL && !tx->__activated) {
@@ -515,6 +591,25 @@ void start_transmission(dxwifi_transmitter* tx, int fd, dxwifi_tx_stats* out) {
 void transmit_bytes(dxwifi_transmitter* tx, const void* data, size_t nbytes, dxwifi_tx_stats* out) {
     debug_assert(tx && tx->__handle && data);
 
+    dxwifi_object_manifest manifest = {
+        .object_id  = 0,
+        .size       = nbytes,
+        .hash       = crc32(data, nbytes),
+        .k          = 0,
+        .n          = 0,
+        .codec      = DXWIFI_CODEC_NONE
+    };
+    transmit_object(tx, data, nbytes, &manifest, out);
+}
+
+
+void transmit_object(dxwifi_transmitter* tx, const void* data, size_t nbytes, dxwifi_object_manifest* manifest, dxwifi_tx_stats* out) {
+    debug_assert(tx && tx->__handle && data && manifest);
+
+    if(manifest->object_id == 0) {
+        manifest->object_id = next_object_id(tx);
+    }
+
     dxwifi_tx_stats stats = {
         .data_frame_count   = 0,
         .ctrl_frame_count   = 0,
@@ -534,7 +629,7 @@ void transmit_bytes(dxwifi_transmitter* tx, const void* data, size_t nbytes, dxw
 
     log_debug("Starting DxWiFi Transmission...");
 
-    send_control_frame(tx, &data_frame, DXWIFI_CONTROL_FRAME_PREAMBLE, &stats);
+    send_control_frame(tx, &data_frame, DXWIFI_CONTROL_FRAME_PREAMBLE, manifest, &stats);
 
     while (nbytes > 0)
     {
@@ -551,6 +646,8 @@ void transmit_bytes(dxwifi_transmitter* tx, const void* data, size_t nbytes, dxw
                 );
         }
 
+        pack_frame_header(&data_frame.dxwifi_hdr, 0, manifest->object_id, stats.data_frame_count);
+
         stats.prev_bytes_sent = inject_packet(tx, &data_frame, &stats);
 
         stats.data_frame_count += 1;
@@ -561,10 +658,12 @@ void transmit_bytes(dxwifi_transmitter* tx, const void* data, size_t nbytes, dxw
         invoke_handlers(tx->__postinjection, &data_frame, &stats);
     }
 
-    send_control_frame(tx, &data_frame, DXWIFI_CONTROL_FRAME_EOT, &stats);
+    send_control_frame(tx, &data_frame, DXWIFI_CONTROL_FRAME_EOT, manifest, &stats);
 
 #if defined(DXWIFI_TESTS)
-    pcap_dump_flush(tx->dumper);
+    if(tx->dumper) {
+        pcap_dump_flush(tx->dumper);
+    }
 #endif
     log_debug("DxWiFI Transmission stopped");
 
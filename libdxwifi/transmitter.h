@@ -21,6 +21,7 @@
 
 #include <libdxwifi/fec.h>
 #include <libdxwifi/dxwifi.h>
+#include <libdxwifi/details/air.h>
 #include <libdxwifi/details/assert.h>
 #include <libdxwifi/details/radiotap.h>
 #include <libdxwifi/details/ieee80211.h>
@@ -30,7 +31,7 @@
  ***********************/
 
 #define DXWIFI_TX_HEADER_SIZE \
-    (sizeof(dxwifi_tx_radiotap_hdr) + sizeof(ieee80211_hdr))
+    (sizeof(dxwifi_tx_radiotap_hdr) + sizeof(ieee80211_hdr) + sizeof(dxwifi_frame_hdr))
 
 #define DXWIFI_TX_PAYLOAD_SIZE DXWIFI_RS_LDPC_FRAME_SIZE
 
@@ -79,7 +80,8 @@ compiler_assert(sizeof(dxwifi_tx_radiotap_hdr) == DXWIFI_TX_RADIOTAP_HDR_SIZE,
  * 
  * 
  *    [ radiotap header + radiotap fields ] <--
- *    [         ieee80211 header          ]   |- All allocated on the same block
+ *    [         ieee80211 header          ]   |
+ *    [          DxWiFi header            ]   |- All allocated on the same block
  *    [             payload               ]   |
  *    [       frame check sequence        ] <--
  *   
@@ -93,6 +95,7 @@ typedef struct __attribute__((packed)) {
     // Actual Data Frame
     dxwifi_tx_radiotap_hdr  radiotap_hdr;  /* frame metadata               */
     ieee80211_hdr           mac_hdr;       /* link-layer header            */
+    dxwifi_frame_hdr        dxwifi_hdr;    /* object id and sequence       */
     uint8_t                 payload[DXWIFI_TX_PAYLOAD_SIZE];       
                                            /* packet data, driver attaches FCS */
 } dxwifi_tx_frame;
@@ -161,7 +164,8 @@ typedef struct {
  *  Transmitter is responsible for handling file transmission. The transmitter
  *  must be intialized before use and torn down after. It is the user's 
  *  responsibility to fill in the fields with the correct data they want for 
- *  their transmission.
+ *  their transmission. When air is set frames are sent on that virtual air
+ *  interface instead of the device, see air.h.
  */
 typedef struct {
     int         transmit_timeout;   /* Number of seconds to wait for a read */
@@ -174,6 +178,8 @@ typedef struct {
     uint8_t     rtap_rate_mbps;     /* Radiotap data rate                   */
     uint16_t    rtap_tx_flags;      /* Radiotap Tx flags                    */
     ieee80211_frame_control fctl;   /* Frame control settings               */
+    const char* air;                /* Virtual air interface or NULL        */
+    dxwifi_air_channel air_channel; /* Channel model of this transmitter    */
 
 
     dxwifi_tx_frame_handler __preinjection[DXWIFI_TX_FRAME_HANDLER_MAX];
@@ -181,7 +187,9 @@ typedef struct {
     dxwifi_tx_frame_handler __postinjection[DXWIFI_TX_FRAME_HANDLER_MAX];
                                     /* Called after injection               */
     volatile bool   __activated;    /* Currently transmitting?              */
+    uint32_t        __object_id;    /* Id of the last object announced      */
     pcap_t*         __handle;       /* Session handle for Pcap              */
+    dxwifi_air      __air;          /* Air interface session                */
 
 #if defined(DXWIFI_TESTS)
     const char*     savefile;       /* File to dump packet data to          */
@@ -211,6 +219,8 @@ typedef struct {
         .order              = false\
     },\
     .address = DXWIFI_DFLT_SENDER_ADDR,\
+    .air = NULL,\
+    .air_channel = DXWIFI_AIR_CHANNEL_CLEAR,\
 }\
 
 
@@ -375,6 +385,29 @@ void start_transmission(dxwifi_transmitter* transmitter, int fd, dxwifi_tx_stats
 void transmit_bytes(dxwifi_transmitter* transmitter, const void* data, size_t nbytes, dxwifi_tx_stats* out);
 
 
+/**
+ *  DESCRIPTION:        Transmit nbytes from data, announcing them with the
+ *                      given manifest in the preamble and EOT control frames
+ * 
+ *  ARGUMENTS:
+ * 
+ *      transmitter:    pointer to an initialized transmitter object
+ * 
+ *      data:           Bytes to transmit
+ * 
+ *      nbytes:         Number of bytes to transmit
+ * 
+ *      manifest:       Object the bytes encode. If the object id is zero an id 
+ *                      is assigned and written back, pass the same manifest 
+ *                      when retransmitting so every copy shares the id
+ * 
+ *      out:            Pointer to an allocated stats object or NULL if stats
+ *                      aren't needed. 
+ * 
+ */
+void transmit_object(dxwifi_transmitter* transmitter, const void* data, size_t nbytes, dxwifi_object_manifest* manifest, dxwifi_tx_stats* out);
+
+
 /**
  *  DESCRIPTION:    Signals to the transmitter to stop transmitting packets
  * 
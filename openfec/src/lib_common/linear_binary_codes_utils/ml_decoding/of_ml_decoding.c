@@ -90,8 +90,8 @@ of_linear_binary_code_finish_decoding_with_ml (of_linear_binary_code_cb_t	*ofcb)
 {
 	INT32		i;
 	UINT32		*permutation_array		= NULL;
-	of_mod2dense	*dense_pchk_matrix_simplified	= NULL;
-	INT32		*column_idx			= NULL;
+	INT32		nb_rows				= 0;
+	INT32		nb_cols				= 0;
 	void		**const_term			= NULL;
 	void		**variable_member		= NULL;
 	UINT32		nb_computed_repair_in_ml;
@@ -133,6 +133,12 @@ of_linear_binary_code_finish_decoding_with_ml (of_linear_binary_code_cb_t	*ofcb)
 	 */
 	for (i = 0 ; i < ofcb->nb_source_symbols ; i++)
 	{
+		if ((i & OF_CANCEL_POLL_MASK) == 0 && of_is_cancelled ())
+		{
+			OF_TRACE_LVL(1,("%s: cancelled\n", __FUNCTION__))
+			OF_EXIT_FUNCTION
+			return OF_STATUS_FAILURE;
+		}
 		if (ofcb->encoding_symbols_tab[i] != NULL)
 		{
 			if (of_linear_binary_code_simplify_linear_system_with_a_symbol (ofcb, ofcb->encoding_symbols_tab[i], i) != OF_STATUS_OK)
@@ -165,6 +171,11 @@ of_linear_binary_code_finish_decoding_with_ml (of_linear_binary_code_cb_t	*ofcb)
 	/* Inject parity symbols following the random order given by permutation_array */
 	for (i = 0 ; i < ofcb->nb_repair_symbols ; i++)
 	{
+		if ((i & OF_CANCEL_POLL_MASK) == 0 && of_is_cancelled ())
+		{
+			OF_TRACE_LVL(1,("%s: cancelled\n", __FUNCTION__))
+			goto failure;
+		}
 		if (ofcb->encoding_symbols_tab[ofcb->nb_source_symbols+permutation_array[i]] != NULL)
 		{
 			if (of_linear_binary_code_simplify_linear_system_with_a_symbol (ofcb, ofcb->encoding_symbols_tab[ofcb->nb_source_symbols+permutation_array[i]],
@@ -186,53 +197,42 @@ of_linear_binary_code_finish_decoding_with_ml (of_linear_binary_code_cb_t	*ofcb)
 #ifdef IL_SUPPORT
 	of_mod2sparse_print_bitmap(ofcb->pchk_matrix_simplified);
 #endif
-	/*
-	 * It's now time to create the simplified matrix, in dense format.
-	 */
-	dense_pchk_matrix_simplified = of_mod2dense_allocate (ofcb->pchk_matrix_simplified->n_rows, ofcb->pchk_matrix_simplified->n_cols);
-	of_mod2sparse_to_dense (ofcb->pchk_matrix_simplified, dense_pchk_matrix_simplified);
-	/* and immediately free the now useless sparse version to save memory... */
-	of_mod2sparse_free (ofcb->pchk_matrix_simplified);
-	of_free (ofcb->pchk_matrix_simplified);
-	ofcb->pchk_matrix_simplified = NULL;
-
+	nb_rows = of_mod2sparse_rows (ofcb->pchk_matrix_simplified);
+	nb_cols = of_mod2sparse_cols (ofcb->pchk_matrix_simplified);
 #ifdef DEBUG
 	gettimeofday (&gdtv0, NULL);
 	OF_TRACE_LVL (1, ("gauss_decoding_start=%ld.%ld\n", gdtv0.tv_sec, gdtv0.tv_usec))
 #endif
-	if ((column_idx = (INT32 *) of_malloc (of_mod2dense_cols (dense_pchk_matrix_simplified) * sizeof (INT32))) == NULL)
+	if ((const_term = (void **) of_malloc (nb_rows * sizeof (void*))) == NULL)
 	{
 		goto no_mem;
 	}
-	for (i = 0; i < of_mod2dense_cols (dense_pchk_matrix_simplified); i++)
-	{
-		column_idx[i] = i;
-	}
-	if ((const_term = (void **) of_malloc (of_mod2dense_rows (dense_pchk_matrix_simplified) * sizeof (void*))) == NULL)
-	{
-		goto no_mem;
-	}
-	for (i = 0; i < of_mod2dense_rows (dense_pchk_matrix_simplified); i++)
+	for (i = 0; i < nb_rows; i++)
 	{
 		const_term[i] = ofcb->tab_const_term_of_equ[ofcb->index_rows[i]];
 		ofcb->tab_const_term_of_equ[ofcb->index_rows[i]] = NULL;
 	}
-	if ((variable_member = (void **) of_calloc (of_mod2dense_cols (dense_pchk_matrix_simplified), sizeof (void*))) == NULL)
+	if ((variable_member = (void **) of_calloc (nb_cols, sizeof (void*))) == NULL)
 	{
 		goto no_mem;
 	}
 	/*
-	 * And finally launch Gaussian Elimination.
+	 * And finally launch the Gaussian Elimination. Most of the simplified system is solved by
+	 * peeling, only the inactivated columns end up in a dense matrix.
 	 */
-	if (of_linear_binary_code_solve_dense_system (ofcb, dense_pchk_matrix_simplified, const_term, variable_member) != OF_STATUS_OK)
+	if (of_linear_binary_code_solve_sparse_system_with_inactivation (ofcb, ofcb->pchk_matrix_simplified,
+									 const_term, variable_member) != OF_STATUS_OK)
 	{
-		OF_TRACE_LVL(0,("Solve dense system failed\n"))
+		OF_TRACE_LVL(0,("Solve sparse system failed\n"))
 		goto failure;
 	}
+	of_mod2sparse_free (ofcb->pchk_matrix_simplified);
+	of_free (ofcb->pchk_matrix_simplified);
+	ofcb->pchk_matrix_simplified = NULL;
 	/*
 	 * the system has been solved, so store the result in the canvas
 	 */
-	OF_TRACE_LVL (1, ("Solve dense system successful\n"))
+	OF_TRACE_LVL (1, ("Solve sparse system successful\n"))
 	nb_computed_repair_in_ml = ofcb->nb_repair_symbols - ofcb->nb_repair_symbol_ready; /* this is the number of repair found in ML */
 	/* ignore the first nb_computed_repair_in_ml symbols found in ML as they are repair symbols and we don't need them */
 	for (i = 0; i < nb_computed_repair_in_ml; i++)
@@ -260,7 +260,7 @@ of_linear_binary_code_finish_decoding_with_ml (of_linear_binary_code_cb_t	*ofcb)
 			gdtv1.tv_sec, gdtv1.tv_usec, gdtv_delta.tv_sec, gdtv_delta.tv_usec))
 #endif
 
-	for (i = 0; i < of_mod2dense_rows (dense_pchk_matrix_simplified); i++)
+	for (i = 0; i < nb_rows; i++)
 	{
 		if (const_term[i])
 		{
@@ -271,10 +271,6 @@ of_linear_binary_code_finish_decoding_with_ml (of_linear_binary_code_cb_t	*ofcb)
 	const_term = NULL;
 	of_free(variable_member);
 	variable_member = NULL;
-	of_free(column_idx);
-	column_idx = NULL;
-	of_mod2dense_free(dense_pchk_matrix_simplified);
-	dense_pchk_matrix_simplified = NULL;
 	OF_EXIT_FUNCTION
 	return OF_STATUS_OK;
 
@@ -286,7 +282,7 @@ failure:
 	}
 	if (const_term != NULL)
 	{
-		for (i = 0; i < of_mod2dense_rows (dense_pchk_matrix_simplified); i++)
+		for (i = 0; i < nb_rows; i++)
 		{
 			if (const_term[i])
 			{
@@ -298,21 +294,152 @@ failure:
 	}
 	if (variable_member != NULL)
 	{
+		for (i = 0; i < nb_cols; i++)
+		{
+			if (variable_member[i])
+			{
+				of_free(variable_member[i]);
+			}
+		}
 		of_free(variable_member);
 		variable_member = NULL;
 	}
-	if (column_idx != NULL)
+	if (ofcb->pchk_matrix_simplified != NULL)
 	{
-		of_free(column_idx);
-		column_idx = NULL;
+		of_mod2sparse_free (ofcb->pchk_matrix_simplified);
+		of_free (ofcb->pchk_matrix_simplified);
+		ofcb->pchk_matrix_simplified = NULL;
 	}
-	if (dense_pchk_matrix_simplified != NULL)
+	OF_EXIT_FUNCTION
+	return OF_STATUS_FAILURE;
+
+no_mem:
+	OF_PRINT_ERROR(("out of memory"))
+	OF_EXIT_FUNCTION
+	return OF_STATUS_FATAL_ERROR;
+}
+
+
+/**
+ * The system left by IT decoding is made of the unknown columns of the parity check matrix, the
+ * entries of known columns are only there because IT decoding is lazy. Peeling it gives the size of
+ * the dense core, and the cost of each step of of_linear_binary_code_finish_decoding_with_ml() then
+ * follows from the number of entries involved:
+ *  - step 0 adds each known symbol to the rows it is in;
+ *  - steps 2 and 3 add each peeled symbol to the rows it is in, and their inactive combinations;
+ *  - the triangularization of a dense r x i core adds about i.r/2 symbols and i.r.w/4 words;
+ *  - back-substitution adds about half the inactive symbols to each peeled one.
+ */
+of_status_t
+of_linear_binary_code_estimate_ml (of_linear_binary_code_cb_t	*ofcb,
+				   of_ml_estimate_t		*estimate)
+{
+	of_mod2sparse	*m = ofcb->pchk_matrix;
+	of_mod2entry	*e;
+	of_ml_peeling_t	peeling;
+	bool		*col_known;
+	bool		unknown_row;
+	UINT32		n_rows;
+	UINT32		n_cols;
+	UINT32		esi;
+	UINT32		row;
+	UINT32		i;
+	UINT64		nb_peeled_entries;
+	UINT64		w;
+	UINT32		k;
+	UINT64		nb_core_tables;
+	UINT64		nb_peeled_tables;
+	of_status_t	status;
+
+	OF_ENTER_FUNCTION
+	memset (estimate, 0, sizeof (*estimate));
+	if (m == NULL)
+	{
+		OF_PRINT_ERROR(("%s: no parity check matrix, ML decoding has already run\n", __FUNCTION__))
+		OF_EXIT_FUNCTION
+		return OF_STATUS_ERROR;
+	}
+	n_rows = of_mod2sparse_rows (m);
+	n_cols = of_mod2sparse_cols (m);
+	if ((col_known = (bool *) of_calloc (n_cols, sizeof (bool))) == NULL)
+	{
+		goto no_mem;
+	}
+	for (esi = 0; esi < ofcb->nb_total_symbols; esi++)
+	{
+		if (ofcb->encoding_symbols_tab[esi] != NULL)
+		{
+			col_known[of_get_symbol_col ((of_cb_t*)ofcb, esi)] = true;
+		}
+		else
+		{
+			estimate->nb_unknowns++;
+		}
+	}
+	for (row = 0; row < n_rows; row++)
+	{
+		unknown_row = false;
+		for (e = of_mod2sparse_first_in_row (m, row); !of_mod2sparse_at_end (e); e = of_mod2sparse_next_in_row (e))
+		{
+			if (col_known[of_mod2sparse_col (e)])
+				estimate->nb_symbol_ops++;
+			else
+				unknown_row = true;
+		}
+		if (unknown_row)
+			estimate->nb_equations++;
+	}
+	if (estimate->nb_unknowns == 0 || estimate->nb_unknowns > estimate->nb_equations)
+	{
+		/* nothing to decode, or no hope to: the whole system is the core */
+		estimate->nb_inactive = estimate->nb_unknowns;
+		estimate->nb_core_rows = estimate->nb_equations;
+		of_free (col_known);
+		OF_EXIT_FUNCTION
+		return OF_STATUS_OK;
+	}
+	status = of_linear_binary_code_peel (m, col_known, &peeling);
+	of_free (col_known);
+	if (status != OF_STATUS_OK)
+	{
+		of_linear_binary_code_free_peeling (&peeling);
+		OF_EXIT_FUNCTION
+		return status;
+	}
+	estimate->nb_inactive = peeling.nb_inactive;
+	estimate->nb_core_rows = peeling.nb_core_rows;
+	/* peeled symbols added to pivot rows (step 2) and to core rows (step 3) */
+	nb_peeled_entries = 0;
+	for (row = 0; row < n_rows; row++)
 	{
-		of_mod2dense_free(dense_pchk_matrix_simplified);
-		dense_pchk_matrix_simplified = NULL;
+		for (e = of_mod2sparse_first_in_row (m, row); !of_mod2sparse_at_end (e); e = of_mod2sparse_next_in_row (e))
+		{
+			i = of_mod2sparse_col (e);
+			if (peeling.col_state[i] == OF_ML_COL_PEELED && peeling.peel_row[peeling.col_index[i]] != row)
+			{
+				nb_peeled_entries++;
+			}
+		}
 	}
+	/*
+	 * The dense core and step 4 go through Four Russians tables: one table of 2^k sums per k
+	 * inactive columns, each sum being a copy and an addition, then one addition per row and
+	 * table. The dense core builds its tables twice, to triangularize and to back-substitute.
+	 */
+	w = (peeling.nb_inactive + of_mod2_wordsize - 1) >> of_mod2_wordsize_shift;
+	k = of_linear_binary_code_m4r_bits (peeling.nb_core_rows);
+	nb_core_tables = (peeling.nb_inactive + k - 1) / k;
+	nb_peeled_tables = (peeling.nb_inactive + OF_ML_M4R_MAX_BITS - 1) / OF_ML_M4R_MAX_BITS;
+	estimate->nb_symbol_ops += nb_peeled_entries
+				 + nb_core_tables * (4 * ((UINT64)1 << k) + peeling.nb_core_rows)
+				 + (peeling.nb_peeled > 0 ? nb_peeled_tables * (2 * ((UINT64)1 << OF_ML_M4R_MAX_BITS) + peeling.nb_peeled) : 0);
+	estimate->nb_word_ops = nb_peeled_entries * w
+			      + nb_core_tables * (((UINT64)1 << k) + peeling.nb_core_rows) * w;
+	OF_TRACE_LVL (1, ("%s: %d unknowns, %d equations, dense core is %dx%d\n", __FUNCTION__,
+			estimate->nb_unknowns, estimate->nb_equations, estimate->nb_core_rows, estimate->nb_inactive))
+	of_linear_binary_code_free_peeling (&peeling);
 	OF_EXIT_FUNCTION
-	return OF_STATUS_FAILURE;
+	return OF_STATUS_OK;
 
 no_mem:
 	OF_PRINT_ERROR(("out of memory"))
@@ -52,6 +52,20 @@
 of_status_t of_linear_binary_code_finish_decoding_with_ml (of_linear_binary_code_cb_t *ofcb);
 
 
+/**
+ * This function estimates what of_linear_binary_code_finish_decoding_with_ml() would take, from the
+ * structure of the system left by IT decoding. No symbol is touched and the session is unchanged.
+ *
+ * @fn of_status_t		of_linear_binary_code_estimate_ml (of_linear_binary_code_cb_t *ofcb, of_ml_estimate_t *estimate)
+ * @brief			estimate ML decoding
+ * @param ofcb 			(IN) Linear-Binary-Code control-block.
+ * @param estimate		(OUT) size of the system and of its dense core, and cost of solving it.
+ * @return			error status, OF_STATUS_FAILURE if cancelled.
+ */
+of_status_t of_linear_binary_code_estimate_ml (of_linear_binary_code_cb_t	*ofcb,
+					       of_ml_estimate_t			*estimate);
+
+
 #endif //ML_DECODING
 
 #endif //OF_USE_LINEAR_BINARY_CODES_UTILS
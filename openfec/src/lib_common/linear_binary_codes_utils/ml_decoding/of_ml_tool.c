@@ -42,11 +42,13 @@
 
 
 /**
- * This function transforms the matrix into a triangular matrix. It goes through each column and calls of_linear_binary_code_col_forward_elimination()
- * to find the pivot and eliminate '1's below the pivot.
+ * This function transforms the matrix into a triangular matrix with the Method of Four Russians. Columns are
+ * taken a few at a time: their pivots are found and reduced to the identity on these columns, then the sum
+ * of every combination of the pivot rows is computed once, so that each row below gets rid of all these
+ * columns with a single addition instead of one per pivot.
  *
  * @brief			triangularize the dense system
- * @param m			(IN/OUT) address of the dense matrix.
+ * @param m			(IN/OUT) address of the dense matrix.
  * @param constant_tab		(IN/OUT)
  * @param ofcb			(IN) Linear-Binary-Code control-block.
  * @return			1 if it's OK, or 0 if an error took place.
@@ -57,30 +59,13 @@ of_linear_binary_code_triangularize_dense_system (of_linear_binary_code_cb_t	*of
 						  void				**constant_tab);
 
 
-/**
- * This function finds the pivot for this column and eliminates '1's below this pivot.
- *
- * @brief			eliminates "1" entries in parity check matrix
- * @param m 			(IN/OUT) address of the dense matrix.
- * @param constant_tab		(IN/OUT) pointer to all constant members
- * @param ofcb			(IN/OUT) Linear-Binary-Code control-block.
- * @param col_idx		(IN) column index
- * @param stats			(IN)
- * @return			1 if it's OK, or 0 if an error took place.
- */
-static INT32
-of_linear_binary_code_col_forward_elimination  (of_linear_binary_code_cb_t	*ofcb,
-						of_mod2dense			*m,
-						void				**constant_tab,
-						INT32				col_idx);
-
-
 /**
  * This function computes the actual values of the symbols, starting from the bottom row up to the first one. It assumes the parity check matrix has
- * already been transformed into a triangular matrix.
+ * already been transformed into a triangular matrix. Variables are solved a few at a time, then added to the rows above
+ * with of_linear_binary_code_add_dense_products().
  *
  * @brief			solve system with backward substitution
- * @param variable_tab		(IN/OUT) address of the dense matrix.
+ * @param variable_tab		(IN/OUT) address of the dense matrix.
  * @param constant_tab
  * @param m 			(IN/OUT) address of the dense matrix.
  * @param ofcb			(IN/OUT) Linear-Binary-Code control-block.
@@ -93,6 +78,71 @@ of_linear_binary_code_backward_substitution (of_linear_binary_code_cb_t	*ofcb,
 					     void			*constant_tab[]);
 
 
+/**
+ * This function adds to each destination symbol the sum of the variables selected by its row of a dense matrix,
+ * with the Method of Four Russians: the columns are split in groups of a few bits, the sum of every combination
+ * of the variables of a group is computed once, and each row then adds a single precomputed sum per group rather
+ * than one symbol per bit set.
+ *
+ * @brief			adds the products of a dense matrix and a vector of symbols
+ * @param ofcb			(IN/OUT) Linear-Binary-Code control-block.
+ * @param m			(IN) address of the dense matrix.
+ * @param nb_rows		(IN) rows 0 to nb_rows - 1 of the matrix are used
+ * @param first_col		(IN) first column used
+ * @param end_col		(IN) columns first_col to end_col - 1 are used
+ * @param variable_tab		(IN) variable of each column used, from first_col on
+ * @param dest_tab		(IN/OUT) symbol each row is added to, allocated when NULL
+ * @return			error status, OF_STATUS_FAILURE if cancelled.
+ */
+static of_status_t
+of_linear_binary_code_add_dense_products (of_linear_binary_code_cb_t	*ofcb,
+					  of_mod2dense			*m,
+					  UINT32			nb_rows,
+					  UINT32			first_col,
+					  UINT32			end_col,
+					  void				**variable_tab,
+					  void				**dest_tab);
+
+
+/**
+ * This function builds the sums of all the combinations of a few symbols, indexed by the bit mask of the
+ * symbols combined. Each sum is a smaller one plus a symbol, so it takes one addition.
+ *
+ * @brief			builds a Four Russians table
+ * @param ofcb			(IN/OUT) Linear-Binary-Code control-block.
+ * @param table			(OUT) 2^nb_bits symbols, the first one being null
+ * @param variable_tab		(IN) nb_bits symbols
+ * @param nb_bits		(IN) number of symbols combined
+ */
+static void
+of_linear_binary_code_build_m4r_table (of_linear_binary_code_cb_t	*ofcb,
+				       UINT8				*table,
+				       void				**variable_tab,
+				       UINT32				nb_bits);
+
+
+/**
+ * This function removes a column from the set of active columns of the inactivation decoder (because it has
+ * either been peeled or inactivated) and updates the degree of all the non pivot rows it belongs to.
+ * Rows whose degree drops to one are pushed on the row stack, they are the next peeling candidates.
+ *
+ * @brief			removes a column from the active part of the sparse system
+ * @param m			(IN) address of the sparse matrix.
+ * @param col			(IN) column index
+ * @param row_is_pivot		(IN) rows already used to peel a column
+ * @param row_degree		(IN/OUT) number of active columns of each row
+ * @param row_stack		(IN/OUT) stack of degree one rows
+ * @param nb_stacked		(IN/OUT) number of rows in row_stack
+ */
+static void
+of_linear_binary_code_deactivate_col (of_mod2sparse	*m,
+				      UINT32		col,
+				      const bool	*row_is_pivot,
+				      UINT32		*row_degree,
+				      UINT32		*row_stack,
+				      UINT32		*nb_stacked);
+
+
 /******************************************************************************/
 
 
@@ -127,149 +177,654 @@ of_linear_binary_code_solve_dense_system (of_linear_binary_code_cb_t	*ofcb,
 }
 
 
-/******  Static Functions  ****************************************************/
-
-
-static
-INT32	of_linear_binary_code_triangularize_dense_system (of_linear_binary_code_cb_t	*ofcb,
-							  of_mod2dense			*m,
-							  void				**constant_tab)
+/**
+ * Peeling: while a row has a single active column, this row becomes the pivot of that column.
+ * When stuck, take the non pivot row of lowest degree and inactivate its heaviest active column.
+ */
+of_status_t
+of_linear_binary_code_peel (of_mod2sparse	*m,
+			    const bool		*col_known,
+			    of_ml_peeling_t	*peeling)
 {
-	INT32 i, n;
+	of_mod2entry	*e;
+	UINT8		*col_state;
+	UINT32		*col_index;
+	bool		*row_is_pivot;
+	UINT32		*peel_row;
+	UINT32		*peel_col;
+	UINT32		*inactive_col;
+	UINT32		*row_degree		= NULL;	/* number of active columns in each row */
+	UINT32		*row_stack		= NULL;	/* rows whose degree dropped to one */
+	UINT32		n_rows;
+	UINT32		n_cols;
+	UINT32		nb_active;
+	UINT32		nb_filled_rows;
+	UINT32		nb_stacked;
+	UINT32		row;
+	UINT32		col;
 
 	OF_ENTER_FUNCTION
-	n = of_mod2dense_cols (m);
-	/* for each row */
-	for (i = 0; i < n; i++)
+	n_rows = of_mod2sparse_rows (m);
+	n_cols = of_mod2sparse_cols (m);
+	memset (peeling, 0, sizeof (*peeling));
+	col_state	= peeling->col_state	= (UINT8 *) of_calloc (n_cols, sizeof (UINT8));
+	col_index	= peeling->col_index	= (UINT32 *) of_calloc (n_cols, sizeof (UINT32));
+	peel_col	= peeling->peel_col	= (UINT32 *) of_calloc (n_cols, sizeof (UINT32));
+	inactive_col	= peeling->inactive_col	= (UINT32 *) of_calloc (n_cols, sizeof (UINT32));
+	row_is_pivot	= peeling->row_is_pivot	= (bool *) of_calloc (n_rows, sizeof (bool));
+	peel_row	= peeling->peel_row	= (UINT32 *) of_calloc (n_rows, sizeof (UINT32));
+	row_degree	= (UINT32 *) of_calloc (n_rows, sizeof (UINT32));
+	row_stack	= (UINT32 *) of_calloc (n_rows, sizeof (UINT32));
+	if (col_state == NULL || col_index == NULL || peel_col == NULL || inactive_col == NULL ||
+	    row_is_pivot == NULL || row_degree == NULL || row_stack == NULL || peel_row == NULL)
 	{
-		if (!of_linear_binary_code_col_forward_elimination(ofcb, m, constant_tab, i))
+		goto no_mem;
+	}
+	nb_active = n_cols;
+	if (col_known != NULL)
+	{
+		for (col = 0; col < n_cols; col++)
 		{
-			OF_EXIT_FUNCTION
-			return 0;
+			if (col_known[col])
+			{
+				col_state[col] = OF_ML_COL_KNOWN;
+				nb_active--;
+			}
+		}
+	}
+	nb_stacked = 0;
+	nb_filled_rows = 0;
+	for (row = 0; row < n_rows; row++)
+	{
+		for (e = of_mod2sparse_first_in_row (m, row); !of_mod2sparse_at_end (e); e = of_mod2sparse_next_in_row (e))
+		{
+			if (col_state[of_mod2sparse_col (e)] == OF_ML_COL_ACTIVE)
+				row_degree[row]++;
+		}
+		if (row_degree[row] > 0)
+		{
+			nb_filled_rows++;
+		}
+		if (row_degree[row] == 1)
+		{
+			row_stack[nb_stacked++] = row;
+		}
+	}
+	while (nb_active > 0)
+	{
+		if (nb_stacked > 0)
+		{
+			row = row_stack[--nb_stacked];
+			if (row_is_pivot[row] || row_degree[row] != 1)
+			{
+				/* its last active column has been inactivated or peeled in the meantime */
+				continue;
+			}
+			for (e = of_mod2sparse_first_in_row (m, row); !of_mod2sparse_at_end (e); e = of_mod2sparse_next_in_row (e))
+			{
+				if (col_state[of_mod2sparse_col (e)] == OF_ML_COL_ACTIVE)
+					break;
+			}
+			ASSERT(!of_mod2sparse_at_end (e));
+			col = of_mod2sparse_col (e);
+			row_is_pivot[row] = true;
+			row_degree[row] = 0;
+			col_state[col] = OF_ML_COL_PEELED;
+			col_index[col] = peeling->nb_peeled;
+			peel_row[peeling->nb_peeled] = row;
+			peel_col[peeling->nb_peeled] = col;
+			peeling->nb_peeled++;
+		}
+		else
+		{
+			UINT32	best_row = n_rows;
+			UINT32	best_weight = 0;
+			UINT32	weight;
+
+			/* each inactivation scans all the rows, which is the slow part of peeling */
+			if (of_is_cancelled ())
+			{
+				OF_TRACE_LVL (1, ("%s: cancelled\n", __FUNCTION__))
+				goto failure;
+			}
+			/* stuck, find the non pivot row of lowest degree... */
+			for (row = 0; row < n_rows; row++)
+			{
+				if (!row_is_pivot[row] && row_degree[row] >= 2 &&
+				    (best_row == n_rows || row_degree[row] < row_degree[best_row]))
+				{
+					best_row = row;
+					if (row_degree[row] == 2)
+						break;
+				}
+			}
+			if (best_row == n_rows)
+			{
+				/* no row can make progress, the remaining columns all go to the dense core */
+				for (col = 0; col < n_cols; col++)
+				{
+					if (col_state[col] == OF_ML_COL_ACTIVE)
+					{
+						col_state[col] = OF_ML_COL_INACTIVE;
+						col_index[col] = peeling->nb_inactive;
+						inactive_col[peeling->nb_inactive++] = col;
+						nb_active--;
+					}
+				}
+				break;
+			}
+			/* ...and inactivate its active column that appears in the largest number of non pivot rows */
+			col = n_cols;
+			for (e = of_mod2sparse_first_in_row (m, best_row); !of_mod2sparse_at_end (e); e = of_mod2sparse_next_in_row (e))
+			{
+				of_mod2entry	*ce;
+
+				if (col_state[of_mod2sparse_col (e)] != OF_ML_COL_ACTIVE)
+					continue;
+				weight = 0;
+				for (ce = of_mod2sparse_first_in_col (m, of_mod2sparse_col (e));
+				     !of_mod2sparse_at_end_col (ce);
+				     ce = of_mod2sparse_next_in_col (ce))
+				{
+					if (!row_is_pivot[of_mod2sparse_row (ce)])
+						weight++;
+				}
+				if (col == n_cols || weight > best_weight)
+				{
+					col = of_mod2sparse_col (e);
+					best_weight = weight;
+				}
+			}
+			col_state[col] = OF_ML_COL_INACTIVE;
+			col_index[col] = peeling->nb_inactive;
+			inactive_col[peeling->nb_inactive++] = col;
 		}
+		nb_active--;
+		of_linear_binary_code_deactivate_col (m, col, row_is_pivot, row_degree, row_stack, &nb_stacked);
 	}
+	/* every pivot row had an active column to begin with */
+	peeling->nb_core_rows = nb_filled_rows - peeling->nb_peeled;
+	OF_TRACE_LVL (1, ("%s: %d cols, %d peeled, %d inactivated, dense core is %dx%d\n",
+			__FUNCTION__, n_cols, peeling->nb_peeled, peeling->nb_inactive, peeling->nb_core_rows, peeling->nb_inactive))
+	of_free (row_degree);
+	of_free (row_stack);
 	OF_EXIT_FUNCTION
-	return 1;
+	return OF_STATUS_OK;
+
+failure:
+	of_free (row_degree);
+	of_free (row_stack);
+	OF_EXIT_FUNCTION
+	return OF_STATUS_FAILURE;
+
+no_mem:
+	OF_PRINT_ERROR(("out of memory"))
+	of_free (row_degree);
+	of_free (row_stack);
+	OF_EXIT_FUNCTION
+	return OF_STATUS_FATAL_ERROR;
 }
 
 
-static
-INT32	of_linear_binary_code_col_forward_elimination  (of_linear_binary_code_cb_t	*ofcb,
-								of_mod2dense			*m,
-								void				**constant_tab,
-								INT32				col_idx)
+void
+of_linear_binary_code_free_peeling (of_ml_peeling_t	*peeling)
 {
-	of_mod2word	*s;
-	of_mod2word	*t;
-	INT32		i, j, k;
-	INT32		n, p;
-	INT32		w;
-	INT32		w0;
-	INT32		b0;
-	INT32		symbol_size;
-	void		*tmp_buffer;
+	of_free (peeling->col_state);
+	of_free (peeling->col_index);
+	of_free (peeling->peel_col);
+	of_free (peeling->inactive_col);
+	of_free (peeling->row_is_pivot);
+	of_free (peeling->peel_row);
+	memset (peeling, 0, sizeof (*peeling));
+}
+
+
+/**
+ * Structured (inactivation) Gaussian elimination:
+ *  - peel the system with of_linear_binary_code_peel();
+ *  - express every peeled column as a constant symbol plus a combination of the inactive columns;
+ *  - build and solve the dense core (remaining rows x inactive columns);
+ *  - back-substitute the inactive columns into the peeled ones.
+ * Only the core is dense, so the cubic cost of the Gaussian elimination applies to the number of
+ * inactivated columns rather than to the total number of unknowns.
+ */
+of_status_t
+of_linear_binary_code_solve_sparse_system_with_inactivation (of_linear_binary_code_cb_t	*ofcb,
+							     of_mod2sparse			*m,
+							     void				**constant_tab,
+							     void				**variable_tab)
+{
+	of_mod2entry	*e;
+	of_ml_peeling_t	peeling;
+	of_mod2dense	*peel_coef		= NULL;	/* inactive columns involved in each peeled column */
+	of_mod2dense	*core			= NULL;	/* dense system on the inactive columns */
+	void		**core_constant_tab	= NULL;
+	void		**core_variable_tab	= NULL;
+	bool		core_variables_moved	= false;	/* core_variable_tab symbols handed to variable_tab */
+	UINT8		*col_state;
+	UINT32		*col_index;
+	bool		*row_is_pivot;
+	UINT32		*peel_row;
+	UINT32		*peel_col;
+	UINT32		*inactive_col;
+	UINT32		n_rows;
+	UINT32		nb_peeled;
+	UINT32		nb_inactive;
+	UINT32		nb_core_rows		= 0;
+	UINT32		row;
+	UINT32		col;
+	UINT32		i;
+	UINT32		j;
+	UINT32		symbol_size;
+	of_status_t	status;
 
 	OF_ENTER_FUNCTION
+	n_rows = of_mod2sparse_rows (m);
 	symbol_size = ofcb->encoding_symbol_length;
-	n = of_mod2dense_cols (m);
-	p = of_mod2dense_rows (m);
-	w = m->n_words;
-	i = col_idx;
-	//printf("of_col_forward_elimination of col %d\n",i);
-	w0 = i >> of_mod2_wordsize_shift;	// word index of the ith bit
-	b0 = i & of_mod2_wordsize_mask;		// bit index of the ith bit in the w0-th word
-	/* search for the first non-null element of that column (pivot) */
-	for (j = i; j < p; j++)
+	/*
+	 * Step 1: peel as far as possible, inactivate a column each time we are stuck.
+	 * This step only works on the matrix structure, no symbol is touched.
+	 */
+	if ((status = of_linear_binary_code_peel (m, NULL, &peeling)) != OF_STATUS_OK)
 	{
-		if (of_mod2_getbit(m->row[j][w0], b0))
-			break;
+		of_linear_binary_code_free_peeling (&peeling);
+		OF_EXIT_FUNCTION
+		return status;
 	}
-	/* now j is the index of the first non null element in column i */
-	if (j == p)
+	col_state	= peeling.col_state;
+	col_index	= peeling.col_index;
+	row_is_pivot	= peeling.row_is_pivot;
+	peel_row	= peeling.peel_row;
+	peel_col	= peeling.peel_col;
+	inactive_col	= peeling.inactive_col;
+	nb_peeled	= peeling.nb_peeled;
+	nb_inactive	= peeling.nb_inactive;
+	nb_core_rows	= peeling.nb_core_rows;
+	if (nb_core_rows < nb_inactive)
 	{
-		/* it's a failure, it's not possible to choose a pivot for this empty column */
-		OF_EXIT_FUNCTION
-		return 0;
+		OF_TRACE_LVL (1, ("%s: Failure, fewer rows than inactive columns in the dense core\n", __FUNCTION__))
+		goto failure;
 	}
-	if (j != i)
+	/*
+	 * Step 2: express each peeled column as a constant term plus a combination of inactive columns.
+	 * Columns are processed in peeling order, so every peeled column of a pivot row is already known.
+	 */
+	if (nb_inactive > 0 && nb_peeled > 0)
 	{
-		// swap columns i and j in the two matrices
-		//printf("swap rows %i and %i\n",j,i);
-		t = m->row[i];
-		m->row[i] = m->row[j];
-		m->row[j] = t;
-		// swap the partial sum
-		tmp_buffer = constant_tab[i];
-		constant_tab[i] = constant_tab[j];
-		constant_tab[j] = tmp_buffer;
-		//of_mod2dense_print(stdout,m);
+		if ((peel_coef = of_mod2dense_allocate (nb_peeled, nb_inactive)) == NULL)
+		{
+			goto no_mem;
+		}
 	}
-	/* we have found the pivot and made sure that it is at row i (potentially after swapping two rows).
-	 * Now eliminate the other '1's below this pivot... */
-	ofcb->nb_tmp_symbols = 0;
-	for (j = i + 1; j < p; j++)
+	for (i = 0; i < nb_peeled; i++)
 	{
-		if (of_mod2_getbit(m->row[j][w0], b0))
+		if ((i & OF_CANCEL_POLL_MASK) == 0 && of_is_cancelled ())
 		{
-			/* there's a '1' below the pivot, so XOR the two rows (word by word to go faster). */
-			//printf("\n\nxor in %i, %i\n",j,i);
-			s = m->row[j];
-			t = m->row[i];
-			s += w0;
-			t += w0;
-			for (k = w0; k < w; k++)
+			OF_TRACE_LVL (1, ("%s: cancelled\n", __FUNCTION__))
+			goto failure;
+		}
+		row = peel_row[i];
+		if ((variable_tab[peel_col[i]] = constant_tab[row]) == NULL &&
+		    (variable_tab[peel_col[i]] = of_calloc (1, symbol_size)) == NULL)
+		{
+			goto no_mem;
+		}
+		constant_tab[row] = NULL;
+		ofcb->nb_tmp_symbols = 0;
+		for (e = of_mod2sparse_first_in_row (m, row); !of_mod2sparse_at_end (e); e = of_mod2sparse_next_in_row (e))
+		{
+			col = of_mod2sparse_col (e);
+			if (col == peel_col[i])
+				continue;
+			if (col_state[col] == OF_ML_COL_PEELED)
+			{
+				ASSERT(col_index[col] < i);
+				ofcb->tmp_tab_symbols[ofcb->nb_tmp_symbols++] = variable_tab[col];
+				if (peel_coef != NULL)
+					of_mod2dense_xor_rows (peel_coef, col_index[col], i);
+			}
+			else
+			{
+				of_mod2dense_flip (peel_coef, i, col_index[col]);
+			}
+		}
+		if (ofcb->nb_tmp_symbols != 0)
+		{
+			of_add_from_multiple_symbols (variable_tab[peel_col[i]], (const void**)ofcb->tmp_tab_symbols,
+						      ofcb->nb_tmp_symbols, symbol_size OP_ARG_VAL);
+		}
+	}
+	/*
+	 * Step 3: substitute the peeled columns in the remaining rows, which gives the dense core,
+	 * and solve it with the usual Gaussian elimination.
+	 */
+	if (nb_inactive > 0)
+	{
+		core = of_mod2dense_allocate (nb_core_rows, nb_inactive);
+		core_constant_tab = (void **) of_calloc (nb_core_rows, sizeof (void*));
+		core_variable_tab = (void **) of_calloc (nb_inactive, sizeof (void*));
+		if (core == NULL || core_constant_tab == NULL || core_variable_tab == NULL)
+		{
+			goto no_mem;
+		}
+		for (row = 0, j = 0; row < n_rows; row++)
+		{
+			if (row_is_pivot[row] || of_mod2sparse_empty_row (m, row))
+				continue;
+			if ((j & OF_CANCEL_POLL_MASK) == 0 && of_is_cancelled ())
 			{
-				*s ^= *t;
-				s++;
-				t++;
+				OF_TRACE_LVL (1, ("%s: cancelled\n", __FUNCTION__))
+				goto failure;
 			}
-			//of_mod2dense_print(stdout,m);
-			if (constant_tab[i] != NULL)
+			if ((core_constant_tab[j] = constant_tab[row]) == NULL &&
+			    (core_constant_tab[j] = of_calloc (1, symbol_size)) == NULL)
 			{
-				/* if the buffer of line i is NULL there is nothing to add.
-				 * add the constant term of the i to the constant term of line j */
-				if (constant_tab[j] == NULL)
+				goto no_mem;
+			}
+			constant_tab[row] = NULL;
+			ofcb->nb_tmp_symbols = 0;
+			for (e = of_mod2sparse_first_in_row (m, row); !of_mod2sparse_at_end (e); e = of_mod2sparse_next_in_row (e))
+			{
+				col = of_mod2sparse_col (e);
+				if (col_state[col] == OF_ML_COL_PEELED)
 				{
-					constant_tab[j] = of_malloc (symbol_size);
-					/* copy data directly, there's no XOR to perform */
-					memcpy (constant_tab[j], constant_tab[i], symbol_size);
+					of_mod2word	*s = core->row[j];
+					of_mod2word	*t = peel_coef->row[col_index[col]];
+
+					ofcb->tmp_tab_symbols[ofcb->nb_tmp_symbols++] = variable_tab[col];
+					for (i = 0; i < core->n_words; i++)
+					{
+						s[i] ^= t[i];
+					}
 				}
 				else
 				{
-					/* add constant term i to constant term j */
-					ofcb->tmp_tab_symbols[ofcb->nb_tmp_symbols++] = constant_tab[j];
+					of_mod2dense_flip (core, j, col_index[col]);
 				}
 			}
-			else
+			if (ofcb->nb_tmp_symbols != 0)
 			{
-				constant_tab[i] = of_calloc (1, symbol_size);
+				of_add_from_multiple_symbols (core_constant_tab[j], (const void**)ofcb->tmp_tab_symbols,
+							      ofcb->nb_tmp_symbols, symbol_size OP_ARG_VAL);
 			}
+			j++;
 		}
+		if (of_linear_binary_code_solve_dense_system (ofcb, core, core_constant_tab, core_variable_tab) != OF_STATUS_OK)
+		{
+			OF_TRACE_LVL (1, ("%s: solving the dense core failed\n", __FUNCTION__))
+			goto failure;
+		}
+		for (i = 0; i < nb_inactive; i++)
+		{
+			variable_tab[inactive_col[i]] = core_variable_tab[i];
+		}
+		core_variables_moved = true;
 	}
-	if (ofcb->nb_tmp_symbols != 0)
+	/*
+	 * Step 4: back-substitute the inactive columns into the peeled columns. Peeled
+	 * columns share many inactive columns, so the sums are taken from tables of
+	 * partial sums rather than added one inactive column at a time.
+	 */
+	if (nb_inactive > 0 && nb_peeled > 0)
 	{
-		if (ofcb->nb_tmp_symbols == 1)
+		void	**peeled_tab;
+
+		if ((peeled_tab = (void **) of_malloc (nb_peeled * sizeof (void*))) == NULL)
 		{
-			of_add_to_symbol (ofcb->tmp_tab_symbols[0], constant_tab[i], symbol_size OP_ARG_VAL);
+			goto no_mem;
 		}
-		else
+		for (i = 0; i < nb_peeled; i++)
 		{
-			of_add_to_multiple_symbols (ofcb->tmp_tab_symbols,
-						    constant_tab[i],
-						    ofcb->nb_tmp_symbols,
-						    ofcb->encoding_symbol_length
-#ifdef OF_DEBUG
-						    , &(ofcb->stats_xor->nb_xor_for_ML)
-#endif
-						   );
+			peeled_tab[i] = variable_tab[peel_col[i]];
+		}
+		status = of_linear_binary_code_add_dense_products (ofcb, peel_coef, nb_peeled, 0, nb_inactive,
+								   core_variable_tab, peeled_tab);
+		of_free (peeled_tab);
+		if (status != OF_STATUS_OK)
+		{
+			goto cleanup;
+		}
+	}
+	status = OF_STATUS_OK;
+	goto cleanup;
+
+failure:
+	status = OF_STATUS_FAILURE;
+	goto cleanup;
+
+no_mem:
+	OF_PRINT_ERROR(("out of memory"))
+	status = OF_STATUS_FATAL_ERROR;
+
+cleanup:
+	/*
+	 * Every allocation is released here. On failure the peeled columns already stored in
+	 * variable_tab are released by the caller, the inactive ones too once they were moved there.
+	 */
+	if (core_constant_tab != NULL)
+	{
+		for (j = 0; j < nb_core_rows; j++)
+		{
+			if (core_constant_tab[j] != NULL)
+				of_free (core_constant_tab[j]);
+		}
+		of_free (core_constant_tab);
+	}
+	if (core_variable_tab != NULL)
+	{
+		if (!core_variables_moved)
+		{
+			for (i = 0; i < nb_inactive; i++)
+			{
+				if (core_variable_tab[i] != NULL)
+					of_free (core_variable_tab[i]);
+			}
+		}
+		of_free (core_variable_tab);
+	}
+	if (core != NULL)
+		of_mod2dense_free (core);
+	if (peel_coef != NULL)
+		of_mod2dense_free (peel_coef);
+	of_linear_binary_code_free_peeling (&peeling);
+	OF_EXIT_FUNCTION
+	return status;
+}
+
+
+UINT32
+of_linear_binary_code_m4r_bits (UINT32	nb_rows)
+{
+	UINT32	k = 1;
+
+	while (k < OF_ML_M4R_MAX_BITS && (2u << (k + 1)) <= nb_rows)
+		k++;
+	return k;
+}
+
+
+/******  Static Functions  ****************************************************/
+
+
+/*
+ * Bits col to col + nb_bits - 1 of a dense matrix row, nb_bits being at most 8.
+ */
+static UINT32
+of_linear_binary_code_get_bits (const of_mod2word	*row,
+				UINT32			col,
+				UINT32			nb_bits)
+{
+	UINT32	w0 = col >> of_mod2_wordsize_shift;
+	UINT32	b0 = col & of_mod2_wordsize_mask;
+	UINT32	bits = row[w0] >> b0;
+
+	if (b0 + nb_bits > of_mod2_wordsize)
+		bits |= row[w0 + 1] << (of_mod2_wordsize - b0);
+	return bits & ((1u << nb_bits) - 1);
+}
+
+
+static
+INT32	of_linear_binary_code_triangularize_dense_system (of_linear_binary_code_cb_t	*ofcb,
+							  of_mod2dense			*m,
+							  void				**constant_tab)
+{
+	of_mod2word	*row_table	= NULL;	/* sum of every combination of the pivot rows of a block */
+	UINT8		*const_table	= NULL;	/* and of their constant terms */
+	UINT8		*slice		= NULL;	/* block bits of each row, reduced by the pivots found so far */
+	of_mod2word	*s;
+	of_mod2word	*t;
+	void		*tmp_buffer;
+	UINT32		symbol_size;
+	UINT32		n, p, w, w0;
+	UINT32		c, i, j, k, u;
+	UINT32		mask, low, b;
+	UINT8		tmp_slice;
+
+	OF_ENTER_FUNCTION
+	symbol_size = ofcb->encoding_symbol_length;
+	n = of_mod2dense_cols (m);
+	p = of_mod2dense_rows (m);
+	w = m->n_words;
+	row_table = (of_mod2word *) of_malloc (((size_t)1 << OF_ML_M4R_MAX_BITS) * w * sizeof (of_mod2word));
+	const_table = (UINT8 *) of_malloc (((size_t)1 << OF_ML_M4R_MAX_BITS) * symbol_size);
+	slice = (UINT8 *) of_malloc (p);
+	if (row_table == NULL || const_table == NULL || slice == NULL)
+	{
+		goto no_mem;
+	}
+	for (c = 0; c < n; c += k)
+	{
+		/* each block goes through all the rows below it, poll every time */
+		if (of_is_cancelled ())
+		{
+			goto failure;
+		}
+		k = of_linear_binary_code_m4r_bits (p - c);
+		if (k > n - c)
+			k = n - c;
+		w0 = c >> of_mod2_wordsize_shift;
+		/* find the pivots of the block, on a copy of its bits */
+		for (j = c; j < p; j++)
+		{
+			slice[j] = of_linear_binary_code_get_bits (m->row[j], c, k);
+		}
+		for (i = 0; i < k; i++)
+		{
+			for (j = c + i; j < p && !of_mod2_getbit (slice[j], i); j++)
+				;
+			if (j == p)
+			{
+				/* it's a failure, it's not possible to choose a pivot for this empty column */
+				goto failure;
+			}
+			if (j != c + i)
+			{
+				t = m->row[c + i];
+				m->row[c + i] = m->row[j];
+				m->row[j] = t;
+				tmp_buffer = constant_tab[c + i];
+				constant_tab[c + i] = constant_tab[j];
+				constant_tab[j] = tmp_buffer;
+				tmp_slice = slice[c + i];
+				slice[c + i] = slice[j];
+				slice[j] = tmp_slice;
+			}
+			for (j = c + i + 1; j < p; j++)
+			{
+				if (of_mod2_getbit (slice[j], i))
+					slice[j] ^= slice[c + i];
+			}
+		}
+		/* reduce the pivot rows to the identity on the block */
+		for (i = 0; i < k; i++)
+		{
+			if (constant_tab[c + i] == NULL &&
+			    (constant_tab[c + i] = of_calloc (1, symbol_size)) == NULL)
+			{
+				goto no_mem;
+			}
+		}
+		for (i = 0; i < k; i++)
+		{
+			ASSERT(of_mod2_getbit (m->row[c + i][(c + i) >> of_mod2_wordsize_shift], (c + i) & of_mod2_wordsize_mask));
+			for (u = 0; u < k; u++)
+			{
+				if (u == i || !of_mod2_getbit (m->row[c + u][(c + i) >> of_mod2_wordsize_shift], (c + i) & of_mod2_wordsize_mask))
+					continue;
+				s = m->row[c + u];
+				t = m->row[c + i];
+				for (j = w0; j < w; j++)
+				{
+					s[j] ^= t[j];
+				}
+				of_add_to_symbol (constant_tab[c + u], constant_tab[c + i], symbol_size OP_ARG_VAL);
+			}
+		}
+		/* sum every combination of the pivot rows... */
+		memset (row_table, 0, w * sizeof (of_mod2word));
+		for (mask = 1; mask < (1u << k); mask++)
+		{
+			low = mask & (~mask + 1);
+			for (b = 0; (1u << b) != low; b++)
+				;
+			s = row_table + (size_t)mask * w;
+			t = row_table + (size_t)(mask ^ low) * w;
+			for (j = w0; j < w; j++)
+			{
+				s[j] = t[j] ^ m->row[c + b][j];
+			}
+		}
+		of_linear_binary_code_build_m4r_table (ofcb, const_table, &constant_tab[c], k);
+		/* ...and clear the block from every row below with one of them */
+		for (j = c + k; j < p; j++)
+		{
+			mask = of_linear_binary_code_get_bits (m->row[j], c, k);
+			if (mask == 0)
+				continue;
+			s = m->row[j];
+			t = row_table + (size_t)mask * w;
+			for (i = w0; i < w; i++)
+			{
+				s[i] ^= t[i];
+			}
+			if (constant_tab[j] == NULL)
+			{
+				if ((constant_tab[j] = of_malloc (symbol_size)) == NULL)
+				{
+					goto no_mem;
+				}
+				memcpy (constant_tab[j], const_table + (size_t)mask * symbol_size, symbol_size);
+			}
+			else
+			{
+				of_add_to_symbol (constant_tab[j], const_table + (size_t)mask * symbol_size, symbol_size OP_ARG_VAL);
+			}
 		}
 	}
+	of_free (row_table);
+	of_free (const_table);
+	of_free (slice);
 	OF_EXIT_FUNCTION
 	return 1;
+
+failure:
+	of_free (row_table);
+	of_free (const_table);
+	of_free (slice);
+	OF_EXIT_FUNCTION
+	return 0;
+
+no_mem:
+	OF_PRINT_ERROR(("out of memory"))
+	of_free (row_table);
+	of_free (const_table);
+	of_free (slice);
+	OF_EXIT_FUNCTION
+	return 0;
 }
 
 
-/* old trivial backward substitution algorithm. */
 static
 INT32	of_linear_binary_code_backward_substitution    (of_linear_binary_code_cb_t	*ofcb,
 							of_mod2dense			*m,
@@ -279,16 +834,21 @@ INT32	of_linear_binary_code_backward_substitution    (of_linear_binary_code_cb_t
 	INT32	i;		/* current variable index for which we apply backward substition. It's also the row index. */
 	INT32	j;		/*  */
 	INT32	n;
+	INT32	start;		/* first variable of the block being solved */
+	INT32	end;		/* variables from end on are already in the constant terms */
 	INT32	w0;		/* dense matrix word index for variable j */
 	INT32	b0;		/* dense matrix bit index in word of index w0 */
 
 	OF_ENTER_FUNCTION
 	n = of_mod2dense_cols (m);
-	/* go through all the rows, starting from the last one... */
-	for (i = n - 1; i >= 0; i--)
+	/* go through all the rows by blocks, starting from the last one... */
+	for (end = n; end > 0; end = start)
 	{
-		ASSERT(variable_tab[i] == NULL);
-		//if (variable_tab[i] == NULL)
+		start = end - (INT32)of_linear_binary_code_m4r_bits (end);
+		if (start < 0)
+			start = 0;
+		/* ...solve the variables of the block... */
+		for (i = end - 1; i >= start; i--)
 		{
 			of_mod2word	*row = m->row[i];		// row corresponding to variable i
 #ifdef OF_DEBUG
@@ -300,13 +860,12 @@ INT32	of_linear_binary_code_backward_substitution    (of_linear_binary_code_cb_t
 			 * the missing source symbol in col i is equal to the sum of the constant term of this
 			 * equation (i.e. row i) plus all the variables of this equation.
 			 */
-			//OF_TRACE_LVL(1, ("%s: rebuilding source symbol %d with col %d\n", __FUNCTION__, col_index[i], i))
 			ASSERT(variable_tab[i] == NULL);
 			variable_tab[i] = constant_tab[i];
 			constant_tab[i] = NULL;
 			/* determine the list of symbols to add to compute the decoded source symbol */
 			ofcb->nb_tmp_symbols = 0;
-			for (j = i + 1; j < n; j++)
+			for (j = i + 1; j < end; j++)
 			{
 				w0 = j >> of_mod2_wordsize_shift;	// word index of the ith bit
 				b0 = j & of_mod2_wordsize_mask;		// bit index of the ith bit in the w0-th word
@@ -327,12 +886,154 @@ INT32	of_linear_binary_code_backward_substitution    (of_linear_binary_code_cb_t
 								);
 			}
 		}
+		/* ...and add them to the constant terms of the rows above at once */
+		if (start > 0 &&
+		    of_linear_binary_code_add_dense_products (ofcb, m, start, start, end, &variable_tab[start], constant_tab) != OF_STATUS_OK)
+		{
+			OF_EXIT_FUNCTION
+			return 0;
+		}
 	}
 	OF_EXIT_FUNCTION
 	return 1;
 }
 
 
+static of_status_t
+of_linear_binary_code_add_dense_products (of_linear_binary_code_cb_t	*ofcb,
+					  of_mod2dense			*m,
+					  UINT32			nb_rows,
+					  UINT32			first_col,
+					  UINT32			end_col,
+					  void				**variable_tab,
+					  void				**dest_tab)
+{
+	UINT8		*tables;		/* sums of a few groups of columns at a time */
+	UINT32		symbol_size;
+	UINT32		k;			/* columns per group */
+	UINT32		nb_groups;
+	UINT32		nb_tables;		/* groups whose table is built at a time */
+	UINT32		first_group;
+	UINT32		g, col, nb_bits, mask;
+	UINT32		row;
+	size_t		table_size;
+
+	OF_ENTER_FUNCTION
+	symbol_size = ofcb->encoding_symbol_length;
+	k = of_linear_binary_code_m4r_bits (nb_rows);
+	nb_groups = (end_col - first_col + k - 1) / k;
+	nb_tables = (nb_groups < OF_ML_M4R_TABLES) ? nb_groups : OF_ML_M4R_TABLES;
+	table_size = ((size_t)1 << k) * symbol_size;
+	if ((tables = (UINT8 *) of_malloc (nb_tables * table_size)) == NULL)
+	{
+		goto no_mem;
+	}
+	for (first_group = 0; first_group < nb_groups; first_group += nb_tables)
+	{
+		if (of_is_cancelled ())
+		{
+			OF_TRACE_LVL (1, ("%s: cancelled\n", __FUNCTION__))
+			of_free (tables);
+			OF_EXIT_FUNCTION
+			return OF_STATUS_FAILURE;
+		}
+		if (nb_tables > nb_groups - first_group)
+			nb_tables = nb_groups - first_group;
+		for (g = 0; g < nb_tables; g++)
+		{
+			col = (first_group + g) * k;
+			nb_bits = (end_col - first_col - col < k) ? end_col - first_col - col : k;
+			of_linear_binary_code_build_m4r_table (ofcb, tables + g * table_size, &variable_tab[col], nb_bits);
+		}
+		/* each row adds at most one sum per table, in a single pass over its destination */
+		for (row = 0; row < nb_rows; row++)
+		{
+			ofcb->nb_tmp_symbols = 0;
+			for (g = 0; g < nb_tables; g++)
+			{
+				col = (first_group + g) * k;
+				nb_bits = (end_col - first_col - col < k) ? end_col - first_col - col : k;
+				mask = of_linear_binary_code_get_bits (m->row[row], first_col + col, nb_bits);
+				if (mask != 0)
+					ofcb->tmp_tab_symbols[ofcb->nb_tmp_symbols++] = tables + g * table_size + mask * symbol_size;
+			}
+			if (ofcb->nb_tmp_symbols == 0)
+				continue;
+			if (dest_tab[row] == NULL &&
+			    (dest_tab[row] = of_calloc (1, symbol_size)) == NULL)
+			{
+				of_free (tables);
+				goto no_mem;
+			}
+			of_add_from_multiple_symbols (dest_tab[row], (const void**)ofcb->tmp_tab_symbols,
+						      ofcb->nb_tmp_symbols, symbol_size OP_ARG_VAL);
+		}
+	}
+	of_free (tables);
+	OF_EXIT_FUNCTION
+	return OF_STATUS_OK;
+
+no_mem:
+	OF_PRINT_ERROR(("out of memory"))
+	OF_EXIT_FUNCTION
+	return OF_STATUS_FATAL_ERROR;
+}
+
+
+static void
+of_linear_binary_code_build_m4r_table (of_linear_binary_code_cb_t	*ofcb,
+				       UINT8				*table,
+				       void				**variable_tab,
+				       UINT32				nb_bits)
+{
+	UINT32		symbol_size = ofcb->encoding_symbol_length;
+	UINT32		mask;
+	UINT32		low;
+	UINT32		b;
+
+	memset (table, 0, symbol_size);
+	for (mask = 1; mask < (1u << nb_bits); mask++)
+	{
+		low = mask & (~mask + 1);
+		for (b = 0; (1u << b) != low; b++)
+			;
+		if (mask == low)
+		{
+			memcpy (table + mask * symbol_size, variable_tab[b], symbol_size);
+		}
+		else
+		{
+			memcpy (table + mask * symbol_size, table + (mask ^ low) * symbol_size, symbol_size);
+			of_add_to_symbol (table + mask * symbol_size, variable_tab[b], symbol_size OP_ARG_VAL);
+		}
+	}
+}
+
+
+static void
+of_linear_binary_code_deactivate_col (of_mod2sparse	*m,
+				      UINT32		col,
+				      const bool	*row_is_pivot,
+				      UINT32		*row_degree,
+				      UINT32		*row_stack,
+				      UINT32		*nb_stacked)
+{
+	of_mod2entry	*e;
+	UINT32		row;
+
+	for (e = of_mod2sparse_first_in_col (m, col); !of_mod2sparse_at_end_col (e); e = of_mod2sparse_next_in_col (e))
+	{
+		row = of_mod2sparse_row (e);
+		if (row_is_pivot[row])
+			continue;
+		if (--row_degree[row] == 1)
+		{
+			row_stack[(*nb_stacked)++] = row;
+		}
+	}
+}
+
+
 #endif //ML_DECODING
 #endif //OF_USE_LINEAR_BINARY_CODES_UTILS
 #endif //OF_USE_DECODER
@@ -48,9 +48,67 @@
 #endif
 
 
+/* state of each column of the sparse system during inactivation decoding */
+#define OF_ML_COL_ACTIVE	0	/* not yet determined, still part of the sparse system */
+#define OF_ML_COL_PEELED	1	/* determined by a pivot row, given the inactive columns */
+#define OF_ML_COL_INACTIVE	2	/* moved to the dense core */
+#define OF_ML_COL_KNOWN		3	/* already known, left out of the system */
+
+/* largest number of columns combined by a Four Russians table, 2^8 sums */
+#define OF_ML_M4R_MAX_BITS	8
+
+/* Four Russians tables built at a time, so that rows add several sums in one pass */
+#define OF_ML_M4R_TABLES	8
+
+
+/**
+ * Outcome of the peeling step of inactivation decoding. It only depends on the structure of the
+ * sparse system, so it is computed the same way to solve the system and to estimate its cost.
+ */
+typedef struct of_ml_peeling
+{
+	UINT8		*col_state;	/* OF_ML_COL_* state of each column */
+	UINT32		*col_index;	/* peeling order or inactive index of each column */
+	bool		*row_is_pivot;	/* rows used to peel a column */
+	UINT32		*peel_row;	/* pivot row of the i-th peeled column */
+	UINT32		*peel_col;	/* i-th peeled column */
+	UINT32		*inactive_col;	/* i-th inactive column */
+	UINT32		nb_peeled;
+	UINT32		nb_inactive;
+	UINT32		nb_core_rows;	/* non pivot rows with at least one unknown column */
+} of_ml_peeling_t;
+
+
 /**
- * This function solves the system: first triangularize the system, then for each column,
- * do a forward elimination, then do the backward elimination.
+ * This function peels the sparse system as far as possible: while a row has a single active column,
+ * this row becomes the pivot of that column. When stuck, the non pivot row of lowest degree is taken
+ * and its heaviest active column inactivated. No symbol is touched.
+ *
+ * @brief			peels the structure of the sparse system
+ * @param m			(IN) address of the sparse matrix. It is not modified.
+ * @param col_known		(IN) columns to leave out of the system as already known, or NULL.
+ * @param peeling		(OUT) peeling outcome, released with of_linear_binary_code_free_peeling()
+ *				whatever the status.
+ * @return			error status, OF_STATUS_FAILURE if cancelled.
+ */
+of_status_t
+of_linear_binary_code_peel (of_mod2sparse	*m,
+			    const bool		*col_known,
+			    of_ml_peeling_t	*peeling);
+
+
+/**
+ * @brief			releases the tables of a peeling outcome
+ * @param peeling		(IN/OUT) outcome of of_linear_binary_code_peel().
+ */
+void
+of_linear_binary_code_free_peeling (of_ml_peeling_t	*peeling);
+
+
+/**
+ * This function solves the system: first triangularize the system, then do the backward
+ * substitution. Both steps use the Method of Four Russians, rows add precomputed sums of a few
+ * pivot rows rather than each pivot row in turn.
  *
  * @fn INT32			of_linear_binary_code_solve_dense_system (of_mod2dense *m,void ** constant_member,void **variables,of_linear_binary_code_cb_t *ofcb)
  * @brief			solves the system
@@ -67,6 +125,39 @@ of_linear_binary_code_solve_dense_system (of_linear_binary_code_cb_t	*ofcb,
 					  void			**variable_tab);
 
 
+/**
+ * Number of columns grouped by the Method of Four Russians, for a table that serves nb_rows rows. A table
+ * of 2^k sums costs about 2^k additions and saves about k/2 - 1 additions per row.
+ *
+ * @param nb_rows		(IN) number of rows added a sum from the table.
+ * @return			number of columns, between 1 and OF_ML_M4R_MAX_BITS
+ */
+UINT32
+of_linear_binary_code_m4r_bits (UINT32	nb_rows);
+
+
+/**
+ * This function solves the sparse system with a structured (inactivation) Gaussian elimination:
+ * columns are peeled while a row has a single unknown, a few columns are inactivated when peeling is
+ * stuck, and only the dense core made of these inactive columns goes through
+ * of_linear_binary_code_solve_dense_system(). Peeled columns are then back-substituted.
+ *
+ * @brief			solves the sparse system, with a dense core limited to the inactivated columns
+ * @param ofcb			(IN/OUT) Linear-Binary-Code control-block.
+ * @param m 			(IN) address of the sparse matrix. It is not modified.
+ * @param constant_tab		(IN/OUT) constant term of each row, NULL meaning a null symbol. The
+ *				buffers used are moved out of the table, the caller frees the remaining ones.
+ * @param variable_tab		(OUT) value of each column, allocated by this function. Some entries
+ *				may be set even on failure, the caller must free the non NULL ones.
+ * @return			error status
+ */
+of_status_t
+of_linear_binary_code_solve_sparse_system_with_inactivation (of_linear_binary_code_cb_t	*ofcb,
+							     of_mod2sparse		*m,
+							     void			**constant_tab,
+							     void			**variable_tab);
+
+
 #endif //ML_DECODING				   
 #endif //OF_USE_LINEAR_BINARY_CODES_UTILS
 #endif //OF_USE_DECODER
@@ -55,6 +55,7 @@
 #include "../of_rand.h"
 #include "../of_cb.h"
 #include "../of_mem.h"
+#include "../of_cancel.h"
 #include "of_symbol.h"
 #include "../statistics/of_statistics.h"
 
@@ -247,19 +247,23 @@ void	of_add_from_multiple_symbols	(void		*to,
 	/*
 	 * 32-bit machines
 	 */
-	UINT32		*t32 = (UINT32*) to;	// to pointer to 32-bit integers
-	UINT32		*f32 = (UINT32*)  from;	// from pointer	to 32-bit integers
-	/* First perform as many 32-bit XORs as needed... */
-	for (i = symbolSize32; i > 0; i--)
-	{
-		*t32 ^= *f32;
-		t32++;
-		f32++;
-	}
-	/* finally perform as many 8-bit XORs as needed if symbol size is not
-	 * multiple of 32 bits... */
-	if (symbolSize32rem > 0)
+	UINT32		*t32;		// to pointer to 32-bit integers
+	UINT32		*f32;		// from pointer	to 32-bit integers
+	UINT32		j;
+
+	for (j = 0; j < from_size; j++)
 	{
+		t32 = (UINT32*) to;
+		f32 = (UINT32*) from[j];
+		/* First perform as many 32-bit XORs as needed... */
+		for (i = symbolSize32; i > 0; i--)
+		{
+			*t32 ^= *f32;
+			t32++;
+			f32++;
+		}
+		/* finally perform as many 8-bit XORs as needed if symbol size is not
+		 * multiple of 32 bits... */
 		for (i = 0; i < symbolSize32rem; i++)
 		{
 			* (UINT8*) ( (UINT8*) t32 + i) ^= * (UINT8*) ( (UINT8*) f32 + i);
@@ -348,14 +352,14 @@ void	of_add_to_multiple_symbols	(void		**to,
 		from_s32 = (UINT32*) from_s;    // pointer to 32-bit integers
 		if ( (symbolSize64 << 1) < symbolSize32)
 		{               
-			(* (UINT32*) pt1++) ^= *from_s32;
-			(* (UINT32*) pt2++) ^= *from_s32;
-			(* (UINT32*) pt3++) ^= *from_s32;
-			(* (UINT32*) pt4++) ^= *from_s32;
-			(* (UINT32*) pt5++) ^= *from_s32;
-			(* (UINT32*) pt6++) ^= *from_s32;
-			(* (UINT32*) pt7++) ^= *from_s32;
-			(* (UINT32*) pt8++) ^= *from_s32;
+			*(UINT32*) pt1 ^= *from_s32; pt1 = (UINT64*) ((UINT32*) pt1 + 1);
+			*(UINT32*) pt2 ^= *from_s32; pt2 = (UINT64*) ((UINT32*) pt2 + 1);
+			*(UINT32*) pt3 ^= *from_s32; pt3 = (UINT64*) ((UINT32*) pt3 + 1);
+			*(UINT32*) pt4 ^= *from_s32; pt4 = (UINT64*) ((UINT32*) pt4 + 1);
+			*(UINT32*) pt5 ^= *from_s32; pt5 = (UINT64*) ((UINT32*) pt5 + 1);
+			*(UINT32*) pt6 ^= *from_s32; pt6 = (UINT64*) ((UINT32*) pt6 + 1);
+			*(UINT32*) pt7 ^= *from_s32; pt7 = (UINT64*) ((UINT32*) pt7 + 1);
+			*(UINT32*) pt8 ^= *from_s32; pt8 = (UINT64*) ((UINT32*) pt8 + 1);
 			from_s32++;
 		}
 		if (symbolSize32rem > 0)
@@ -403,10 +407,10 @@ void	of_add_to_multiple_symbols	(void		**to,
 		from_s32 = (UINT32*) from_s;
 		if ( (symbolSize64 << 1) < symbolSize32) 
 		{ 
-			(* (UINT32*) pt1++) ^= *from_s32; 
-			(* (UINT32*) pt2++) ^= *from_s32; 
-			(* (UINT32*) pt3++) ^= *from_s32; 
-			(* (UINT32*) pt4++) ^= *from_s32;                        
+			*(UINT32*) pt1 ^= *from_s32; pt1 = (UINT64*) ((UINT32*) pt1 + 1); 
+			*(UINT32*) pt2 ^= *from_s32; pt2 = (UINT64*) ((UINT32*) pt2 + 1); 
+			*(UINT32*) pt3 ^= *from_s32; pt3 = (UINT64*) ((UINT32*) pt3 + 1); 
+			*(UINT32*) pt4 ^= *from_s32; pt4 = (UINT64*) ((UINT32*) pt4 + 1);                        
 			from_s32++; 
 		} 
 		if (symbolSize32rem > 0)
@@ -444,8 +448,8 @@ void	of_add_to_multiple_symbols	(void		**to,
                 from_s32 = (UINT32*) from_s;    // pointer to 32-bit integers
                 if ( (symbolSize64 << 1) < symbolSize32) 
                 { 
-                        (* (UINT32*) pt1++) ^= *from_s32; 
-                        (* (UINT32*) pt2++) ^= *from_s32; 
+                        *(UINT32*) pt1 ^= *from_s32; pt1 = (UINT64*) ((UINT32*) pt1 + 1); 
+                        *(UINT32*) pt2 ^= *from_s32; pt2 = (UINT64*) ((UINT32*) pt2 + 1); 
                         from_s32++; 
                 }
 		if (symbolSize32rem > 0)
@@ -494,19 +498,23 @@ void	of_add_to_multiple_symbols	(void		**to,
 	/*
 	 * 32-bit machines
 	 */
-	UINT32		*t32 = (UINT32*) to;	// to pointer to 32-bit integers
-	UINT32		*f32 = (UINT32*)  from;	// from pointer	to 32-bit integers
-	/* First perform as many 32-bit XORs as needed... */
-	for (i = symbolSize32; i > 0; i--)
-	{
-		*t32 ^= *f32;
-		t32++;
-		f32++;
-	}
-	/* finally perform as many 8-bit XORs as needed if symbol size is not
-	 * multiple of 32 bits... */
-	if (symbolSize32rem > 0)
+	UINT32		*t32;		// to pointer to 32-bit integers
+	UINT32		*f32;		// from pointer	to 32-bit integers
+	UINT32		j;
+
+	for (j = 0; j < to_size; j++)
 	{
+		t32 = (UINT32*) to[j];
+		f32 = (UINT32*) from;
+		/* First perform as many 32-bit XORs as needed... */
+		for (i = symbolSize32; i > 0; i--)
+		{
+			*t32 ^= *f32;
+			t32++;
+			f32++;
+		}
+		/* finally perform as many 8-bit XORs as needed if symbol size is not
+		 * multiple of 32 bits... */
 		for (i = 0; i < symbolSize32rem; i++)
 		{
 			* (UINT8*) ( (UINT8*) t32 + i) ^= * (UINT8*) ( (UINT8*) f32 + i);
@@ -0,0 +1,32 @@
+/*
+ * OpenFEC.org AL-FEC Library.
+ * Cancellation of long running decoding steps.
+ *
+ * This software is governed by the CeCILL-C license under French law, see
+ * the LICENCE_CeCILL-C_V1-en.txt file at the root of the OpenFEC tree.
+ */
+
+#include <stdlib.h>
+#include "of_openfec_api.h"
+#include "of_cancel.h"
+
+
+/**
+ * Cancel callback installed by of_set_cancel_callback(), if any.
+ */
+static of_cancel_callback_t	of_cancel_callback = NULL;
+static void*			of_cancel_context = NULL;
+
+
+void of_set_cancel_callback (of_cancel_callback_t	callback,
+			     void*			context)
+{
+	of_cancel_callback = callback;
+	of_cancel_context = context;
+}
+
+
+bool of_is_cancelled (void)
+{
+	return of_cancel_callback != NULL && of_cancel_callback (of_cancel_context) != 0;
+}
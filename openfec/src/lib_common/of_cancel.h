@@ -0,0 +1,27 @@
+/*
+ * OpenFEC.org AL-FEC Library.
+ * Cancellation of long running decoding steps.
+ *
+ * This software is governed by the CeCILL-C license under French law, see
+ * the LICENCE_CeCILL-C_V1-en.txt file at the root of the OpenFEC tree.
+ */
+
+#ifndef OF_CANCEL_H
+#define OF_CANCEL_H
+
+
+/**
+ * @fn			bool	of_is_cancelled (void)
+ * @brief		poll the callback installed by of_set_cancel_callback()
+ * @return		true if the current decoding step must stop.
+ */
+bool	of_is_cancelled (void);
+
+
+/**
+ * Iterations of a loop between two polls, for loops whose iterations are cheap.
+ */
+#define OF_CANCEL_POLL_MASK	1023
+
+
+#endif  //OF_CANCEL_H
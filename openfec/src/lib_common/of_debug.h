@@ -101,4 +101,23 @@
 #define ASSERT(c)
 #endif /* OF_DEBUG */
 
+
+/**
+ * Static tracepoints (USDT) of the "openfec" provider, for perf, bpftrace or
+ * SystemTap. A probe is a single nop until something attaches to it, and there's
+ * no code at all when sys/sdt.h is not available (OF_HAVE_SDT undefined).
+ *
+ *	openfec:symbol__accept	(esi, nb_source_symbol_ready)
+ *	openfec:ml__start	(nb_source_symbol_ready)
+ *	openfec:ml__done	(status)
+ */
+#ifdef OF_HAVE_SDT
+#include <sys/sdt.h>
+#define OF_PROBE1(name, a)	DTRACE_PROBE1(openfec, name, a)
+#define OF_PROBE2(name, a, b)	DTRACE_PROBE2(openfec, name, a, b)
+#else
+#define OF_PROBE1(name, a)
+#define OF_PROBE2(name, a, b)
+#endif
+
 #endif /* } OF_DEBUG_H */
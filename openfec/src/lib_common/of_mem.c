@@ -33,32 +33,92 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <malloc.h>
 #include "of_openfec_api.h"
+#include "of_mem.h"
+
+
+/**
+ * Memory callback installed by of_set_mem_callback(), if any.
+ */
+static of_mem_callback_t	of_mem_callback = NULL;
+static void*			of_mem_context = NULL;
+
+
+void of_set_mem_callback (of_mem_callback_t	callback,
+			  void*			context)
+{
+	of_mem_callback = callback;
+	of_mem_context = context;
+}
+
 
 void* of_malloc (size_t	size)
 {
-	return malloc (size);
+	void	*ptr;
+
+	if (posix_memalign (&ptr, OF_MEM_ALIGNMENT, size) != 0)
+	{
+		return NULL;
+	}
+	if (of_mem_callback != NULL)
+	{
+		of_mem_callback (of_mem_context, (INT64) malloc_usable_size (ptr));
+	}
+	return ptr;
 }
 
 
 void* of_calloc (size_t	nmemb,
 		 size_t	size)
 {
-	return calloc (nmemb, size);
+	void	*ptr;
+
+	if (size != 0 && nmemb > SIZE_MAX / size)
+	{
+		return NULL;
+	}
+	if ((ptr = of_malloc (nmemb * size)) != NULL)
+	{
+		memset (ptr, 0, nmemb * size);
+	}
+	return ptr;
 }
 
 
 void* of_realloc (void* ptr,
 		  size_t size)
 {
-	return realloc (ptr, size);
+	void	*new_ptr;
+	INT64	old_size;
 
+	if (of_mem_callback == NULL)
+	{
+		return realloc (ptr, size);
+	}
+	old_size = (ptr != NULL) ? (INT64) malloc_usable_size (ptr) : 0;
+	if ((new_ptr = realloc (ptr, size)) != NULL)
+	{
+		of_mem_callback (of_mem_context, (INT64) malloc_usable_size (new_ptr) - old_size);
+	}
+	else if (size == 0)
+	{
+		/* the old block was released */
+		of_mem_callback (of_mem_context, -old_size);
+	}
+	return new_ptr;
 }
 
 
 void  of_free (void* ptr)
 {
 	if (ptr) {
+		if (of_mem_callback != NULL)
+		{
+			of_mem_callback (of_mem_context, -(INT64) malloc_usable_size (ptr));
+		}
 		free (ptr);
 	}
 }
@@ -40,6 +40,14 @@
 #define OF_MEM_H
 
 
+/**
+ * Alignment of the blocks returned by of_malloc() and of_calloc(). Repair symbols, partial
+ * sums and decoded symbols are all allocated there, so this keeps the XOR loops of
+ * of_symbol.c on cache line aligned buffers.
+ */
+#define OF_MEM_ALIGNMENT	64
+
+
 /**
  * @fn			inline void*	of_malloc (size_t size)
  * @brief		do a malloc
@@ -50,7 +58,7 @@ void*	of_malloc (size_t size);
 
 /**
  * @fn			inline void*	of_calloc (size_t nmemb,size_t size)
- * @brief		do a calloc
+ * @brief		do a calloc, the block is aligned on OF_MEM_ALIGNMENT bytes
  * @param nmemb		(IN) number of elements
  * @param size		(IN) size of wanted allocated area.
  * @return		allocated pointer or NULL if error.
@@ -548,6 +548,69 @@ of_status_t	of_get_control_parameter (of_session_t*	ses,
 					  UINT32	length);
 
 
+/**
+ * Callback told of every block of_malloc(), of_calloc(), of_realloc() and of_free() allocate or
+ * release, so the application can count the memory used by the library. The codec does not
+ * recover from every failed allocation, so the callback can only count memory, not refuse it.
+ *
+ * @param context	(IN) Context given to of_set_mem_callback().
+ * @param delta		(IN) Bytes allocated, negative for bytes released. This is the usable size
+ *			of the block as reported by the system allocator.
+ */
+typedef void	(*of_mem_callback_t) (void*	context,
+				      INT64	delta);
+
+
+/**
+ * This function installs a memory callback for the whole library, all sessions included.
+ * It must be called before any session is created, and not changed while blocks allocated
+ * under a previous callback are still alive.
+ *
+ * @param callback	(IN) Callback or NULL to remove it.
+ * @param context	(IN) Context given back to the callback.
+ */
+void		of_set_mem_callback (of_mem_callback_t	callback,
+				     void*		context);
+
+
+/**
+ * Callback polled by the long running decoding steps, ML decoding above all. Once it returns
+ * non zero the step stops at the next poll and fails with OF_STATUS_FAILURE. Symbols decoded
+ * before that are kept, but the session can't finish decoding anymore and should be released.
+ *
+ * @param context	(IN) Context given to of_set_cancel_callback().
+ * @return		non zero to cancel the current decoding step.
+ */
+typedef UINT32	(*of_cancel_callback_t) (void*	context);
+
+
+/**
+ * This function installs a cancel callback for the whole library, all sessions included. The
+ * callback is called from whichever thread decodes, so per session decisions are best kept in
+ * thread local state.
+ *
+ * @param callback	(IN) Callback or NULL to remove it.
+ * @param context	(IN) Context given back to the callback.
+ */
+void		of_set_cancel_callback (of_cancel_callback_t	callback,
+					void*			context);
+
+
+/**
+ * Structural estimate of finishing the decoding with ML, as returned by OF_CTRL_GET_ML_ESTIMATE.
+ * The system is made of the unknown symbols and the equations that still involve them.
+ */
+typedef struct of_ml_estimate
+{
+	UINT32	nb_unknowns;		/* symbols neither received nor decoded			*/
+	UINT32	nb_equations;		/* equations with at least one unknown symbol		*/
+	UINT32	nb_inactive;		/* unknowns left to the dense Gaussian elimination	*/
+	UINT32	nb_core_rows;		/* equations left for these inactive unknowns		*/
+	UINT64	nb_symbol_ops;		/* symbol additions ML decoding would take		*/
+	UINT64	nb_word_ops;		/* machine word additions on the binary matrices	*/
+} of_ml_estimate_t;
+
+
 /**
  * Control parameters for of_set_control_parameter()/of_get_control_parameter() functions:
  *   - range {0 .. 1023} inclusive are for generic parameters;
@@ -578,6 +641,17 @@ of_status_t	of_get_control_parameter (of_session_t*	ses,
  */
 #define OF_CTRL_GET_MAX_N	2
 
+/**
+ * Once iterative decoding is stuck, estimate what finishing it with ML decoding would take
+ * without touching any symbol. Peeling is run on the structure of the remaining system, so
+ * this costs a small fraction of ML decoding. When nb_core_rows < nb_inactive ML decoding
+ * can't succeed. Otherwise the dense core behaves like a random binary matrix, whose odds
+ * of being singular are about 2^-(nb_core_rows - nb_inactive).
+ * Only for codecs built on the linear binary code utilities, with ML decoding.
+ * Argument: of_ml_estimate_t
+ */
+#define OF_CTRL_GET_ML_ESTIMATE	3
+
 /**
  * Set the field size using the of__set_control_parameter function.
  * Instead of using of_set_fec_parameter function to initialize the field size during the
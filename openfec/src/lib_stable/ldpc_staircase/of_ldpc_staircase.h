@@ -118,6 +118,9 @@ typedef struct of_ldpc_staircase_cb
 	bool		extra_entries_added_in_pchk;
 	/** ESI of first non decoded source symbol. Used by is_decoding_complete function. */
 	UINT32		first_non_decoded;
+	/** H1 without the staircase, row i holds columns h1_cols[h1_rows[i]] to h1_cols[h1_rows[i+1] - 1]. */
+	UINT32		*h1_rows;
+	UINT32		*h1_cols;
 } of_ldpc_staircase_cb_t;
 
 
@@ -321,6 +324,30 @@ of_mod2sparse* of_create_pchck_matrix_rfc5170_compliant (UINT32			nb_rows,
 							 UINT32			seed,
 							 of_ldpc_staircase_cb_t	*ofcb);
 
+/**
+ * @brief		Create H1 of the LDPC-Staircase matrix as defined in RFC 5170, in compressed row form.
+ *			Produces the same code as of_create_pchck_matrix_rfc5170_compliant() but without the
+ *			staircase, which is implicit, and without building a sparse matrix.
+ * @param nb_rows	(IN) number of rows, also equal to n-k.
+ * @param nb_cols	(IN) number of columns, also equal to n.
+ * @param left_degree	(IN) another name of the N1 parameter.
+ * @param seed		(IN) seed to use for the PRNG.
+ * @param ofcb		(IN/OUT) h1_rows, h1_cols and extra_entries_added_in_pchk are set.
+ * @return		Error status.
+ */
+of_status_t of_create_h1_rfc5170_compliant (UINT32			nb_rows,
+					    UINT32			nb_cols,
+					    UINT32			left_degree,
+					    UINT32			seed,
+					    of_ldpc_staircase_cb_t	*ofcb);
+
+/**
+ * @brief		Create the full parity check matrix, staircase included, from the compact H1.
+ * @param ofcb		(IN) session whose h1_rows and h1_cols have been set.
+ * @return		pointer to the parity check matrix that has just been allocated and initialized.
+ */
+of_mod2sparse* of_create_pchck_matrix_from_h1 (of_ldpc_staircase_cb_t	*ofcb);
+
 #endif  //OF_USE_DECODER
 
 #endif //OF_LDPC_STAIRCASE_H
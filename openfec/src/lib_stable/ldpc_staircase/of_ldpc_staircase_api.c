@@ -66,6 +66,10 @@ of_status_t	of_ldpc_staircase_release_codec_instance (of_ldpc_staircase_cb_t*	of
 		of_free (ofcb->pchk_matrix);
 		ofcb->pchk_matrix  = NULL;
 	}
+	of_free (ofcb->h1_rows);
+	of_free (ofcb->h1_cols);
+	ofcb->h1_rows = NULL;
+	ofcb->h1_cols = NULL;
 	if (ofcb->encoding_symbols_tab != NULL)
 	{
 		/* do not try to free source buffers, it's the responsibility of the application
@@ -212,20 +216,38 @@ of_status_t	of_ldpc_staircase_set_fec_parameters (of_ldpc_staircase_cb_t*	ofcb,
 			ofcb->nb_source_symbols, ofcb->nb_repair_symbols, ofcb->nb_total_symbols,
 			ofcb->encoding_symbol_length, ofcb->prng_seed, ofcb->N1))
 	/* it's now time to create the parity check matrix! */
-	ofcb->pchk_matrix = of_create_pchck_matrix_rfc5170_compliant
-						  (ofcb->nb_repair_symbols,
-						   ofcb->nb_total_symbols,
-						   ofcb->N1,
-						   ofcb->prng_seed,
-						   ofcb);
-	if (ofcb->pchk_matrix == NULL)
+	if (of_create_h1_rfc5170_compliant (ofcb->nb_repair_symbols,
+					    ofcb->nb_total_symbols,
+					    ofcb->N1,
+					    ofcb->prng_seed,
+					    ofcb) != OF_STATUS_OK)
 	{
 		OF_PRINT_ERROR(("of_ldpc_staircase_set_fec_parameters : ERROR, parity check matrix can't be created with this parameters..\n"))
 		goto error;
 	}
+	/*
+	 * the encoder works on the compact H1 directly, only the decoder needs the sparse
+	 * matrix since it deletes entries from it as symbols get known.
+	 */
+	if (ofcb->codec_type & OF_DECODER)
+	{
+		if ((ofcb->pchk_matrix = of_create_pchck_matrix_from_h1 (ofcb)) == NULL)
+		{
+			OF_PRINT_ERROR(("of_ldpc_staircase_set_fec_parameters : ERROR, parity check matrix can't be created with this parameters..\n"))
+			goto error;
+		}
+		if (!(ofcb->codec_type & OF_ENCODER))
+		{
+			of_free (ofcb->h1_rows);
+			of_free (ofcb->h1_cols);
+			ofcb->h1_rows = NULL;
+			ofcb->h1_cols = NULL;
+		}
+	}
 #ifdef IL_SUPPORT
 	/* print the matrix using the DevIL library */
-	of_mod2sparse_print_bitmap(ofcb->pchk_matrix);
+	if (ofcb->pchk_matrix != NULL)
+		of_mod2sparse_print_bitmap(ofcb->pchk_matrix);
 #else
 	//of_mod2sparse_matrix_stats(stdout,ofcb->pchk_matrix,ofcb->nb_source_symbols, ofcb->nb_repair_symbols);
 #endif
@@ -378,8 +400,8 @@ of_status_t	of_ldpc_staircase_build_repair_symbol (of_ldpc_staircase_cb_t*	ofcb,
 							void*			encoding_symbols_tab[],
 							UINT32			esi_of_symbol_to_build)
 {
-	of_mod2entry	*e;
-	UINT32		col_to_build;
+	UINT32		row;
+	UINT32		i;
 	UINT32		esi;
 	void		*to_add_buf;
 	void		*parity_symbol;
@@ -389,30 +411,34 @@ of_status_t	of_ldpc_staircase_build_repair_symbol (of_ldpc_staircase_cb_t*	ofcb,
 		OF_PRINT_ERROR(("of_ldpc_staircase_build_repair_symbol: Error, bad esi of encoding symbol (%d)\n", esi_of_symbol_to_build))
 		goto error;
 	}
+	if (ofcb->h1_rows == NULL)
+	{
+		OF_PRINT_ERROR(("of_ldpc_staircase_build_repair_symbol: Error, session was not created as an encoder\n"))
+		goto error;
+	}
 	parity_symbol = encoding_symbols_tab[esi_of_symbol_to_build];
 	memset (parity_symbol, 0, ofcb->encoding_symbol_length);
-	col_to_build = of_get_symbol_col ((of_cb_t*)ofcb, esi_of_symbol_to_build);
-	e = of_mod2sparse_first_in_row (ofcb->pchk_matrix, col_to_build);
-	while (!of_mod2sparse_at_end (e))
+	/*
+	 * row i of H is the staircase (columns i-1 and i) followed by the source symbols of
+	 * row i of H1, so repair symbol i is the sum of those source symbols and of the
+	 * previous repair symbol.
+	 */
+	row = of_get_symbol_col ((of_cb_t*)ofcb, esi_of_symbol_to_build);
+	for (i = (row > 0) ? ofcb->h1_rows[row] - 1 : ofcb->h1_rows[row]; i < ofcb->h1_rows[row + 1]; i++)
 	{
-		// paritySymbol_index in {0.. n-k-1} range, so this test is ok
-		if (e->col != col_to_build)
+		esi = (i < ofcb->h1_rows[row]) ? esi_of_symbol_to_build - 1
+					       : (UINT32) of_get_symbol_esi ((of_cb_t*)ofcb, ofcb->h1_cols[i]);
+		to_add_buf = (void*) encoding_symbols_tab[esi];
+		if (to_add_buf == NULL)
 		{
-			// don't add paritySymbol to itself
-			esi = of_get_symbol_esi ((of_cb_t*)ofcb, e->col);
-			to_add_buf = (void*) encoding_symbols_tab[esi];
-			if (to_add_buf == NULL)
-			{
-				OF_PRINT_ERROR(("symbol %d is not allocated\n", esi));
-				goto error;
-			}
+			OF_PRINT_ERROR(("symbol %d is not allocated\n", esi));
+			goto error;
+		}
 #ifdef OF_DEBUG
-			of_add_to_symbol (parity_symbol, to_add_buf, ofcb->encoding_symbol_length,&(ofcb->stats_xor->nb_xor_for_IT));
+		of_add_to_symbol (parity_symbol, to_add_buf, ofcb->encoding_symbol_length,&(ofcb->stats_xor->nb_xor_for_IT));
 #else
-			of_add_to_symbol (parity_symbol, to_add_buf, ofcb->encoding_symbol_length);
+		of_add_to_symbol (parity_symbol, to_add_buf, ofcb->encoding_symbol_length);
 #endif
-		}
-		e = of_mod2sparse_next_in_row (e);
 	}
 	OF_TRACE_LVL (1, ("%s: repair symbol (esi=%d) built\n", __FUNCTION__, esi_of_symbol_to_build))
 	OF_EXIT_FUNCTION
@@ -432,8 +458,12 @@ of_status_t	of_ldpc_staircase_decode_with_new_symbol (of_ldpc_staircase_cb_t*	of
 							  void*				new_symbol,
 							  UINT32			new_symbol_esi)
 {
+	of_status_t	status;
+
 	OF_ENTER_FUNCTION
-	return of_linear_binary_code_decode_with_new_symbol((of_linear_binary_code_cb_t*)ofcb, new_symbol, new_symbol_esi);
+	status = of_linear_binary_code_decode_with_new_symbol((of_linear_binary_code_cb_t*)ofcb, new_symbol, new_symbol_esi);
+	OF_PROBE2(symbol__accept, new_symbol_esi, ofcb->nb_source_symbol_ready);
+	return status;
 }
 
 
@@ -450,9 +480,19 @@ of_status_t	of_ldpc_staircase_set_available_symbols (of_ldpc_staircase_cb_t*	ofc
 			continue;	
 		}
 		/* use the decode_with_new_symbol function */
-		of_linear_binary_code_decode_with_new_symbol((of_linear_binary_code_cb_t*)ofcb, encoding_symbols_tab[i], i);
+		if (of_linear_binary_code_decode_with_new_symbol((of_linear_binary_code_cb_t*)ofcb, encoding_symbols_tab[i], i) != OF_STATUS_OK)
+		{
+			OF_EXIT_FUNCTION
+			return OF_STATUS_FATAL_ERROR;
+		}
 		/* NB: this approach is a little bit sub-optimal with LDPC codes, as symbols are submit for IT decoding in sequence.
 		 *     We should consider randomizing this order. */
+		/* Source symbols come first, so once they are all known the remaining repair
+		 * symbols would only be stored and summed into equations nobody needs. */
+		if (i >= ofcb->nb_source_symbols - 1 && of_ldpc_staircase_is_decoding_complete(ofcb))
+		{
+			break;
+		}
 	}
 	OF_EXIT_FUNCTION
 	return OF_STATUS_OK;
@@ -463,7 +503,12 @@ of_status_t	of_ldpc_staircase_finish_decoding (of_ldpc_staircase_cb_t*	ofcb)
 {
 	OF_ENTER_FUNCTION
 #ifdef OF_LDPC_STAIRCASE_ML_DECODING
-	return of_linear_binary_code_finish_decoding_with_ml ((of_linear_binary_code_cb_t*)ofcb);		
+	of_status_t	status;
+
+	OF_PROBE1(ml__start, ofcb->nb_source_symbol_ready);
+	status = of_linear_binary_code_finish_decoding_with_ml ((of_linear_binary_code_cb_t*)ofcb);
+	OF_PROBE1(ml__done, status);
+	return status;
 #else
 	return OF_STATUS_ERROR;
 #endif
@@ -538,6 +583,23 @@ of_status_t	of_ldpc_staircase_get_control_parameter (of_ldpc_staircase_cb_t*	ofc
 		OF_TRACE_LVL(1, ("%s: OF_CTRL_GET_MAX_N (%d)\n", __FUNCTION__, *(UINT32*)value))
 		break;
 
+	case OF_CTRL_GET_ML_ESTIMATE:
+#ifdef OF_LDPC_STAIRCASE_ML_DECODING
+		if (value == NULL || length != sizeof(of_ml_estimate_t)) {
+			OF_PRINT_ERROR(("%s: OF_CTRL_GET_ML_ESTIMATE ERROR: null value or bad length (got %d, expected %zd)\n",
+				__FUNCTION__, length, sizeof(of_ml_estimate_t)))
+			goto error;
+		}
+		if (of_linear_binary_code_estimate_ml ((of_linear_binary_code_cb_t*)ofcb, (of_ml_estimate_t*)value) != OF_STATUS_OK)
+			goto error;
+		OF_TRACE_LVL(1, ("%s: OF_CTRL_GET_ML_ESTIMATE (%d unknowns, %d equations)\n", __FUNCTION__,
+			((of_ml_estimate_t*)value)->nb_unknowns, ((of_ml_estimate_t*)value)->nb_equations))
+		break;
+#else
+		OF_PRINT_ERROR(("%s: OF_CTRL_GET_ML_ESTIMATE ERROR: ML decoding not supported\n", __FUNCTION__))
+		goto error;
+#endif
+
 	case OF_CRTL_LDPC_STAIRCASE_IS_LAST_SYMBOL_NULL:
 		if (ofcb->extra_entries_added_in_pchk == true)
 		{
@@ -556,6 +618,24 @@ of_status_t	of_ldpc_staircase_get_control_parameter (of_ldpc_staircase_cb_t*	ofc
 		}
 		break;
 
+	case OF_CRTL_LDPC_STAIRCASE_GET_NB_SOURCE_SYMBOLS_READY:
+		if (value == NULL || length != sizeof(UINT32)) {
+			OF_PRINT_ERROR(("%s: OF_CRTL_LDPC_STAIRCASE_GET_NB_SOURCE_SYMBOLS_READY ERROR: null value or bad length (got %d, expected %zd)\n",
+				__FUNCTION__, length, sizeof(UINT32)))
+			goto error;
+		}
+		*(UINT32*)value = ofcb->nb_source_symbol_ready;
+		break;
+
+	case OF_CRTL_LDPC_STAIRCASE_GET_NB_REPAIR_SYMBOLS_READY:
+		if (value == NULL || length != sizeof(UINT32)) {
+			OF_PRINT_ERROR(("%s: OF_CRTL_LDPC_STAIRCASE_GET_NB_REPAIR_SYMBOLS_READY ERROR: null value or bad length (got %d, expected %zd)\n",
+				__FUNCTION__, length, sizeof(UINT32)))
+			goto error;
+		}
+		*(UINT32*)value = ofcb->nb_repair_symbol_ready;
+		break;
+
 	default:
 		OF_PRINT_ERROR(("%s: unknown type (%d)\n", __FUNCTION__, type))
 		goto error;
@@ -76,6 +76,20 @@ typedef struct of_ldpc_parameters
  */
 #define	OF_CRTL_LDPC_STAIRCASE_IS_LAST_SYMBOL_NULL	1024
 
+/**
+ * Get the number of source symbols the decoder knows so far, i.e. received or rebuilt by
+ * iterative decoding. This is a constant time call that lets the application follow the
+ * decoding progress symbol by symbol.
+ * Argument: UINT32
+ */
+#define	OF_CRTL_LDPC_STAIRCASE_GET_NB_SOURCE_SYMBOLS_READY	1025
+
+/**
+ * Same as above for the repair symbols.
+ * Argument: UINT32
+ */
+#define	OF_CRTL_LDPC_STAIRCASE_GET_NB_REPAIR_SYMBOLS_READY	1026
+
 
 #endif  /* OF_CODEC_STABLE_LDPC_SCSTAIRCASE_API */
 
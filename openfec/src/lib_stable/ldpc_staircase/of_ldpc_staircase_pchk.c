@@ -178,4 +178,235 @@ of_mod2sparse* of_create_pchck_matrix_rfc5170_compliant (UINT32		nb_rows,
 	return pchkMatrix;
 }
 
+
+/*
+ * Compact H1 generator.
+ *
+ * Same PRNG draws, in the same order, as of_create_pchck_matrix_rfc5170_compliant()
+ * so the code is unchanged, but H1 ends up in two flat arrays instead of a sparse
+ * matrix: row i holds columns h1_cols[h1_rows[i]] .. h1_cols[h1_rows[i+1] - 1], in
+ * increasing order. The staircase is not stored, row i implicitly also holds
+ * columns i and i-1.
+ *
+ * A column only ever has left_degree entries while it is built, so the duplicate
+ * checks the reference does with of_mod2sparse_find() become a scan of the rows
+ * already drawn for that column.
+ */
+of_status_t of_create_h1_rfc5170_compliant (UINT32		nb_rows,
+					    UINT32		nb_cols,
+					    UINT32		left_degree,
+					    UINT32		seed,
+					    of_ldpc_staircase_cb_t	*ofcb)
+{
+	OF_ENTER_FUNCTION
+	UINT32		added, uneven;
+	INT32		i, j, k, m;
+	INT32		t;			/* left limit within the list of possible choices u[] */
+	UINT32		*u = NULL;		/* table used to have a homogeneous 1 distrib. */
+	UINT32		*row_of = NULL;		/* row of the k-th "1" of data column j, at j * left_degree + k */
+	UINT32		*row_weight = NULL;	/* number of "1s" of each row */
+	UINT32		*last_col = NULL;	/* column of the last "1" placed in each row */
+	UINT32		*extra = NULL;		/* columns of the extra bits of each row, 0 if none */
+	UINT32		*fill = NULL;
+	UINT32		*rows = NULL;
+	UINT32		*cols = NULL;
+	UINT32		skipCols;
+	UINT32		nbDataCols;
+	UINT32		row, col;
+
+	skipCols = nb_rows;
+	nbDataCols = nb_cols - skipCols;
+	if (left_degree > nb_rows)
+	{
+		OF_PRINT_ERROR(("number of 1s per column (i.e. N1=%d parameter) is greater than total number of rows (i.e. n-k=%d)\n",
+				left_degree, nb_rows));
+		OF_EXIT_FUNCTION
+		return OF_STATUS_ERROR;
+	}
+	of_rfc5170_srand (seed);
+	u = (UINT32*) of_calloc (left_degree * nbDataCols, sizeof * u);
+	row_of = (UINT32*) of_malloc (left_degree * nbDataCols * sizeof * row_of);
+	row_weight = (UINT32*) of_calloc (nb_rows, sizeof * row_weight);
+	last_col = (UINT32*) of_calloc (nb_rows, sizeof * last_col);
+	extra = (UINT32*) of_calloc (2 * nb_rows, sizeof * extra);
+	if (u == NULL || row_of == NULL || row_weight == NULL || last_col == NULL || extra == NULL)
+	{
+		goto no_mem;
+	}
+	for (k = left_degree * nbDataCols - 1; k >= 0; k--)
+	{
+		u[k] = k % nb_rows;
+	}
+	uneven = 0;
+	t = 0;
+	for (j = 0; j < (INT32)nbDataCols; j++)
+	{
+		UINT32	*drawn = &row_of[j * left_degree];
+
+		for (k = 0; k < (INT32)left_degree; k++)
+		{
+			/* check that valid available choices remain */
+			for (i = t; i < (INT32)(left_degree * nbDataCols); i++)
+			{
+				for (m = 0; m < k && drawn[m] != u[i]; m++)
+					;
+				if (m == k)
+					break;
+			}
+			if (i < (INT32)(left_degree * nbDataCols))
+			{
+				do
+				{
+					i = t + of_rfc5170_rand (left_degree * nbDataCols - t);
+					for (m = 0; m < k && drawn[m] != u[i]; m++)
+						;
+				}
+				while (m < k);
+				row = u[i];
+				u[i] = u[t];
+				t++;
+			}
+			else
+			{
+				uneven += 1;
+				do
+				{
+					row = of_rfc5170_rand (nb_rows);
+					for (m = 0; m < k && drawn[m] != row; m++)
+						;
+				}
+				while (m < k);
+			}
+			drawn[k] = row;
+			row_weight[row]++;
+			last_col[row] = j + skipCols;
+		}
+	}
+	if (uneven > 0 && of_verbosity >= 1)
+	{
+		OF_PRINT_LVL(1, ("%s: Had to place %d checks in rows unevenly\n", __FUNCTION__, uneven))
+	}
+	of_free (u);
+	u = NULL;
+	/* Add extra bits to avoid rows with less than two checks. */
+	added = 0;
+	for (row = 0; row < nb_rows; row++)
+	{
+		if (row_weight[row] == 0)
+		{
+			col = (of_rfc5170_rand (nbDataCols)) + skipCols;
+			extra[2 * row] = col;
+			last_col[row] = col;
+			row_weight[row]++;
+			added ++;
+		}
+		if (row_weight[row] == 1 && nbDataCols > 1)
+		{
+			do
+			{
+				col = (of_rfc5170_rand (nbDataCols)) + skipCols;
+			}
+			while (col == last_col[row]);
+			extra[2 * row + 1] = col;
+			row_weight[row]++;
+			added ++;
+		}
+	}
+	ofcb->extra_entries_added_in_pchk = (added >= 1) ? 1 : 0;
+	if (added >= 1)
+	{
+		OF_TRACE_LVL(1,("%s: Added %d extra bit-checks to make row Hamming weight at least two\n", __FUNCTION__, added));
+	}
+	/* lay the rows out, columns were drawn in increasing order so only the extra bits need sorting */
+	rows = (UINT32*) of_malloc ((nb_rows + 1) * sizeof * rows);
+	fill = (UINT32*) of_malloc (nb_rows * sizeof * fill);
+	if (rows == NULL || fill == NULL)
+	{
+		goto no_mem;
+	}
+	rows[0] = 0;
+	for (row = 0; row < nb_rows; row++)
+	{
+		rows[row + 1] = rows[row] + row_weight[row];
+		fill[row] = rows[row];
+	}
+	if ((cols = (UINT32*) of_malloc ((rows[nb_rows] > 0 ? rows[nb_rows] : 1) * sizeof * cols)) == NULL)
+	{
+		goto no_mem;
+	}
+	for (j = 0; j < (INT32)(left_degree * nbDataCols); j++)
+	{
+		row = row_of[j];
+		cols[fill[row]++] = j / left_degree + skipCols;
+	}
+	for (row = 0; row < nb_rows; row++)
+	{
+		for (k = 0; k < 2; k++)
+		{
+			if ((col = extra[2 * row + k]) == 0)
+				continue;
+			for (i = fill[row]++; i > (INT32)rows[row] && cols[i - 1] > col; i--)
+			{
+				cols[i] = cols[i - 1];
+			}
+			cols[i] = col;
+		}
+	}
+	of_free (row_of);
+	of_free (row_weight);
+	of_free (last_col);
+	of_free (extra);
+	of_free (fill);
+	ofcb->h1_rows = rows;
+	ofcb->h1_cols = cols;
+	OF_EXIT_FUNCTION
+	return OF_STATUS_OK;
+
+no_mem:
+	OF_PRINT_ERROR(("%s: out of memory\n", __FUNCTION__))
+	of_free (u);
+	of_free (row_of);
+	of_free (row_weight);
+	of_free (last_col);
+	of_free (extra);
+	of_free (fill);
+	of_free (rows);
+	OF_EXIT_FUNCTION
+	return OF_STATUS_ERROR;
+}
+
+
+/*
+ * Expands the compact H1 and the implicit staircase into the sparse matrix the
+ * decoder works on. Entries are produced row after row in increasing column order,
+ * so every of_mod2sparse_insert() appends to the end of its row and column.
+ */
+of_mod2sparse* of_create_pchck_matrix_from_h1 (of_ldpc_staircase_cb_t	*ofcb)
+{
+	OF_ENTER_FUNCTION
+	of_mod2sparse	*pchkMatrix;
+	UINT32		nb_rows = ofcb->nb_repair_symbols;
+	UINT32		row, i;
+
+	if ((pchkMatrix = of_mod2sparse_allocate (nb_rows, ofcb->nb_total_symbols)) == NULL)
+	{
+		OF_EXIT_FUNCTION
+		return NULL;
+	}
+	for (row = 0; row < nb_rows; row++)
+	{
+		if (row > 0)
+		{
+			of_mod2sparse_insert (pchkMatrix, row, row - 1);
+		}
+		of_mod2sparse_insert (pchkMatrix, row, row);
+		for (i = ofcb->h1_rows[row]; i < ofcb->h1_rows[row + 1]; i++)
+		{
+			of_mod2sparse_insert (pchkMatrix, row, ofcb->h1_cols[i]);
+		}
+	}
+	OF_EXIT_FUNCTION
+	return pchkMatrix;
+}
+
 #endif /* #ifdef OF_USE_LDPC_STAIRCASE_CODEC */
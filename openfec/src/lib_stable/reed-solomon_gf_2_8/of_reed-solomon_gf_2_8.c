@@ -205,6 +205,14 @@ of_modnn (INT32 x)
 #if (GF_BITS <= 8)
 static gf of_gf_mul_table[GF_SIZE + 1][GF_SIZE + 1];
 
+/*
+ * Split-nibble form of the multiplication table used by the SIMD addmul
+ * kernels: c * x = nibble[c][x & 0x0F] ^ nibble[c][16 + (x >> 4)].
+ * The 32 bytes for a constant fit in one or two vector registers, whereas
+ * the full table row is spread over the whole 64KB table.
+ */
+static gf of_gf_mul_nibble_table[GF_SIZE + 1][32] __attribute__((aligned(32)));
+
 #define of_gf_mul(x,y) of_gf_mul_table[x][y]
 
 #define USE_GF_MULC register gf * __gf_mulc_
@@ -227,6 +235,13 @@ of_rs_init_mul_table()
 
 	for (j = 0; j < GF_SIZE + 1; j++)
 		of_gf_mul_table[0][j] = of_gf_mul_table[j][0] = 0;
+
+	for (i = 0; i < GF_SIZE + 1; i++)
+		for (j = 0; j < 16; j++)
+		{
+			of_gf_mul_nibble_table[i][j] = of_gf_mul_table[i][j];
+			of_gf_mul_nibble_table[i][16 + j] = of_gf_mul_table[i][j << 4];
+		}
 	OF_EXIT_FUNCTION
 }
 #else	/* GF_BITS > 8 */
@@ -360,7 +375,7 @@ of_generate_gf (void)
  * calls are unfrequent in my typical apps so I did not bother.
  */
 #define addmul(dst, src, c, sz) \
-    if (c != 0) of_addmul1(dst, src, c, sz)
+    if (c != 0) of_addmul1_fn(dst, src, c, sz)
 
 
 
@@ -441,6 +456,153 @@ of_addmul1 (gf *dst1, gf *src1, gf c, int sz)
 
 #endif //defined (__LP64__) || (__WORDSIZE == 64)
 
+/*
+ * SIMD addmul kernels. Each 16 byte lane looks up the low and high nibbles of
+ * src in the split-nibble table of c with a byte shuffle, and the remaining
+ * sz % 16 bytes go through the scalar table. The kernel is chosen once, in
+ * of_rs_init(), from what the CPU supports.
+ */
+#if (GF_BITS == 8) && (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define OF_RS_SIMD_X86
+#include <immintrin.h>
+
+__attribute__((target("ssse3")))
+static void
+of_addmul1_ssse3 (gf *dst, gf *src, gf c, int sz)
+{
+	const __m128i	lo = _mm_load_si128 ((const __m128i*) &of_gf_mul_nibble_table[c][0]);
+	const __m128i	hi = _mm_load_si128 ((const __m128i*) &of_gf_mul_nibble_table[c][16]);
+	const __m128i	mask = _mm_set1_epi8 (0x0F);
+	int		i;
+
+	for (i = 0; i + 16 <= sz; i += 16)
+	{
+		__m128i	x = _mm_loadu_si128 ((const __m128i*) (src + i));
+		__m128i	l = _mm_shuffle_epi8 (lo, _mm_and_si128 (x, mask));
+		__m128i	h = _mm_shuffle_epi8 (hi, _mm_and_si128 (_mm_srli_epi64 (x, 4), mask));
+		__m128i	d = _mm_loadu_si128 ((const __m128i*) (dst + i));
+		_mm_storeu_si128 ((__m128i*) (dst + i), _mm_xor_si128 (d, _mm_xor_si128 (l, h)));
+	}
+	for (; i < sz; i++)
+		dst[i] ^= of_gf_mul_table[c][src[i]];
+}
+
+__attribute__((target("avx2")))
+static void
+of_addmul1_avx2 (gf *dst, gf *src, gf c, int sz)
+{
+	const __m256i	lo = _mm256_broadcastsi128_si256 (_mm_load_si128 ((const __m128i*) &of_gf_mul_nibble_table[c][0]));
+	const __m256i	hi = _mm256_broadcastsi128_si256 (_mm_load_si128 ((const __m128i*) &of_gf_mul_nibble_table[c][16]));
+	const __m256i	mask = _mm256_set1_epi8 (0x0F);
+	int		i;
+
+	for (i = 0; i + 32 <= sz; i += 32)
+	{
+		__m256i	x = _mm256_loadu_si256 ((const __m256i*) (src + i));
+		__m256i	l = _mm256_shuffle_epi8 (lo, _mm256_and_si256 (x, mask));
+		__m256i	h = _mm256_shuffle_epi8 (hi, _mm256_and_si256 (_mm256_srli_epi64 (x, 4), mask));
+		__m256i	d = _mm256_loadu_si256 ((const __m256i*) (dst + i));
+		_mm256_storeu_si256 ((__m256i*) (dst + i), _mm256_xor_si256 (d, _mm256_xor_si256 (l, h)));
+	}
+	for (; i < sz; i++)
+		dst[i] ^= of_gf_mul_table[c][src[i]];
+}
+
+#elif (GF_BITS == 8) && (defined(__aarch64__) || defined(__ARM_NEON))
+#define OF_RS_SIMD_NEON
+#include <arm_neon.h>
+
+static void
+of_addmul1_neon (gf *dst, gf *src, gf c, int sz)
+{
+	const uint8x16_t	mask = vdupq_n_u8 (0x0F);
+#if defined(__aarch64__)
+	const uint8x16_t	lo = vld1q_u8 (&of_gf_mul_nibble_table[c][0]);
+	const uint8x16_t	hi = vld1q_u8 (&of_gf_mul_nibble_table[c][16]);
+#else
+	/* ARMv7 has no 16 byte table lookup, use VTBL on two 8 byte halves */
+	const uint8x8x2_t	lo = { { vld1_u8 (&of_gf_mul_nibble_table[c][0]), vld1_u8 (&of_gf_mul_nibble_table[c][8]) } };
+	const uint8x8x2_t	hi = { { vld1_u8 (&of_gf_mul_nibble_table[c][16]), vld1_u8 (&of_gf_mul_nibble_table[c][24]) } };
+#endif
+	int			i;
+
+	for (i = 0; i + 16 <= sz; i += 16)
+	{
+		uint8x16_t	x = vld1q_u8 (src + i);
+		uint8x16_t	xl = vandq_u8 (x, mask);
+		uint8x16_t	xh = vshrq_n_u8 (x, 4);
+#if defined(__aarch64__)
+		uint8x16_t	p = veorq_u8 (vqtbl1q_u8 (lo, xl), vqtbl1q_u8 (hi, xh));
+#else
+		uint8x16_t	p = vcombine_u8 (
+					veor_u8 (vtbl2_u8 (lo, vget_low_u8 (xl)), vtbl2_u8 (hi, vget_low_u8 (xh))),
+					veor_u8 (vtbl2_u8 (lo, vget_high_u8 (xl)), vtbl2_u8 (hi, vget_high_u8 (xh))));
+#endif
+		vst1q_u8 (dst + i, veorq_u8 (vld1q_u8 (dst + i), p));
+	}
+	for (; i < sz; i++)
+		dst[i] ^= of_gf_mul_table[c][src[i]];
+}
+#endif
+
+/* addmul kernel in use, the portable one until of_rs_init() has run */
+static void (*of_addmul1_fn) (gf *dst, gf *src, gf c, int sz) = of_addmul1;
+
+static void
+of_rs_select_addmul()
+{
+	OF_ENTER_FUNCTION
+#if defined(OF_RS_SIMD_X86)
+	__builtin_cpu_init ();
+	if (__builtin_cpu_supports ("avx2"))
+		of_addmul1_fn = of_addmul1_avx2;
+	else if (__builtin_cpu_supports ("ssse3"))
+		of_addmul1_fn = of_addmul1_ssse3;
+#elif defined(OF_RS_SIMD_NEON)
+	/* NEON is part of ARMv8, and was enabled at compile time on ARMv7 */
+	of_addmul1_fn = of_addmul1_neon;
+#endif
+	OF_EXIT_FUNCTION
+}
+
+const char*
+of_rs_addmul_kernel (UINT32 i, void *dst, void *src, UINT8 c, int sz)
+{
+	OF_ENTER_FUNCTION
+	struct {
+		const char	*name;
+		void		(*fn) (gf *dst, gf *src, gf c, int sz);
+	}		kernels[3];
+	UINT32		n = 0;
+
+	kernels[n].name = "portable";
+	kernels[n++].fn = of_addmul1;
+#if defined(OF_RS_SIMD_X86)
+	__builtin_cpu_init ();
+	if (__builtin_cpu_supports ("ssse3"))
+	{
+		kernels[n].name = "ssse3";
+		kernels[n++].fn = of_addmul1_ssse3;
+	}
+	if (__builtin_cpu_supports ("avx2"))
+	{
+		kernels[n].name = "avx2";
+		kernels[n++].fn = of_addmul1_avx2;
+	}
+#elif defined(OF_RS_SIMD_NEON)
+	kernels[n].name = "neon";
+	kernels[n++].fn = of_addmul1_neon;
+#endif
+	if (i >= n)
+	{
+		OF_EXIT_FUNCTION
+		return NULL;
+	}
+	kernels[i].fn ((gf*) dst, (gf*) src, (gf) c, sz);
+	OF_EXIT_FUNCTION
+	return kernels[i].name;
+}
+
 /*
  * computes C = AB where A is n*k, B is k*m, C is n*m
  */
@@ -733,6 +895,7 @@ of_rs_init()
 	of_rs_init_mul_table();
 	TOCK (ticks[0]);
 	DDB (printf("init_mul_table took %ldus\n", ticks[0]);)
+	of_rs_select_addmul();
 	of_rs_initialized = 1 ;
 	OF_EXIT_FUNCTION
 }
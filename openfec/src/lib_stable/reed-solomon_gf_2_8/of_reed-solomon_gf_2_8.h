@@ -298,6 +298,14 @@ void *		of_rs_new (UINT32 k, UINT32 n) ;
 
 void		of_rs_init (void) ;
 
+/*
+ * Runs addmul kernel i, dst[] += c * src[], and returns its name. Kernel 0 is the portable
+ * one, the others are the SIMD kernels this build and CPU support. Returns NULL, with
+ * nothing done, when there is no kernel i. Lets tests check every kernel against the
+ * portable one, not only the one of_rs_init() selects. of_rs_init() must have run.
+ */
+const char*	of_rs_addmul_kernel (UINT32 i, void *dst, void *src, UINT8 c, int sz) ;
+
 of_status_t	of_rs_encode (void *code, void **src, void *dst,  int index, int sz) ;
 
 of_status_t 	of_rs_decode (void *code,  void **pkt, int index[], int sz) ;
@@ -18,6 +18,7 @@ import os
 import sys
 import shutil
 import argparse
+import csv
 import subprocess
 
 # Generate inclusive float range list from given parameters
@@ -27,6 +28,22 @@ def make_range(start, stop, step):
     int_params[1] += 1
     return [i / shift for i in range(*int_params)]
 
+# Read the peak bytes, refused allocations and budget of every subsystem from
+# the memory usage report logged when tx and rx exit
+def parse_memory_usage(path):
+    usage = {}
+    with open(path) as f:
+        lines = f.read().splitlines()
+    for i, line in enumerate(lines):
+        if not line.endswith("Memory Usage"):
+            continue
+        for row in lines[i + 2:]:
+            fields = row.split()
+            if not row.startswith("\t") or len(fields) != 6:
+                break
+            usage[fields[0]] = { "peak": int(fields[2]), "refused": int(fields[4]), "budget": int(fields[5]) }
+    return usage
+
 # Get binary paths
 INSTALL_DIR = os.environ.get('DXWIFI_INSTALL_DIR', default='bin/TestDebug')
 TX = f'./{INSTALL_DIR}/tx'
@@ -48,6 +65,8 @@ parser.add_argument("--packet-loss", "-p", type = float, nargs = 3, required = T
                     help = "packet loss", metavar = metavar_names)
 parser.add_argument("--source", "-s", required = True, help = "source file path")
 parser.add_argument("--output", "-o", required = True, help = "output directory path")
+parser.add_argument("--mem-budget", "-m", type = int, default = 0,
+                    help = "tx memory budget in bytes, 0 for no limit", metavar = "BYTES")
 args = parser.parse_args()
 
 # Generate sweep lists
@@ -66,6 +85,11 @@ if os.path.exists(args.output):
     shutil.rmtree(args.output)
 os.mkdir(args.output)
 
+# Peak memory of every run is collected in one table
+memory_file = open(os.path.join(args.output, "memory.csv"), "w", newline = "")
+memory_csv = csv.writer(memory_file)
+memory_csv.writerow(("code_rate", "error_rate", "packet_loss", "tx_peak", "tx_refused", "tx_budget", "rx_peak", "rx_refused", "rx_budget"))
+
 # Iterate over code rates
 for cr in code_rates:
 
@@ -85,15 +109,24 @@ for cr in code_rates:
 
             # Perform "transmission"
             tx_output = os.path.join(er_pl_dir, "file.sent")
-            tx_command = f"{TX} -c {cr} -e {er} -p {pl} --savefile {tx_output} {args.source}"
-            with open(os.path.join(er_pl_dir, "tx_output.txt"), "w") as f:
+            tx_command = f"{TX} -c {cr} -e {er} -p {pl} -M {args.mem_budget} --savefile {tx_output} {args.source}"
+            tx_log = os.path.join(er_pl_dir, "tx_output.txt")
+            with open(tx_log, "w") as f:
                 subprocess.run(tx_command.split(), stdout = f, stderr = f)
 
             # Perform "reception"
             rx_output = os.path.join(er_pl_dir, "file.received")
             rx_command = f"{RX} --savefile {tx_output} {rx_output}"
-            with open(os.path.join(er_pl_dir, "rx_output.txt"), "w") as f:
+            rx_log = os.path.join(er_pl_dir, "rx_output.txt")
+            with open(rx_log, "w") as f:
                 subprocess.run(rx_command.split(), stdout = f, stderr = f)
 
+            # Record the overall memory figures of both sides
+            tx_total = parse_memory_usage(tx_log).get("total", {})
+            rx_total = parse_memory_usage(rx_log).get("total", {})
+            memory_csv.writerow((cr, er, pl, *[side.get(key, "") for side in (tx_total, rx_total) for key in ("peak", "refused", "budget")]))
+
             # Notify user
-            print(f"Finished packet loss rate {pl:.{pl_pad}f} for error rate {er:.{er_pad}f} with code rate {cr:.{cr_pad}f}.")
\ No newline at end of file
+            print(f"Finished packet loss rate {pl:.{pl_pad}f} for error rate {er:.{er_pad}f} with code rate {cr:.{cr_pad}f}.")
+
+memory_file.close()
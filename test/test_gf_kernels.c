@@ -0,0 +1,120 @@
+/**
+ *  test_gf_kernels.c
+ *
+ *  DESCRIPTION: Randomized differential test of the GF(2^8) addmul kernels of
+ *  OpenFEC's Reed-Solomon codec. Every SIMD kernel the CPU supports must give
+ *  byte identical output to the portable kernel, which is itself checked
+ *  against a bitwise multiply in the field. Lengths are mostly odd, so every
+ *  kernel runs its scalar tail, and source and destination sit at unaligned
+ *  offsets between guard bytes that no kernel may touch.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: usage is `test_gf_kernels [iterations] [seed]`. The program exits
+ *  with a non-zero status on the first mismatch.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <reed-solomon_gf_2_8/of_reed-solomon_gf_2_8_includes.h>
+
+
+// Longest vector tested, a few times the widest SIMD lane
+#define MAX_LENGTH 1024
+
+// Largest offset of a vector from an aligned address
+#define MAX_OFFSET 63
+
+// Guard bytes on each side of the destination
+#define GUARD_SIZE 64
+
+#define BUFFER_SIZE (GUARD_SIZE + MAX_OFFSET + MAX_LENGTH + GUARD_SIZE)
+
+// 1 + x^2 + x^3 + x^4 + x^8, the field polynomial of the codec
+#define GF_POLYNOMIAL 0x11d
+
+
+// Product in GF(2^8), shift and add
+static uint8_t gf_mul(uint8_t a, uint8_t b) {
+    unsigned product = 0;
+    unsigned shifted = a;
+    for(; b; b >>= 1) {
+        if(b & 1) {
+            product ^= shifted;
+        }
+        shifted <<= 1;
+        if(shifted & 0x100) {
+            shifted ^= GF_POLYNOMIAL;
+        }
+    }
+    return product;
+}
+
+
+int main(int argc, char** argv) {
+    unsigned iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 10000;
+    unsigned seed       = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+
+    srand(seed);
+    of_rs_init();
+
+    unsigned nkernels = 0;
+    uint8_t scratch[1] = { 0 };
+    while(of_rs_addmul_kernel(nkernels, scratch, scratch, 0, 0)) {
+        printf("Kernel %u: %s\n", nkernels, of_rs_addmul_kernel(nkernels, scratch, scratch, 0, 0));
+        ++nkernels;
+    }
+
+    static uint8_t src[BUFFER_SIZE] __attribute__((aligned(64)));
+    static uint8_t dst[BUFFER_SIZE] __attribute__((aligned(64)));
+    static uint8_t expected[BUFFER_SIZE];
+    static uint8_t actual[BUFFER_SIZE] __attribute__((aligned(64)));
+
+    for(unsigned it = 0; it < iterations; ++it) {
+
+        // Short vectors never fill a lane, the rest mostly end part way into one
+        int length = (it % 4 == 0) ? rand() % 48 : rand() % (MAX_LENGTH + 1);
+        if(it % 2 && length % 2 == 0) {
+            length = (length + 1) % (MAX_LENGTH + 1);
+        }
+        size_t src_offset = rand() % (MAX_OFFSET + 1);
+        size_t dst_offset = GUARD_SIZE + rand() % (MAX_OFFSET + 1);
+        uint8_t c = (it % 16 == 0) ? it % 2 : rand();
+
+        for(size_t i = 0; i < BUFFER_SIZE; ++i) {
+            src[i] = rand();
+            dst[i] = rand();
+        }
+
+        // The portable kernel has to match the field itself
+        memcpy(expected, dst, BUFFER_SIZE);
+        for(int i = 0; i < length; ++i) {
+            expected[dst_offset + i] ^= gf_mul(c, src[src_offset + i]);
+        }
+
+        for(unsigned k = 0; k < nkernels; ++k) {
+            memcpy(actual, dst, BUFFER_SIZE);
+            const char* name = of_rs_addmul_kernel(k, actual + dst_offset, src + src_offset, c, length);
+
+            if(memcmp(actual, expected, BUFFER_SIZE) != 0) {
+                size_t first = 0;
+                while(actual[first] == expected[first]) {
+                    ++first;
+                }
+                fprintf(
+                    stderr,
+                    "Mismatch: kernel=%s, iteration=%u, length=%d, src offset=%zu, dst offset=%zu, c=%u, first difference at %+ld\n",
+                    name, it, length, src_offset, dst_offset - GUARD_SIZE, c, (long) first - (long) dst_offset
+                );
+                return 1;
+            }
+        }
+    }
+    printf("%u vectors matched across %u kernels\n", iterations, nkernels);
+    return 0;
+}
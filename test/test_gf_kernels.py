@@ -0,0 +1,29 @@
+'''
+    FILE: test_gf_kernels.py
+
+    DESCRIPTION: Differential test of the Reed-Solomon codec's GF(2^8) kernels
+
+    https://github.com/oresat/oresat-dxwifi-software
+
+    NOTES: Runs the `test_gf_kernels` program, only built with the `TestDebug`
+    and `TestRel` configurations, which compares every SIMD addmul kernel the
+    CPU supports against the portable one on random unaligned vectors.
+'''
+
+import os
+import unittest
+import subprocess
+
+INSTALL_DIR = os.environ.get('DXWIFI_INSTALL_DIR', default='bin/TestDebug')
+
+TEST_GF = f'./{INSTALL_DIR}/test_gf_kernels'
+
+
+class TestGFKernels(unittest.TestCase):
+
+    def testMatchesPortableKernel(self):
+        '''SIMD kernels give byte identical output to the portable kernel'''
+
+        for seed in range(4):
+            result = subprocess.run([TEST_GF, '20000', str(seed)], capture_output=True, text=True)
+            self.assertEqual(result.returncode, 0, result.stderr)
@@ -0,0 +1,317 @@
+/**
+ *  test_ml_decoding.c
+ *
+ *  DESCRIPTION: Randomized differential test of OpenFEC's ML solvers against
+ *  plain Gaussian elimination. Random GF(2) systems are built over random
+ *  symbols, then solved by the Method of Four Russians dense solver, by the
+ *  inactivation solver on their sparse form, and by a reference Gauss-Jordan
+ *  elimination that adds one pivot row at a time, as ML decoding did before.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: usage is `test_ml_decoding [iterations] [seed]`. The program exits
+ *  with a non-zero status on the first mismatch. Solvers must agree on
+ *  whether each system has a unique solution and, when it does, on every
+ *  symbol of it.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// The ML tools are only declared for codecs that decode with them
+#define ML_DECODING
+#include <linear_binary_codes_utils/of_linear_binary_code.h>
+
+
+// Largest system tested, in columns. Past a few hundred the M4R tables are
+// at their widest, so bigger systems don't reach any new code
+#define MAX_COLS 600
+
+// Extra equations a system may have over its number of unknowns
+#define MAX_EXTRA_ROWS 8
+
+// Symbols are kept small, every solver adds them a whole word at a time
+#define SYMBOL_SIZE 16
+
+
+// A system of equations over GF(2), one byte per coefficient, with the
+// constant term of each equation
+typedef struct {
+    uint32_t    rows;
+    uint32_t    cols;
+    uint8_t*    coefs;
+    uint8_t*    constants;
+} gf2_system;
+
+
+static uint8_t* coef(gf2_system* sys, uint32_t row, uint32_t col) {
+    return sys->coefs + (size_t) row * sys->cols + col;
+}
+
+
+static uint8_t* constant(gf2_system* sys, uint32_t row) {
+    return sys->constants + (size_t) row * SYMBOL_SIZE;
+}
+
+
+static void add_symbol(uint8_t* to, const uint8_t* from) {
+    for(size_t i = 0; i < SYMBOL_SIZE; ++i) {
+        to[i] ^= from[i];
+    }
+}
+
+
+static bool is_zero(const uint8_t* symbol) {
+    for(size_t i = 0; i < SYMBOL_SIZE; ++i) {
+        if(symbol[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Random system with the given solution. Dense systems have about half their
+// coefficients set, sparse ones a few per row like a parity check matrix,
+// with the odd heavy row. Most sparse systems also get a shuffled diagonal,
+// otherwise nearly all of them would leave a column uncovered. Any system may
+// still be rank deficient
+static void make_system(gf2_system* sys, bool sparse, const uint8_t* solution) {
+    memset(sys->coefs, 0, (size_t) sys->rows * sys->cols);
+    memset(sys->constants, 0, (size_t) sys->rows * SYMBOL_SIZE);
+
+    if(sparse && rand() % 4) {
+        uint32_t diagonal[MAX_COLS + MAX_EXTRA_ROWS];
+        for(uint32_t row = 0; row < sys->rows; ++row) {
+            diagonal[row] = row;
+        }
+        for(uint32_t row = sys->rows - 1; row > 0; --row) {
+            uint32_t other = rand() % (row + 1);
+            uint32_t tmp = diagonal[row];
+            diagonal[row] = diagonal[other];
+            diagonal[other] = tmp;
+        }
+        for(uint32_t col = 0; col < sys->cols; ++col) {
+            *coef(sys, diagonal[col], col) = 1;
+        }
+    }
+
+    for(uint32_t row = 0; row < sys->rows; ++row) {
+        if(sparse) {
+            uint32_t degree = (rand() % 16 == 0) ? sys->cols / 2 : 1 + (uint32_t) rand() % 6;
+            for(uint32_t i = 0; i < degree; ++i) {
+                *coef(sys, row, rand() % sys->cols) = 1;
+            }
+        }
+        else {
+            for(uint32_t col = 0; col < sys->cols; ++col) {
+                *coef(sys, row, col) = rand() & 1;
+            }
+        }
+        for(uint32_t col = 0; col < sys->cols; ++col) {
+            if(*coef(sys, row, col)) {
+                add_symbol(constant(sys, row), solution + (size_t) col * SYMBOL_SIZE);
+            }
+        }
+    }
+}
+
+
+// Gauss-Jordan elimination, each pivot row added in turn to every other row
+// holding its column. Works on a copy, false if the system isn't full rank
+static bool reference_solve(const gf2_system* src, uint8_t* solution) {
+    gf2_system sys = *src;
+    sys.coefs     = malloc((size_t) sys.rows * sys.cols);
+    sys.constants = malloc((size_t) sys.rows * SYMBOL_SIZE);
+    memcpy(sys.coefs, src->coefs, (size_t) sys.rows * sys.cols);
+    memcpy(sys.constants, src->constants, (size_t) sys.rows * SYMBOL_SIZE);
+
+    uint8_t row_buffer[MAX_COLS];
+    uint8_t symbol_buffer[SYMBOL_SIZE];
+
+    bool solved = true;
+    for(uint32_t col = 0; col < sys.cols && solved; ++col) {
+        uint32_t pivot = col;
+        while(pivot < sys.rows && !*coef(&sys, pivot, col)) {
+            ++pivot;
+        }
+        if(pivot == sys.rows) {
+            solved = false;
+            break;
+        }
+        if(pivot != col) {
+            memcpy(row_buffer, coef(&sys, col, 0), sys.cols);
+            memcpy(coef(&sys, col, 0), coef(&sys, pivot, 0), sys.cols);
+            memcpy(coef(&sys, pivot, 0), row_buffer, sys.cols);
+            memcpy(symbol_buffer, constant(&sys, col), SYMBOL_SIZE);
+            memcpy(constant(&sys, col), constant(&sys, pivot), SYMBOL_SIZE);
+            memcpy(constant(&sys, pivot), symbol_buffer, SYMBOL_SIZE);
+        }
+        for(uint32_t row = 0; row < sys.rows; ++row) {
+            if(row == col || !*coef(&sys, row, col)) {
+                continue;
+            }
+            for(uint32_t c = col; c < sys.cols; ++c) {
+                *coef(&sys, row, c) ^= *coef(&sys, col, c);
+            }
+            add_symbol(constant(&sys, row), constant(&sys, col));
+        }
+    }
+    if(solved) {
+        memcpy(solution, sys.constants, (size_t) sys.cols * SYMBOL_SIZE);
+    }
+    free(sys.coefs);
+    free(sys.constants);
+    return solved;
+}
+
+
+// Constant terms as OpenFEC takes them, a zero constant may be left NULL
+static void** openfec_constants(gf2_system* sys) {
+    void** constants = calloc(sys->rows, sizeof(void*));
+    for(uint32_t row = 0; row < sys->rows; ++row) {
+        if(is_zero(constant(sys, row)) && rand() % 2) {
+            continue;
+        }
+        constants[row] = of_malloc(SYMBOL_SIZE);
+        memcpy(constants[row], constant(sys, row), SYMBOL_SIZE);
+    }
+    return constants;
+}
+
+
+static void free_symbols(void** symbols, uint32_t count) {
+    for(uint32_t i = 0; i < count; ++i) {
+        of_free(symbols[i]);
+    }
+    free(symbols);
+}
+
+
+// Compare an OpenFEC outcome with the reference. On success every variable
+// must be set and match the reference solution
+static bool check_outcome(const char* solver, unsigned it, gf2_system* sys, of_status_t status, void** variables, bool solvable, const uint8_t* expected) {
+    if((status == OF_STATUS_OK) != solvable) {
+        fprintf(stderr, "%s disagrees on rank: iteration=%u, %ux%u, status=%d, reference %s\n",
+            solver, it, sys->rows, sys->cols, status, solvable ? "solved" : "failed");
+        return false;
+    }
+    if(!solvable) {
+        return true;
+    }
+    for(uint32_t col = 0; col < sys->cols; ++col) {
+        if(!variables[col] || memcmp(variables[col], expected + (size_t) col * SYMBOL_SIZE, SYMBOL_SIZE) != 0) {
+            fprintf(stderr, "%s mismatch: iteration=%u, %ux%u, column=%u\n", solver, it, sys->rows, sys->cols, col);
+            return false;
+        }
+    }
+    return true;
+}
+
+
+int main(int argc, char** argv) {
+    unsigned iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 2000;
+    unsigned seed       = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+
+    srand(seed);
+
+    uint8_t* solution = malloc((size_t) MAX_COLS * SYMBOL_SIZE);
+    uint8_t* expected = malloc((size_t) MAX_COLS * SYMBOL_SIZE);
+
+    gf2_system sys = {
+        .coefs      = malloc((size_t) (MAX_COLS + MAX_EXTRA_ROWS) * MAX_COLS),
+        .constants  = malloc((size_t) (MAX_COLS + MAX_EXTRA_ROWS) * SYMBOL_SIZE)
+    };
+
+    of_linear_binary_code_cb_t ofcb;
+    memset(&ofcb, 0, sizeof(ofcb));
+    ofcb.encoding_symbol_length = SYMBOL_SIZE;
+    ofcb.tmp_tab_symbols        = malloc((MAX_COLS + MAX_EXTRA_ROWS) * sizeof(void*));
+#ifdef OF_DEBUG
+    of_symbol_stats_op_t stats_xor;
+    memset(&stats_xor, 0, sizeof(stats_xor));
+    ofcb.stats_xor = &stats_xor;
+#endif
+
+    unsigned long solved = 0;
+
+    for(unsigned it = 0; it < iterations; ++it) {
+        bool sparse = it % 2;
+
+        // Small systems are exercised as often as large ones
+        sys.cols = 1 + rand() % ((it % 4 < 2) ? 64 : MAX_COLS);
+        sys.rows = sys.cols + rand() % (MAX_EXTRA_ROWS + 1);
+
+        for(size_t i = 0; i < (size_t) sys.cols * SYMBOL_SIZE; ++i) {
+            solution[i] = rand();
+        }
+        make_system(&sys, sparse, solution);
+
+        bool solvable = reference_solve(&sys, expected);
+        if(solvable && memcmp(expected, solution, (size_t) sys.cols * SYMBOL_SIZE) != 0) {
+            fprintf(stderr, "Reference solution is wrong: iteration=%u, %ux%u\n", it, sys.rows, sys.cols);
+            return 1;
+        }
+        solved += solvable;
+
+        // Method of Four Russians dense solver
+        of_mod2dense* dense = of_mod2dense_allocate(sys.rows, sys.cols);
+        for(uint32_t row = 0; row < sys.rows; ++row) {
+            for(uint32_t col = 0; col < sys.cols; ++col) {
+                if(*coef(&sys, row, col)) {
+                    of_mod2dense_set(dense, row, col, 1);
+                }
+            }
+        }
+        void** constants = openfec_constants(&sys);
+        void** variables = calloc(sys.cols, sizeof(void*));
+
+        of_status_t status = of_linear_binary_code_solve_dense_system(&ofcb, dense, constants, variables);
+        bool ok = check_outcome("Dense solver", it, &sys, status, variables, solvable, expected);
+
+        free_symbols(constants, sys.rows);
+        free_symbols(variables, sys.cols);
+        of_mod2dense_free(dense);
+        if(!ok) {
+            return 1;
+        }
+
+        // Inactivation solver, peeling then the same dense solver on the core.
+        // Peeling is meant for parity check matrices, dense systems only slow it
+        if(sparse) {
+            of_mod2sparse* matrix = of_mod2sparse_allocate(sys.rows, sys.cols);
+            for(uint32_t row = 0; row < sys.rows; ++row) {
+                for(uint32_t col = 0; col < sys.cols; ++col) {
+                    if(*coef(&sys, row, col)) {
+                        of_mod2sparse_insert(matrix, row, col);
+                    }
+                }
+            }
+            constants = openfec_constants(&sys);
+            variables = calloc(sys.cols, sizeof(void*));
+
+            status = of_linear_binary_code_solve_sparse_system_with_inactivation(&ofcb, matrix, constants, variables);
+            ok = check_outcome("Inactivation solver", it, &sys, status, variables, solvable, expected);
+
+            free_symbols(constants, sys.rows);
+            free_symbols(variables, sys.cols);
+            of_mod2sparse_free(matrix);
+            of_free(matrix);
+            if(!ok) {
+                return 1;
+            }
+        }
+    }
+    printf("%u systems, %lu full rank\n", iterations, solved);
+
+    free(ofcb.tmp_tab_symbols);
+    free(sys.coefs);
+    free(sys.constants);
+    free(solution);
+    free(expected);
+    return 0;
+}
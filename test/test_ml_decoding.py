@@ -0,0 +1,30 @@
+'''
+    FILE: test_ml_decoding.py
+
+    DESCRIPTION: Differential test of OpenFEC's ML decoding solvers
+
+    https://github.com/oresat/oresat-dxwifi-software
+
+    NOTES: Runs the `test_ml_decoding` program, only built with the
+    `TestDebug` and `TestRel` configurations, which compares the Method of
+    Four Russians and inactivation solvers against Gaussian elimination on
+    random dense and sparse systems.
+'''
+
+import os
+import unittest
+import subprocess
+
+INSTALL_DIR = os.environ.get('DXWIFI_INSTALL_DIR', default='bin/TestDebug')
+
+TEST_ML = f'./{INSTALL_DIR}/test_ml_decoding'
+
+
+class TestMLDecoding(unittest.TestCase):
+
+    def testMatchesGaussianElimination(self):
+        '''Solutions and rank failures match Gaussian elimination on random systems'''
+
+        for seed in range(4):
+            result = subprocess.run([TEST_ML, '1000', str(seed)], capture_output=True, text=True)
+            self.assertEqual(result.returncode, 0, result.stderr)
@@ -0,0 +1,246 @@
+/**
+ *  test_raptor.c
+ *
+ *  DESCRIPTION: Randomized round trip test of the Raptor fountain code. Random
+ *  source blocks are precoded, a random share of their source symbols is
+ *  dropped and replaced by repair symbols with random ESIs, and the decoder
+ *  must recover the block. Whole messages are then fountain encoded through
+ *  libdxwifi, their frames shuffled and thinned out, and dxwifi_decode must
+ *  give the message back.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: usage is `test_raptor [iterations] [seed]`. The program exits with
+ *  a non-zero status on the first mismatch. Every block gets RAPTOR_OVERHEAD
+ *  distinct symbols past K, where the odds of a decoding failure are far too
+ *  small to show up in a run.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <libdxwifi/fec.h>
+#include <libdxwifi/details/raptor.h>
+#include <libdxwifi/details/logging.h>
+
+
+// Largest source block tested at the code level
+#define MAX_K 1500
+
+// Largest message tested through libdxwifi, in symbols
+#define MAX_MESSAGE_SYMBOLS 300
+
+// Distinct encoding symbols past K handed to the decoder
+#define RAPTOR_OVERHEAD 15
+
+// Symbols are kept small, the code adds them a whole word at a time
+#define MAX_SYMBOL_SIZE 64
+
+
+static void fill_random(uint8_t* data, size_t size) {
+    for(size_t i = 0; i < size; ++i) {
+        data[i] = rand();
+    }
+}
+
+
+// Shuffles the first count entries, Fisher-Yates
+static void shuffle(uint32_t* values, size_t count) {
+    for(size_t i = count; i > 1; --i) {
+        size_t j = rand() % i;
+        uint32_t tmp  = values[i - 1];
+        values[i - 1] = values[j];
+        values[j]     = tmp;
+    }
+}
+
+
+static bool test_code(unsigned it) {
+    uint32_t k  = (it % 8 == 0) ? 1 + rand() % MAX_K : 1 + rand() % 100;
+    size_t size = 8 * (1 + rand() % (MAX_SYMBOL_SIZE / 8));
+
+    raptor_code code;
+    if(!raptor_init(&code, k)) {
+        fprintf(stderr, "Init failed: iteration=%u, k=%u\n", it, k);
+        return false;
+    }
+
+    uint8_t* original = malloc(k * size);
+    uint8_t* source   = malloc(k * size);
+    uint8_t* inter    = malloc(code.l * size);
+    bool*    known    = malloc(k * sizeof(bool));
+
+    // Half of the iterations lose every source symbol
+    uint32_t nlost = (it % 2) ? k : rand() % (k + 1);
+    size_t nrepair = nlost + RAPTOR_OVERHEAD;
+
+    uint8_t*  repair = malloc(nrepair * size);
+    uint32_t* esi    = malloc(nrepair * sizeof(uint32_t));
+    uint32_t* order  = malloc(k * sizeof(uint32_t));
+
+    void** source_ptrs = malloc(k * sizeof(void*));
+    void** inter_ptrs  = malloc(code.l * sizeof(void*));
+    void** repair_ptrs = malloc(nrepair * sizeof(void*));
+
+    fill_random(original, k * size);
+    memcpy(source, original, k * size);
+
+    for(uint32_t i = 0; i < k; ++i) {
+        source_ptrs[i] = source + i * size;
+        order[i] = i;
+    }
+    for(uint32_t i = 0; i < code.l; ++i) {
+        inter_ptrs[i] = inter + i * size;
+    }
+
+    bool passed = raptor_precode(&code, source_ptrs, inter_ptrs, size);
+    if(!passed) {
+        fprintf(stderr, "Precode failed: iteration=%u, k=%u\n", it, k);
+    }
+
+    // The code is systematic, ESIs below K are the source symbols
+    uint8_t symbol[MAX_SYMBOL_SIZE];
+    for(uint32_t i = 0; passed && i < k; ++i) {
+        raptor_encode(&code, inter_ptrs, i, symbol, size);
+        if(memcmp(symbol, original + i * size, size) != 0) {
+            fprintf(stderr, "Not systematic: iteration=%u, k=%u, esi=%u\n", it, k, i);
+            passed = false;
+        }
+    }
+
+    // Repair ESIs are distinct and anywhere in the 16 bit ESI space
+    for(size_t i = 0; passed && i < nrepair; ++i) {
+        bool duplicate;
+        do {
+            esi[i] = k + rand() % (UINT16_MAX + 1 - k);
+            duplicate = false;
+            for(size_t j = 0; j < i && !duplicate; ++j) {
+                duplicate = (esi[j] == esi[i]);
+            }
+        } while(duplicate);
+
+        repair_ptrs[i] = repair + i * size;
+        raptor_encode(&code, inter_ptrs, esi[i], repair_ptrs[i], size);
+    }
+
+    if(passed) {
+        shuffle(order, k);
+        for(uint32_t i = 0; i < k; ++i) {
+            known[i] = true;
+        }
+        for(uint32_t i = 0; i < nlost; ++i) {
+            known[order[i]] = false;
+            memset(source + order[i] * size, 0xa5, size);
+        }
+
+        if(!raptor_decode(&code, source_ptrs, known, repair_ptrs, esi, nrepair, size)) {
+            fprintf(stderr, "Decode failed: iteration=%u, k=%u, lost=%u\n", it, k, nlost);
+            passed = false;
+        }
+        else if(memcmp(source, original, k * size) != 0) {
+            fprintf(stderr, "Mismatch: iteration=%u, k=%u, lost=%u\n", it, k, nlost);
+            passed = false;
+        }
+    }
+
+    free(repair_ptrs);
+    free(inter_ptrs);
+    free(source_ptrs);
+    free(order);
+    free(esi);
+    free(repair);
+    free(known);
+    free(inter);
+    free(source);
+    free(original);
+    raptor_close(&code);
+    return passed;
+}
+
+
+static bool test_message(unsigned it) {
+    static const dxwifi_fec_inner_code_t inner_codes[] = { DXWIFI_FEC_INNER_RS, DXWIFI_FEC_INNER_CRC, DXWIFI_FEC_INNER_NONE };
+
+    dxwifi_fec_inner_code_t inner_code = inner_codes[it % 3];
+    size_t symbol_size = (inner_code == DXWIFI_FEC_INNER_RS) ? DXWIFI_FEC_SYMBOL_SIZE : DXWIFI_FEC_RAW_SYMBOL_SIZE;
+
+    // Messages that end part way through a symbol are padded by the encoder
+    size_t msglen = 1 + rand() % (MAX_MESSAGE_SYMBOLS * symbol_size);
+    size_t k      = (msglen + symbol_size - 1) / symbol_size;
+    float coderate = 0.5;
+
+    uint8_t* message = malloc(msglen);
+    fill_random(message, msglen);
+
+    void* encoded = NULL;
+    ssize_t encoded_size = dxwifi_encode_fountain(message, msglen, coderate, inner_code, &encoded);
+    if(encoded_size < 0) {
+        fprintf(stderr, "Encode failed: iteration=%u, msglen=%zu - %s\n", it, msglen, dxwifi_fec_error_to_str(encoded_size));
+        free(message);
+        return false;
+    }
+
+    // Only K + RAPTOR_OVERHEAD frames are kept, in a random order
+    size_t nframes = encoded_size / DXWIFI_RS_LDPC_FRAME_SIZE;
+    size_t nkept   = (k + RAPTOR_OVERHEAD < nframes) ? k + RAPTOR_OVERHEAD : nframes;
+
+    uint32_t* order = malloc(nframes * sizeof(uint32_t));
+    for(size_t i = 0; i < nframes; ++i) {
+        order[i] = i;
+    }
+    shuffle(order, nframes);
+
+    uint8_t* received = malloc(nkept * DXWIFI_RS_LDPC_FRAME_SIZE);
+    for(size_t i = 0; i < nkept; ++i) {
+        memcpy(received + i * DXWIFI_RS_LDPC_FRAME_SIZE, (uint8_t*) encoded + order[i] * DXWIFI_RS_LDPC_FRAME_SIZE, DXWIFI_RS_LDPC_FRAME_SIZE);
+    }
+
+    bool passed = true;
+
+    void* decoded = NULL;
+    ssize_t decoded_size = dxwifi_decode(received, nkept * DXWIFI_RS_LDPC_FRAME_SIZE, &decoded);
+    if(decoded_size < 0) {
+        fprintf(stderr, "Decode failed: iteration=%u, msglen=%zu, frames=%zu/%zu - %s\n", it, msglen, nkept, nframes, dxwifi_fec_error_to_str(decoded_size));
+        passed = false;
+    }
+    else if((size_t) decoded_size != msglen || memcmp(decoded, message, msglen) != 0) {
+        fprintf(stderr, "Mismatch: iteration=%u, msglen=%zu, decoded=%zd\n", it, msglen, decoded_size);
+        passed = false;
+    }
+
+    free(decoded);
+    free(received);
+    free(order);
+    free(encoded);
+    free(message);
+    return passed;
+}
+
+
+int main(int argc, char** argv) {
+    unsigned iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000;
+    unsigned seed       = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+
+    srand(seed);
+    set_log_level(DXWIFI_LOG_ALL_MODULES, DXWIFI_LOG_ERROR);
+
+    for(unsigned it = 0; it < iterations; ++it) {
+        if(!test_code(it)) {
+            return 1;
+        }
+    }
+
+    // Messages go through the whole encoder and decoder, fewer are needed
+    unsigned messages = iterations / 10 + 1;
+    for(unsigned it = 0; it < messages; ++it) {
+        if(!test_message(it)) {
+            return 1;
+        }
+    }
+    printf("%u blocks and %u messages round tripped\n", iterations, messages);
+    return 0;
+}
@@ -0,0 +1,29 @@
+'''
+    FILE: test_raptor.py
+
+    DESCRIPTION: Round trip test of the libdxwifi Raptor fountain code
+
+    https://github.com/oresat/oresat-dxwifi-software
+
+    NOTES: Runs the `test_raptor` program, only built with the `TestDebug`
+    and `TestRel` configurations, which decodes random blocks and fountain
+    coded messages from a random subset of their symbols.
+'''
+
+import os
+import unittest
+import subprocess
+
+INSTALL_DIR = os.environ.get('DXWIFI_INSTALL_DIR', default='bin/TestDebug')
+
+TEST_RAPTOR = f'./{INSTALL_DIR}/test_raptor'
+
+
+class TestRaptor(unittest.TestCase):
+
+    def testRoundTrip(self):
+        '''Blocks and messages decode from any K + overhead of their symbols'''
+
+        for seed in range(4):
+            result = subprocess.run([TEST_RAPTOR, '500', str(seed)], capture_output=True, text=True)
+            self.assertEqual(result.returncode, 0, result.stderr)
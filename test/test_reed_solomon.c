@@ -0,0 +1,114 @@
+/**
+ *  test_reed_solomon.c
+ *
+ *  DESCRIPTION: Randomized differential test of the libdxwifi Reed-Solomon
+ *  error correction against rscode. Codewords are encoded with rscode, checked
+ *  against the libdxwifi encoder, hit with random symbol errors and corrected
+ *  by both decoders.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: usage is `test_reed_solomon [iterations] [seed]`. The program exits
+ *  with a non-zero status on the first mismatch.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <rscode/ecc.h>
+
+#include <libdxwifi/details/reed_solomon.h>
+
+
+// Error counts past the correction limit are tested too
+#define MAX_INJECTED_ERRORS (RS_MAX_CORRECTABLE + 4)
+
+
+static void inject_errors(uint8_t* codeword, size_t csize, int nerrors) {
+    bool hit[RSCODE_MAX_LEN] = { false };
+
+    for(int e = 0; e < nerrors; ++e) {
+        size_t pos;
+        do {
+            pos = rand() % csize;
+        } while(hit[pos]);
+        hit[pos] = true;
+
+        codeword[pos] ^= 1 + rand() % 255;
+    }
+}
+
+
+int main(int argc, char** argv) {
+    unsigned iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+    unsigned seed       = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+
+    srand(seed);
+    initialize_ecc();
+
+    unsigned long corrected = 0, uncorrectable = 0;
+
+    uint8_t message[RSCODE_MAX_MSG_LEN];
+    uint8_t original[RSCODE_MAX_LEN];
+    uint8_t expected[RSCODE_MAX_LEN];
+    uint8_t actual[RSCODE_MAX_LEN];
+
+    for(unsigned it = 0; it < iterations; ++it) {
+
+        // Shortened codes are exercised as well as full length ones
+        size_t msglen = (it % 4 == 0) ? RSCODE_NPAR / 2 + rand() % (RSCODE_MAX_MSG_LEN - RSCODE_NPAR / 2) : RSCODE_MAX_MSG_LEN;
+        size_t csize  = msglen + RSCODE_NPAR;
+        int nerrors   = rand() % (MAX_INJECTED_ERRORS + 1);
+
+        for(size_t i = 0; i < msglen; ++i) {
+            message[i] = rand();
+        }
+        encode_data(message, msglen, original);
+
+        rs_encode(message, msglen, actual);
+        if(memcmp(actual, original, csize) != 0) {
+            fprintf(stderr, "Encoder mismatch: iteration=%u, csize=%zu\n", it, csize);
+            return 1;
+        }
+
+        memcpy(expected, original, csize);
+        inject_errors(expected, csize, nerrors);
+        memcpy(actual, expected, csize);
+
+        decode_data(expected, csize);
+        if((rs_check(actual, csize) != 0) != (check_syndrome() != 0)) {
+            fprintf(stderr, "Check mismatch: iteration=%u, csize=%zu, errors=%d\n", it, csize, nerrors);
+            return 1;
+        }
+        if(check_syndrome() != 0) {
+            correct_errors_erasures(expected, csize, 0, NULL);
+        }
+
+        int count = rs_correct_errors(actual, csize);
+
+        if(nerrors <= RS_MAX_CORRECTABLE) {
+            if(count != nerrors || memcmp(actual, original, csize) != 0 || memcmp(actual, expected, csize) != 0) {
+                fprintf(stderr, "Mismatch: iteration=%u, csize=%zu, errors=%d, corrected=%d\n", it, csize, nerrors, count);
+                return 1;
+            }
+        }
+        else if(count != RS_UNCORRECTABLE && memcmp(actual, expected, csize) != 0) {
+            // Past the limit a decoder may land on a different codeword, but
+            // when both claim a correction they must agree on it
+            fprintf(stderr, "Miscorrection differs: iteration=%u, csize=%zu, errors=%d, corrected=%d\n", it, csize, nerrors, count);
+            return 1;
+        }
+
+        if(count == RS_UNCORRECTABLE) {
+            ++uncorrectable;
+        }
+        else {
+            corrected += count;
+        }
+    }
+    printf("%u codewords, %lu symbols corrected, %lu uncorrectable\n", iterations, corrected, uncorrectable);
+    return 0;
+}
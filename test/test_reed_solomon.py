@@ -0,0 +1,29 @@
+'''
+    FILE: test_reed_solomon.py
+
+    DESCRIPTION: Differential test of the libdxwifi Reed-Solomon decoder
+
+    https://github.com/oresat/oresat-dxwifi-software
+
+    NOTES: Runs the `test_reed_solomon` program, only built with the 
+    `TestDebug` and `TestRel` configurations, which compares libdxwifi's error
+    correction against rscode on randomly corrupted codewords.
+'''
+
+import os
+import unittest
+import subprocess
+
+INSTALL_DIR = os.environ.get('DXWIFI_INSTALL_DIR', default='bin/TestDebug')
+
+TEST_RS = f'./{INSTALL_DIR}/test_reed_solomon'
+
+
+class TestReedSolomon(unittest.TestCase):
+
+    def testMatchesRscode(self):
+        '''Corrected codewords match rscode for random error patterns'''
+
+        for seed in range(4):
+            result = subprocess.run([TEST_RS, '25000', str(seed)], capture_output=True, text=True)
+            self.assertEqual(result.returncode, 0, result.stderr)
@@ -0,0 +1,251 @@
+/**
+ *  test_threadpool.c
+ *
+ *  DESCRIPTION: Randomized test of the libdxwifi thread pool. Random ranges
+ *  are split into nested task groups and parallel fors, from the main thread
+ *  and from threads outside the pool at the same time, and every item has to
+ *  run exactly once. Each round restarts the pool with a different number of
+ *  workers, including starts where a worker fails and the pool falls back to
+ *  the ones it has. Tasks spawned outside the pool go through the shared deque
+ *  at the end of the pool's deques, a round checks that workers take them
+ *  without the spawning thread ever waiting.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: usage is `test_threadpool [iterations] [seed]`. The program exits
+ *  with a non-zero status on the first mismatch.
+ *
+ */
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdbool.h>
+
+#include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/threadpool.h>
+
+
+// Largest range tested
+#define MAX_ITEMS 20000
+
+// Threads outside the pool spawning alongside the main thread
+#define NSPAWNERS 3
+
+// How long workers get to drain the shared deque
+#define DRAIN_TIMEOUT_MS 10000
+
+
+typedef struct {
+    uint32_t*   counts;     /* Times each item ran              */
+    size_t      leaf;       /* Ranges this short run directly   */
+} workload;
+
+
+// Part of a workload offset by base, parallel fors count items from 0
+typedef struct {
+    workload*   work;
+    size_t      base;
+} workload_slice;
+
+
+typedef struct {
+    workload    work;
+    size_t      nitems;
+    pthread_t   thread;
+} spawner;
+
+
+typedef struct {
+    int         workers;    /* Workers asked for                    */
+    int         failing;    /* Worker that fails to start, or -1    */
+    size_t      expected;   /* Workers the pool should end up with  */
+} pool_config;
+
+
+static void mark_items(workload* work, size_t begin, size_t end) {
+    for(size_t i = begin; i < end; ++i) {
+        __atomic_add_fetch(&work->counts[i], 1, __ATOMIC_RELAXED);
+    }
+}
+
+
+static void mark_slice(void* arg, size_t begin, size_t end) {
+    workload_slice* slice = (workload_slice*) arg;
+    mark_items(slice->work, slice->base + begin, slice->base + end);
+}
+
+
+// Splits a range in a few parts, each spawned in a group of its own nested in
+// the caller's task. Some ranges go through a parallel for instead
+static void run_range(void* arg, size_t begin, size_t end) {
+    workload* work = (workload*) arg;
+    size_t count = end - begin;
+
+    if(count <= work->leaf) {
+        mark_items(work, begin, end);
+        return;
+    }
+    if((begin ^ end) % 5 == 0) {
+        workload_slice slice = { .work = work, .base = begin };
+        dxwifi_parallel_for(count, work->leaf, mark_slice, &slice);
+        return;
+    }
+
+    size_t nparts = 2 + (begin + end) % 4;
+    size_t step   = (count + nparts - 1) / nparts;
+
+    dxwifi_task_group group;
+    dxwifi_task_group_init(&group);
+    for(size_t b = begin; b < end; b += step) {
+        dxwifi_task_group_spawn(&group, run_range, work, b, b + step < end ? b + step : end);
+    }
+    dxwifi_task_group_wait(&group);
+}
+
+
+static void* spawner_main(void* arg) {
+    spawner* s = (spawner*) arg;
+    run_range(&s->work, 0, s->nitems);
+    return NULL;
+}
+
+
+static bool check_counts(const uint32_t* counts, size_t nitems, const char* what, unsigned it) {
+    for(size_t i = 0; i < nitems; ++i) {
+        if(counts[i] != 1) {
+            fprintf(stderr, "Mismatch: %s, iteration=%u, items=%zu, item %zu ran %u times\n", what, it, nitems, i, counts[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Random ranges split from the main thread and the spawners all at once
+static bool test_nested(unsigned it) {
+    spawner spawners[NSPAWNERS + 1];
+
+    for(size_t i = 0; i <= NSPAWNERS; ++i) {
+        spawners[i].nitems      = 1 + rand() % MAX_ITEMS;
+        spawners[i].work.leaf   = 1 + rand() % 64;
+        spawners[i].work.counts = calloc(spawners[i].nitems, sizeof(uint32_t));
+    }
+    for(size_t i = 1; i <= NSPAWNERS; ++i) {
+        pthread_create(&spawners[i].thread, NULL, spawner_main, &spawners[i]);
+    }
+    spawner_main(&spawners[0]);
+
+    bool passed = true;
+    for(size_t i = 0; i <= NSPAWNERS; ++i) {
+        if(i > 0) {
+            pthread_join(spawners[i].thread, NULL);
+        }
+        passed = passed && check_counts(spawners[i].work.counts, spawners[i].nitems, i ? "spawner" : "main", it);
+        free(spawners[i].work.counts);
+    }
+    return passed;
+}
+
+
+// Workers have to take tasks off the shared deque while this thread sleeps.
+// Spawning past the deque's capacity runs the extra tasks inline
+static bool drain_shared_deque(size_t nworkers, unsigned batch) {
+    size_t nitems = 2 * DXWIFI_POOL_DEQUE_CAPACITY;
+
+    workload work = {
+        .counts = calloc(nitems, sizeof(uint32_t)),
+        .leaf   = 1
+    };
+
+    dxwifi_task_group group;
+    dxwifi_task_group_init(&group);
+    for(size_t i = 0; i < nitems; ++i) {
+        dxwifi_task_group_spawn(&group, run_range, &work, i, i + 1);
+    }
+
+    size_t done = 0;
+    struct timespec nap = { .tv_sec = 0, .tv_nsec = 1000000 };
+    for(unsigned ms = 0; ms < DRAIN_TIMEOUT_MS && done < nitems; ++ms) {
+        done = 0;
+        for(size_t i = 0; i < nitems; ++i) {
+            done += __atomic_load_n(&work.counts[i], __ATOMIC_RELAXED);
+        }
+        if(done < nitems) {
+            nanosleep(&nap, NULL);
+        }
+    }
+    dxwifi_task_group_wait(&group);
+
+    bool passed = check_counts(work.counts, nitems, "shared deque", batch);
+    if(passed && done < nitems) {
+        fprintf(stderr, "Shared deque not drained: workers=%zu, batch=%u, ran %zu/%zu\n", nworkers, batch, done, nitems);
+        passed = false;
+    }
+    free(work.counts);
+    return passed;
+}
+
+
+// A second batch once the first is drained, the workers must still be up
+static bool test_shared_deque(size_t nworkers) {
+    return drain_shared_deque(nworkers, 0) && drain_shared_deque(nworkers, 1);
+}
+
+
+int main(int argc, char** argv) {
+    unsigned iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 20;
+    unsigned seed       = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+
+    srand(seed);
+    set_log_level(DXWIFI_LOG_ALL_MODULES, DXWIFI_LOG_ERROR);
+
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t dflt_workers = ncpus > 1 ? ncpus - 1 : 0;
+    dflt_workers = dflt_workers > DXWIFI_POOL_MAX_WORKERS ? DXWIFI_POOL_MAX_WORKERS : dflt_workers;
+
+    // The pool starts on first use, the rounds after restart it
+    const pool_config configs[] = {
+        { DXWIFI_POOL_DFLT_WORKERS,     -1, dflt_workers            },
+        { 0,                            -1, 0                       },
+        { 1,                            -1, 1                       },
+        { 4,                            -1, 4                       },
+        { 4,                             2, 2                       },
+        { 4,                             0, 0                       },
+        { DXWIFI_POOL_MAX_WORKERS + 8,  -1, DXWIFI_POOL_MAX_WORKERS },
+        { 4,                            -1, 4                       },
+        { DXWIFI_POOL_DFLT_WORKERS,     -1, dflt_workers            },
+    };
+
+    for(size_t round = 0; round < sizeof(configs) / sizeof(configs[0]); ++round) {
+        const pool_config* config = &configs[round];
+
+        if(round > 0) {
+            dxwifi_pool_fail_worker_start(config->failing);
+            dxwifi_pool_set_workers(config->workers);
+        }
+        size_t nworkers = dxwifi_pool_workers();
+        if(nworkers != config->expected) {
+            fprintf(stderr, "Wrong worker count: round=%zu, asked=%d, failing=%d, got %zu, expected %zu\n",
+                round, config->workers, config->failing, nworkers, config->expected);
+            return 1;
+        }
+
+        if(nworkers > 0 && !test_shared_deque(nworkers)) {
+            return 1;
+        }
+        for(unsigned it = 0; it < iterations; ++it) {
+            if(!test_nested(it)) {
+                fprintf(stderr, "Failed with %zu workers, round %zu\n", nworkers, round);
+                return 1;
+            }
+        }
+    }
+    dxwifi_pool_fail_worker_start(-1);
+
+    printf("%u iterations passed in %zu pool configurations\n", iterations, sizeof(configs) / sizeof(configs[0]));
+    return 0;
+}
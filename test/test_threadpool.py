@@ -0,0 +1,29 @@
+'''
+    FILE: test_threadpool.py
+
+    DESCRIPTION: Stress test of the libdxwifi work-stealing thread pool
+
+    https://github.com/oresat/oresat-dxwifi-software
+
+    NOTES: Runs the `test_threadpool` program, only built with the `TestDebug`
+    and `TestRel` configurations, which runs nested task groups from inside
+    and outside the pool across pool restarts and failed worker starts.
+'''
+
+import os
+import unittest
+import subprocess
+
+INSTALL_DIR = os.environ.get('DXWIFI_INSTALL_DIR', default='bin/TestDebug')
+
+TEST_POOL = f'./{INSTALL_DIR}/test_threadpool'
+
+
+class TestThreadPool(unittest.TestCase):
+
+    def testEveryItemRunsOnce(self):
+        '''Nested tasks run every item exactly once for any worker count'''
+
+        for seed in range(4):
+            result = subprocess.run([TEST_POOL, '20', str(seed)], capture_output=True, text=True, timeout=300)
+            self.assertEqual(result.returncode, 0, result.stderr)
@@ -5,8 +5,9 @@
 
     https://github.com/oresat/oresat-dxwifi-software
 
-    NOTES: This test program runs the Tx/Rx programs in `offline` mode and 
-    only works with the `TestDebug` and `TestRel` configurations. 
+    NOTES: This test program runs the Tx/Rx programs in `offline` mode, or 
+    together over a virtual air interface, and only works with the `TestDebug` 
+    and `TestRel` configurations. 
 
     By default, it will assume the binaries are installed in `bin/TestDebug`. 
     If they are installed elsewhere please define the `DXWIFI_INSTALL_DIR` 
@@ -18,6 +19,10 @@
 '''
 
 import os
+import re
+import random
+import zlib
+import struct
 import signal
 import shutil
 import filecmp
@@ -27,6 +32,7 @@ from time import sleep
 from test.genbytes import genbytes
 
 FEC_SYMBOL_SIZE = 1103
+RS_LDPC_FRAME_SIZE = 1275
 
 INSTALL_DIR = os.environ.get('DXWIFI_INSTALL_DIR', default='bin/TestDebug')
 TEMP_DIR    = '__temp'
@@ -41,6 +47,9 @@ else:
     TX = f'./{INSTALL_DIR}/tx'
     RX = f'./{INSTALL_DIR}/rx'
 
+REPLAY = f'./{INSTALL_DIR}/replay'
+DECODE = f'./{INSTALL_DIR}/decode'
+
 
 class TestTxRx(unittest.TestCase):
 
@@ -154,6 +163,40 @@ class TestTxRx(unittest.TestCase):
         self.assertEqual(all(results), True)
 
 
+    def testBundledFiles(self):
+        '''Small files sent in bundles are each received under their own name'''
+
+        rng = random.Random(81)
+
+        src_dir = f'{TEMP_DIR}/src'
+        os.mkdir(src_dir)
+
+        # Sizes around the symbol size, and names of different lengths
+        test_files = {}
+        for i, size in enumerate([1, 37, 500, FEC_SYMBOL_SIZE - 1, FEC_SYMBOL_SIZE + 1, 2000]):
+            name = f'file_{i}' + 'x' * i + '.bin'
+            test_files[name] = bytes(rng.randrange(256) for _ in range(size))
+            with open(f'{src_dir}/{name}', 'wb') as f:
+                f.write(test_files[name])
+        paths = ' '.join(f'{src_dir}/{name}' for name in test_files)
+
+        # All of them in one bundle, then split over several smaller ones
+        for bundle_size in (65536, 2500):
+            with self.subTest(bundle_size=bundle_size):
+                rx_dir      = f'{TEMP_DIR}/rx_{bundle_size}'
+                tx_out      = f'{TEMP_DIR}/tx_{bundle_size}.raw'
+                tx_command  = f'{TX} {paths} -q --bundle-size {bundle_size} --bundle-age 60 --savefile {tx_out}'
+                rx_command  = f'{RX} {rx_dir} -q -c 1 -t 2 --prefix rx --extension bundle --savefile {tx_out}'
+
+                os.mkdir(rx_dir)
+                subprocess.run(tx_command.split()).check_returncode()
+                subprocess.run(rx_command.split()).check_returncode()
+
+                for name, data in test_files.items():
+                    with open(f'{rx_dir}/{name}', 'rb') as f:
+                        self.assertEqual(f.read(), data, name)
+
+
     def testDirectoryTransmission(self):
         '''Tx can send all files currently in a directory'''
 
@@ -328,6 +371,389 @@ class TestTxRx(unittest.TestCase):
 
         self.assertEqual(status, True)
 
+    def testInnerCodes(self):
+        '''Tx and Rx round trip objects with the weaker inner codes, with and without packet loss'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+
+        # Create a single test file
+        genbytes(test_file, 10, FEC_SYMBOL_SIZE)
+
+        for inner_code in ('crc', 'none'):
+            for packet_loss in (0, 0.1):
+                with self.subTest(inner_code=inner_code, packet_loss=packet_loss):
+                    tx_out      = f'{TEMP_DIR}/tx_{inner_code}_{packet_loss}.raw'
+                    rx_out      = f'{TEMP_DIR}/rx_{inner_code}_{packet_loss}.raw'
+
+                    tx_command  = f'{TX} {test_file} -q -i {inner_code} --packet-loss {packet_loss} --savefile {tx_out}'
+                    rx_command  = f'{RX} {rx_out} -q -t 2 --savefile {tx_out}'
+
+                    subprocess.run(tx_command.split()).check_returncode()
+                    subprocess.run(rx_command.split()).check_returncode()
+
+                    self.assertEqual(filecmp.cmp(test_file, rx_out), True)
+
+    def testAirInterface(self):
+        '''Two receivers capture a live transmission over a lossy virtual air interface'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        rx_outs     = [ f'{TEMP_DIR}/rx{i}.raw' for i in range(2) ]
+        air         = f'/dxwifi-test-{os.getpid()}'
+
+        # Seeded channels, both receivers lose frames the code can recover.
+        # Unseeded, a small object like this one now and then loses two
+        # frames the LDPC code can't do without
+        tx_command  = f'{TX} {test_file} -q --air={air} --channel loss=0.05,rate=20000,seed=3'
+        rx_commands = [
+            f'{RX} {rx_outs[0]} -q -t 2 --air={air}',
+            f'{RX} {rx_outs[1]} -q -t 2 --air={air} --channel fade=0.02:0.5,seed=13'
+        ]
+
+        # Create a single test file
+        genbytes(test_file, 10, FEC_SYMBOL_SIZE) # Create test file
+
+        # Receivers only hear frames sent after they attach
+        rx_procs = [ subprocess.Popen(command.split()) for command in rx_commands ]
+        sleep(0.5)
+
+        try:
+            # Transmit the test file while both receivers capture it
+            subprocess.run(tx_command.split()).check_returncode()
+
+            for proc in rx_procs:
+                self.assertEqual(proc.wait(timeout=10), 0)
+        finally:
+            if os.path.exists(f'/dev/shm{air}'):
+                os.remove(f'/dev/shm{air}')
+
+        # Verify both files match
+        for rx_out in rx_outs:
+            self.assertEqual(filecmp.cmp(test_file, rx_out), True)
+
+
+    def testReplay(self):
+        '''A recorded transmission is replayed onto a virtual air interface'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        tx_out      = f'{TEMP_DIR}/tx.raw'
+        rx_out      = f'{TEMP_DIR}/rx.raw'
+        air         = f'/dxwifi-test-{os.getpid()}'
+
+        tx_command      = f'{TX} {test_file} -q --savefile {tx_out}'
+        replay_command  = f'{REPLAY} {tx_out} -q --air {air} --speed 4 --settle 0'
+        rx_command      = f'{RX} {rx_out} -q -t 2 --air={air}'
+
+        # Record the transmission
+        genbytes(test_file, 10, FEC_SYMBOL_SIZE)
+        subprocess.run(tx_command.split()).check_returncode()
+
+        rx_proc = subprocess.Popen(rx_command.split())
+        sleep(0.5)
+
+        try:
+            subprocess.run(replay_command.split()).check_returncode()
+            self.assertEqual(rx_proc.wait(timeout=10), 0)
+        finally:
+            if os.path.exists(f'/dev/shm{air}'):
+                os.remove(f'/dev/shm{air}')
+
+        self.assertEqual(filecmp.cmp(test_file, rx_out), True)
+
+
+    def testDecodeBudgetDefersBlock(self):
+        '''A block that needs ML decoding past the decode budget is deferred and decodes later'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        tx_out      = f'{TEMP_DIR}/tx.raw'
+        rx_out      = f'{TEMP_DIR}/rx.raw'
+        decode_out  = f'{TEMP_DIR}/decode.raw'
+
+        # At this loss iterative decoding stalls and the block needs ML decoding
+        tx_command      = f'{TX} {test_file} -q -c 0.5 --packet-loss 0.45 --savefile {tx_out}'
+        rx_command      = f'{RX} {rx_out} -q -t 2 --decode-budget 0.000001 --savefile {tx_out}'
+        decode_command  = f'{DECODE} {rx_out}.raw -q -o {decode_out}'
+
+        genbytes(test_file, 200, FEC_SYMBOL_SIZE)
+        subprocess.run(tx_command.split()).check_returncode()
+
+        # No time is left for ML decoding, so rx keeps the capture for later
+        subprocess.run(rx_command.split()).check_returncode()
+        self.assertEqual(os.path.exists(f'{rx_out}.raw'), True)
+
+        # Without the budget the kept capture decodes
+        subprocess.run(decode_command.split()).check_returncode()
+        self.assertEqual(filecmp.cmp(test_file, decode_out), True)
+
+
+    def testCompressionRoundTrip(self):
+        '''Objects compressed by Tx with each available codec are restored by Rx'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        genbytes(test_file, 50, FEC_SYMBOL_SIZE)
+
+        sent_sizes = {}
+        for codec in ('none', 'lz4', 'zstd'):
+            with self.subTest(codec=codec):
+                tx_out      = f'{TEMP_DIR}/tx_{codec}.raw'
+                rx_out      = f'{TEMP_DIR}/rx_{codec}.raw'
+                tx_command  = f'{TX} {test_file} -q --compress {codec} --savefile {tx_out}'
+                rx_command  = f'{RX} {rx_out} -q -t 2 --savefile {tx_out}'
+
+                # Codecs this build was configured without are refused up front
+                tx_proc = subprocess.run(tx_command.split(), stderr=subprocess.DEVNULL)
+                if codec != 'none' and tx_proc.returncode != 0:
+                    self.skipTest(f'{codec} compression is not supported by this build')
+                tx_proc.check_returncode()
+
+                subprocess.run(rx_command.split()).check_returncode()
+
+                self.assertEqual(filecmp.cmp(test_file, rx_out), True)
+                sent_sizes[codec] = os.path.getsize(tx_out)
+
+        # The test data is repetitive, so any codec sends fewer frames
+        for codec, size in sent_sizes.items():
+            if codec != 'none':
+                self.assertLess(size, sent_sizes['none'])
+
+
+    def testEncodeFailureExitStatus(self):
+        '''Tx reports a message it could not encode through its exit status'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        tx_out      = f'{TEMP_DIR}/tx.raw'
+
+        # The memory budget can't hold the symbol table, so encoding fails
+        tx_command  = f'{TX} {test_file} -q --mem-budget 1000 --savefile {tx_out}'
+
+        genbytes(test_file, 50, FEC_SYMBOL_SIZE)
+        tx_proc = subprocess.run(tx_command.split(), stderr=subprocess.DEVNULL)
+        self.assertNotEqual(tx_proc.returncode, 0)
+
+
+    def testUnequalErrorProtection(self):
+        '''The header of a file sent with UEP survives losses the rest of it can't'''
+
+        test_file   = f'{TEMP_DIR}/test.png'
+        tx_out      = f'{TEMP_DIR}/tx.raw'
+        rx_out      = f'{TEMP_DIR}/rx.png'
+
+        tx_command = f'{TX} {test_file} -q --uep --packet-loss 0.4 --savefile {tx_out}'
+        rx_command = f'{RX} {rx_out} -q -t 2 --savefile {tx_out}'
+
+        # A PNG whose header, every chunk before the first IDAT, spans a few symbols
+        def chunk(kind, data):
+            return struct.pack('>I', len(data)) + kind + data + struct.pack('>I', zlib.crc32(kind + data))
+
+        header = b'\x89PNG\r\n\x1a\n'
+        header += chunk(b'IHDR', struct.pack('>IIBBBBB', 640, 480, 8, 2, 0, 0, 0))
+        header += chunk(b'tEXt', b'Comment\x00' + bytes(ord('a') + i % 26 for i in range(3 * FEC_SYMBOL_SIZE)))
+        image = header + chunk(b'IDAT', bytes([0x55]) * (100 * FEC_SYMBOL_SIZE)) + chunk(b'IEND', b'')
+
+        with open(test_file, 'wb') as f:
+            f.write(image)
+
+        subprocess.run(tx_command.split()).check_returncode()
+        subprocess.run(rx_command.split()).check_returncode()
+
+        with open(rx_out, 'rb') as f:
+            received = f.read()
+
+        # Too much was lost for the whole file, what's missing is zero filled
+        self.assertEqual(len(received), len(image))
+        self.assertNotEqual(received, image)
+        self.assertIn(bytes(FEC_SYMBOL_SIZE), received)
+
+        # But the header was sent in its own block at a lower coderate
+        self.assertEqual(received[:len(header)], header)
+
+
+    def testMergeCaptures(self):
+        '''Two captures too lossy to decode alone decode once merged'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        tx_out      = f'{TEMP_DIR}/tx.raw'
+        rx_out      = f'{TEMP_DIR}/rx.raw'
+        captures    = [ f'{TEMP_DIR}/pass{i}.raw' for i in range(2) ]
+        merged_out  = f'{TEMP_DIR}/merged.raw'
+
+        tx_command  = f'{TX} {test_file} -q --savefile {tx_out}'
+        rx_command  = f'{RX} {rx_out} -q -t 2 --keep-capture --savefile {tx_out}'
+
+        genbytes(test_file, 50, FEC_SYMBOL_SIZE)
+        subprocess.run(tx_command.split()).check_returncode()
+        subprocess.run(rx_command.split()).check_returncode()
+
+        # Each pass misses a different 40% of the frames, more than the code can recover
+        with open(f'{rx_out}.raw', 'rb') as f:
+            capture = f.read()
+        frames = [ capture[i:i + RS_LDPC_FRAME_SIZE] for i in range(0, len(capture), RS_LDPC_FRAME_SIZE) ]
+        for n, path in enumerate(captures):
+            with open(path, 'wb') as f:
+                f.write(b''.join(frame for i, frame in enumerate(frames) if i % 5 not in (2 * n, 2 * n + 1)))
+
+        for n, path in enumerate(captures):
+            out = f'{TEMP_DIR}/pass{n}.out'
+            subprocess.run(f'{DECODE} {path} -q -o {out}'.split()).check_returncode()
+            self.assertEqual(filecmp.cmp(test_file, out), False)
+
+        # Together they hold every frame
+        subprocess.run(f'{DECODE} {" ".join(captures)} -q -o {merged_out}'.split()).check_returncode()
+        self.assertEqual(filecmp.cmp(test_file, merged_out), True)
+
+
+    def testFountainRetransmission(self):
+        '''Rx combines the fresh repair symbols of every fountain pass into one capture'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        tx_out      = f'{TEMP_DIR}/tx.raw'
+        rx_out      = f'{TEMP_DIR}/rx.raw'
+
+        # Half of every pass is lost, no single pass holds K frames
+        tx_command  = f'{TX} {test_file} -q --fountain --retransmit 2 --packet-loss 0.5 --savefile {tx_out}'
+        rx_command  = f'{RX} {rx_out} -q -t 2 --savefile {tx_out}'
+
+        genbytes(test_file, 50, FEC_SYMBOL_SIZE)
+        subprocess.run(tx_command.split()).check_returncode()
+        subprocess.run(rx_command.split()).check_returncode()
+
+        self.assertEqual(filecmp.cmp(test_file, rx_out), True)
+
+
+    def testFountainNotMerged(self):
+        '''Fountain coded objects are refused by the archive and the merger with an error'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        tx_out      = f'{TEMP_DIR}/tx.raw'
+        rx_out      = f'{TEMP_DIR}/rx.raw'
+        archive     = f'{TEMP_DIR}/frames.archive'
+        merged_out  = f'{TEMP_DIR}/merged.raw'
+
+        tx_command  = f'{TX} {test_file} -q --fountain --savefile {tx_out}'
+        rx_command  = f'{RX} {rx_out} -t 2 --keep-capture --archive {archive} --savefile {tx_out}'
+        dec_command = f'{DECODE} {rx_out}.raw {rx_out}.raw -o {merged_out}'
+
+        genbytes(test_file, 50, FEC_SYMBOL_SIZE)
+        subprocess.run(tx_command.split()).check_returncode()
+
+        # The object itself is still received
+        rx_proc = subprocess.run(rx_command.split(), capture_output=True, text=True)
+        rx_proc.check_returncode()
+        self.assertEqual(filecmp.cmp(test_file, rx_out), True)
+        self.assertIn('fountain coded and can\'t be merged', rx_proc.stderr)
+
+        dec_proc = subprocess.run(dec_command.split(), capture_output=True, text=True)
+        dec_proc.check_returncode()
+        self.assertIn('fountain coded frames', dec_proc.stderr)
+        self.assertEqual(os.path.exists(merged_out), False)
+
+
+    def testArchiveLookup(self):
+        '''Objects archived by Rx are listed and decoded one at a time by their id'''
+
+        test_files  = [ f'{TEMP_DIR}/test_{x}.raw' for x in range(2) ]
+        tx_out      = f'{TEMP_DIR}/tx.raw'
+        archive     = f'{TEMP_DIR}/frames.archive'
+
+        tx_command      = f'{TX} {" ".join(test_files)} -q --savefile {tx_out}'
+        rx_command      = f'{RX} {TEMP_DIR} -q -c 1 -t 2 --prefix rx --extension raw --archive {archive} --savefile {tx_out}'
+        list_command    = f'{DECODE} {archive} -q --list'
+
+        # Files of different sizes, so each object can be told apart
+        for i, file in enumerate(test_files):
+            genbytes(file, 10 * (i + 1), FEC_SYMBOL_SIZE)
+
+        subprocess.run(tx_command.split()).check_returncode()
+        subprocess.run(rx_command.split()).check_returncode()
+
+        # Every frame made it, so each object has as many distinct ESIs as frames
+        listing = subprocess.run(list_command.split(), stdout=subprocess.PIPE, text=True, check=True).stdout
+        objects = re.findall(r'object (\d+)\s+frames: (\d+)\s+distinct ESIs: (\d+)', listing)
+        self.assertEqual(len(objects), len(test_files))
+        for _, frames, distinct in objects:
+            self.assertEqual(frames, distinct)
+
+        # Only the indexed frames of the object asked for are decoded
+        decoded = []
+        for object_id, _, _ in objects:
+            out = f'{TEMP_DIR}/object_{object_id}.out'
+            subprocess.run(f'{DECODE} {archive} -q -i {object_id} -o {out}'.split()).check_returncode()
+            match = next((file for file in test_files if filecmp.cmp(file, out)), None)
+            self.assertIsNotNone(match)
+            decoded.append(match)
+
+        self.assertEqual(sorted(decoded), sorted(test_files))
+
+
+    def testDecodabilityEstimate(self):
+        '''The live decodability estimate Rx exports agrees with the decode'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        genbytes(test_file, 50, FEC_SYMBOL_SIZE)
+
+        def read_metrics(path):
+            with open(path) as f:
+                return { name: int(value) for name, value in re.findall(r'^(\w+(?:{[^}]*})?) (-?\d+)$', f.read(), re.MULTILINE) }
+
+        for loss, decodes in ((0.1, True), (0.6, False)):
+            with self.subTest(loss=loss):
+                tx_out      = f'{TEMP_DIR}/tx_{loss}.raw'
+                rx_out      = f'{TEMP_DIR}/rx_{loss}.raw'
+                metrics     = f'{TEMP_DIR}/rx_{loss}.prom'
+                tx_command  = f'{TX} {test_file} -q --packet-loss {loss} --savefile {tx_out}'
+                rx_command  = f'{RX} {rx_out} -q -t 2 --metrics {metrics} --savefile {tx_out}'
+
+                subprocess.run(tx_command.split()).check_returncode()
+                subprocess.run(rx_command.split()).check_returncode()
+
+                values = read_metrics(metrics)
+                self.assertEqual(filecmp.cmp(test_file, rx_out), decodes)
+                if decodes:
+                    # Likely to decode, if iterative decoding didn't rebuild every source symbol already
+                    self.assertGreaterEqual(values['dxwifi_rx_decodability'], 1)
+                    self.assertEqual(values['dxwifi_rx_rank_deficit'], 0)
+                    self.assertGreaterEqual(
+                        values['dxwifi_rx_symbols_received{kind="source"}'] + values['dxwifi_rx_symbols_received{kind="repair"}'],
+                        values['dxwifi_rx_symbols_total{kind="source"}']
+                    )
+                else:
+                    self.assertEqual(values['dxwifi_rx_decodability'], 0)
+                    self.assertGreater(values['dxwifi_rx_rank_deficit'], 0)
+
+
+    def testDecodeSymbolTable(self):
+        '''Decode indexes a capture's symbols by ESI, whatever their order and duplicates'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        tx_out      = f'{TEMP_DIR}/tx.raw'
+        rx_out      = f'{TEMP_DIR}/rx.raw'
+
+        tx_command  = f'{TX} {test_file} -q --savefile {tx_out}'
+        rx_command  = f'{RX} {rx_out} -q -t 2 --keep-capture --savefile {tx_out}'
+
+        genbytes(test_file, 50, FEC_SYMBOL_SIZE)
+        subprocess.run(tx_command.split()).check_returncode()
+        subprocess.run(rx_command.split()).check_returncode()
+
+        with open(f'{rx_out}.raw', 'rb') as f:
+            capture = f.read()
+        frames = [ capture[i:i + RS_LDPC_FRAME_SIZE] for i in range(0, len(capture), RS_LDPC_FRAME_SIZE) ]
+
+        # A tenth of the frames lost and a quarter of the rest repeated, all out of order
+        rng = random.Random(1621981756)
+        kept = rng.sample(frames, len(frames) * 9 // 10)
+        shuffled = kept + rng.sample(kept, len(kept) // 4)
+        rng.shuffle(shuffled)
+
+        for name, capture_frames in (('reversed', frames[::-1]), ('shuffled', shuffled)):
+            with self.subTest(capture=name):
+                path = f'{TEMP_DIR}/{name}.raw'
+                out  = f'{TEMP_DIR}/{name}.out'
+                with open(path, 'wb') as f:
+                    f.write(b''.join(capture_frames))
+
+                subprocess.run(f'{DECODE} {path} -q -o {out}'.split()).check_returncode()
+                self.assertEqual(filecmp.cmp(test_file, out), True)
+
 
 if __name__ == '__main__':
     unittest.main()